@@ -113,19 +113,36 @@ void App::Load(Platform::String^ entryPoint)
 // This method is called after the window becomes active.
 void App::Run(void)
 {
+	// With the simulation and rendering on threads of their own, this one only waits for the window's events
+	if (m_main->IsDecoupled())
+	{
+		if (m_windowVisible)
+		{
+			m_main->StartLoops();
+		}
+
+		while (!m_windowClosed)
+		{
+			CoreWindow::GetForCurrentThread()->Dispatcher->ProcessEvents(CoreProcessEventsOption::ProcessOneAndAllPending);
+			m_main->SetInput(SendKeyboardButtons(), SendMousePos());
+		}
+
+		m_main->StopLoops();
+		return;
+	}
+
 	while (!m_windowClosed)
 	{
 		if (m_windowVisible)
 		{
 			CoreWindow::GetForCurrentThread()->Dispatcher->ProcessEvents(CoreProcessEventsOption::ProcessAllIfPresent);
 
-			m_main->GetKeyboardButtons(SendKeyboardButtons());
-			m_main->GetMousePos(SendMousePos());
+			m_main->SetInput(SendKeyboardButtons(), SendMousePos());
 			m_main->Update();
 
 			if (m_main->Render())
 			{
-				m_deviceResources->Present();
+				m_main->Present();
 			}
 		}
 		else
@@ -158,6 +175,10 @@ void App::OnSuspending(Platform::Object^ sender, SuspendingEventArgs^ args)
 	// the app will be forced to exit.
 	SuspendingDeferral^ deferral = args->SuspendingOperation->GetDeferral();
 
+	// Nothing renders while the app is suspended, which may be the last the app hears before it's closed
+	m_main->StopLoops();
+	m_main->ExportFrameStats();
+
 	create_task([this, deferral]()
 	{
         m_deviceResources->Trim();
@@ -175,12 +196,20 @@ void App::OnResuming(Platform::Object^ sender, Platform::Object^ args)
 	// does not occur if the app was previously terminated.
 
 	// Insert your code here.
+
+	// The loops were stopped when the app was suspended
+	if (m_windowVisible)
+	{
+		m_main->StartLoops();
+	}
 }
 
-// Window event handlers.
+// Window event handlers. The render thread may be drawing while the UI thread handles them, so the device
+// resources only change with the render thread's lock held.
 
 void App::OnWindowSizeChanged(CoreWindow^ sender, WindowSizeChangedEventArgs^ args)
 {
+	critical_section::scoped_lock lock(m_main->GetCriticalSection());
 	m_deviceResources->SetLogicalSize(Size(sender->Bounds.Width, sender->Bounds.Height));
 	m_main->CreateWindowSizeDependentResources();
 }
@@ -188,6 +217,16 @@ void App::OnWindowSizeChanged(CoreWindow^ sender, WindowSizeChangedEventArgs^ ar
 void App::OnVisibilityChanged(CoreWindow^ sender, VisibilityChangedEventArgs^ args)
 {
 	m_windowVisible = args->Visible;
+
+	// Nothing is simulated or drawn while the window is hidden
+	if (m_windowVisible)
+	{
+		m_main->StartLoops();
+	}
+	else
+	{
+		m_main->StopLoops();
+	}
 }
 
 void App::OnWindowClosed(CoreWindow^ sender, CoreWindowEventArgs^ args)
@@ -203,18 +242,21 @@ void App::OnDpiChanged(DisplayInformation^ sender, Object^ args)
 	// if it is being scaled for high resolution devices. Once the DPI is set on DeviceResources,
 	// you should always retrieve it using the GetDpi method.
 	// See DeviceResources.cpp for more details.
+	critical_section::scoped_lock lock(m_main->GetCriticalSection());
 	m_deviceResources->SetDpi(sender->LogicalDpi);
 	m_main->CreateWindowSizeDependentResources();
 }
 
 void App::OnOrientationChanged(DisplayInformation^ sender, Object^ args)
 {
+	critical_section::scoped_lock lock(m_main->GetCriticalSection());
 	m_deviceResources->SetCurrentOrientation(sender->CurrentOrientation);
 	m_main->CreateWindowSizeDependentResources();
 }
 
 void App::OnDisplayContentsInvalidated(DisplayInformation^ sender, Object^ args)
 {
+	critical_section::scoped_lock lock(m_main->GetCriticalSection());
 	m_deviceResources->ValidateDevice();
 }
 
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Assets shared by everything that uses them, under a key naming their content: the file they come from and
+// whatever settings change what's made of it. Handles are shared_ptrs and the cache only keeps weak ones, so
+// an asset lives for as long as anything holds a handle and is loaded again after the last one lets go.
+// Requests for an asset that is still loading wait for that load instead of starting another one.
+// Safe to use from several threads at once.
+template <typename T>
+class AssetCache
+{
+public:
+	typedef std::shared_ptr<T> Handle;
+
+	AssetCache(void) : m_generation(0) {}
+
+	AssetCache(const AssetCache &) = delete;
+	AssetCache &operator=(const AssetCache &) = delete;
+
+	// The asset cached under key, or else what load() returns. load runs on the calling thread without the
+	// cache locked, and returns null for an asset that can't be loaded, which isn't cached so the next
+	// request tries again. What load throws is thrown to every request that waited for it as well.
+	template <typename Load>
+	Handle Acquire(const std::string &key, Load load)
+	{
+		std::promise<Handle> loaded;
+		std::shared_future<Handle> pending;
+		uint64_t generation;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			generation = m_generation;
+			Entry &entry = m_entries[key];
+			if (Handle asset = entry.asset.lock())
+				return asset;
+
+			if (entry.pending.valid())
+				pending = entry.pending;
+			else
+				entry.pending = loaded.get_future().share();
+		}
+
+		if (pending.valid())
+			return pending.get();
+
+		Handle asset;
+		try
+		{
+			asset = load();
+		}
+		catch (...)
+		{
+			Finish(key, nullptr, generation);
+			loaded.set_exception(std::current_exception());
+			throw;
+		}
+
+		Finish(key, asset, generation);
+		loaded.set_value(asset);
+		return asset;
+	}
+
+	// The asset cached under key, null if there is none or it's still loading. Never loads anything.
+	Handle Find(const std::string &key) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		typename std::map<std::string, Entry>::const_iterator found = m_entries.find(key);
+		return (found != m_entries.end()) ? found->second.asset.lock() : nullptr;
+	}
+
+	// Forgets every asset, so the next request for any of them loads it again. Handles already given out stay
+	// valid. Loads still running are handed to the requests that waited for them but never cached, as they may
+	// have been made from whatever the cache was cleared for (a lost device, say).
+	void Clear(void)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries.clear();
+		++m_generation;
+	}
+
+	// Assets cached and still in use
+	size_t GetCount(void) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t count = 0;
+		for (const std::pair<const std::string, Entry> &entry : m_entries)
+		{
+			if (!entry.second.asset.expired())
+				++count;
+		}
+		return count;
+	}
+
+private:
+	struct Entry
+	{
+		std::weak_ptr<T>			asset;
+		std::shared_future<Handle>	pending;	// Valid while the asset is loading
+	};
+
+	// Caches what a load started in generation made of the asset, unless the cache has been cleared since,
+	// and drops the entries of assets no one uses anymore
+	void Finish(const std::string &key, const Handle &asset, uint64_t generation)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (generation != m_generation)
+			return;
+
+		m_entries[key].asset = asset;
+		m_entries[key].pending = std::shared_future<Handle>();
+
+		for (typename std::map<std::string, Entry>::iterator entry = m_entries.begin(); entry != m_entries.end();)
+		{
+			if (entry->second.asset.expired() && !entry->second.pending.valid())
+				entry = m_entries.erase(entry);
+			else
+				++entry;
+		}
+	}
+
+	mutable std::mutex			m_mutex;
+	std::map<std::string, Entry>	m_entries;
+	uint64_t					m_generation;	// Clear calls so far
+};
@@ -0,0 +1,630 @@
+#include "pch.h"
+#include "AssetPack.h"
+#include "LzCompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace
+{
+	// Blocks each thread of an AssetPackStream decompresses per batch
+	const uint32_t streamBlocksPerThread = 2;
+
+	// Paths are compared as lower case with forward slashes
+	char pathChar(char c)
+	{
+		return (c == '\\') ? '/' : static_cast<char>(tolower(static_cast<unsigned char>(c)));
+	}
+
+	const char *skipCurrentFolder(const char *path)
+	{
+		while ((path[0] == '.') && (path[1] == '/' || path[1] == '\\'))
+			path += 2;
+		return path;
+	}
+
+	unsigned int resolveThreadCount(unsigned int threadCount, size_t work)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		return static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(threadCount, work)));
+	}
+
+	// Runs work(0) .. work(count - 1) with one thread each, work(0) on the calling thread
+	template<typename TWork>
+	void runParallel(unsigned int count, const TWork &work)
+	{
+		std::vector<std::thread> threads;
+		threads.reserve(count);
+
+		for (unsigned int i = 1; i < count; ++i)
+			threads.emplace_back(work, i);
+
+		work(0);
+
+		for (std::thread &thread : threads)
+			thread.join();
+	}
+
+	size_t blockCountOf(uint64_t size)
+	{
+		return static_cast<size_t>((size + ASSET_PACK_BLOCK_SIZE - 1) / ASSET_PACK_BLOCK_SIZE);
+	}
+
+	size_t blockSizeOf(uint64_t size, size_t block)
+	{
+		return static_cast<size_t>(std::min<uint64_t>(ASSET_PACK_BLOCK_SIZE, size - static_cast<uint64_t>(block) * ASSET_PACK_BLOCK_SIZE));
+	}
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Replaces target with source, even when target already exists
+	bool replaceFile(const std::string &source, const std::string &target)
+	{
+#if defined(_WIN32)
+		wchar_t wideSource[MAX_PATH], wideTarget[MAX_PATH];
+		if (MultiByteToWideChar(CP_UTF8, 0, source.c_str(), -1, wideSource, MAX_PATH) == 0 ||
+			MultiByteToWideChar(CP_UTF8, 0, target.c_str(), -1, wideTarget, MAX_PATH) == 0)
+			return false;
+
+		return MoveFileExW(wideSource, wideTarget, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return rename(source.c_str(), target.c_str()) == 0;
+#endif
+	}
+
+	bool writeZeros(FILE *file, uint64_t count)
+	{
+		static const uint8_t zeros[4096] = {};
+		while (count > 0)
+		{
+			const size_t chunk = static_cast<size_t>(std::min<uint64_t>(count, sizeof(zeros)));
+			if (fwrite(zeros, 1, chunk, file) != chunk)
+				return false;
+			count -= chunk;
+		}
+		return true;
+	}
+
+	template<typename T>
+	bool writeArray(FILE *file, const std::vector<T> &values)
+	{
+		return values.empty() || fwrite(values.data(), sizeof(T), values.size(), file) == values.size();
+	}
+
+	struct MountedPacks
+	{
+		std::mutex									mutex;
+		std::vector<std::shared_ptr<const AssetPack>>	packs;
+	};
+
+	MountedPacks &mountedPacks(void)
+	{
+		static MountedPacks mounted;
+		return mounted;
+	}
+}
+
+uint64_t assetPathHash(const char *path)
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (const char *c = skipCurrentFolder(path); *c; ++c)
+	{
+		hash ^= static_cast<uint8_t>(pathChar(*c));
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool assetPathEquals(const char *a, const char *b)
+{
+	a = skipCurrentFolder(a);
+	b = skipCurrentFolder(b);
+
+	for (; *a && *b; ++a, ++b)
+	{
+		if (pathChar(*a) != pathChar(*b))
+			return false;
+	}
+
+	return *a == *b;
+}
+
+AssetPack::AssetPack(void) :
+	m_header(nullptr),
+	m_entries(nullptr),
+	m_slots(nullptr),
+	m_blockEnds(nullptr),
+	m_names(nullptr)
+{
+}
+
+bool AssetPack::Open(const char *path)
+{
+	Close();
+
+	if (!m_file.OpenFile(path) || m_file.GetSize() < sizeof(AssetPackHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const uint8_t *data = reinterpret_cast<const uint8_t *>(m_file.GetData());
+	const uint64_t size = m_file.GetSize();
+	const AssetPackHeader &header = *reinterpret_cast<const AssetPackHeader *>(data);
+
+	// Every section has to be inside the file and aligned for its type
+	const bool valid = header.magic == ASSET_PACK_MAGIC && header.version == ASSET_PACK_VERSION && header.headerSize == sizeof(AssetPackHeader) &&
+		header.fileSize == size && header.slotCount >= 2 && (header.slotCount & (header.slotCount - 1)) == 0 && header.slotCount / 2 >= header.entryCount &&
+		header.entryOffset % 8 == 0 && header.slotOffset % 4 == 0 && header.blockOffset % 4 == 0 &&
+		header.entryOffset <= size && (size - header.entryOffset) / sizeof(AssetPackEntry) >= header.entryCount &&
+		header.slotOffset <= size && (size - header.slotOffset) / sizeof(uint32_t) >= header.slotCount &&
+		header.blockOffset <= size && (size - header.blockOffset) / sizeof(uint32_t) >= header.blockCount &&
+		header.nameOffset <= size;
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+
+	const AssetPackEntry *entries = reinterpret_cast<const AssetPackEntry *>(data + header.entryOffset);
+	const uint32_t *slots = reinterpret_cast<const uint32_t *>(data + header.slotOffset);
+	const uint64_t namesSize = size - header.nameOffset;
+	const char *names = reinterpret_cast<const char *>(data + header.nameOffset);
+
+	for (uint32_t i = 0; i < header.entryCount; ++i)
+	{
+		const AssetPackEntry &entry = entries[i];
+		const bool entryValid = entry.offset <= size && entry.storedSize <= size - entry.offset &&
+			entry.nameOffset < namesSize && entry.nameLength < namesSize - entry.nameOffset && names[entry.nameOffset + entry.nameLength] == 0 &&
+			((entry.compression == ASSET_PACK_STORED && entry.storedSize == entry.size) ||
+			(entry.compression == ASSET_PACK_LZ && entry.blockStart <= header.blockCount && blockCountOf(entry.size) <= header.blockCount - entry.blockStart));
+		if (!entryValid)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < header.slotCount; ++i)
+	{
+		if (slots[i] > header.entryCount)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	m_header = &header;
+	m_entries = entries;
+	m_slots = slots;
+	m_blockEnds = reinterpret_cast<const uint32_t *>(data + header.blockOffset);
+	m_names = names;
+	return true;
+}
+
+void AssetPack::Close(void)
+{
+	m_file.Close();
+	m_header = nullptr;
+	m_entries = nullptr;
+	m_slots = nullptr;
+	m_blockEnds = nullptr;
+	m_names = nullptr;
+}
+
+const char *AssetPack::GetName(const AssetPackEntry &entry) const
+{
+	return m_names + entry.nameOffset;
+}
+
+const AssetPackEntry *AssetPack::Find(const char *path) const
+{
+	if (!m_header)
+		return nullptr;
+
+	const uint64_t hash = assetPathHash(path);
+	const uint32_t mask = m_header->slotCount - 1;
+
+	// Open addressing, so the first empty slot ends the search
+	uint32_t slot = static_cast<uint32_t>(hash) & mask;
+	for (uint32_t probe = 0; probe < m_header->slotCount; ++probe, slot = (slot + 1) & mask)
+	{
+		if (m_slots[slot] == 0)
+			return nullptr;
+
+		const AssetPackEntry &entry = m_entries[m_slots[slot] - 1];
+		if (entry.hash == hash && assetPathEquals(GetName(entry), path))
+			return &entry;
+	}
+
+	return nullptr;
+}
+
+const uint8_t *AssetPack::GetStoredData(const AssetPackEntry &entry) const
+{
+	if (entry.compression != ASSET_PACK_STORED)
+		return nullptr;
+
+	return reinterpret_cast<const uint8_t *>(m_file.GetData()) + entry.offset;
+}
+
+uint32_t AssetPack::GetBlockCount(const AssetPackEntry &entry) const
+{
+	return (entry.compression == ASSET_PACK_LZ) ? static_cast<uint32_t>(blockCountOf(entry.size)) : 0;
+}
+
+bool AssetPack::ReadBlocks(const AssetPackEntry &entry, uint32_t firstBlock, uint32_t blockCount, uint8_t *out, unsigned int threadCount) const
+{
+	if (entry.compression != ASSET_PACK_LZ || firstBlock > GetBlockCount(entry) || blockCount > GetBlockCount(entry) - firstBlock)
+		return false;
+
+	const uint8_t *data = reinterpret_cast<const uint8_t *>(m_file.GetData()) + entry.offset;
+	const uint32_t *ends = m_blockEnds + entry.blockStart;
+
+	// Blocks don't depend on each other, so each thread takes a run of them
+	threadCount = resolveThreadCount(threadCount, blockCount);
+	std::atomic<bool> failed(false);
+
+	runParallel(threadCount, [&](unsigned int thread)
+	{
+		const uint32_t begin = firstBlock + static_cast<uint32_t>(static_cast<uint64_t>(blockCount) * thread / threadCount);
+		const uint32_t end = firstBlock + static_cast<uint32_t>(static_cast<uint64_t>(blockCount) * (thread + 1) / threadCount);
+
+		for (uint32_t block = begin; block < end && !failed; ++block)
+		{
+			const uint32_t start = block ? ends[block - 1] : 0;
+			const size_t blockSize = blockSizeOf(entry.size, block);
+			uint8_t *dest = out + static_cast<size_t>(block - firstBlock) * ASSET_PACK_BLOCK_SIZE;
+
+			if (ends[block] < start || ends[block] > entry.storedSize)
+			{
+				failed = true;
+				break;
+			}
+
+			const size_t storedSize = ends[block] - start;
+			if (storedSize == blockSize)
+				memcpy(dest, data + start, blockSize);
+			else if (!lzDecompress(data + start, storedSize, dest, blockSize))
+				failed = true;
+		}
+	});
+
+	return !failed;
+}
+
+bool AssetPack::Read(const AssetPackEntry &entry, uint8_t *out, unsigned int threadCount) const
+{
+	if (entry.compression == ASSET_PACK_STORED)
+	{
+		if (entry.size)
+			memcpy(out, GetStoredData(entry), static_cast<size_t>(entry.size));
+		return true;
+	}
+
+	return ReadBlocks(entry, 0, GetBlockCount(entry), out, threadCount);
+}
+
+AssetPackStream::AssetPackStream(const AssetPack &pack, const AssetPackEntry &entry, unsigned int threadCount) :
+	m_pack(pack),
+	m_entry(entry),
+	m_threadCount(0),
+	m_blockCount(pack.GetBlockCount(entry)),
+	m_batchBlocks(0),
+	m_current(1),
+	m_nextBlock(0),
+	m_pendingBlocks(0),
+	m_data(nullptr),
+	m_remaining(0),
+	m_remainingBlocks(0),
+	m_storedPosition(0),
+	m_failed(false)
+{
+	if (entry.compression == ASSET_PACK_STORED)
+		return;
+
+	m_threadCount = resolveThreadCount(threadCount, m_blockCount);
+	m_batchBlocks = std::min(m_blockCount, m_threadCount * streamBlocksPerThread);
+	m_buffers[0].resize(static_cast<size_t>(m_batchBlocks) * ASSET_PACK_BLOCK_SIZE);
+	m_buffers[1].resize(static_cast<size_t>(m_batchBlocks) * ASSET_PACK_BLOCK_SIZE);
+
+	StartBatch();
+}
+
+AssetPackStream::~AssetPackStream(void)
+{
+	if (m_pending.valid())
+		m_pending.wait();
+}
+
+void AssetPackStream::StartBatch(void)
+{
+	if (m_nextBlock >= m_blockCount)
+		return;
+
+	const uint32_t first = m_nextBlock;
+	const uint32_t count = std::min(m_batchBlocks, m_blockCount - m_nextBlock);
+	uint8_t *target = m_buffers[m_current ^ 1].data();
+
+	m_pendingBlocks = count;
+	m_pending = std::async(std::launch::async, [this, first, count, target]()
+	{
+		return m_pack.ReadBlocks(m_entry, first, count, target, m_threadCount);
+	});
+}
+
+bool AssetPackStream::Next(const uint8_t *&data, size_t &size)
+{
+	if (m_failed)
+		return false;
+
+	// Stored entries are already whole in the mapping
+	if (m_entry.compression == ASSET_PACK_STORED)
+	{
+		if (m_storedPosition >= m_entry.size)
+			return false;
+
+		data = m_pack.GetStoredData(m_entry);
+		size = static_cast<size_t>(m_entry.size);
+		m_storedPosition = m_entry.size;
+		return true;
+	}
+
+	if (m_remainingBlocks == 0)
+	{
+		if (!m_pending.valid())
+			return false;
+
+		if (!m_pending.get())
+		{
+			m_failed = true;
+			return false;
+		}
+
+		m_current ^= 1;
+		m_data = m_buffers[m_current].data();
+		m_remainingBlocks = m_pendingBlocks;
+		m_remaining = static_cast<size_t>(std::min<uint64_t>(m_entry.size - static_cast<uint64_t>(m_nextBlock) * ASSET_PACK_BLOCK_SIZE,
+			static_cast<uint64_t>(m_pendingBlocks) * ASSET_PACK_BLOCK_SIZE));
+
+		m_nextBlock += m_pendingBlocks;
+		StartBatch();
+	}
+
+	// The whole batch at once, the reader doesn't gain anything from smaller pieces
+	data = m_data;
+	size = m_remaining;
+	m_remainingBlocks = 0;
+	m_remaining = 0;
+	return true;
+}
+
+bool AssetPackBuilder::AddFile(const char *name, const char *path, bool compress)
+{
+	FileStamp stamp;
+	if (!getFileStamp(path, stamp))
+		return false;
+
+	for (const File &file : m_files)
+	{
+		if (assetPathEquals(file.name.c_str(), name))
+			return false;
+	}
+
+	File file;
+	file.name = name;
+	file.path = path;
+	file.compress = compress;
+	m_files.push_back(file);
+	return true;
+}
+
+bool AssetPackBuilder::Write(const char *path, unsigned int threadCount, std::string *error) const
+{
+	auto fail = [&](const std::string &reason)
+	{
+		if (error)
+			*error = reason;
+		return false;
+	};
+
+	if (m_files.size() >= 0x7fffffffu)
+		return fail("too many files");
+
+	const std::string temporary = std::string(path) + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file)
+		return fail("can't write " + temporary);
+
+	auto abandon = [&](const std::string &reason)
+	{
+		fclose(file);
+		remove(temporary.c_str());
+		return fail(reason);
+	};
+
+	AssetPackHeader header = {};
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+		return abandon("can't write " + temporary);
+	uint64_t position = sizeof(header);
+
+	std::vector<AssetPackEntry> entries;
+	std::vector<uint32_t> blockEnds;
+	std::string names;
+	entries.reserve(m_files.size());
+
+	for (const File &source : m_files)
+	{
+		MappedFile input;
+		FileStamp stamp;
+		if (!input.OpenFile(source.path.c_str()) || !getFileStamp(source.path.c_str(), stamp))
+			return abandon("can't read " + source.path);
+
+		const uint8_t *data = reinterpret_cast<const uint8_t *>(input.GetData());
+		const size_t size = input.GetSize();
+
+		AssetPackEntry entry = {};
+		entry.hash = assetPathHash(source.name.c_str());
+		entry.size = size;
+		entry.modifiedTime = stamp.modifiedTime;
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entry.nameLength = static_cast<uint32_t>(source.name.size());
+		entry.compression = ASSET_PACK_STORED;
+		entry.storedSize = size;
+
+		// Each block is compressed on its own, in parallel. Blocks that don't get smaller are kept as they are.
+		const size_t blockCount = blockCountOf(size);
+		const size_t bound = lzCompressBound(ASSET_PACK_BLOCK_SIZE);
+		std::vector<uint8_t> compressed;
+		std::vector<size_t> compressedSizes;
+		uint64_t compressedTotal = 0;
+
+		if (source.compress && blockCount > 0)
+		{
+			compressed.resize(blockCount * bound);
+			compressedSizes.resize(blockCount);
+
+			const unsigned int threads = resolveThreadCount(threadCount, blockCount);
+			runParallel(threads, [&](unsigned int thread)
+			{
+				for (size_t block = blockCount * thread / threads; block < blockCount * (thread + 1) / threads; ++block)
+				{
+					const size_t blockSize = blockSizeOf(size, block);
+					const size_t written = lzCompress(data + block * ASSET_PACK_BLOCK_SIZE, blockSize, compressed.data() + block * bound, bound);
+					compressedSizes[block] = (written == 0 || written >= blockSize) ? blockSize : written;
+				}
+			});
+
+			for (size_t block = 0; block < blockCount; ++block)
+				compressedTotal += compressedSizes[block];
+
+			// Stored entries are used in place, which is worth more than a small saving
+			if (compressedTotal <= size - size / 8 && compressedTotal < 0xffffffffu && blockEnds.size() + blockCount < 0xffffffffu)
+			{
+				entry.compression = ASSET_PACK_LZ;
+				entry.storedSize = compressedTotal;
+				entry.blockStart = static_cast<uint32_t>(blockEnds.size());
+			}
+		}
+
+		const uint64_t offset = alignUp(position, (entry.storedSize >= ASSET_PACK_LARGE_ALIGNMENT) ? ASSET_PACK_LARGE_ALIGNMENT : ASSET_PACK_SMALL_ALIGNMENT);
+		if (!writeZeros(file, offset - position))
+			return abandon("can't write " + temporary);
+		entry.offset = offset;
+
+		if (entry.compression == ASSET_PACK_STORED)
+		{
+			if (size && fwrite(data, 1, size, file) != size)
+				return abandon("can't write " + temporary);
+		}
+		else
+		{
+			uint32_t end = 0;
+			for (size_t block = 0; block < blockCount; ++block)
+			{
+				const size_t blockSize = blockSizeOf(size, block);
+				const bool stored = compressedSizes[block] == blockSize;
+				const uint8_t *blockData = stored ? data + block * ASSET_PACK_BLOCK_SIZE : compressed.data() + block * bound;
+				if (fwrite(blockData, 1, compressedSizes[block], file) != compressedSizes[block])
+					return abandon("can't write " + temporary);
+
+				end += static_cast<uint32_t>(compressedSizes[block]);
+				blockEnds.push_back(end);
+			}
+		}
+
+		position = offset + entry.storedSize;
+		names.append(source.name);
+		names.push_back('\0');
+		entries.push_back(entry);
+	}
+
+	// The table of contents follows the data
+	header.magic = ASSET_PACK_MAGIC;
+	header.version = ASSET_PACK_VERSION;
+	header.headerSize = sizeof(AssetPackHeader);
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	header.slotCount = 2;
+	while (header.slotCount / 2 < header.entryCount)
+		header.slotCount *= 2;
+	header.blockCount = static_cast<uint32_t>(blockEnds.size());
+
+	std::vector<uint32_t> slots(header.slotCount, 0);
+	for (uint32_t i = 0; i < header.entryCount; ++i)
+	{
+		uint32_t slot = static_cast<uint32_t>(entries[i].hash) & (header.slotCount - 1);
+		while (slots[slot] != 0)
+			slot = (slot + 1) & (header.slotCount - 1);
+		slots[slot] = i + 1;
+	}
+
+	header.entryOffset = alignUp(position, 8);
+	header.slotOffset = header.entryOffset + entries.size() * sizeof(AssetPackEntry);
+	header.blockOffset = header.slotOffset + slots.size() * sizeof(uint32_t);
+	header.nameOffset = header.blockOffset + blockEnds.size() * sizeof(uint32_t);
+	header.fileSize = header.nameOffset + names.size();
+
+	const bool written = writeZeros(file, header.entryOffset - position) && writeArray(file, entries) && writeArray(file, slots) &&
+		writeArray(file, blockEnds) && (names.empty() || fwrite(names.data(), 1, names.size(), file) == names.size()) &&
+		fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+	if (!written)
+		return abandon("can't write " + temporary);
+
+	if (fclose(file) != 0 || !replaceFile(temporary, path))
+	{
+		remove(temporary.c_str());
+		return fail(std::string("can't write ") + path);
+	}
+
+	return true;
+}
+
+bool mountAssetPack(const char *path)
+{
+	std::shared_ptr<AssetPack> pack = std::make_shared<AssetPack>();
+	if (!pack->Open(path))
+		return false;
+
+	MountedPacks &mounted = mountedPacks();
+	std::lock_guard<std::mutex> lock(mounted.mutex);
+	mounted.packs.push_back(pack);
+	return true;
+}
+
+void unmountAssetPacks(void)
+{
+	MountedPacks &mounted = mountedPacks();
+	std::lock_guard<std::mutex> lock(mounted.mutex);
+	mounted.packs.clear();
+}
+
+bool findMountedAsset(const char *path, std::shared_ptr<const AssetPack> &pack, const AssetPackEntry *&entry)
+{
+	MountedPacks &mounted = mountedPacks();
+	std::lock_guard<std::mutex> lock(mounted.mutex);
+
+	for (auto it = mounted.packs.rbegin(); it != mounted.packs.rend(); ++it)
+	{
+		if (const AssetPackEntry *found = (*it)->Find(path))
+		{
+			pack = *it;
+			entry = found;
+			return true;
+		}
+	}
+
+	return false;
+}
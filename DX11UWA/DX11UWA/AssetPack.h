@@ -0,0 +1,197 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+// .rpak files hold many assets in one file, so loading them costs one open and one mapping instead of one
+// each. The table of contents is read in place from the mapping: a hash table of the entries, looked up by
+// the path the asset had under the folder the pack was built from.
+//
+//   AssetPackHeader | entry data | AssetPackEntry[entryCount] | uint32_t slots[slotCount] |
+//   uint32_t blockEnds[blockCount] | names
+//
+// Entry data starts on a 4 KB boundary, or on a 64 KB one for entries of 64 KB or more, so the data of
+// every entry starts on its own page and large ones can be mapped on their own as well.
+//
+// Entries are either stored, and then used in place without a copy, or compressed with lzCompress (see
+// LzCompression.h) in independent blocks of ASSET_PACK_BLOCK_SIZE bytes, so they can be decompressed on
+// several threads at once or a block at a time. A block that didn't get smaller is stored as it is.
+//
+// Bump ASSET_PACK_VERSION whenever the layout or the meaning of a field changes.
+const uint32_t ASSET_PACK_MAGIC = 0x4b415052;	// "RPAK"
+const uint32_t ASSET_PACK_VERSION = 1;
+
+// Bytes of an entry each compressed block holds, once decompressed. The last block of an entry may hold less.
+const uint32_t ASSET_PACK_BLOCK_SIZE = 64 * 1024;
+
+const uint64_t ASSET_PACK_SMALL_ALIGNMENT = 4 * 1024;
+const uint64_t ASSET_PACK_LARGE_ALIGNMENT = 64 * 1024;
+
+enum AssetPackCompression
+{
+	ASSET_PACK_STORED = 0,
+	ASSET_PACK_LZ = 1
+};
+
+struct AssetPackHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	headerSize;
+	uint32_t	entryCount;
+	uint32_t	slotCount;		// A power of two, at least twice entryCount
+	uint32_t	blockCount;
+
+	// Byte offsets from the start of the file
+	uint64_t	entryOffset;
+	uint64_t	slotOffset;
+	uint64_t	blockOffset;
+	uint64_t	nameOffset;
+	uint64_t	fileSize;
+};
+
+struct AssetPackEntry
+{
+	uint64_t	hash;			// assetPathHash of the name
+	uint64_t	offset;			// Of the data, from the start of the file
+	uint64_t	storedSize;		// Bytes of data in the pack
+	uint64_t	size;			// Bytes once decompressed
+	uint64_t	modifiedTime;	// Of the file it was packed from, as getFileStamp returned it
+	uint32_t	nameOffset;		// From nameOffset of the header, zero terminated
+	uint32_t	nameLength;
+	uint32_t	compression;	// AssetPackCompression
+	uint32_t	blockStart;		// Its first end in the block table, only for compressed entries
+};
+
+static_assert(sizeof(AssetPackHeader) == 64, "AssetPackHeader is part of the file format");
+static_assert(sizeof(AssetPackEntry) == 56, "AssetPackEntry is part of the file format");
+
+// Hash of a path as the table of contents looks it up: backslashes count as slashes, case doesn't count
+// and a leading "./" is ignored, so "Assets\Models\A.obj" finds "./assets/models/a.obj".
+uint64_t assetPathHash(const char *path);
+
+// Whether two paths are the same under the rules of assetPathHash
+bool assetPathEquals(const char *a, const char *b);
+
+// A mapped .rpak file
+class AssetPack
+{
+public:
+	AssetPack(void);
+
+	AssetPack(const AssetPack &) = delete;
+	AssetPack &operator=(const AssetPack &) = delete;
+
+	// Maps the pack at path, always from disk. Returns false if it can't be read or isn't a valid pack of this version.
+	bool Open(const char *path);
+	void Close(void);
+
+	bool IsOpen(void) const { return m_header != nullptr; }
+
+	uint32_t GetEntryCount(void) const { return m_header ? m_header->entryCount : 0; }
+	const AssetPackEntry &GetEntry(uint32_t index) const { return m_entries[index]; }
+	const char *GetName(const AssetPackEntry &entry) const;
+
+	// The entry with the name path, or null if there is none
+	const AssetPackEntry *Find(const char *path) const;
+
+	// The data of a stored entry, in place in the mapping. Null for compressed entries.
+	const uint8_t *GetStoredData(const AssetPackEntry &entry) const;
+
+	// Blocks the entry is compressed in, 0 for stored entries
+	uint32_t GetBlockCount(const AssetPackEntry &entry) const;
+
+	// Decompresses blockCount blocks of a compressed entry from firstBlock on into out, on threadCount threads
+	// (0 uses every core). Returns false if the data is corrupt.
+	bool ReadBlocks(const AssetPackEntry &entry, uint32_t firstBlock, uint32_t blockCount, uint8_t *out, unsigned int threadCount = 0) const;
+
+	// Copies or decompresses the whole entry into out, which has room for entry.size bytes
+	bool Read(const AssetPackEntry &entry, uint8_t *out, unsigned int threadCount = 0) const;
+
+private:
+	MappedFile				m_file;
+	const AssetPackHeader	*m_header;
+	const AssetPackEntry	*m_entries;
+	const uint32_t			*m_slots;
+	const uint32_t			*m_blockEnds;
+	const char				*m_names;
+};
+
+// Reads an entry front to back a piece at a time. Compressed entries are decompressed in batches of blocks
+// on threadCount threads, the next batch while the reader works on the current one, so a large entry never
+// has to be decompressed in one piece. Stored entries are handed out in place.
+class AssetPackStream
+{
+public:
+	AssetPackStream(const AssetPack &pack, const AssetPackEntry &entry, unsigned int threadCount = 0);
+	~AssetPackStream(void);
+
+	AssetPackStream(const AssetPackStream &) = delete;
+	AssetPackStream &operator=(const AssetPackStream &) = delete;
+
+	// The next piece of the entry, valid until the next call. Returns false at the end, or if the data is corrupt.
+	bool Next(const uint8_t *&data, size_t &size);
+
+	bool Failed(void) const { return m_failed; }
+
+private:
+	// Starts decompressing the batch from m_nextBlock on into the buffer that isn't being read
+	void StartBatch(void);
+
+	const AssetPack			&m_pack;
+	const AssetPackEntry	&m_entry;
+	unsigned int			m_threadCount;
+	uint32_t				m_blockCount;
+	uint32_t				m_batchBlocks;
+
+	std::vector<uint8_t>	m_buffers[2];
+	int						m_current;
+	uint32_t				m_nextBlock;		// First block of the batch that's being decompressed
+	std::future<bool>		m_pending;
+	uint32_t				m_pendingBlocks;
+
+	// What is left to hand out of the current batch
+	const uint8_t			*m_data;
+	size_t					m_remaining;
+	uint32_t				m_remainingBlocks;
+
+	uint64_t				m_storedPosition;
+	bool					m_failed;
+};
+
+// Writes .rpak files, reading each file when the pack is written rather than when it's added
+class AssetPackBuilder
+{
+public:
+	// Adds the file at path as name. With compress it's stored compressed unless that saves less than an eighth
+	// of its size. Returns false if the file doesn't exist or the pack already has name.
+	bool AddFile(const char *name, const char *path, bool compress);
+
+	// Writes the pack to path, compressing the blocks of each entry on threadCount threads (0 uses every core).
+	// Sets error when it returns false.
+	bool Write(const char *path, unsigned int threadCount = 0, std::string *error = nullptr) const;
+
+	size_t GetEntryCount(void) const { return m_files.size(); }
+
+private:
+	struct File
+	{
+		std::string	name;
+		std::string	path;
+		bool		compress;
+	};
+
+	std::vector<File>	m_files;
+};
+
+// Packs that MappedFile::Open and getFileStamp look in before the file system, the last mounted first.
+// Returns false if the pack can't be opened.
+bool mountAssetPack(const char *path);
+void unmountAssetPacks(void);
+
+// Finds path in the mounted packs. pack keeps the pack that has it mapped for as long as entry is used.
+bool findMountedAsset(const char *path, std::shared_ptr<const AssetPack> &pack, const AssetPackEntry *&entry);
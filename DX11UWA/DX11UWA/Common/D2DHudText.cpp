@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "D2DHudText.h"
+#include "DirectXHelper.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DX;
+using namespace Microsoft::WRL;
+
+namespace
+{
+	// Every printable ASCII glyph of a 16 pt font fits in a few rows this wide
+	const float atlasWidth = 512.0f;
+
+	// Room for glyphs that reach past their advance, and for filtering at the cell edges
+	const float glyphPadding = 2.0f;
+
+	UINT32 toAtlasPixels(float dips, float scale)
+	{
+		return static_cast<UINT32>(std::floor(dips * scale + 0.5f));
+	}
+}
+
+D2DHudTextBackend::D2DHudTextBackend(ID2D1DeviceContext2 *context, IDWriteFactory *factory, IDWriteTextFormat *format, HudFont &font)
+{
+	DX::ThrowIfFailed(context->QueryInterface(IID_PPV_ARGS(&m_context)));
+
+	// Each glyph is measured once, its advance is what a layout of it alone is wide
+	font.lineHeight = 0.0f;
+	for (uint32_t i = 0; i < HUD_GLYPH_COUNT; ++i)
+	{
+		const wchar_t c = static_cast<wchar_t>(HUD_FIRST_GLYPH + i);
+
+		ComPtr<IDWriteTextLayout> layout;
+		DX::ThrowIfFailed(factory->CreateTextLayout(&c, 1, format, 1000.0f, 1000.0f, &layout));
+
+		DWRITE_TEXT_METRICS metrics;
+		DX::ThrowIfFailed(layout->GetMetrics(&metrics));
+		font.glyphs[i].advance = metrics.widthIncludingTrailingWhitespace;
+		font.lineHeight = std::max<float>(font.lineHeight, metrics.height);
+	}
+	const float atlasHeight = packHudGlyphs(font, atlasWidth, glyphPadding);
+
+	// Rasterized at the display's DPI, so the glyphs are as sharp as DirectWrite would draw them
+	float dpiX, dpiY;
+	m_context->GetDpi(&dpiX, &dpiY);
+	m_atlasScale = dpiX / 96.0f;
+
+	DX::ThrowIfFailed(
+		m_context->CreateBitmap(
+			D2D1::SizeU(toAtlasPixels(atlasWidth, m_atlasScale), toAtlasPixels(atlasHeight, m_atlasScale)),
+			nullptr,
+			0,
+			D2D1::BitmapProperties1(D2D1_BITMAP_OPTIONS_TARGET, D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED), dpiX, dpiY),
+			&m_atlas
+			)
+		);
+
+	// White glyphs on a transparent atlas, which ClearType can't be blended onto, so they're antialiased in grayscale
+	ComPtr<ID2D1SolidColorBrush> whiteBrush;
+	DX::ThrowIfFailed(m_context->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), &whiteBrush));
+
+	ComPtr<ID2D1Image> target;
+	m_context->GetTarget(&target);
+	D2D1::Matrix3x2F transform;
+	m_context->GetTransform(&transform);
+	const D2D1_TEXT_ANTIALIAS_MODE textAntialias = m_context->GetTextAntialiasMode();
+
+	m_context->SetTarget(m_atlas.Get());
+	m_context->SetTransform(D2D1::Matrix3x2F::Identity());
+	m_context->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+	m_context->BeginDraw();
+	m_context->Clear(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.0f));
+
+	for (uint32_t i = 0; i < HUD_GLYPH_COUNT; ++i)
+	{
+		const wchar_t c = static_cast<wchar_t>(HUD_FIRST_GLYPH + i);
+		const HudRect &cell = font.glyphs[i].source;
+		m_context->DrawText(&c, 1, format, D2D1::RectF(cell.left + font.glyphs[i].originX, cell.top, cell.right, cell.bottom), whiteBrush.Get());
+	}
+
+	const HRESULT hr = m_context->EndDraw();
+	m_context->SetTextAntialiasMode(textAntialias);
+	m_context->SetTransform(transform);
+	m_context->SetTarget(target.Get());
+	DX::ThrowIfFailed(hr);
+
+	DX::ThrowIfFailed(m_context->CreateSpriteBatch(&m_sprites));
+}
+
+void D2DHudTextBackend::SetQuads(const HudQuad *quads, uint32_t count)
+{
+	m_destinations.resize(count);
+	m_sources.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const HudRect &destination = quads[i].destination, &source = quads[i].source;
+		m_destinations[i] = D2D1::RectF(destination.left, destination.top, destination.right, destination.bottom);
+		m_sources[i] = D2D1::RectU(toAtlasPixels(source.left, m_atlasScale), toAtlasPixels(source.top, m_atlasScale),
+			toAtlasPixels(source.right, m_atlasScale), toAtlasPixels(source.bottom, m_atlasScale));
+	}
+
+	m_sprites->Clear();
+	if (count > 0)
+		DX::ThrowIfFailed(m_sprites->AddSprites(count, m_destinations.data(), m_sources.data()));
+}
+
+void D2DHudTextBackend::Draw(float x, float y)
+{
+	if (m_sprites->GetSpriteCount() == 0)
+		return;
+
+	D2D1::Matrix3x2F transform;
+	m_context->GetTransform(&transform);
+	const D2D1_ANTIALIAS_MODE antialias = m_context->GetAntialiasMode();
+
+	// Sprite batches are only drawn aliased, the glyphs were antialiased when the atlas was rasterized
+	m_context->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+	m_context->SetTransform(D2D1::Matrix3x2F::Translation(x, y) * transform);
+	m_context->DrawSpriteBatch(m_sprites.Get(), m_atlas.Get(), D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, D2D1_SPRITE_OPTIONS_NONE);
+
+	m_context->SetTransform(transform);
+	m_context->SetAntialiasMode(antialias);
+}
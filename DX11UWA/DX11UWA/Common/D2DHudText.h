@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include "..\HudText.h"
+
+namespace DX
+{
+	// Rasterizes the glyphs of a text format into an atlas bitmap once, at the context's DPI, and draws HudText's
+	// quads from it as one Direct2D sprite batch. The sprites are only added again when the quads change.
+	// Sprite batches came with ID2D1DeviceContext3 in Windows 10 1607, the oldest version the app runs on.
+	class D2DHudTextBackend : public HudTextBackend
+	{
+	public:
+		// Fills in font with where each glyph is in the atlas
+		D2DHudTextBackend(ID2D1DeviceContext2 *context, IDWriteFactory *factory, IDWriteTextFormat *format, HudFont &font);
+
+		virtual void SetQuads(const HudQuad *quads, uint32_t count) override;
+		virtual void Draw(float x, float y) override;
+
+	private:
+		Microsoft::WRL::ComPtr<ID2D1DeviceContext3>	m_context;
+		Microsoft::WRL::ComPtr<ID2D1Bitmap1>		m_atlas;
+		Microsoft::WRL::ComPtr<ID2D1SpriteBatch>	m_sprites;
+		float										m_atlasScale;	// Atlas pixels per DIP
+
+		// Kept between changes so adding the sprites doesn't allocate
+		std::vector<D2D1_RECT_F>	m_destinations;
+		std::vector<D2D1_RECT_U>	m_sources;
+	};
+}
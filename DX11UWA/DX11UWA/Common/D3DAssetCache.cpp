@@ -0,0 +1,138 @@
+#include "pch.h"
+#include "D3DAssetCache.h"
+
+#include "DirectXHelper.h"
+
+using namespace DX;
+
+namespace
+{
+	// A handle that points at the Direct3D object and holds the reference the cache created it with
+	template <typename T>
+	std::shared_ptr<T> shareObject(Microsoft::WRL::ComPtr<T> &object)
+	{
+		return std::shared_ptr<T>(object.Detach(), [](T *released) { released->Release(); });
+	}
+
+	// Every field of every element, so layouts that differ in anything get their own entry
+	std::string inputLayoutKey(const char *vertexShaderFile, const D3D11_INPUT_ELEMENT_DESC *elements, UINT elementCount)
+	{
+		std::string key = vertexShaderFile;
+		for (UINT i = 0; i < elementCount; ++i)
+		{
+			const D3D11_INPUT_ELEMENT_DESC &element = elements[i];
+			key += "|" + std::string(element.SemanticName) + std::to_string(element.SemanticIndex) + ":" + std::to_string(element.Format) + ":" +
+				std::to_string(element.InputSlot) + ":" + std::to_string(element.AlignedByteOffset) + ":" + std::to_string(element.InputSlotClass) + ":" +
+				std::to_string(element.InstanceDataStepRate);
+		}
+		return key;
+	}
+}
+
+D3DAssetCache::D3DAssetCache(const std::shared_ptr<DeviceResources>& deviceResources) :
+	m_deviceResources(deviceResources)
+{
+	CreateDeviceDependentResources();
+}
+
+void D3DAssetCache::CreateDeviceDependentResources(void)
+{
+	m_textureBackend = std::unique_ptr<D3DTextureStreamingBackend>(new D3DTextureStreamingBackend(m_deviceResources->GetD3DDevice()));
+	m_textureStreamer = std::make_shared<TextureStreamer>(*m_textureBackend);
+}
+
+void D3DAssetCache::ReleaseDeviceDependentResources(void)
+{
+	m_vertexShaders.Clear();
+	m_pixelShaders.Clear();
+	m_inputLayouts.Clear();
+	m_meshes.Clear();
+	m_textures.Clear();
+
+	// The streamer hands its textures back to the backend as it goes
+	m_textureStreamer.reset();
+	m_textureBackend.reset();
+}
+
+std::shared_ptr<ID3D11VertexShader> D3DAssetCache::AcquireVertexShader(const char *file)
+{
+	return m_vertexShaders.Acquire(file, [this, file]() -> std::shared_ptr<ID3D11VertexShader>
+	{
+		MappedFile bytecode;
+		if (!bytecode.Open(file))
+			return nullptr;
+
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
+		ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateVertexShader(bytecode.GetData(), bytecode.GetSize(), nullptr, &shader));
+		return shareObject(shader);
+	});
+}
+
+std::shared_ptr<ID3D11PixelShader> D3DAssetCache::AcquirePixelShader(const char *file)
+{
+	return m_pixelShaders.Acquire(file, [this, file]() -> std::shared_ptr<ID3D11PixelShader>
+	{
+		MappedFile bytecode;
+		if (!bytecode.Open(file))
+			return nullptr;
+
+		Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
+		ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreatePixelShader(bytecode.GetData(), bytecode.GetSize(), nullptr, &shader));
+		return shareObject(shader);
+	});
+}
+
+std::shared_ptr<ID3D11InputLayout> D3DAssetCache::AcquireInputLayout(const char *vertexShaderFile, const D3D11_INPUT_ELEMENT_DESC *elements, UINT elementCount)
+{
+	return m_inputLayouts.Acquire(inputLayoutKey(vertexShaderFile, elements, elementCount), [=]() -> std::shared_ptr<ID3D11InputLayout>
+	{
+		// The layout is checked against the shader's input signature
+		MappedFile bytecode;
+		if (!bytecode.Open(vertexShaderFile))
+			return nullptr;
+
+		Microsoft::WRL::ComPtr<ID3D11InputLayout> layout;
+		ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateInputLayout(elements, elementCount, bytecode.GetData(), bytecode.GetSize(), &layout));
+		return shareObject(layout);
+	});
+}
+
+std::shared_ptr<MeshGeometry> D3DAssetCache::AcquireMesh(const std::string &key, const std::function<std::shared_ptr<MeshGeometry>(void)> &load)
+{
+	return m_meshes.Acquire(key, load);
+}
+
+std::shared_ptr<SharedTexture> D3DAssetCache::AcquireTexture(const char *path)
+{
+	return m_textures.Acquire(path, [this, path]() -> std::shared_ptr<SharedTexture>
+	{
+		const StreamedTextureId id = m_textureStreamer->AddTexture(path);
+		if (id == INVALID_STREAMED_TEXTURE)
+			return nullptr;
+
+		// Textures still held when the device is lost went with the streamer
+		std::weak_ptr<TextureStreamer> streamer = m_textureStreamer;
+		return std::shared_ptr<SharedTexture>(new SharedTexture{ id }, [streamer](SharedTexture *texture)
+		{
+			if (std::shared_ptr<TextureStreamer> owner = streamer.lock())
+				owner->RemoveTexture(texture->id);
+			delete texture;
+		});
+	});
+}
+
+void D3DAssetCache::RequestTexture(const SharedTexture *texture, float screenPixels)
+{
+	if (texture)
+		m_textureStreamer->RequestTexture(texture->id, screenPixels);
+}
+
+ID3D11ShaderResourceView *D3DAssetCache::GetTextureView(const SharedTexture *texture) const
+{
+	return texture ? m_textureBackend->GetView(texture->id) : nullptr;
+}
+
+void D3DAssetCache::Update(void)
+{
+	m_textureStreamer->Update();
+}
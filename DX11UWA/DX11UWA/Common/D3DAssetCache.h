@@ -0,0 +1,74 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include "DeviceResources.h"
+#include "D3DTextureStreaming.h"
+#include "..\AssetCache.h"
+#include "..\MaterialLibrary.h"
+
+struct MeshGeometry;
+
+namespace DX
+{
+	// A texture of the shared streamer. It's removed from the streamer when the last handle to it goes.
+	struct SharedTexture
+	{
+		StreamedTextureId	id;
+	};
+
+	// Shaders, input layouts, meshes, materials and textures of every renderer on the device, so each one is
+	// loaded and created once however many renderers and views draw it (see AssetCache.h). The Acquire
+	// functions block until the asset is loaded, or until another thread that was already loading it is done.
+	// Shaders are read straight from the asset pack or the install folder by file name.
+	class D3DAssetCache
+	{
+	public:
+		D3DAssetCache(const std::shared_ptr<DeviceResources>& deviceResources);
+		void CreateDeviceDependentResources(void);
+
+		// Renderers let go of their handles first, so every Direct3D object is released with the device
+		void ReleaseDeviceDependentResources(void);
+
+		// Null if the file can't be read, throws if Direct3D can't create the shader
+		std::shared_ptr<ID3D11VertexShader> AcquireVertexShader(const char *file);
+		std::shared_ptr<ID3D11PixelShader> AcquirePixelShader(const char *file);
+
+		// The layout of elements for the vertex shader in file, shared with every other shader with the same
+		// signature file and elements
+		std::shared_ptr<ID3D11InputLayout> AcquireInputLayout(const char *vertexShaderFile, const D3D11_INPUT_ELEMENT_DESC *elements, UINT elementCount);
+
+		// The mesh cached under key, or the one load creates. The renderer knows how meshes are made, so key
+		// has to name everything that changes the result.
+		std::shared_ptr<MeshGeometry> AcquireMesh(const std::string &key, const std::function<std::shared_ptr<MeshGeometry>(void)> &load);
+
+		// Only the smallest mips are uploaded here, the rest stream in as the texture is requested. Null if the
+		// DDS file can't be used. Only call these from the render thread, like the streamer itself.
+		std::shared_ptr<SharedTexture> AcquireTexture(const char *path);
+
+		// Streams in the mips every view that draws the texture needs, the largest request of the frame wins
+		void RequestTexture(const SharedTexture *texture, float screenPixels);
+
+		// The view of the texture's resident mips, null if it has none or texture is null
+		ID3D11ShaderResourceView *GetTextureView(const SharedTexture *texture) const;
+
+		// Once a frame, after every view is drawn, uploads what was requested for the next one
+		void Update(void);
+
+		// Material libraries aren't device dependent, so they stay loaded with the device lost
+		MaterialTable &GetMaterials(void) { return m_materials; }
+
+	private:
+		std::shared_ptr<DeviceResources>		m_deviceResources;
+
+		AssetCache<ID3D11VertexShader>			m_vertexShaders;
+		AssetCache<ID3D11PixelShader>			m_pixelShaders;
+		AssetCache<ID3D11InputLayout>			m_inputLayouts;
+		AssetCache<MeshGeometry>				m_meshes;
+		AssetCache<SharedTexture>				m_textures;
+		MaterialTable							m_materials;
+
+		std::unique_ptr<D3DTextureStreamingBackend>	m_textureBackend;
+		std::shared_ptr<TextureStreamer>			m_textureStreamer;
+	};
+}
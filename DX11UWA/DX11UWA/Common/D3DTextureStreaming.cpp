@@ -0,0 +1,215 @@
+#include "pch.h"
+#include "D3DTextureStreaming.h"
+
+#include <algorithm>
+
+using namespace DX;
+
+namespace
+{
+	D3D11_SHADER_RESOURCE_VIEW_DESC viewDescription(const DDSDescription &desc, UINT mipCount)
+	{
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+		viewDesc.Format = desc.format;
+
+		if (desc.resourceDimension == DDS_DIMENSION_TEXTURE2D)
+		{
+			if (desc.isCubeMap && desc.arraySize > 6)
+			{
+				viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+				viewDesc.TextureCubeArray.MipLevels = mipCount;
+				viewDesc.TextureCubeArray.NumCubes = static_cast<UINT>(desc.arraySize / 6);
+			}
+			else if (desc.isCubeMap)
+			{
+				viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+				viewDesc.TextureCube.MipLevels = mipCount;
+			}
+			else if (desc.arraySize > 1)
+			{
+				viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+				viewDesc.Texture2DArray.MipLevels = mipCount;
+				viewDesc.Texture2DArray.ArraySize = static_cast<UINT>(desc.arraySize);
+			}
+			else
+			{
+				viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+				viewDesc.Texture2D.MipLevels = mipCount;
+			}
+		}
+		else if (desc.resourceDimension == DDS_DIMENSION_TEXTURE3D)
+		{
+			viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE3D;
+			viewDesc.Texture3D.MipLevels = mipCount;
+		}
+		else
+		{
+			viewDesc.ViewDimension = (desc.arraySize > 1) ? D3D11_SRV_DIMENSION_TEXTURE1DARRAY : D3D11_SRV_DIMENSION_TEXTURE1D;
+			viewDesc.Texture1DArray.MipLevels = mipCount;
+			viewDesc.Texture1DArray.ArraySize = static_cast<UINT>(desc.arraySize);
+		}
+
+		return viewDesc;
+	}
+
+	// A 2D texture or cube map with mips firstMip on of desc, in usage
+	CD3D11_TEXTURE2D_DESC texture2DDescription(const DDSDescription &desc, uint32_t firstMip, D3D11_USAGE usage)
+	{
+		return CD3D11_TEXTURE2D_DESC(desc.format, std::max<UINT>(static_cast<UINT>(desc.width >> firstMip), 1),
+			std::max<UINT>(static_cast<UINT>(desc.height >> firstMip), 1), static_cast<UINT>(desc.arraySize), static_cast<UINT>(desc.mipCount - firstMip),
+			D3D11_BIND_SHADER_RESOURCE, usage, 0, 1, 0, desc.isCubeMap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0);
+	}
+}
+
+D3DTextureStreamingBackend::D3DTextureStreamingBackend(ID3D11Device *device) :
+	m_device(device)
+{
+	m_device->GetImmediateContext(&m_context);
+}
+
+bool D3DTextureStreamingBackend::UploadMips(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip, uint32_t previousFirstMip)
+{
+	// With nothing resident yet there's nothing to keep
+	if (previousFirstMip >= source.GetDescription().mipCount || texture >= m_textures.size() || !m_textures[texture])
+		return CreateTexture(texture, source, firstMip);
+
+	return ReplaceTexture(texture, source, firstMip, previousFirstMip);
+}
+
+void D3DTextureStreamingBackend::EvictMips(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip, uint32_t previousFirstMip)
+{
+	// Without the texture the mips would stay resident, so the old one is released either way
+	if (!ReplaceTexture(texture, source, firstMip, previousFirstMip))
+		RemoveTexture(texture);
+}
+
+void D3DTextureStreamingBackend::RemoveTexture(StreamedTextureId texture)
+{
+	if (texture < m_views.size())
+	{
+		m_textures[texture].Reset();
+		m_views[texture].Reset();
+	}
+}
+
+ID3D11ShaderResourceView *D3DTextureStreamingBackend::GetView(StreamedTextureId texture) const
+{
+	return (texture < m_views.size()) ? m_views[texture].Get() : nullptr;
+}
+
+bool D3DTextureStreamingBackend::MapFileSubresources(const MappedDDS &source)
+{
+	const DDSDescription &desc = source.GetDescription();
+
+	m_fileSubresources.resize(desc.mipCount * desc.arraySize);
+	size_t width, height, depth, skipMip;
+	return FillDDSInitData(desc.width, desc.height, desc.depth, desc.mipCount, desc.arraySize, desc.format, 0, source.GetBitSize(), source.GetBitData(),
+		width, height, depth, skipMip, m_fileSubresources.data()) == DDS_FILL_OK;
+}
+
+bool D3DTextureStreamingBackend::CreateTexture(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip)
+{
+	const DDSDescription &desc = source.GetDescription();
+	if (!MapFileSubresources(source))
+		return false;
+
+	const UINT mipCount = static_cast<UINT>(desc.mipCount - firstMip);
+	m_residentSubresources.clear();
+	for (size_t slice = 0; slice < desc.arraySize; ++slice)
+	{
+		for (size_t mip = firstMip; mip < desc.mipCount; ++mip)
+			m_residentSubresources.push_back(m_fileSubresources[slice * desc.mipCount + mip]);
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+
+	if (desc.resourceDimension == DDS_DIMENSION_TEXTURE2D)
+	{
+		const CD3D11_TEXTURE2D_DESC textureDesc = texture2DDescription(desc, firstMip, D3D11_USAGE_IMMUTABLE);
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture2D;
+		if (FAILED(m_device->CreateTexture2D(&textureDesc, m_residentSubresources.data(), &texture2D)))
+			return false;
+		resource = texture2D;
+	}
+	else if (desc.resourceDimension == DDS_DIMENSION_TEXTURE3D)
+	{
+		// Not streamed, so these always have every mip
+		CD3D11_TEXTURE3D_DESC textureDesc(desc.format, static_cast<UINT>(desc.width), static_cast<UINT>(desc.height), static_cast<UINT>(desc.depth),
+			mipCount, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+
+		Microsoft::WRL::ComPtr<ID3D11Texture3D> texture3D;
+		if (FAILED(m_device->CreateTexture3D(&textureDesc, m_residentSubresources.data(), &texture3D)))
+			return false;
+		resource = texture3D;
+	}
+	else
+	{
+		CD3D11_TEXTURE1D_DESC textureDesc(desc.format, static_cast<UINT>(desc.width), static_cast<UINT>(desc.arraySize), mipCount,
+			D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+
+		Microsoft::WRL::ComPtr<ID3D11Texture1D> texture1D;
+		if (FAILED(m_device->CreateTexture1D(&textureDesc, m_residentSubresources.data(), &texture1D)))
+			return false;
+		resource = texture1D;
+	}
+
+	return SetTexture(texture, resource.Get(), desc, mipCount);
+}
+
+bool D3DTextureStreamingBackend::ReplaceTexture(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip, uint32_t previousFirstMip)
+{
+	const DDSDescription &desc = source.GetDescription();
+
+	// Only 2D textures and cube maps are streamed, anything else always has every mip
+	if (desc.resourceDimension != DDS_DIMENSION_TEXTURE2D || texture >= m_textures.size() || !m_textures[texture])
+		return CreateTexture(texture, source, firstMip);
+
+	// The file is only read for the mips that weren't resident
+	if (firstMip < previousFirstMip && !MapFileSubresources(source))
+		return false;
+
+	const CD3D11_TEXTURE2D_DESC textureDesc = texture2DDescription(desc, firstMip, D3D11_USAGE_DEFAULT);
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> replacement;
+	if (FAILED(m_device->CreateTexture2D(&textureDesc, nullptr, &replacement)))
+		return false;
+
+	ID3D11Resource *previous = m_textures[texture].Get();
+	const UINT mipCount = textureDesc.MipLevels;
+	const UINT previousMipCount = static_cast<UINT>(desc.mipCount - previousFirstMip);
+
+	for (UINT slice = 0; slice < textureDesc.ArraySize; ++slice)
+	{
+		for (UINT mip = firstMip; mip < desc.mipCount; ++mip)
+		{
+			const UINT subresource = D3D11CalcSubresource(mip - firstMip, slice, mipCount);
+			if (mip >= previousFirstMip)
+				m_context->CopySubresourceRegion(replacement.Get(), subresource, 0, 0, 0, previous, D3D11CalcSubresource(mip - previousFirstMip, slice, previousMipCount), nullptr);
+			else
+			{
+				const D3D11_SUBRESOURCE_DATA &data = m_fileSubresources[slice * desc.mipCount + mip];
+				m_context->UpdateSubresource(replacement.Get(), subresource, nullptr, data.pSysMem, data.SysMemPitch, data.SysMemSlicePitch);
+			}
+		}
+	}
+
+	return SetTexture(texture, replacement.Get(), desc, mipCount);
+}
+
+bool D3DTextureStreamingBackend::SetTexture(StreamedTextureId texture, ID3D11Resource *resource, const DDSDescription &desc, UINT mipCount)
+{
+	const D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = viewDescription(desc, mipCount);
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view;
+	if (FAILED(m_device->CreateShaderResourceView(resource, &viewDesc, &view)))
+		return false;
+
+	if (texture >= m_views.size())
+	{
+		m_textures.resize(texture + 1);
+		m_views.resize(texture + 1);
+	}
+	m_textures[texture] = resource;
+	m_views[texture] = view;
+	return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include "..\TextureStreaming.h"
+
+namespace DX
+{
+	// Makes the mips TextureStreamer decides on resident as Direct3D textures. Direct3D 11 can't add mips to or
+	// drop mips from a texture, so when they change the texture is replaced by one with only the resident mips:
+	// the mips that stay resident are copied over on the GPU, and only the new ones are uploaded from the mapped
+	// DDS file. The view to bind changes with it.
+	class D3DTextureStreamingBackend : public TextureStreamingBackend
+	{
+	public:
+		D3DTextureStreamingBackend(ID3D11Device *device);
+
+		// A texture's first mips are uploaded by creating it, which only needs the device, so textures can be
+		// added from any thread. Streaming mips in and out after that uses the immediate context.
+		virtual bool UploadMips(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip, uint32_t previousFirstMip) override;
+		virtual void EvictMips(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip, uint32_t previousFirstMip) override;
+		virtual void RemoveTexture(StreamedTextureId texture) override;
+
+		// The view of the texture's resident mips, null if it has none
+		ID3D11ShaderResourceView *GetView(StreamedTextureId texture) const;
+
+	private:
+		// Points m_fileSubresources at every subresource of the file
+		bool MapFileSubresources(const MappedDDS &source);
+
+		bool CreateTexture(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip);
+
+		// Replaces the texture, which has mips previousFirstMip on, with one that has mips firstMip on. Mips both
+		// have are copied from the old one, the others uploaded from source.
+		bool ReplaceTexture(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip, uint32_t previousFirstMip);
+
+		bool SetTexture(StreamedTextureId texture, ID3D11Resource *resource, const DDSDescription &desc, UINT mipCount);
+
+		Microsoft::WRL::ComPtr<ID3D11Device>							m_device;
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext>						m_context;
+		std::vector<Microsoft::WRL::ComPtr<ID3D11Resource>>				m_textures;
+		std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>	m_views;
+
+		// Kept between textures so creating one doesn't allocate
+		std::vector<D3D11_SUBRESOURCE_DATA>	m_fileSubresources;
+		std::vector<D3D11_SUBRESOURCE_DATA>	m_residentSubresources;
+	};
+}
@@ -0,0 +1,310 @@
+//--------------------------------------------------------------------------------------
+// File: DDS.h
+//
+// DDS file structure definitions and the format helpers shared by DDSTextureLoader and
+// the command-line tools. Only needs dxgiformat.h, so it also builds without Direct3D.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <dxgiformat.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../MappedFile.h"
+
+#if (!defined(_WIN32) || (_WIN32_WINNT >= 0x0602 /*_WIN32_WINNT_WIN8*/)) && !defined(DXGI_1_2_FORMATS)
+#define DXGI_1_2_FORMATS
+#endif
+
+//--------------------------------------------------------------------------------------
+// Macros
+//--------------------------------------------------------------------------------------
+#ifndef MAKEFOURCC
+    #define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+                ((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) |       \
+                ((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
+#endif /* defined(MAKEFOURCC) */
+
+//--------------------------------------------------------------------------------------
+// DDS file structure definitions
+//
+// See DDS.h in the 'Texconv' sample and the 'DirectXTex' library
+//--------------------------------------------------------------------------------------
+#pragma pack(push,1)
+
+#define DDS_MAGIC 0x20534444 // "DDS "
+
+struct DDS_PIXELFORMAT
+{
+    uint32_t    size;
+    uint32_t    flags;
+    uint32_t    fourCC;
+    uint32_t    RGBBitCount;
+    uint32_t    RBitMask;
+    uint32_t    GBitMask;
+    uint32_t    BBitMask;
+    uint32_t    ABitMask;
+};
+
+#define DDS_FOURCC      0x00000004  // DDPF_FOURCC
+#define DDS_RGB         0x00000040  // DDPF_RGB
+#define DDS_RGBA        0x00000041  // DDPF_RGB | DDPF_ALPHAPIXELS
+#define DDS_LUMINANCE   0x00020000  // DDPF_LUMINANCE
+#define DDS_LUMINANCEA  0x00020001  // DDPF_LUMINANCE | DDPF_ALPHAPIXELS
+#define DDS_ALPHA       0x00000002  // DDPF_ALPHA
+#define DDS_PAL8        0x00000020  // DDPF_PALETTEINDEXED8
+
+#define DDS_HEADER_FLAGS_TEXTURE        0x00001007  // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT 
+#define DDS_HEADER_FLAGS_MIPMAP         0x00020000  // DDSD_MIPMAPCOUNT
+#define DDS_HEADER_FLAGS_VOLUME         0x00800000  // DDSD_DEPTH
+#define DDS_HEADER_FLAGS_PITCH          0x00000008  // DDSD_PITCH
+#define DDS_HEADER_FLAGS_LINEARSIZE     0x00080000  // DDSD_LINEARSIZE
+
+#define DDS_HEIGHT 0x00000002 // DDSD_HEIGHT
+#define DDS_WIDTH  0x00000004 // DDSD_WIDTH
+
+#define DDS_SURFACE_FLAGS_TEXTURE 0x00001000 // DDSCAPS_TEXTURE
+#define DDS_SURFACE_FLAGS_MIPMAP  0x00400008 // DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+#define DDS_SURFACE_FLAGS_CUBEMAP 0x00000008 // DDSCAPS_COMPLEX
+
+#define DDS_CUBEMAP_POSITIVEX 0x00000600 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
+#define DDS_CUBEMAP_NEGATIVEX 0x00000a00 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
+#define DDS_CUBEMAP_POSITIVEY 0x00001200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
+#define DDS_CUBEMAP_NEGATIVEY 0x00002200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
+#define DDS_CUBEMAP_POSITIVEZ 0x00004200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
+#define DDS_CUBEMAP_NEGATIVEZ 0x00008200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
+
+#define DDS_CUBEMAP_ALLFACES ( DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX |\
+                               DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY |\
+                               DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ )
+
+#define DDS_CUBEMAP 0x00000200 // DDSCAPS2_CUBEMAP
+
+#define DDS_FLAGS_VOLUME 0x00200000 // DDSCAPS2_VOLUME
+
+typedef struct
+{
+    uint32_t        size;
+    uint32_t        flags;
+    uint32_t        height;
+    uint32_t        width;
+    uint32_t        pitchOrLinearSize;
+    uint32_t        depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
+    uint32_t        mipMapCount;
+    uint32_t        reserved1[11];
+    DDS_PIXELFORMAT ddspf;
+    uint32_t        caps;
+    uint32_t        caps2;
+    uint32_t        caps3;
+    uint32_t        caps4;
+    uint32_t        reserved2;
+} DDS_HEADER;
+
+typedef struct
+{
+    DXGI_FORMAT     dxgiFormat;
+    uint32_t        resourceDimension;
+    uint32_t        miscFlag; // see D3D11_RESOURCE_MISC_FLAG
+    uint32_t        arraySize;
+    uint32_t        reserved;
+} DDS_HEADER_DXT10;
+
+#pragma pack(pop)
+
+//--------------------------------------------------------------------------------------
+// Resource dimensions and limits, with the values of their D3D11_ counterparts
+//--------------------------------------------------------------------------------------
+#define DDS_DIMENSION_TEXTURE1D 2 // D3D11_RESOURCE_DIMENSION_TEXTURE1D
+#define DDS_DIMENSION_TEXTURE2D 3 // D3D11_RESOURCE_DIMENSION_TEXTURE2D
+#define DDS_DIMENSION_TEXTURE3D 4 // D3D11_RESOURCE_DIMENSION_TEXTURE3D
+
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4 // D3D11_RESOURCE_MISC_TEXTURECUBE
+
+#define DDS_REQ_MIP_LEVELS                  15      // D3D11_REQ_MIP_LEVELS
+#define DDS_REQ_TEXTURE1D_ARRAY_AXIS_DIMENSION 2048 // D3D11_REQ_TEXTURE1D_ARRAY_AXIS_DIMENSION
+#define DDS_REQ_TEXTURE1D_U_DIMENSION       16384   // D3D11_REQ_TEXTURE1D_U_DIMENSION
+#define DDS_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION 2048 // D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION
+#define DDS_REQ_TEXTURE2D_U_OR_V_DIMENSION  16384   // D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+#define DDS_REQ_TEXTURECUBE_DIMENSION       16384   // D3D11_REQ_TEXTURECUBE_DIMENSION
+#define DDS_REQ_TEXTURE3D_U_V_OR_W_DIMENSION 2048   // D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION
+
+// Everything needed to create the resource described by a DDS file
+struct DDSDescription
+{
+    uint32_t        resourceDimension; // DDS_DIMENSION_*
+    size_t          width;
+    size_t          height;
+    size_t          depth;
+    size_t          mipCount;
+    size_t          arraySize;         // Already multiplied by 6 for cube maps
+    DXGI_FORMAT     format;
+    bool            isCubeMap;
+    size_t          bitOffset;         // Start of the surface data in the file
+    size_t          bitSize;           // Bytes of surface data the headers describe
+};
+
+//--------------------------------------------------------------------------------------
+size_t BitsPerPixel( _In_ DXGI_FORMAT fmt );
+
+void GetSurfaceInfo( _In_ size_t width,
+                     _In_ size_t height,
+                     _In_ DXGI_FORMAT fmt,
+                     _Out_opt_ size_t* outNumBytes,
+                     _Out_opt_ size_t* outRowBytes,
+                     _Out_opt_ size_t* outNumRows );
+
+DXGI_FORMAT GetDXGIFormat( const DDS_PIXELFORMAT& ddpf );
+
+// Checks the headers of a DDS file in memory against the same rules DDSTextureLoader
+// applies, and that the file holds every surface they describe. On failure error (when
+// given) points to a short static description of the problem.
+bool GetDDSDescription( _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+                        _In_ size_t ddsDataSize,
+                        _Out_ DDSDescription& desc,
+                        _Out_opt_ const char** error = nullptr );
+
+enum DDS_OPEN_RESULT
+{
+    DDS_OPEN_OK,
+    DDS_OPEN_NO_FILE,       // The file can't be opened or mapped
+    DDS_OPEN_INVALID        // GetDDSDescription rejected it
+};
+
+// A DDS file mapped with MappedFile, so it may also be an entry of a mounted asset pack. The
+// surfaces are used in place: FillDDSInitData points straight into GetBitData(), so a texture
+// isn't read into a heap copy of the file on its way to the GPU.
+class MappedDDS
+{
+public:
+    MappedDDS() : m_desc() {}
+
+    // On DDS_OPEN_INVALID error (when given) points to GetDDSDescription's description
+    DDS_OPEN_RESULT Open( _In_z_ const char* path, _Out_opt_ const char** error = nullptr );
+    void Close();
+
+    bool IsOpen() const { return m_file.IsOpen(); }
+    const DDSDescription& GetDescription() const { return m_desc; }
+
+    const uint8_t* GetData() const { return reinterpret_cast<const uint8_t*>( m_file.GetData() ); }
+    size_t GetSize() const { return m_file.GetSize(); }
+
+    const DDS_HEADER* GetHeader() const { return reinterpret_cast<const DDS_HEADER*>( GetData() + sizeof( uint32_t ) ); }
+
+    // Everything after the headers, which may run past the surfaces the headers describe
+    const uint8_t* GetBitData() const { return GetData() + m_desc.bitOffset; }
+    size_t GetBitSize() const { return GetSize() - m_desc.bitOffset; }
+
+private:
+    MappedFile      m_file;
+    DDSDescription  m_desc;
+};
+
+enum DDS_FILL_RESULT
+{
+    DDS_FILL_OK,
+    DDS_FILL_END_OF_DATA,   // bitData ends before the last surface
+    DDS_FILL_NO_SURFACES    // Every mip is larger than maxsize
+};
+
+// Points initData at every mip of every array slice in bitData, skipping the mips larger than
+// maxsize (0 keeps them all). twidth, theight and tdepth receive the size of the first mip
+// kept and skipMip how many were skipped per slice. TSubresourceData is D3D11_SUBRESOURCE_DATA
+// in the loader, or anything else with the same three members.
+template<typename TSubresourceData>
+DDS_FILL_RESULT FillDDSInitData( _In_ size_t width,
+                                 _In_ size_t height,
+                                 _In_ size_t depth,
+                                 _In_ size_t mipCount,
+                                 _In_ size_t arraySize,
+                                 _In_ DXGI_FORMAT format,
+                                 _In_ size_t maxsize,
+                                 _In_ size_t bitSize,
+                                 _In_reads_bytes_(bitSize) const uint8_t* bitData,
+                                 _Out_ size_t& twidth,
+                                 _Out_ size_t& theight,
+                                 _Out_ size_t& tdepth,
+                                 _Out_ size_t& skipMip,
+                                 _Out_writes_(mipCount*arraySize) TSubresourceData* initData )
+{
+    skipMip = 0;
+    twidth = 0;
+    theight = 0;
+    tdepth = 0;
+
+    size_t NumBytes = 0;
+    size_t RowBytes = 0;
+    size_t NumRows = 0;
+    const uint8_t* pSrcBits = bitData;
+    const uint8_t* pEndBits = bitData + bitSize;
+
+    size_t index = 0;
+    for( size_t j = 0; j < arraySize; j++ )
+    {
+        size_t w = width;
+        size_t h = height;
+        size_t d = depth;
+        for( size_t i = 0; i < mipCount; i++ )
+        {
+            GetSurfaceInfo( w,
+                            h,
+                            format,
+                            &NumBytes,
+                            &RowBytes,
+                            &NumRows
+                          );
+
+            if ( (mipCount <= 1) || !maxsize || (w <= maxsize && h <= maxsize && d <= maxsize) )
+            {
+                if ( !twidth )
+                {
+                    twidth = w;
+                    theight = h;
+                    tdepth = d;
+                }
+
+                initData[index].pSysMem = ( const void* )pSrcBits;
+                initData[index].SysMemPitch = static_cast<uint32_t>( RowBytes );
+                initData[index].SysMemSlicePitch = static_cast<uint32_t>( NumBytes );
+                ++index;
+            }
+            else
+                ++skipMip;
+
+            if (pSrcBits + (NumBytes*d) > pEndBits)
+            {
+                return DDS_FILL_END_OF_DATA;
+            }
+
+            pSrcBits += NumBytes * d;
+
+            w = w >> 1;
+            h = h >> 1;
+            d = d >> 1;
+            if (w == 0)
+            {
+                w = 1;
+            }
+            if (h == 0)
+            {
+                h = 1;
+            }
+            if (d == 0)
+            {
+                d = 1;
+            }
+        }
+    }
+
+    return (index > 0) ? DDS_FILL_OK : DDS_FILL_NO_SURFACES;
+}
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <ppltasks.h>	// For create_task
+#include "..\MappedFile.h"
 
 namespace DX
 {
@@ -19,6 +20,15 @@ namespace DX
 		using namespace Windows::Storage;
 		using namespace Concurrency;
 
+		// Files in a mounted asset pack (see AssetPack.h) are read from there instead
+		char packedName[MAX_PATH];
+		if (WideCharToMultiByte(CP_UTF8, 0, filename.c_str(), -1, packedName, MAX_PATH, nullptr, nullptr) > 0)
+		{
+			MappedFile packed;
+			if (packed.OpenPacked(packedName))
+				return task_from_result(std::vector<byte>(packed.GetData(), packed.GetData() + packed.GetSize()));
+		}
+
 		auto folder = Windows::ApplicationModel::Package::Current->InstalledLocation;
 
 		return create_task(folder->GetFileAsync(Platform::StringReference(filename.c_str()))).then([] (StorageFile^ file) 
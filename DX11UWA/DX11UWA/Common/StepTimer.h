@@ -1,14 +1,99 @@
 ﻿#pragma once
 
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(RAPTURE_TOOLS)
+#include <chrono>
+#else
 #include <wrl.h>
+#endif
 
 namespace DX
 {
+	// Where StepTimer reads the time from, as a count of ticks at a fixed frequency
+	class StepClock
+	{
+	public:
+		virtual ~StepClock() {}
+
+		virtual uint64_t GetFrequency() const = 0;
+		virtual uint64_t GetTicks() const = 0;
+	};
+
+	// The system's monotonic clock. QueryPerformanceCounter in the app, std::chrono::steady_clock in the tools
+	// (clock_gettime(CLOCK_MONOTONIC) on Linux).
+	class SystemStepClock : public StepClock
+	{
+	public:
+#if defined(RAPTURE_TOOLS)
+		virtual uint64_t GetFrequency() const override
+		{
+			return std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+		}
+
+		virtual uint64_t GetTicks() const override
+		{
+			return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+		}
+#else
+		virtual uint64_t GetFrequency() const override
+		{
+			LARGE_INTEGER frequency;
+			if (!QueryPerformanceFrequency(&frequency))
+			{
+				throw ref new Platform::FailureException();
+			}
+			return frequency.QuadPart;
+		}
+
+		virtual uint64_t GetTicks() const override
+		{
+			LARGE_INTEGER time;
+			if (!QueryPerformanceCounter(&time))
+			{
+				throw ref new Platform::FailureException();
+			}
+			return time.QuadPart;
+		}
+#endif
+
+		// Shared by every timer that isn't given a clock
+		static SystemStepClock &Get()
+		{
+			static SystemStepClock clock;
+			return clock;
+		}
+	};
+
+	// A clock that only moves when it's told to, so the updates a sequence of frames makes StepTimer call are
+	// the same on every machine. Counts in StepTimer ticks.
+	class VirtualStepClock : public StepClock
+	{
+	public:
+		VirtualStepClock() : m_ticks(0) {}
+
+		virtual uint64_t GetFrequency() const override		{ return 10000000; }
+		virtual uint64_t GetTicks() const override			{ return m_ticks; }
+
+		void Advance(uint64_t ticks)						{ m_ticks += ticks; }
+		void AdvanceSeconds(double seconds)					{ m_ticks += static_cast<uint64_t>(seconds * GetFrequency()); }
+
+	private:
+		uint64_t m_ticks;
+	};
+
 	// Helper class for animation and simulation timing.
 	class StepTimer
 	{
 	public:
-		StepTimer() : 
+		StepTimer() : StepTimer(SystemStepClock::Get())
+		{
+		}
+
+		// Times the updates with clock, which has to outlive the timer
+		explicit StepTimer(const StepClock &clock) :
+			m_clock(&clock),
 			m_elapsedTicks(0),
 			m_totalTicks(0),
 			m_leftOverTicks(0),
@@ -19,46 +104,42 @@ namespace DX
 			m_isFixedTimeStep(false),
 			m_targetElapsedTicks(TicksPerSecond / 60)
 		{
-			if (!QueryPerformanceFrequency(&m_qpcFrequency))
-			{
-				throw ref new Platform::FailureException();
-			}
-
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_qpcFrequency = m_clock->GetFrequency();
+			m_qpcLastTime = m_clock->GetTicks();
 
 			// Initialize max delta to 1/10 of a second.
-			m_qpcMaxDelta = m_qpcFrequency.QuadPart / 10;
+			m_qpcMaxDelta = m_qpcFrequency / 10;
 		}
 
 		// Get elapsed time since the previous Update call.
-		uint64 GetElapsedTicks() const						{ return m_elapsedTicks; }
+		uint64_t GetElapsedTicks() const					{ return m_elapsedTicks; }
 		double GetElapsedSeconds() const					{ return TicksToSeconds(m_elapsedTicks); }
 
 		// Get total time since the start of the program.
-		uint64 GetTotalTicks() const						{ return m_totalTicks; }
+		uint64_t GetTotalTicks() const						{ return m_totalTicks; }
 		double GetTotalSeconds() const						{ return TicksToSeconds(m_totalTicks); }
 
 		// Get total number of updates since start of the program.
-		uint32 GetFrameCount() const						{ return m_frameCount; }
+		uint32_t GetFrameCount() const						{ return m_frameCount; }
 
 		// Get the current framerate.
-		uint32 GetFramesPerSecond() const					{ return m_framesPerSecond; }
+		uint32_t GetFramesPerSecond() const					{ return m_framesPerSecond; }
+
+		// Get the time carried over to the next fixed timestep Update, as of the last Tick.
+		uint64_t GetLeftOverTicks() const					{ return m_leftOverTicks; }
 
 		// Set whether to use fixed or variable timestep mode.
 		void SetFixedTimeStep(bool isFixedTimestep)			{ m_isFixedTimeStep = isFixedTimestep; }
 
 		// Set how often to call Update when in fixed timestep mode.
-		void SetTargetElapsedTicks(uint64 targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
+		void SetTargetElapsedTicks(uint64_t targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
 		void SetTargetElapsedSeconds(double targetElapsed)	{ m_targetElapsedTicks = SecondsToTicks(targetElapsed); }
 
 		// Integer format represents time using 10,000,000 ticks per second.
-		static const uint64 TicksPerSecond = 10000000;
+		static const uint64_t TicksPerSecond = 10000000;
 
-		static double TicksToSeconds(uint64 ticks)			{ return static_cast<double>(ticks) / TicksPerSecond; }
-		static uint64 SecondsToTicks(double seconds)		{ return static_cast<uint64>(seconds * TicksPerSecond); }
+		static double TicksToSeconds(uint64_t ticks)		{ return static_cast<double>(ticks) / TicksPerSecond; }
+		static uint64_t SecondsToTicks(double seconds)		{ return static_cast<uint64_t>(seconds * TicksPerSecond); }
 
 		// After an intentional timing discontinuity (for instance a blocking IO operation)
 		// call this to avoid having the fixed timestep logic attempt a set of catch-up 
@@ -66,10 +147,7 @@ namespace DX
 
 		void ResetElapsedTime()
 		{
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_qpcLastTime = m_clock->GetTicks();
 
 			m_leftOverTicks = 0;
 			m_framesPerSecond = 0;
@@ -82,14 +160,9 @@ namespace DX
 		void Tick(const TUpdate& update)
 		{
 			// Query the current time.
-			LARGE_INTEGER currentTime;
+			const uint64_t currentTime = m_clock->GetTicks();
 
-			if (!QueryPerformanceCounter(&currentTime))
-			{
-				throw ref new Platform::FailureException();
-			}
-
-			uint64 timeDelta = currentTime.QuadPart - m_qpcLastTime.QuadPart;
+			uint64_t timeDelta = currentTime - m_qpcLastTime;
 
 			m_qpcLastTime = currentTime;
 			m_qpcSecondCounter += timeDelta;
@@ -100,11 +173,11 @@ namespace DX
 				timeDelta = m_qpcMaxDelta;
 			}
 
-			// Convert QPC units into a canonical tick format. This cannot overflow due to the previous clamp.
+			// Convert clock units into a canonical tick format. This cannot overflow due to the previous clamp.
 			timeDelta *= TicksPerSecond;
-			timeDelta /= m_qpcFrequency.QuadPart;
+			timeDelta /= m_qpcFrequency;
 
-			uint32 lastFrameCount = m_frameCount;
+			uint32_t lastFrameCount = m_frameCount;
 
 			if (m_isFixedTimeStep)
 			{
@@ -117,7 +190,7 @@ namespace DX
 				// accumulate enough tiny errors that it would drop a frame. It is better to just round 
 				// small deviations down to zero to leave things running smoothly.
 
-				if (abs(static_cast<int64>(timeDelta - m_targetElapsedTicks)) < TicksPerSecond / 4000)
+				if (std::llabs(static_cast<long long>(timeDelta - m_targetElapsedTicks)) < static_cast<long long>(TicksPerSecond / 4000))
 				{
 					timeDelta = m_targetElapsedTicks;
 				}
@@ -151,33 +224,35 @@ namespace DX
 				m_framesThisSecond++;
 			}
 
-			if (m_qpcSecondCounter >= static_cast<uint64>(m_qpcFrequency.QuadPart))
+			if (m_qpcSecondCounter >= m_qpcFrequency)
 			{
 				m_framesPerSecond = m_framesThisSecond;
 				m_framesThisSecond = 0;
-				m_qpcSecondCounter %= m_qpcFrequency.QuadPart;
+				m_qpcSecondCounter %= m_qpcFrequency;
 			}
 		}
 
 	private:
-		// Source timing data uses QPC units.
-		LARGE_INTEGER m_qpcFrequency;
-		LARGE_INTEGER m_qpcLastTime;
-		uint64 m_qpcMaxDelta;
+		const StepClock *m_clock;
+
+		// Source timing data uses the clock's units.
+		uint64_t m_qpcFrequency;
+		uint64_t m_qpcLastTime;
+		uint64_t m_qpcMaxDelta;
 
 		// Derived timing data uses a canonical tick format.
-		uint64 m_elapsedTicks;
-		uint64 m_totalTicks;
-		uint64 m_leftOverTicks;
+		uint64_t m_elapsedTicks;
+		uint64_t m_totalTicks;
+		uint64_t m_leftOverTicks;
 
 		// Members for tracking the framerate.
-		uint32 m_frameCount;
-		uint32 m_framesPerSecond;
-		uint32 m_framesThisSecond;
-		uint64 m_qpcSecondCounter;
+		uint32_t m_frameCount;
+		uint32_t m_framesPerSecond;
+		uint32_t m_framesThisSecond;
+		uint64_t m_qpcSecondCounter;
 
 		// Members for configuring fixed timestep mode.
 		bool m_isFixedTimeStep;
-		uint64 m_targetElapsedTicks;
+		uint64_t m_targetElapsedTicks;
 	};
 }
@@ -0,0 +1,40 @@
+#pragma pack_matrix(row_major)
+
+// A constant buffer that stores the three basic column-major matrices for composing geometry.
+cbuffer ModelViewProjectionConstantBuffer : register(b0)
+{
+	matrix model;
+	matrix view;
+	matrix projection;
+};
+
+#include "PackedVertex.hlsli"
+
+// Per-pixel color data passed through the pixel shader.
+struct PixelShaderInput
+{
+	float4 pos  : SV_POSITION;
+	float2 uv 	: UV;
+	float3 norm : NORM;
+};
+
+// Simple shader to do vertex processing on the GPU.
+PixelShaderInput main(PackedVertexShaderInput input)
+{
+	PixelShaderInput output;
+	float4 pos = float4(DecodePosition(input.pos), 1.0f);
+
+	// Transform the vertex position into projected space.
+	pos = mul(pos, model);
+	pos = mul(pos, view);
+	pos = mul(pos, projection);
+	output.pos = pos;
+
+	// Pass the color through without modification.
+	output.uv = input.uv;
+
+	// Normals only need unfolding.
+	output.norm = DecodeOctahedral(input.norm);
+
+	return output;
+}
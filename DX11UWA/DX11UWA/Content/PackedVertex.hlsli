@@ -0,0 +1,30 @@
+// Decodes DX11UWA::VertexPositionUVNormalPacked, see VertexPacking.h.
+
+// Maps the packed positions back to model space
+cbuffer VertexDequantizationConstantBuffer : register(b1)
+{
+	float4 positionScale;
+	float4 positionOffset;
+};
+
+// Per-vertex data used as input to the vertex shader.
+struct PackedVertexShaderInput
+{
+	float4 pos : POSITION;	// R16G16B16A16_UNORM, w is padding
+	float2 uv : UV;			// R16G16_FLOAT
+	float2 norm : NORM;		// R16G16_SNORM, octahedral
+};
+
+float3 DecodePosition(float4 pos)
+{
+	return positionOffset.xyz + pos.xyz * positionScale.xyz;
+}
+
+// Unfolds a point of the octahedron's projection back into a unit vector
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += (n.xy >= 0.0f) ? -t : t;
+	return normalize(n);
+}
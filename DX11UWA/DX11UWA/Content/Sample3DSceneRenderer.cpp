@@ -2,25 +2,532 @@
 #include "Sample3DSceneRenderer.h"
 
 #include "..\Common\DirectXHelper.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <string>
 
 using namespace DX11UWA;
 
 using namespace DirectX;
 using namespace Windows::Foundation;
 
+namespace
+{
+	// The install folder is read only, so mesh caches go in the app's local cache folder
+	std::string meshCachePath(const char *name)
+	{
+		Platform::String^ folder = Windows::Storage::ApplicationData::Current->LocalCacheFolder->Path;
+
+		char path[MAX_PATH];
+		if (WideCharToMultiByte(CP_UTF8, 0, folder->Data(), -1, path, MAX_PATH, nullptr, nullptr) == 0)
+			return name;
+
+		return std::string(path) + "\\" + name;
+	}
+
+	// OBJs and the MTL files they use
+	const char *modelFolder = "Assets/Models";
+
+	std::string modelObjPath(const char *name)
+	{
+		return std::string(modelFolder) + "/" + name + ".obj";
+	}
+
+	// Optimized, clustered, simplified and with tangents like the cooked meshes are
+	ObjLoadOptions cookOptions(const ObjLoadOptions &options)
+	{
+		ObjLoadOptions optimized = options;
+		optimized.optimize = true;
+		optimized.buildClusters = true;
+		optimized.buildTangents = true;
+		optimized.lodCount = MESH_LOD_DEFAULT_COUNT;
+		return optimized;
+	}
+
+	// Maps the mesh the asset cooker shipped with the app, or the local cache if it's up to date. Never cooks anything.
+	bool openModel(const char *name, RMesh &mesh, const ObjLoadOptions &options = ObjLoadOptions())
+	{
+		if (mesh.Open(("Assets/Cooked/Models/" + std::string(name) + ".rmesh").c_str()))
+			return true;
+
+		return openMeshCache(modelObjPath(name).c_str(), meshCachePath((std::string(name) + ".rmesh").c_str()).c_str(),
+			mesh, cookOptions(options), findMeshRecipe(name));
+	}
+
+	// Uses the mesh the asset cooker shipped with the app when there is one. Otherwise the OBJ is loaded
+	// through the local cache, with the same recipe the cooker would have applied.
+	bool loadModel(const char *name, RMesh &mesh, const ObjLoadOptions &options = ObjLoadOptions())
+	{
+		if (mesh.Open(("Assets/Cooked/Models/" + std::string(name) + ".rmesh").c_str()))
+			return true;
+
+		return loadMeshCached(modelObjPath(name).c_str(), meshCachePath((std::string(name) + ".rmesh").c_str()).c_str(),
+			mesh, cookOptions(options), findMeshRecipe(name));
+	}
+
+	// Input layout of VertexPositionUVNormalPacked, for the Packed*VertexShaders
+	const D3D11_INPUT_ELEMENT_DESC packedVertexDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "UV", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORM", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+
+	// Creates the vertex buffer of the geometry from the mesh. Packed vertices also get the constant buffer
+	// the vertex shader decodes their positions with.
+	void createVertexBuffer(ID3D11Device *device, const RMesh &mesh, bool packed, MeshGeometry &model)
+	{
+		D3D11_SUBRESOURCE_DATA vertexBufferData = { 0 };
+		std::vector<DX11UWA::VertexPositionUVNormalPacked> packedVertices;
+
+		if (packed)
+		{
+			const VertexQuantization quantization = computeVertexQuantization(mesh.GetVertices(), mesh.GetVertexCount());
+			packedVertices.resize(mesh.GetVertexCount());
+			packVertices(mesh.GetVertices(), mesh.GetVertexCount(), quantization, packedVertices.data());
+
+			const DX11UWA::VertexDequantizationConstantBuffer constants = makeDequantizationConstants(quantization);
+			D3D11_SUBRESOURCE_DATA constantBufferData = { 0 };
+			constantBufferData.pSysMem = &constants;
+			CD3D11_BUFFER_DESC constantBufferDesc(sizeof(constants), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_IMMUTABLE);
+			DX::ThrowIfFailed(device->CreateBuffer(&constantBufferDesc, &constantBufferData, &model._dequantizationBuffer));
+
+			vertexBufferData.pSysMem = packedVertices.data();
+			model._vertexStride = sizeof(DX11UWA::VertexPositionUVNormalPacked);
+		}
+		else
+		{
+			vertexBufferData.pSysMem = mesh.GetVertices();
+			model._vertexStride = sizeof(DX11UWA::VertexPositionUVNormal);
+		}
+
+		CD3D11_BUFFER_DESC vertexBufferDesc(model._vertexStride * mesh.GetVertexCount(), D3D11_BIND_VERTEX_BUFFER);
+		DX::ThrowIfFailed(device->CreateBuffer(&vertexBufferDesc, &vertexBufferData, &model._vertexBuffer));
+	}
+
+	// Creates the index buffer of the geometry in the mesh's index format, and keeps its submeshes, levels of detail and clusters to draw.
+	// The mesh's materials are looked up in the shared table, loading their libraries if they haven't been yet.
+	void createIndexBuffer(ID3D11Device *device, const RMesh &mesh, MaterialTable &materials, MeshGeometry &model)
+	{
+		model._indexCount = mesh.GetIndexCount();
+		model._indexFormat = (mesh.GetIndexStride() == sizeof(uint16_t)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		model._submeshes.assign(mesh.GetSubmeshes(), mesh.GetSubmeshes() + mesh.GetSubmeshCount());
+		model._submeshBounds.assign(mesh.GetSubmeshBounds(), mesh.GetSubmeshBounds() + mesh.GetSubmeshCount());
+
+		model._materials.resize(mesh.GetMaterialCount());
+		for (uint32_t i = 0; i < mesh.GetMaterialCount(); ++i)
+			model._materials[i] = materials.Resolve(modelFolder, mesh.GetMaterials()[i].library, mesh.GetMaterials()[i].name);
+
+		model._lods.assign(mesh.GetLods(), mesh.GetLods() + mesh.GetLodCount());
+
+		const RMeshHeader &header = mesh.GetHeader();
+		const XMFLOAT3 extent((header.boundsMax[0] - header.boundsMin[0]) * 0.5f, (header.boundsMax[1] - header.boundsMin[1]) * 0.5f,
+			(header.boundsMax[2] - header.boundsMin[2]) * 0.5f);
+		model._boundsCenter = XMFLOAT3(header.boundsMin[0] + extent.x, header.boundsMin[1] + extent.y, header.boundsMin[2] + extent.z);
+		model._boundsRadius = sqrtf(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+		model._clusters.assign(mesh.GetClusters(), mesh.GetClusters() + mesh.GetClusterCount());
+		prepareClusterBounds(model._clusters.data(), model._clusters.size(), model._clusterBounds);
+
+		D3D11_SUBRESOURCE_DATA indexBufferData = { 0 };
+		indexBufferData.pSysMem = mesh.GetIndices();
+		CD3D11_BUFFER_DESC indexBufferDesc(mesh.GetIndexStride() * mesh.GetIndexCount(), D3D11_BIND_INDEX_BUFFER);
+		DX::ThrowIfFailed(device->CreateBuffer(&indexBufferDesc, &indexBufferData, &model._indexBuffer));
+	}
+
+	// Bytes of OBJ text the loading thread parses between hand-offs to the render thread
+	const size_t streamChunkSize = 256 * 1024;
+
+	// Converts a streamed batch to the formats of the model's buffers and queues it for the render thread
+	void queueStreamBatch(MeshStream &stream, ObjStreamBatch &batch, const MeshRecipe *recipe, const VertexQuantization *quantization, UINT indexStride)
+	{
+		if (recipe)
+			applyMeshRecipe(*recipe, batch.vertices.data(), batch.vertices.size());
+
+		std::vector<uint8_t> vertices, indices;
+
+		if (quantization)
+		{
+			vertices.resize(batch.vertices.size() * sizeof(DX11UWA::VertexPositionUVNormalPacked));
+			packVertices(batch.vertices.data(), batch.vertices.size(), *quantization, reinterpret_cast<DX11UWA::VertexPositionUVNormalPacked *>(vertices.data()));
+		}
+		else
+		{
+			const uint8_t *bytes = reinterpret_cast<const uint8_t *>(batch.vertices.data());
+			vertices.assign(bytes, bytes + batch.vertices.size() * sizeof(DX11UWA::VertexPositionUVNormal));
+		}
+
+		indices.resize(batch.indices.size() * indexStride);
+		if (indexStride == sizeof(uint16_t))
+		{
+			uint16_t *shortIndices = reinterpret_cast<uint16_t *>(indices.data());
+			for (size_t i = 0; i < batch.indices.size(); ++i)
+				shortIndices[i] = static_cast<uint16_t>(batch.indices[i]);
+		}
+		else if (!batch.indices.empty())
+			memcpy(indices.data(), batch.indices.data(), indices.size());
+
+		std::lock_guard<std::mutex> lock(stream.mutex);
+		stream.vertices.insert(stream.vertices.end(), vertices.begin(), vertices.end());
+		stream.indices.insert(stream.indices.end(), indices.begin(), indices.end());
+	}
+
+	// The key a mesh is shared under, naming everything that changes what's uploaded
+	std::string meshKey(const char *name, const ObjLoadOptions &options, bool packed)
+	{
+		return std::string(name) + ":" + std::to_string(meshBuildKey(cookOptions(options), findMeshRecipe(name))) + (packed ? ":packed" : "");
+	}
+
+	// An OBJ that is being streamed into a mesh, read up to the first triangles
+	struct PendingMeshStream
+	{
+		ObjStreamReader		reader;
+		ObjStreamBatch		batch;
+		const MeshRecipe	*recipe;
+		VertexQuantization	quantization;
+		UINT				indexStride;
+
+		std::shared_ptr<MeshStream>	stream;
+	};
+
+	// Used when there is no cooked or cached mesh to map. Buffers big enough for the whole mesh are created and
+	// the mesh made drawable right away, then finishMeshStream reads the rest. Returns false, without touching
+	// the mesh, if the OBJ can't be streamed.
+	bool startMeshStream(ID3D11Device *device, const char *name, bool packed, MeshGeometry &model, PendingMeshStream &pending)
+	{
+		ObjStreamReader &reader = pending.reader;
+		if (!reader.Open(modelObjPath(name).c_str()) || reader.GetCornerCount() == 0)
+			return false;
+
+		// The reader has the bounds the vertices are packed with since it opened the file, read on to the first triangles
+		do
+		{
+			if (!reader.Read(streamChunkSize, pending.batch))
+				return false;
+		} while (pending.batch.indices.empty() && !reader.IsFinished());
+
+		pending.recipe = findMeshRecipe(name);
+		const XMFLOAT3 offset = pending.recipe ? pending.recipe->offset : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		const XMFLOAT3 &boundsMin = reader.GetBoundsMin();
+		const XMFLOAT3 &boundsMax = reader.GetBoundsMax();
+
+		VertexQuantization &quantization = pending.quantization;
+		quantization.offset = XMFLOAT3(boundsMin.x + offset.x, boundsMin.y + offset.y, boundsMin.z + offset.z);
+		quantization.scale = XMFLOAT3(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z);
+
+		// There are never more vertices than corners, and exactly as many indices
+		const UINT maxCount = static_cast<UINT>(reader.GetCornerCount());
+		pending.indexStride = (maxCount <= RMESH_MAX_16BIT_VERTICES) ? sizeof(uint16_t) : sizeof(uint32_t);
+
+		model._vertexStride = packed ? sizeof(DX11UWA::VertexPositionUVNormalPacked) : sizeof(DX11UWA::VertexPositionUVNormal);
+		model._indexFormat = (pending.indexStride == sizeof(uint16_t)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+		CD3D11_BUFFER_DESC vertexBufferDesc(model._vertexStride * maxCount, D3D11_BIND_VERTEX_BUFFER);
+		DX::ThrowIfFailed(device->CreateBuffer(&vertexBufferDesc, nullptr, &model._vertexBuffer));
+		CD3D11_BUFFER_DESC indexBufferDesc(pending.indexStride * maxCount, D3D11_BIND_INDEX_BUFFER);
+		DX::ThrowIfFailed(device->CreateBuffer(&indexBufferDesc, nullptr, &model._indexBuffer));
+
+		if (packed)
+		{
+			const DX11UWA::VertexDequantizationConstantBuffer constants = makeDequantizationConstants(quantization);
+			D3D11_SUBRESOURCE_DATA constantBufferData = { 0 };
+			constantBufferData.pSysMem = &constants;
+			CD3D11_BUFFER_DESC constantBufferDesc(sizeof(constants), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_IMMUTABLE);
+			DX::ThrowIfFailed(device->CreateBuffer(&constantBufferDesc, &constantBufferData, &model._dequantizationBuffer));
+		}
+
+		// One submesh and level of detail, grown as the triangles arrive, drawn with the default material until the cooked mesh has its own
+		const RMeshSubmesh whole = { 0, 0, 0, 0 };
+		const MeshLod level = { 0, 1, 0.0f, 0 };
+		const RMeshSubmeshBounds wholeBounds = { { boundsMin.x + offset.x, boundsMin.y + offset.y, boundsMin.z + offset.z },
+			{ boundsMax.x + offset.x, boundsMax.y + offset.y, boundsMax.z + offset.z } };
+		model._indexCount = 0;
+		model._submeshes.assign(1, whole);
+		model._submeshBounds.assign(1, wholeBounds);
+		model._materials.assign(1, 0);
+		model._lods.assign(1, level);
+		model._clusters.clear();
+
+		const XMFLOAT3 extent(quantization.scale.x * 0.5f, quantization.scale.y * 0.5f, quantization.scale.z * 0.5f);
+		model._boundsCenter = XMFLOAT3(quantization.offset.x + extent.x, quantization.offset.y + extent.y, quantization.offset.z + extent.z);
+		model._boundsRadius = sqrtf(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+
+		pending.stream = std::make_shared<MeshStream>();
+		model._stream = pending.stream;
+		return true;
+	}
+
+	// Parses the rest of the OBJ a chunk at a time and hands each chunk to the render thread to upload (see
+	// uploadStreamedGeometry). Once it's all read, what was parsed is cooked like loadModel cooks the OBJ, without
+	// reading the file again, and the result replaces the streamed mesh and is written to the local cache.
+	void finishMeshStream(ID3D11Device *device, const char *name, const ObjLoadOptions &options, bool packed, MaterialTable &materials, PendingMeshStream &pending)
+	{
+		MeshStream &stream = *pending.stream;
+
+		bool streamed = true;
+		for (;;)
+		{
+			queueStreamBatch(stream, pending.batch, pending.recipe, packed ? &pending.quantization : nullptr, pending.indexStride);
+			if (pending.reader.IsFinished())
+				break;
+
+			// A malformed file keeps the triangles read before the error
+			if (!pending.reader.Read(streamChunkSize, pending.batch))
+			{
+				streamed = false;
+				break;
+			}
+		}
+
+		std::unique_ptr<MeshGeometry> replacement;
+		RMesh mesh;
+		if (streamed && cookMesh(modelObjPath(name).c_str(), pending.reader, mesh, cookOptions(options), findMeshRecipe(name)))
+		{
+			// The cache only saves the next run from cooking again, so the mesh is used even if it can't be written
+			mesh.Save(meshCachePath((std::string(name) + ".rmesh").c_str()).c_str());
+
+			replacement.reset(new MeshGeometry());
+			createVertexBuffer(device, mesh, packed, *replacement);
+			createIndexBuffer(device, mesh, materials, *replacement);
+		}
+
+		std::lock_guard<std::mutex> lock(stream.mutex);
+		stream.replacement = std::move(replacement);
+		stream.finished = true;
+	}
+
+	// Gives the model the mesh every other model drawn from the same OBJ with the same settings uses. When there
+	// is none yet it's created from the cooked or cached mesh, or streamed in when there is neither, in which
+	// case the model is drawable as soon as the first triangles are read and the call returns once the rest is.
+	// Returns false if it can't be loaded at all.
+	bool createModel(ID3D11Device *device, DX::D3DAssetCache &assets, const char *name, const ObjLoadOptions &options, bool packed, Model &model)
+	{
+		PROFILE_FUNCTION();
+
+		std::unique_ptr<PendingMeshStream> pending;
+		std::shared_ptr<MeshGeometry> shared = assets.AcquireMesh(meshKey(name, options, packed), [&]() -> std::shared_ptr<MeshGeometry>
+		{
+			std::shared_ptr<MeshGeometry> created = std::make_shared<MeshGeometry>();
+			RMesh mesh;
+			if (!openModel(name, mesh, options))
+			{
+				pending.reset(new PendingMeshStream());
+				if (startMeshStream(device, name, packed, *created, *pending))
+					return created;
+				pending.reset();
+
+				if (!loadModel(name, mesh, options))
+					return nullptr;
+			}
+
+			createVertexBuffer(device, mesh, packed, *created);
+			createIndexBuffer(device, mesh, assets.GetMaterials(), *created);
+			return created;
+		});
+
+		if (!shared)
+			return false;
+
+		std::atomic_store(&model._mesh, shared);
+		model._lod = 0;
+
+		// Only the model that started the stream reads the rest of it, every other one just draws what there is
+		if (pending)
+		{
+			model._loadingComplete.store(true, std::memory_order_release);
+			finishMeshStream(device, name, options, packed, assets.GetMaterials(), *pending);
+		}
+		return true;
+	}
+
+	// Takes over the buffers and draw data of a mesh built on another thread
+	void adoptMesh(MeshGeometry &model, MeshGeometry &built)
+	{
+		model._vertexBuffer = built._vertexBuffer;
+		model._indexBuffer = built._indexBuffer;
+		model._dequantizationBuffer = built._dequantizationBuffer;
+		model._vertexStride = built._vertexStride;
+		model._indexCount = built._indexCount;
+		model._indexFormat = built._indexFormat;
+		model._submeshes.swap(built._submeshes);
+		model._submeshBounds.swap(built._submeshBounds);
+		model._materials.swap(built._materials);
+		model._lods.swap(built._lods);
+		model._boundsCenter = built._boundsCenter;
+		model._boundsRadius = built._boundsRadius;
+		model._clusters.swap(built._clusters);
+		std::swap(model._clusterBounds, built._clusterBounds);
+	}
+
+	// Uploads what the loading thread streamed in since the last frame after the geometry already in the
+	// mesh's buffers and draws that much more. Swaps in the cooked mesh once it's ready. Every model drawn from
+	// the mesh sees it, whichever of them calls this first in a frame.
+	void uploadStreamedGeometry(ID3D11DeviceContext *context, MeshGeometry &model)
+	{
+		PROFILE_FUNCTION();
+
+		MeshStream &stream = *model._stream;
+
+		std::vector<uint8_t> vertices, indices;
+		std::unique_ptr<MeshGeometry> replacement;
+		bool finished;
+		{
+			std::lock_guard<std::mutex> lock(stream.mutex);
+			vertices.swap(stream.vertices);
+			indices.swap(stream.indices);
+			replacement = std::move(stream.replacement);
+			finished = stream.finished;
+		}
+
+		if (replacement)
+		{
+			adoptMesh(model, *replacement);
+			model._stream.reset();
+			return;
+		}
+
+		// Vertices first, since the new triangles can use them
+		if (!vertices.empty())
+		{
+			const D3D11_BOX box = { stream.uploadedVertexBytes, 0, 0, stream.uploadedVertexBytes + static_cast<UINT>(vertices.size()), 1, 1 };
+			context->UpdateSubresource(model._vertexBuffer.Get(), 0, &box, vertices.data(), 0, 0);
+			stream.uploadedVertexBytes = box.right;
+		}
+
+		if (!indices.empty())
+		{
+			const D3D11_BOX box = { stream.uploadedIndexBytes, 0, 0, stream.uploadedIndexBytes + static_cast<UINT>(indices.size()), 1, 1 };
+			context->UpdateSubresource(model._indexBuffer.Get(), 0, &box, indices.data(), 0, 0);
+			stream.uploadedIndexBytes = box.right;
+
+			model._indexCount = stream.uploadedIndexBytes / ((model._indexFormat == DXGI_FORMAT_R16_UINT) ? sizeof(uint16_t) : sizeof(uint32_t));
+			model._submeshes[0].indexCount = model._indexCount;
+		}
+
+		if (finished)
+			model._stream.reset();
+	}
+
+	// Shared table index of the range's material
+	uint32_t sharedMaterial(const MeshGeometry &model, const RMeshSubmesh &range)
+	{
+		return (range.materialIndex < model._materials.size()) ? model._materials[range.materialIndex] : 0;
+	}
+
+	// Puts the ranges with the same material next to each other, keeping them in index buffer order otherwise, and
+	// merges the ones that end up back to back. The shaders don't take material constants yet, but once they do
+	// each run is where they're bound.
+	void sortDrawRanges(const MeshGeometry &model, std::vector<RMeshSubmesh> &ranges)
+	{
+		std::stable_sort(ranges.begin(), ranges.end(), [&model](const RMeshSubmesh &a, const RMeshSubmesh &b)
+		{
+			return sharedMaterial(model, a) < sharedMaterial(model, b);
+		});
+
+		size_t merged = 0;
+		for (size_t i = 0; i < ranges.size(); ++i)
+		{
+			if (merged > 0)
+			{
+				RMeshSubmesh &last = ranges[merged - 1];
+				if (last.baseVertex == ranges[i].baseVertex && sharedMaterial(model, last) == sharedMaterial(model, ranges[i]) &&
+					last.indexStart + last.indexCount == ranges[i].indexStart)
+				{
+					last.indexCount += ranges[i].indexCount;
+					continue;
+				}
+			}
+			ranges[merged++] = ranges[i];
+		}
+		ranges.resize(merged);
+	}
+
+	// Draws the model's submeshes at the level of detail its size on screen calls for, skipping the ones
+	// outside the view and grouped by material. At full detail, models with clusters only draw the clusters
+	// that can be seen with these matrices.
+	void drawSubmeshes(ID3D11DeviceContext *context, Model &model, const MeshGeometry &mesh, const ModelViewProjectionConstantBuffer &matrices, float lodPixelScale)
+	{
+		PROFILE_FUNCTION();
+
+		const XMMATRIX modelView = XMMatrixMultiply(XMLoadFloat4x4(&matrices.model), XMLoadFloat4x4(&matrices.view));
+
+		// The camera is the origin of view space
+		XMFLOAT3 camera;
+		XMStoreFloat3(&camera, XMMatrixInverse(nullptr, modelView).r[3]);
+
+		// The levels change when a streamed mesh is replaced by its cooked one
+		if (model._lod >= mesh._lods.size())
+			model._lod = 0;
+		model._lod = selectMeshLod(mesh._lods.data(), mesh._lods.size(), lodDistance(camera, mesh._boundsCenter, mesh._boundsRadius), lodPixelScale, model._lod);
+
+		XMFLOAT4X4 modelViewProjection;
+		XMStoreFloat4x4(&modelViewProjection, XMMatrixMultiply(modelView, XMLoadFloat4x4(&matrices.projection)));
+		const ClusterCullView view = makeClusterCullView(camera, modelViewProjection);
+
+		if (model._lod > 0 || mesh._clusters.empty())
+		{
+			model._drawRanges.clear();
+			const MeshLod &lod = mesh._lods[model._lod];
+			for (uint32_t i = lod.submeshStart; i < lod.submeshStart + lod.submeshCount; ++i)
+			{
+				if (i < mesh._submeshBounds.size() && isBoxOutsideView(mesh._submeshBounds[i].boundsMin, mesh._submeshBounds[i].boundsMax, view))
+					continue;
+				model._drawRanges.push_back(mesh._submeshes[i]);
+			}
+		}
+		else
+		{
+			model._clusterCulling.resize(mesh._clusters.size());
+			cullMeshClusters(mesh._clusterBounds, view, model._clusterCulling.data());
+			buildClusterDrawRanges(mesh._clusters.data(), mesh._clusters.size(), model._clusterCulling.data(), mesh._submeshes.data(), model._drawRanges);
+		}
+
+		sortDrawRanges(mesh, model._drawRanges);
+
+		for (const RMeshSubmesh &range : model._drawRanges)
+			context->DrawIndexed(range.indexCount, range.indexStart, range.baseVertex);
+	}
+
+	// Lets go of the model's shared mesh and shaders and of its own constant buffer
+	void releaseModel(Model &model)
+	{
+		model._loadingComplete.store(false, std::memory_order_release);
+		std::atomic_store(&model._mesh, std::shared_ptr<MeshGeometry>());
+		model._inputLayout.reset();
+		model._vertexShader.reset();
+		model._pixelShader.reset();
+		model._constantBuffer.Reset();
+	}
+
+	// Pixels across the model's bounding sphere covers on screen, which its textures stream in for
+	float screenSize(const MeshGeometry &mesh, const ModelViewProjectionConstantBuffer &matrices, float lodPixelScale)
+	{
+		const XMMATRIX modelView = XMMatrixMultiply(XMLoadFloat4x4(&matrices.model), XMLoadFloat4x4(&matrices.view));
+
+		XMFLOAT3 camera;
+		XMStoreFloat3(&camera, XMMatrixInverse(nullptr, modelView).r[3]);
+
+		return 2.0f * mesh._boundsRadius * lodPixelScale / lodDistance(camera, mesh._boundsCenter, mesh._boundsRadius);
+	}
+}
+
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
-Sample3DSceneRenderer::Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
+Sample3DSceneRenderer::Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, const std::shared_ptr<DX::D3DAssetCache>& assets) :
 	m_loadingComplete(false),
-	m_degreesPerSecond(45),
 	m_indexCount(0),
 	m_tracking(false),
-	m_deviceResources(deviceResources)
+	m_packedVertices(true),
+	m_lodPixelScale(0.0f),
+	m_viewportHeight(0.0f),
+	m_deviceResources(deviceResources),
+	m_assets(assets)
 {
-	memset(m_kbuttons, 0, sizeof(m_kbuttons));
-	m_currMousePos = nullptr;
-	m_prevMousePos = nullptr;
 	memset(&m_camera, 0, sizeof(XMFLOAT4X4));
 
+	// Each model is drawn as soon as it's loaded
+	big_daddy_model._loadingComplete.store(false, std::memory_order_relaxed);
+	floor_model._loadingComplete.store(false, std::memory_order_relaxed);
+
 	CreateDeviceDependentResources();
 	CreateWindowSizeDependentResources();
 }
@@ -47,6 +554,8 @@ void Sample3DSceneRenderer::CreateWindowSizeDependentResources(void)
 
 	// This sample makes use of a right-handed coordinate system using row-major matrices.
 	XMMATRIX perspectiveMatrix = XMMatrixPerspectiveFovLH(fovAngleY, aspectRatio, 0.01f, 100.0f);
+	m_lodPixelScale = lodPixelScale(outputSize.Height, fovAngleY);
+	m_viewportHeight = outputSize.Height;
 
 	XMFLOAT4X4 orientation = m_deviceResources->GetOrientationTransform3D();
 
@@ -63,88 +572,29 @@ void Sample3DSceneRenderer::CreateWindowSizeDependentResources(void)
 	static const XMVECTORF32 at = { 0.0f, -0.1f, 0.0f, 0.0f };
 	static const XMVECTORF32 up = { 0.0f, 1.0f, 0.0f, 0.0f };
 
-	XMStoreFloat4x4(&m_camera, XMMatrixInverse(nullptr, XMMatrixLookAtLH(eye, at, up)));
-
-	// Update the constant buffer data based on camera
+	// Update the constant buffer data based on camera. Render draws from the simulation's camera instead.
 	XMStoreFloat4x4(&m_constantBufferData.view, (XMMatrixLookAtLH(eye, at, up)));
 	XMStoreFloat4x4(&m_constantBufferData_big_daddy.view, (XMMatrixLookAtLH(eye, at, up)));
 	XMStoreFloat4x4(&m_constantBufferData_floor.view, (XMMatrixLookAtLH(eye, at, up)));
 
 }
 
-// Called once per frame, rotates the cube and calculates the model and view matrices.
-void Sample3DSceneRenderer::Update(DX::StepTimer const& timer)
+// Called once per frame before Render, with the scene to draw interpolated between the last two simulation steps.
+void Sample3DSceneRenderer::Update(const SceneSnapshot &scene)
 {
-	if (!m_tracking)
-	{
-		// Convert degrees to radians, then convert seconds to rotation angle
-		float radiansPerSecond = XMConvertToRadians(m_degreesPerSecond);
-		double totalRotation = timer.GetTotalSeconds() * radiansPerSecond;
-		float radians = static_cast<float>(fmod(totalRotation, XM_2PI));
-
-		Rotate(radians);
-	}
-
-
-	// Update or move camera here
-	UpdateCamera(timer, 1.0f, 0.75f);
-
-	// Update lights
-	// Update the directional light
-	y_inc_dir = timer.GetElapsedSeconds();
-	float directional_light_boundaries = 5.0f;
-
-	if (floor_directional_light.direction.y >= directional_light_boundaries)
-	{
-		floor_directional_light.direction.y = directional_light_boundaries;
-		y_inc_dir *= -1.0f;
-	}
-	if (floor_directional_light.direction.y <= -directional_light_boundaries)
-	{
-		floor_directional_light.direction.y = -directional_light_boundaries;
-		y_inc_dir *= -1.0f;
-	}
+	PROFILE_FUNCTION();
 
-	floor_directional_light.direction.y += y_inc_dir;
-
-	// Point Light
-	x_inc_point = timer.GetElapsedSeconds();
-	float point_light_boundaries = 4.0f;
-
-	// Update the position of the point light
-	if (floor_point_light.position.x >= point_light_boundaries)
-	{
-		floor_point_light.position.x = point_light_boundaries;
-		x_inc_point *= -1.0f;
-	}
-
-	if (floor_point_light.position.x <= -point_light_boundaries)
+	if (!m_tracking)
 	{
-		floor_point_light.position.x = -point_light_boundaries;
-		x_inc_point *= -1.0f;
+		Rotate(scene.modelRadians);
 	}
 
-	floor_point_light.position.x += x_inc_point;
-
-	// Update the position of the spot light
-	x_inc_spot_pos = timer.GetElapsedSeconds();
-	z_inc_spot_pos = timer.GetElapsedSeconds();
-	x_inc_spot_dir = timer.GetElapsedSeconds();
-
-	if (floor_spot_light.position.x >= 0.25f || floor_spot_light.position.x <= -0.25f)
-		x_inc_spot_pos *= -1.0f;
-	if (floor_spot_light.position.z >= 0.25f || floor_spot_light.position.z <= -0.25f)
-		z_inc_spot_pos *= -1.0f;
+	m_camera = scene.camera;
 
-	if (floor_spot_light.cone_direction.x >= 0.25f || floor_spot_light.cone_direction.x <= -0.25f)
-		x_inc_spot_dir *= -1.0f;
-
-	floor_spot_light.position.x += x_inc_spot_pos;
-	floor_spot_light.position.z += z_inc_spot_pos;
-	floor_spot_light.cone_direction.x += x_inc_spot_dir;
-
-	// Update the Lights
-	UpdateLights();
+	// The floor's constant buffers are filled with them as it's drawn
+	floor_directional_light = scene.directional;
+	floor_point_light = scene.point;
+	floor_spot_light = scene.spot;
 }
 
 // Rotate the 3D cube model a set amount of radians.
@@ -163,101 +613,6 @@ void Sample3DSceneRenderer::Rotate(float radians)
 
 }
 
-void Sample3DSceneRenderer::UpdateCamera(DX::StepTimer const& timer, float const moveSpd, float const rotSpd)
-{
-	const float delta_time = (float)timer.GetElapsedSeconds();
-
-	if (m_kbuttons['W'])
-	{
-		XMMATRIX translation = XMMatrixTranslation(0.0f, 0.0f, moveSpd * delta_time);
-		XMMATRIX temp_camera = XMLoadFloat4x4(&m_camera);
-		XMMATRIX result = XMMatrixMultiply(translation, temp_camera);
-		XMStoreFloat4x4(&m_camera, result);
-	}
-	if (m_kbuttons['S'])
-	{
-		XMMATRIX translation = XMMatrixTranslation(0.0f, 0.0f, -moveSpd * delta_time);
-		XMMATRIX temp_camera = XMLoadFloat4x4(&m_camera);
-		XMMATRIX result = XMMatrixMultiply(translation, temp_camera);
-		XMStoreFloat4x4(&m_camera, result);
-	}
-	if (m_kbuttons['A'])
-	{
-		XMMATRIX translation = XMMatrixTranslation(-moveSpd * delta_time, 0.0f, 0.0f);
-		XMMATRIX temp_camera = XMLoadFloat4x4(&m_camera);
-		XMMATRIX result = XMMatrixMultiply(translation, temp_camera);
-		XMStoreFloat4x4(&m_camera, result);
-	}
-	if (m_kbuttons['D'])
-	{
-		XMMATRIX translation = XMMatrixTranslation(moveSpd * delta_time, 0.0f, 0.0f);
-		XMMATRIX temp_camera = XMLoadFloat4x4(&m_camera);
-		XMMATRIX result = XMMatrixMultiply(translation, temp_camera);
-		XMStoreFloat4x4(&m_camera, result);
-	}
-	if (m_kbuttons['X'])
-	{
-		XMMATRIX translation = XMMatrixTranslation( 0.0f, -moveSpd * delta_time, 0.0f);
-		XMMATRIX temp_camera = XMLoadFloat4x4(&m_camera);
-		XMMATRIX result = XMMatrixMultiply(translation, temp_camera);
-		XMStoreFloat4x4(&m_camera, result);
-	}
-	if (m_kbuttons[VK_SPACE])
-	{
-		XMMATRIX translation = XMMatrixTranslation( 0.0f, moveSpd * delta_time, 0.0f);
-		XMMATRIX temp_camera = XMLoadFloat4x4(&m_camera);
-		XMMATRIX result = XMMatrixMultiply(translation, temp_camera);
-		XMStoreFloat4x4(&m_camera, result);
-	}
-
-	if (m_currMousePos) 
-	{
-		if (m_currMousePos->Properties->IsRightButtonPressed && m_prevMousePos)
-		{
-			float dx = m_currMousePos->Position.X - m_prevMousePos->Position.X;
-			float dy = m_currMousePos->Position.Y - m_prevMousePos->Position.Y;
-
-			XMFLOAT4 pos = XMFLOAT4(m_camera._41, m_camera._42, m_camera._43, m_camera._44);
-
-			m_camera._41 = 0;
-			m_camera._42 = 0;
-			m_camera._43 = 0;
-
-			XMMATRIX rotX = XMMatrixRotationX(dy * rotSpd * delta_time);
-			XMMATRIX rotY = XMMatrixRotationY(dx * rotSpd * delta_time);
-
-			XMMATRIX temp_camera = XMLoadFloat4x4(&m_camera);
-			temp_camera = XMMatrixMultiply(rotX, temp_camera);
-			temp_camera = XMMatrixMultiply(temp_camera, rotY);
-
-			XMStoreFloat4x4(&m_camera, temp_camera);
-
-			m_camera._41 = pos.x;
-			m_camera._42 = pos.y;
-			m_camera._43 = pos.z;
-		}
-		m_prevMousePos = m_currMousePos;
-	}
-
-
-}
-
-void Sample3DSceneRenderer::SetKeyboardButtons(const char* list)
-{
-	memcpy_s(m_kbuttons, sizeof(m_kbuttons), list, sizeof(m_kbuttons));
-}
-
-void Sample3DSceneRenderer::SetMousePosition(const Windows::UI::Input::PointerPoint^ pos)
-{
-	m_currMousePos = const_cast<Windows::UI::Input::PointerPoint^>(pos);
-}
-
-void Sample3DSceneRenderer::SetInputDeviceData(const char* kb, const Windows::UI::Input::PointerPoint^ pos)
-{
-	SetKeyboardButtons(kb);
-	SetMousePosition(pos);
-}
-
 void DX11UWA::Sample3DSceneRenderer::StartTracking(void)
 {
 	m_tracking = true;
@@ -281,141 +636,160 @@ void Sample3DSceneRenderer::StopTracking(void)
 // Renders one frame using the vertex and pixel shaders.
 void Sample3DSceneRenderer::Render(DirectX::XMFLOAT4X4 view_matrix)
 {
+	PROFILE_FUNCTION();
+
 	m_constantBufferData.view = view_matrix;
 	m_constantBufferData_big_daddy.view = view_matrix;
 	m_constantBufferData_floor.view = view_matrix;
 
 	auto context = m_deviceResources->GetD3DDeviceContext();
 
+	// Every object is a triangle list, whichever of them are loaded
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
 #pragma region Skybox
 
-	// Loading is asynchronous. Only draw geometry after it's loaded.
-	if (!m_loadingComplete)
+	// Loading is asynchronous, and every object is drawn as soon as it's loaded, whatever the others are doing.
+	if (m_loadingComplete.load(std::memory_order_acquire))
 	{
-		return;
+		// Setup the Cubemap, which always covers the whole screen
+		m_assets->RequestTexture(m_skyboxTexture.get(), m_viewportHeight);
+
+		ID3D11ShaderResourceView *skyboxView = m_assets->GetTextureView(m_skyboxTexture.get());
+		context->PSSetShaderResources(0, 1, &skyboxView);
+
+		XMStoreFloat4x4(&m_constantBufferData.view, (XMMatrixInverse(nullptr, XMLoadFloat4x4(&m_camera))));
+
+		// Prepare the constant buffer to send it to the graphics device.
+		context->UpdateSubresource1(m_constantBuffer.Get(), 0, NULL, &m_constantBufferData, 0, 0, 0);
+		// Each vertex is one instance of the VertexPositionColor struct.
+		UINT stride = sizeof(VertexPositionColor);
+		UINT offset = 0;
+		context->IASetVertexBuffers(0, 1, m_vertexBuffer.GetAddressOf(), &stride, &offset);
+		// Each index is one 16-bit unsigned integer (short).
+		context->IASetIndexBuffer(m_indexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
+		context->IASetInputLayout(m_inputLayout.get());
+		// Attach our vertex shader.
+		context->VSSetShader(m_vertexShader.get(), nullptr, 0);
+		// Send the constant buffer to the graphics device.
+		context->VSSetConstantBuffers1(0, 1, m_constantBuffer.GetAddressOf(), nullptr, nullptr);
+		// Attach our pixel shader.
+		context->PSSetShader(m_pixelShader.get(), nullptr, 0);
+		// Draw the objects.
+		context->DrawIndexed(m_indexCount, 0, 0);
 	}
 
-
-	// Setup the Cubemap
-	ID3D11ShaderResourceView** skyboxViews[] = { skyboxSRV.GetAddressOf() };
-	context->PSSetShaderResources(0, 1, *skyboxViews);
-
-	XMStoreFloat4x4(&m_constantBufferData.view, (XMMatrixInverse(nullptr, XMLoadFloat4x4(&m_camera))));
-
-	// Prepare the constant buffer to send it to the graphics device.
-	context->UpdateSubresource1(m_constantBuffer.Get(), 0, NULL, &m_constantBufferData, 0, 0, 0);
-	// Each vertex is one instance of the VertexPositionColor struct.
-	UINT stride = sizeof(VertexPositionColor);
-	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, m_vertexBuffer.GetAddressOf(), &stride, &offset);
-	// Each index is one 16-bit unsigned integer (short).
-	context->IASetIndexBuffer(m_indexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	context->IASetInputLayout(m_inputLayout.Get());
-	// Attach our vertex shader.
-	context->VSSetShader(m_vertexShader.Get(), nullptr, 0);
-	// Send the constant buffer to the graphics device.
-	context->VSSetConstantBuffers1(0, 1, m_constantBuffer.GetAddressOf(), nullptr, nullptr);
-	// Attach our pixel shader.
-	context->PSSetShader(m_pixelShader.Get(), nullptr, 0);
-	// Draw the objects.
-	context->DrawIndexed(m_indexCount, 0, 0);
-
 #pragma endregion
 
 #pragma region Big Daddy Model
 
-	if (!big_daddy_model._loadingComplete)
+	std::shared_ptr<MeshGeometry> bigDaddy_shared = big_daddy_model._loadingComplete.load(std::memory_order_acquire) ?
+		std::atomic_load(&big_daddy_model._mesh) : std::shared_ptr<MeshGeometry>();
+	if (bigDaddy_shared)
 	{
-		return;
-	}
+		// Streamed models grow every frame until they are fully loaded
+		MeshGeometry &bigDaddy_mesh = *bigDaddy_shared;
+		if (bigDaddy_mesh._stream)
+			uploadStreamedGeometry(context, bigDaddy_mesh);
 
-	ID3D11ShaderResourceView** texViews[] = { bigDaddyMeshSRV.GetAddressOf() };
-	context->PSSetShaderResources(0, 1, *texViews);
+		XMStoreFloat4x4(&m_constantBufferData_big_daddy.view, (XMMatrixInverse(nullptr, XMLoadFloat4x4(&m_camera))));
 
-	XMStoreFloat4x4(&m_constantBufferData_big_daddy.view, (XMMatrixInverse(nullptr, XMLoadFloat4x4(&m_camera))));
+		m_assets->RequestTexture(m_bigDaddyTexture.get(), screenSize(bigDaddy_mesh, m_constantBufferData_big_daddy, m_lodPixelScale));
 
-	// Setup Vertex Buffer
-	UINT bigDaddy_stride = sizeof(DX11UWA::VertexPositionUVNormal);
-	UINT bigDaddy_offset = 0;
-	context->IASetVertexBuffers(0, 1, big_daddy_model._vertexBuffer.GetAddressOf(), &bigDaddy_stride, &bigDaddy_offset);
+		ID3D11ShaderResourceView *bigDaddyView = m_assets->GetTextureView(m_bigDaddyTexture.get());
+		context->PSSetShaderResources(0, 1, &bigDaddyView);
 
-	// Set Index buffer
-	context->IASetIndexBuffer(big_daddy_model._indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-	context->IASetInputLayout(big_daddy_model._inputLayout.Get());
+		// Setup Vertex Buffer
+		UINT bigDaddy_stride = bigDaddy_mesh._vertexStride;
+		UINT bigDaddy_offset = 0;
+		context->IASetVertexBuffers(0, 1, bigDaddy_mesh._vertexBuffer.GetAddressOf(), &bigDaddy_stride, &bigDaddy_offset);
 
-	context->UpdateSubresource1(big_daddy_model._constantBuffer.Get(), 0, NULL, &m_constantBufferData_big_daddy, 0, 0, 0);
+		// Set Index buffer
+		context->IASetIndexBuffer(bigDaddy_mesh._indexBuffer.Get(), bigDaddy_mesh._indexFormat, 0);
+		context->IASetInputLayout(big_daddy_model._inputLayout.get());
 
-	// Attach our vertex shader.
-	context->VSSetShader(big_daddy_model._vertexShader.Get(), nullptr, 0);
+		// Packed vertices are decoded with the bounds of the mesh
+		if (bigDaddy_mesh._dequantizationBuffer)
+			context->VSSetConstantBuffers1(1, 1, bigDaddy_mesh._dequantizationBuffer.GetAddressOf(), nullptr, nullptr);
 
-	// Attach our pixel shader.
-	context->PSSetShader(big_daddy_model._pixelShader.Get(), nullptr, 0);
+		context->UpdateSubresource1(big_daddy_model._constantBuffer.Get(), 0, NULL, &m_constantBufferData_big_daddy, 0, 0, 0);
 
-	context->DrawIndexed(big_daddy_model._indexCount, 0, 0);
+		// Attach our vertex shader.
+		context->VSSetShader(big_daddy_model._vertexShader.get(), nullptr, 0);
+
+		// Attach our pixel shader.
+		context->PSSetShader(big_daddy_model._pixelShader.get(), nullptr, 0);
+
+		drawSubmeshes(context, big_daddy_model, bigDaddy_mesh, m_constantBufferData_big_daddy, m_lodPixelScale);
+	}
 
 #pragma endregion
 
 #pragma region Floor
 
-	if (!floor_model._loadingComplete)
+	std::shared_ptr<MeshGeometry> floor_shared = floor_model._loadingComplete.load(std::memory_order_acquire) ?
+		std::atomic_load(&floor_model._mesh) : std::shared_ptr<MeshGeometry>();
+	if (floor_shared)
 	{
-		return;
-	}
+		MeshGeometry &floor_mesh = *floor_shared;
+		if (floor_mesh._stream)
+			uploadStreamedGeometry(context, floor_mesh);
 
-	XMStoreFloat4x4(&m_constantBufferData_floor.view, (XMMatrixInverse(nullptr, XMLoadFloat4x4(&m_camera))));
+		XMStoreFloat4x4(&m_constantBufferData_floor.view, (XMMatrixInverse(nullptr, XMLoadFloat4x4(&m_camera))));
 
-	// Setup Vertex Buffer
-	UINT floor_stride = sizeof(DX11UWA::VertexPositionUVNormal);
-	UINT floor_offset = 0;
-	context->IASetVertexBuffers(0, 1, floor_model._vertexBuffer.GetAddressOf(), &floor_stride, &floor_offset);
+		// Setup Vertex Buffer
+		UINT floor_stride = floor_mesh._vertexStride;
+		UINT floor_offset = 0;
+		context->IASetVertexBuffers(0, 1, floor_mesh._vertexBuffer.GetAddressOf(), &floor_stride, &floor_offset);
 
-	// Set Index buffer
-	context->IASetIndexBuffer(floor_model._indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-	context->IASetInputLayout(floor_model._inputLayout.Get());
+		// Set Index buffer
+		context->IASetIndexBuffer(floor_mesh._indexBuffer.Get(), floor_mesh._indexFormat, 0);
+		context->IASetInputLayout(floor_model._inputLayout.get());
 
-	context->UpdateSubresource1(floor_model._constantBuffer.Get(), 0, NULL, &m_constantBufferData_floor, 0, 0, 0);
+		// Packed vertices are decoded with the bounds of the mesh
+		if (floor_mesh._dequantizationBuffer)
+			context->VSSetConstantBuffers1(1, 1, floor_mesh._dequantizationBuffer.GetAddressOf(), nullptr, nullptr);
 
-	// Update subresources for the lights
-	context->UpdateSubresource1(m_constantBuffer_pointLight.Get(), 0, NULL, &floor_point_light, 0, 0, 0);
-	context->UpdateSubresource1(m_constantBuffer_directionalLight.Get(), 0, NULL, &floor_directional_light, 0, 0, 0);
-	context->UpdateSubresource1(m_constantBuffer_spotLight.Get(), 0, NULL, &floor_spot_light, 0, 0, 0);
+		context->UpdateSubresource1(floor_model._constantBuffer.Get(), 0, NULL, &m_constantBufferData_floor, 0, 0, 0);
 
-	// Set the light constant buffers to the floor
-	context->PSSetConstantBuffers1(0, 1, m_constantBuffer_pointLight.GetAddressOf(), nullptr, nullptr);
-	context->PSSetConstantBuffers1(1, 1, m_constantBuffer_directionalLight.GetAddressOf(), nullptr, nullptr);
-	context->PSSetConstantBuffers1(2, 1, m_constantBuffer_spotLight.GetAddressOf(), nullptr, nullptr);
+		// Update subresources for the lights
+		context->UpdateSubresource1(m_constantBuffer_pointLight.Get(), 0, NULL, &floor_point_light, 0, 0, 0);
+		context->UpdateSubresource1(m_constantBuffer_directionalLight.Get(), 0, NULL, &floor_directional_light, 0, 0, 0);
+		context->UpdateSubresource1(m_constantBuffer_spotLight.Get(), 0, NULL, &floor_spot_light, 0, 0, 0);
 
-	// Attach our vertex shader.
-	context->VSSetShader(floor_model._vertexShader.Get(), nullptr, 0);
+		// Set the light constant buffers to the floor
+		context->PSSetConstantBuffers1(0, 1, m_constantBuffer_pointLight.GetAddressOf(), nullptr, nullptr);
+		context->PSSetConstantBuffers1(1, 1, m_constantBuffer_directionalLight.GetAddressOf(), nullptr, nullptr);
+		context->PSSetConstantBuffers1(2, 1, m_constantBuffer_spotLight.GetAddressOf(), nullptr, nullptr);
 
-	// Attach our pixel shader.
-	context->PSSetShader(floor_model._pixelShader.Get(), nullptr, 0);
+		// Attach our vertex shader.
+		context->VSSetShader(floor_model._vertexShader.get(), nullptr, 0);
 
-	context->DrawIndexed(floor_model._indexCount, 0, 0);
+		// Attach our pixel shader.
+		context->PSSetShader(floor_model._pixelShader.get(), nullptr, 0);
+
+		drawSubmeshes(context, floor_model, floor_mesh, m_constantBufferData_floor, m_lodPixelScale);
+	}
 
 #pragma endregion
 
+	// Mips requested this frame are uploaded for the next one by DX11UWAMain, once every view has asked for its own
 }
 
 void Sample3DSceneRenderer::CreateDeviceDependentResources(void)
 {
-	// Load shaders asynchronously.
-	auto loadVSTask = DX::ReadDataAsync(L"SkyboxVertexShader.cso");
-	auto loadPSTask = DX::ReadDataAsync(L"SkyboxPixelShader.cso");
-
-	auto loadVSTaskTexture = DX::ReadDataAsync(L"TextureVertexShader.cso");
-	auto loadPSTaskTexture = DX::ReadDataAsync(L"TexturePixelShader.cso");
-
-	auto LoadVSTaskModel = DX::ReadDataAsync(L"SampleVertexShader.cso");
-	auto LoadPSTaskModel = DX::ReadDataAsync(L"SamplePixelShader.cso");
+	// Load shaders asynchronously. They come from the asset cache, so another renderer may already have created them.
+	const char *textureVertexShader = m_packedVertices ? "PackedTextureVertexShader.cso" : "TextureVertexShader.cso";
+	const char *modelVertexShader = m_packedVertices ? "PackedSampleVertexShader.cso" : "SampleVertexShader.cso";
 
 #pragma region Floor
 
-	// After the vertex shader file is loaded, create the shader and input layout.
-	auto createVSTaskFloorModel = LoadVSTaskModel.then([this](const std::vector<byte>& floor_fileData)
+	// Get the vertex shader and the input layout for it.
+	auto createVSTaskFloorModel = Concurrency::create_task([this, modelVertexShader]()
 	{
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateVertexShader(&floor_fileData[0], floor_fileData.size(), nullptr, &floor_model._vertexShader));
+		PROFILE_SCOPE("Floor vertex shader");
+
+		floor_model._vertexShader = m_assets->AcquireVertexShader(modelVertexShader);
 
 		static const D3D11_INPUT_ELEMENT_DESC floor_vertexDesc[] =
 		{
@@ -424,13 +798,18 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources(void)
 			{ "NORM", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		};
 
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateInputLayout(floor_vertexDesc, ARRAYSIZE(floor_vertexDesc), &floor_fileData[0], floor_fileData.size(), &floor_model._inputLayout));
+		if (m_packedVertices)
+			floor_model._inputLayout = m_assets->AcquireInputLayout(modelVertexShader, packedVertexDesc, ARRAYSIZE(packedVertexDesc));
+		else
+			floor_model._inputLayout = m_assets->AcquireInputLayout(modelVertexShader, floor_vertexDesc, ARRAYSIZE(floor_vertexDesc));
 	});
 
-	// After the pixel shader file is loaded, create the shader and constant buffer.
-	auto createPSTaskFloorModel = LoadPSTaskModel.then([this](const std::vector<byte>& floor_fileData)
+	// Get the pixel shader and create the constant buffer.
+	auto createPSTaskFloorModel = Concurrency::create_task([this]()
 	{
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreatePixelShader(&floor_fileData[0], floor_fileData.size(), nullptr, &floor_model._pixelShader));
+		PROFILE_SCOPE("Floor pixel shader");
+
+		floor_model._pixelShader = m_assets->AcquirePixelShader("SamplePixelShader.cso");
 
 		CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ModelViewProjectionConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
 		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, &floor_model._constantBuffer));
@@ -444,162 +823,32 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources(void)
 	// Once both shaders are loaded, create the mesh.
 	auto createTaskFloorModel = (createPSTaskFloorModel && createVSTaskFloorModel).then([this]()
 	{
-		std::vector<DX11UWA::VertexPositionUVNormal> floor_vertices;
-		std::vector<DirectX::XMFLOAT3> floor_normals;
-		std::vector<DirectX::XMFLOAT2> floor_uvs;
-		std::vector<unsigned int> floor_indices;
-
-		loadOBJ("Assets/Models/Floor.obj", floor_vertices, floor_indices, floor_normals, floor_uvs);
-
-		// Change uv's so the floor is a dark color or black
-		for (unsigned int i = 0; i < floor_vertices.size(); i++)
-		{
-			floor_vertices[i].uv.x = 0.5f;
-			floor_vertices[i].uv.y = 0.0f;
-			floor_vertices[i].normal = DirectX::XMFLOAT3(0, 1, 0);
-		}
-
-		// Move down the floor, so it's below the big daddys feet
-		for (unsigned int i = 0; i < floor_vertices.size(); i++)
-		{
-			floor_vertices[i].pos.y -= 10.35f;
-		}
-
-		floor_vertices_updater = floor_vertices;
-
-		// Set the new color of the surface
-		DirectX::XMFLOAT2 overall_result = { 0.0f, 0.0f };
-
-		// Initialize the directional light data
-		floor_directional_light.direction = { 0.0f, -4.0f, 1.0f, 0.0f };
-		floor_directional_light.color = { 0.250980f , 0.611764f, 1.0f, 0.0f };
-
-		// Initialize the point light data
-		floor_point_light.position = { 0.0f, 2.0f, 0.0f, 0.0f };
-		floor_point_light.color = { 0.788f, 0.886f, 1.0f, 0.0f };
-		floor_point_light.radius.x = 3.0f;
-
-		// Initialize the spot light data
-		floor_spot_light.position = { 0.0f, 2.0f, 0.0f, 0.0f };
-		floor_spot_light.color = { 1.0f, 0.945f, 0.878f, 0.0f };
-		floor_spot_light.cone_direction = { 0.0f, -0.35f, -0.1f, 0.0f };
-		floor_spot_light.cone_ratio.x = 0.5f;
-		floor_spot_light.inner_cone_ratio.x = 0.96f;
-		floor_spot_light.outer_cone_ratio.x = 0.95f;
-
-//		for (unsigned int i = 0; i < floor_vertices.size(); i++)
-//		{
-//			DirectX::XMFLOAT3 surfacePosition = floor_vertices[i].pos;
-//			DirectX::XMFLOAT3 surfaceNormal = floor_vertices[i].normal;
-//			DirectX::XMFLOAT2 surfaceColor = floor_vertices[i].uv;
-//
-//#pragma region Directional Light
-//
-//			{
-//				/*float lightRatio;
-//				DirectX::XMFLOAT2 result;
-//
-//				lightRatio = Clamp(Vector_Dot(directionalLightDirection, surfaceNormal), 1.0f, 0.0f);
-//				result.x = lightRatio * directionalLightColor.x * surfaceColor.x;
-//				result.y = lightRatio * directionalLightColor.y * surfaceColor.y;
-//
-//				overall_result.x = result.x;
-//				overall_result.y = result.y;*/
-//			}
-//
-//#pragma endregion
-//
-//#pragma region Point Light
-//
-//			{
-//				/*float attenuation;
-//				DirectX::XMFLOAT3 lightDirection;
-//				DirectX::XMFLOAT2 result;
-//
-//				lightDirection = Vector_Normalize(Vector_Subtraction(lightPosition, surfacePosition));
-//
-//				attenuation = 1.0f - Clamp(Vector_Length(Vector_Subtraction(lightPosition, surfacePosition)) - lightRadius, 1.0f, 0.0f);
-//				result.x = attenuation * lightColor.x * surfaceColor.x;
-//				result.y = attenuation * lightColor.y * surfaceColor.y;
-//
-//				overall_result.x += result.x;
-//				overall_result.y += result.y;*/
-//			}
-//
-//#pragma endregion
-//
-//#pragma region Spot Light
-//			{
-//				/*float attenuation;
-//				float surfaceRatio;
-//				float spotFactor;
-//				DirectX::XMFLOAT3 lightDirection;
-//				DirectX::XMFLOAT2 result;
-//
-//				lightDirection = Vector_Normalize(Vector_Subtraction(spotLightPosition, surfacePosition));
-//
-//				surfaceRatio = Clamp(Vector_Dot(Vector_Scalar_Multiply(lightDirection, -1.0f), coneDirection), 1.0f, 0.0f);
-//
-//				spotFactor = (surfaceRatio > coneRatio) ? 1 : 0;
-//
-//				attenuation = 1.0f - Clamp((innerConeRatio - surfaceRatio) / (innerConeRatio - outerConeRatio), 1.0f, 0.0f);
-//
-//				result.x = spotFactor * attenuation * spotLightColor.x * surfaceColor.x;
-//				result.y = spotFactor * attenuation * spotLightColor.y * surfaceColor.y;
-//
-//				overall_result.x += result.x;
-//				overall_result.y += result.y;*/
-//			}
-//#pragma endregion
-//
-//			floor_vertices[i].uv = overall_result;
-//		}
-			
-
-		D3D11_SUBRESOURCE_DATA floor_vertexBufferData = { 0 };
-		floor_vertexBufferData.pSysMem = floor_vertices.data();
-		floor_vertexBufferData.SysMemPitch = 0;
-		floor_vertexBufferData.SysMemSlicePitch = 0;
-		CD3D11_BUFFER_DESC floor_vertexBufferDesc(sizeof(DX11UWA::VertexPositionUVNormal) * floor_vertices.size(), D3D11_BIND_VERTEX_BUFFER);
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateBuffer(&floor_vertexBufferDesc, &floor_vertexBufferData, &floor_model._vertexBuffer));
-
-		floor_model._indexCount = floor_indices.size();
-
-		D3D11_SUBRESOURCE_DATA floor_indexBufferData = { 0 };
-		floor_indexBufferData.pSysMem = floor_indices.data();
-		floor_indexBufferData.SysMemPitch = 0;
-		floor_indexBufferData.SysMemSlicePitch = 0;
-		CD3D11_BUFFER_DESC floor_indexBufferDesc(sizeof(unsigned int) * floor_indices.size(), D3D11_BIND_INDEX_BUFFER);
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateBuffer(&floor_indexBufferDesc, &floor_indexBufferData, &floor_model._indexBuffer));
+		// The floor's recipe already made it a dark flat surface below the big daddy's feet
+		return createModel(m_deviceResources->GetD3DDevice(), *m_assets, "Floor", ObjLoadOptions(), m_packedVertices, floor_model);
 	});
 
-	// Once the cube is loaded, the object is ready to be rendered.
-	createTaskFloorModel.then([this]()
+	// Once the cube is loaded, the object is ready to be rendered. Without a mesh it's left out.
+	createTaskFloorModel.then([this](bool created)
 	{
-		floor_model._loadingComplete = true;
+		if (created)
+			floor_model._loadingComplete.store(true, std::memory_order_release);
+		else
+			OutputDebugStringA("The floor model can't be loaded\n");
 	});
 
 #pragma endregion
 
 #pragma region Skybox
 
-	auto context_Skybox = m_deviceResources->GetD3DDeviceContext();
-	ID3D11Device *device_Skybox;
-	context_Skybox->GetDevice(&device_Skybox);
-
-	const char *skybox_path = "Assets/Cubemaps/Rapture.dds";
+	// Only the smallest mips are uploaded here, the rest stream in while it's drawn
+	m_skyboxTexture = m_assets->AcquireTexture("Assets/Cubemaps/Rapture.dds");
 
-	size_t skybox_pathSize = strlen(skybox_path) + 1;
-	wchar_t *skybox_wc = new wchar_t[skybox_pathSize];
-	mbstowcs(&skybox_wc[0], skybox_path, skybox_pathSize);
-
-	HRESULT hr2;
-	hr2 = CreateDDSTextureFromFile(device_Skybox, skybox_wc, &skybox_texture, &skyboxSRV);
-
-	// After the vertex shader file is loaded, create the shader and input layout.
-	auto createVSTask = loadVSTask.then([this](const std::vector<byte>& fileData)
+	// Get the vertex shader and the input layout for it.
+	auto createVSTask = Concurrency::create_task([this]()
 	{
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateVertexShader(&fileData[0], fileData.size(), nullptr, &m_vertexShader));
+		PROFILE_SCOPE("Skybox vertex shader");
+
+		m_vertexShader = m_assets->AcquireVertexShader("SkyboxVertexShader.cso");
 
 		static const D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
 		{
@@ -607,13 +856,15 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources(void)
 			{ "UV", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		};
 
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateInputLayout(vertexDesc, ARRAYSIZE(vertexDesc), &fileData[0], fileData.size(), &m_inputLayout));
+		m_inputLayout = m_assets->AcquireInputLayout("SkyboxVertexShader.cso", vertexDesc, ARRAYSIZE(vertexDesc));
 	});
 
-	// After the pixel shader file is loaded, create the shader and constant buffer.
-	auto createPSTask = loadPSTask.then([this](const std::vector<byte>& fileData)
+	// Get the pixel shader and create the constant buffer.
+	auto createPSTask = Concurrency::create_task([this]()
 	{
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreatePixelShader(&fileData[0], fileData.size(), nullptr, &m_pixelShader));
+		PROFILE_SCOPE("Skybox pixel shader");
+
+		m_pixelShader = m_assets->AcquirePixelShader("SkyboxPixelShader.cso");
 
 		CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ModelViewProjectionConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
 		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, &m_constantBuffer));
@@ -622,6 +873,8 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources(void)
 	// Once both shaders are loaded, create the mesh.
 	auto createCubeTask = (createPSTask && createVSTask).then([this]()
 	{
+		PROFILE_SCOPE("Skybox mesh");
+
 		// Load mesh vertices. Each vertex has a position and a color.
 		static const VertexPositionColor cubeVertices[] =
 		{
@@ -681,30 +934,21 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources(void)
 	// Once the cube is loaded, the object is ready to be rendered.
 	createCubeTask.then([this]()
 	{
-		m_loadingComplete = true;
+		m_loadingComplete.store(true, std::memory_order_release);
 	});
 
 #pragma endregion
 
 #pragma region Big Daddy Model
 
-	auto context = m_deviceResources->GetD3DDeviceContext();
-	ID3D11Device *device;
-	context->GetDevice(&device);
-
-	const char *path = "Assets/Textures/Big_Daddy_Texture.dds";
-
-	size_t pathSize = strlen(path) + 1;
-	wchar_t *wc = new wchar_t[pathSize];
-	mbstowcs(&wc[0], path, pathSize);
+	m_bigDaddyTexture = m_assets->AcquireTexture("Assets/Textures/Big_Daddy_Texture.dds");
 
-	HRESULT hr;
-	hr = CreateDDSTextureFromFile(device, wc, &texture, &bigDaddyMeshSRV);
-
-	// After the vertex shader file is loaded, create the shader and input layout.
-	auto createVSBigDaddyTaskModel = loadVSTaskTexture.then([this](const std::vector<byte>& bigDaddy_fileData)
+	// Get the vertex shader and the input layout for it.
+	auto createVSBigDaddyTaskModel = Concurrency::create_task([this, textureVertexShader]()
 	{
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateVertexShader(&bigDaddy_fileData[0], bigDaddy_fileData.size(), nullptr, &big_daddy_model._vertexShader));
+		PROFILE_SCOPE("Big daddy vertex shader");
+
+		big_daddy_model._vertexShader = m_assets->AcquireVertexShader(textureVertexShader);
 
 		static const D3D11_INPUT_ELEMENT_DESC bigDaddy_vertexDesc[] =
 		{
@@ -713,13 +957,18 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources(void)
 			{ "NORM", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		};
 
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateInputLayout(bigDaddy_vertexDesc, ARRAYSIZE(bigDaddy_vertexDesc), &bigDaddy_fileData[0], bigDaddy_fileData.size(), &big_daddy_model._inputLayout));
+		if (m_packedVertices)
+			big_daddy_model._inputLayout = m_assets->AcquireInputLayout(textureVertexShader, packedVertexDesc, ARRAYSIZE(packedVertexDesc));
+		else
+			big_daddy_model._inputLayout = m_assets->AcquireInputLayout(textureVertexShader, bigDaddy_vertexDesc, ARRAYSIZE(bigDaddy_vertexDesc));
 	});
 
-	// After the pixel shader file is loaded, create the shader and constant buffer.
-	auto createPSBigDaddyTaskModel = loadPSTaskTexture.then([this](const std::vector<byte>& bigDaddy_fileData)
+	// Get the pixel shader and create the constant buffer.
+	auto createPSBigDaddyTaskModel = Concurrency::create_task([this]()
 	{
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreatePixelShader(&bigDaddy_fileData[0], bigDaddy_fileData.size(), nullptr, &big_daddy_model._pixelShader));
+		PROFILE_SCOPE("Big daddy pixel shader");
+
+		big_daddy_model._pixelShader = m_assets->AcquirePixelShader("TexturePixelShader.cso");
 
 		CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ModelViewProjectionConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
 		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, &big_daddy_model._constantBuffer));
@@ -728,40 +977,18 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources(void)
 	// Once both shaders are loaded, create the mesh.
 	auto createBigDaddyTaskModel = (createPSBigDaddyTaskModel && createVSBigDaddyTaskModel).then([this]()
 	{
-		std::vector<DX11UWA::VertexPositionUVNormal> bigDaddy_vertices;
-		std::vector<DirectX::XMFLOAT3> bigDaddy_normals;
-		std::vector<DirectX::XMFLOAT2> bigDaddy_uvs;
-		std::vector<unsigned int> bigDaddy_indices;
-
-		loadOBJ("Assets/Models/Big_Daddy.obj", bigDaddy_vertices, bigDaddy_indices, bigDaddy_normals, bigDaddy_uvs);
-
-		// Move down the big daddy, so the floor is below his feet
-		for (unsigned int i = 0; i < bigDaddy_vertices.size(); i++)
-		{
-			bigDaddy_vertices[i].pos.y -= 10.00f;
-		}
-
-		D3D11_SUBRESOURCE_DATA bigDaddy_vertexBufferData = { 0 };
-		bigDaddy_vertexBufferData.pSysMem = bigDaddy_vertices.data();
-		bigDaddy_vertexBufferData.SysMemPitch = 0;
-		bigDaddy_vertexBufferData.SysMemSlicePitch = 0;
-		CD3D11_BUFFER_DESC bigDaddy_vertexBufferDesc(sizeof(DX11UWA::VertexPositionUVNormal) * bigDaddy_vertices.size(), D3D11_BIND_VERTEX_BUFFER);
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateBuffer(&bigDaddy_vertexBufferDesc, &bigDaddy_vertexBufferData, &big_daddy_model._vertexBuffer));
-
-		big_daddy_model._indexCount = bigDaddy_indices.size();
-
-		D3D11_SUBRESOURCE_DATA bigDaddy_indexBufferData = { 0 };
-		bigDaddy_indexBufferData.pSysMem = bigDaddy_indices.data();
-		bigDaddy_indexBufferData.SysMemPitch = 0;
-		bigDaddy_indexBufferData.SysMemSlicePitch = 0;
-		CD3D11_BUFFER_DESC bigDaddy_indexBufferDesc(sizeof(unsigned int) * bigDaddy_indices.size(), D3D11_BIND_INDEX_BUFFER);
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateBuffer(&bigDaddy_indexBufferDesc, &bigDaddy_indexBufferData, &big_daddy_model._indexBuffer));
+		// Without a cooked or cached mesh it's streamed in, so it shows up while it's still being parsed. The other
+		// renderer gets the same mesh, however far along it is. It's parsed on this thread, see ObjLoadOptions::parseThreads.
+		return createModel(m_deviceResources->GetD3DDevice(), *m_assets, "Big_Daddy", ObjLoadOptions(), m_packedVertices, big_daddy_model);
 	});
 
-	// Once the cube is loaded, the object is ready to be rendered.
-	createBigDaddyTaskModel.then([this]()
+	// Once the cube is loaded, the object is ready to be rendered. Without a mesh it's left out.
+	createBigDaddyTaskModel.then([this](bool created)
 	{
-		big_daddy_model._loadingComplete = true;
+		if (created)
+			big_daddy_model._loadingComplete.store(true, std::memory_order_release);
+		else
+			OutputDebugStringA("The big daddy model can't be loaded\n");
 	});
 
 #pragma endregion
@@ -770,29 +997,17 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources(void)
 
 void Sample3DSceneRenderer::ReleaseDeviceDependentResources(void)
 {
-	m_loadingComplete = false;
-	m_vertexShader.Reset();
-	m_inputLayout.Reset();
-	m_pixelShader.Reset();
+	m_loadingComplete.store(false, std::memory_order_release);
+	m_vertexShader.reset();
+	m_inputLayout.reset();
+	m_pixelShader.reset();
 	m_constantBuffer.Reset();
 	m_vertexBuffer.Reset();
 	m_indexBuffer.Reset();
-}
-
-void Sample3DSceneRenderer::UpdateLights()
-{
-	// Get the context so I can update the lights
-	auto context = m_deviceResources->GetD3DDeviceContext();
-
-	// Update subresources for the lights
-	context->UpdateSubresource1(m_constantBuffer_pointLight.Get(), 0, NULL, &floor_point_light, 0, 0, 0);
-	context->UpdateSubresource1(m_constantBuffer_directionalLight.Get(), 0, NULL, &floor_directional_light, 0, 0, 0);
-	context->UpdateSubresource1(m_constantBuffer_spotLight.Get(), 0, NULL, &floor_spot_light, 0, 0, 0);
-
-
-	// Set the light constant buffers to the floor
-	context->PSSetConstantBuffers1(0, 1, m_constantBuffer_pointLight.GetAddressOf(), nullptr, nullptr);
-	context->PSSetConstantBuffers1(1, 1, m_constantBuffer_directionalLight.GetAddressOf(), nullptr, nullptr);
-	context->PSSetConstantBuffers1(2, 1, m_constantBuffer_spotLight.GetAddressOf(), nullptr, nullptr);
 
+	// Shared assets go once no renderer holds them anymore, see D3DAssetCache::ReleaseDeviceDependentResources
+	releaseModel(big_daddy_model);
+	releaseModel(floor_model);
+	m_skyboxTexture.reset();
+	m_bigDaddyTexture.reset();
 }
\ No newline at end of file
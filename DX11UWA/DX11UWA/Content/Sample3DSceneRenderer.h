@@ -6,10 +6,16 @@
 
 // My Header Files
 #include "ObjLoader.h"
+#include "MaterialLibrary.h"
+#include "MeshCache.h"
+#include "MeshClusters.h"
+#include "MeshLod.h"
+#include "VertexPacking.h"
 #include "Structures.h"
 
-// Texture header file
-#include "DDSTextureLoader.h"
+// Texture header files
+#include "..\Common\DDSTextureLoader.h"
+#include "..\Common\D3DAssetCache.h"
 
 namespace DX11UWA
 {
@@ -17,59 +23,53 @@ namespace DX11UWA
 	class Sample3DSceneRenderer
 	{
 	public:
-		Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources);
+		// Shaders, meshes, materials and textures come from assets, shared with every other renderer using it
+		Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, const std::shared_ptr<DX::D3DAssetCache>& assets);
 		void CreateDeviceDependentResources(void);
 		void CreateWindowSizeDependentResources(void);
 		void ReleaseDeviceDependentResources(void);
-		void Update(DX::StepTimer const& timer);
+		void Update(const SceneSnapshot &scene);
 		void Render(DirectX::XMFLOAT4X4 view_matrix);
 		void StartTracking(void);
 		void TrackingUpdate(float positionX);
 		void StopTracking(void);
 		inline bool IsTracking(void) { return m_tracking; }
 
-		// Helper functions for keyboard and mouse input
-		void SetKeyboardButtons(const char* list);
-		void SetMousePosition(const Windows::UI::Input::PointerPoint^ pos);
-		void SetInputDeviceData(const char* kb, const Windows::UI::Input::PointerPoint^ pos);
-
-
 	private:
 		void Rotate(float radians);
-		void UpdateCamera(DX::StepTimer const& timer, float const moveSpd, float const rotSpd);
-		void UpdateLights();
 
 	private:
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
+		std::shared_ptr<DX::D3DAssetCache> m_assets;
 
 		// Direct3D resources for cube geometry.
-		Microsoft::WRL::ComPtr<ID3D11InputLayout>	m_inputLayout;
+		std::shared_ptr<ID3D11InputLayout>			m_inputLayout;
 		Microsoft::WRL::ComPtr<ID3D11Buffer>		m_vertexBuffer;
 		Microsoft::WRL::ComPtr<ID3D11Buffer>		m_indexBuffer;
-		Microsoft::WRL::ComPtr<ID3D11VertexShader>	m_vertexShader;
-		Microsoft::WRL::ComPtr<ID3D11PixelShader>	m_pixelShader;
+		std::shared_ptr<ID3D11VertexShader>			m_vertexShader;
+		std::shared_ptr<ID3D11PixelShader>			m_pixelShader;
 		Microsoft::WRL::ComPtr<ID3D11Buffer>		m_constantBuffer;
 
 		// System resources for cube geometry.
 		ModelViewProjectionConstantBuffer	m_constantBufferData;
 		uint32	m_indexCount;
 
-		// Texture Variables
-		Microsoft::WRL::ComPtr<ID3D11Resource> skybox_texture;
-		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skyboxSRV;
+		// Textures stream in their finer mips as they get larger on screen, in any view
+		std::shared_ptr<DX::SharedTexture>	m_skyboxTexture;
 
 		// Variables used with the rendering loop.
-		bool	m_loadingComplete;
-		float	m_degreesPerSecond;
+		std::atomic<bool>	m_loadingComplete;	// Set by the loading task, read by the render thread
 		bool	m_tracking;
 
-		// Data members for keyboard and mouse input
-		char	m_kbuttons[256];
-		Windows::UI::Input::PointerPoint^ m_currMousePos;
-		Windows::UI::Input::PointerPoint^ m_prevMousePos;
+		// Upload models as 16 byte VertexPositionUVNormalPacked instead of 32 byte VertexPositionUVNormal
+		bool	m_packedVertices;
 
-		// Matrix data member for the camera
+		// Pixels one unit covers at distance 1, to project the error of the levels of detail
+		float	m_lodPixelScale;
+		float	m_viewportHeight;
+
+		// Matrix data member for the camera, as of the last Update
 		DirectX::XMFLOAT4X4 m_camera;
 
 		// My Model Variables/Resources
@@ -81,8 +81,7 @@ namespace DX11UWA
 		ModelViewProjectionConstantBuffer m_constantBufferData_big_daddy;
 
 		// Texture Variables
-		Microsoft::WRL::ComPtr<ID3D11Resource> texture;
-		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bigDaddyMeshSRV;
+		std::shared_ptr<DX::SharedTexture> m_bigDaddyTexture;
 		////////////////////////////////////////////////////////////////
 		//                  END BIG DADDY MODELS STUFF                //
 		////////////////////////////////////////////////////////////////
@@ -94,9 +93,6 @@ namespace DX11UWA
 		Model floor_model;
 		ModelViewProjectionConstantBuffer m_constantBufferData_floor;
 
-		// Temporary Variables to use for updating
-		std::vector<DX11UWA::VertexPositionUVNormal> floor_vertices_updater;
-
 		// Lights
 		DirectionalLight floor_directional_light;
 		PointLight floor_point_light;
@@ -107,12 +103,6 @@ namespace DX11UWA
 		Microsoft::WRL::ComPtr<ID3D11Buffer> m_constantBuffer_directionalLight;
 		Microsoft::WRL::ComPtr<ID3D11Buffer> m_constantBuffer_spotLight;
 
-		// Light Movement Variables
-		float y_inc_dir;
-		float x_inc_point;
-		float x_inc_spot_pos;
-		float z_inc_spot_pos;
-		float x_inc_spot_dir;
 		////////////////////////////////////////////////////////////////
 		//                  BEGIN FLOOR MODEL STUFF                   //
 		////////////////////////////////////////////////////////////////
@@ -8,10 +8,10 @@ using namespace Microsoft::WRL;
 
 // Initializes D2D resources used for text rendering.
 SampleFpsTextRenderer::SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) : 
-	m_text(L""),
+	m_overlay(""),
 	m_deviceResources(deviceResources)
 {
-	ZeroMemory(&m_textMetrics, sizeof(DWRITE_TEXT_METRICS));
+	ZeroMemory(&m_font, sizeof(HudFont));
 
 	// Create device independent resources
 	ComPtr<IDWriteTextFormat> textFormat;
@@ -22,7 +22,7 @@ SampleFpsTextRenderer::SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceRes
 			DWRITE_FONT_WEIGHT_LIGHT,
 			DWRITE_FONT_STYLE_NORMAL,
 			DWRITE_FONT_STRETCH_NORMAL,
-			32.0f,
+			16.0f,
 			L"en-US",
 			&textFormat
 			)
@@ -32,10 +32,15 @@ SampleFpsTextRenderer::SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceRes
 		textFormat.As(&m_textFormat)
 		);
 
+	// Glyphs are rasterized one to a cell of the atlas, HudText aligns the lines
 	DX::ThrowIfFailed(
 		m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR)
 		);
 
+	DX::ThrowIfFailed(
+		m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING)
+		);
+
 	DX::ThrowIfFailed(
 		m_deviceResources->GetD2DFactory()->CreateDrawingStateBlock(&m_stateBlock)
 		);
@@ -44,32 +49,14 @@ SampleFpsTextRenderer::SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceRes
 }
 
 // Updates the text to be displayed.
-void SampleFpsTextRenderer::Update(DX::StepTimer const& timer)
+void SampleFpsTextRenderer::Update(const FrameStats& stats)
 {
-	// Update display text.
-	uint32 fps = timer.GetFramesPerSecond();
-
-	m_text = (fps > 0) ? std::to_wstring(fps) + L" FPS" : L" - FPS";
-
-	ComPtr<IDWriteTextLayout> textLayout;
-	DX::ThrowIfFailed(
-		m_deviceResources->GetDWriteFactory()->CreateTextLayout(
-			m_text.c_str(),
-			(uint32) m_text.length(),
-			m_textFormat.Get(),
-			240.0f, // Max width of the input text.
-			50.0f, // Max height of the input text.
-			&textLayout
-			)
-		);
-
-	DX::ThrowIfFailed(
-		textLayout.As(&m_textLayout)
-		);
+	char text[256];
+	formatFrameStats(stats, text, sizeof(text));
+	m_overlay = text;
 
-	DX::ThrowIfFailed(
-		m_textLayout->GetMetrics(&m_textMetrics)
-		);
+	// Only laid out again if the numbers shown changed
+	m_text->SetText(text);
 }
 
 // Renders a frame to the screen.
@@ -81,22 +68,12 @@ void SampleFpsTextRenderer::Render()
 	context->SaveDrawingState(m_stateBlock.Get());
 	context->BeginDraw();
 
-	// Position on the bottom right corner
-	D2D1::Matrix3x2F screenTranslation = D2D1::Matrix3x2F::Translation(
-		logicalSize.Width - m_textMetrics.layoutWidth,
-		logicalSize.Height - m_textMetrics.height
-		);
-
-	context->SetTransform(screenTranslation * m_deviceResources->GetOrientationTransform2D());
+	context->SetTransform(m_deviceResources->GetOrientationTransform2D());
 
-	DX::ThrowIfFailed(
-		m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_TRAILING)
-		);
-
-	context->DrawTextLayout(
-		D2D1::Point2F(0.f, 0.f),
-		m_textLayout.Get(),
-		m_whiteBrush.Get()
+	// Position on the bottom right corner, every glyph in one draw
+	m_text->Draw(
+		logicalSize.Width - m_text->GetWidth(),
+		logicalSize.Height - m_text->GetHeight()
 		);
 
 	// Ignore D2DERR_RECREATE_TARGET here. This error indicates that the device
@@ -112,11 +89,14 @@ void SampleFpsTextRenderer::Render()
 
 void SampleFpsTextRenderer::CreateDeviceDependentResources()
 {
-	DX::ThrowIfFailed(
-		m_deviceResources->GetD2DDeviceContext()->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), &m_whiteBrush)
-		);
+	// The glyphs are rasterized into the atlas once, here
+	m_textBackend = std::unique_ptr<DX::D2DHudTextBackend>(new DX::D2DHudTextBackend(
+		m_deviceResources->GetD2DDeviceContext(), m_deviceResources->GetDWriteFactory(), m_textFormat.Get(), m_font));
+	m_text = std::unique_ptr<HudText>(new HudText(*m_textBackend, m_font, HUD_ALIGN_RIGHT));
+	m_text->SetText(m_overlay.c_str());
 }
 void SampleFpsTextRenderer::ReleaseDeviceDependentResources()
 {
-	m_whiteBrush.Reset();
+	m_text.reset();
+	m_textBackend.reset();
 }
\ No newline at end of file
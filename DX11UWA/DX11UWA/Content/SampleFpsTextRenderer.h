@@ -1,19 +1,24 @@
 ﻿#pragma once
 
+#include <memory>
 #include <string>
 #include "..\Common\DeviceResources.h"
+#include "..\Common\D2DHudText.h"
 #include "..\Common\StepTimer.h"
+#include "..\FrameStats.h"
+#include "..\HudText.h"
 
 namespace DX11UWA
 {
-	// Renders the current FPS value in the bottom right corner of the screen using Direct2D and DirectWrite.
+	// Renders the frame time percentiles and hitches in the bottom right corner of the screen from a glyph atlas
+	// (see HudText.h), laid out again only when the numbers change.
 	class SampleFpsTextRenderer
 	{
 	public:
 		SampleFpsTextRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources);
 		void CreateDeviceDependentResources();
 		void ReleaseDeviceDependentResources();
-		void Update(DX::StepTimer const& timer);
+		void Update(const FrameStats& stats);
 		void Render();
 
 	private:
@@ -21,11 +26,11 @@ namespace DX11UWA
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
 		// Resources related to text rendering.
-		std::wstring                                    m_text;
-		DWRITE_TEXT_METRICS	                            m_textMetrics;
-		Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>    m_whiteBrush;
+		std::string                                     m_overlay;
+		HudFont                                         m_font;
+		std::unique_ptr<DX::D2DHudTextBackend>          m_textBackend;
+		std::unique_ptr<HudText>                        m_text;
 		Microsoft::WRL::ComPtr<ID2D1DrawingStateBlock1> m_stateBlock;
-		Microsoft::WRL::ComPtr<IDWriteTextLayout3>      m_textLayout;
 		Microsoft::WRL::ComPtr<IDWriteTextFormat2>      m_textFormat;
 	};
 }
\ No newline at end of file
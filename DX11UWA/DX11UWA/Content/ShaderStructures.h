@@ -23,4 +23,20 @@ namespace DX11UWA
 		DirectX::XMFLOAT2 uv;
 		DirectX::XMFLOAT3 normal;
 	};
+
+	// 16 byte version of VertexPositionUVNormal, see VertexPacking.h. Positions are relative to the
+	// mesh bounds, so the vertex shader also needs a VertexDequantizationConstantBuffer.
+	struct VertexPositionUVNormalPacked
+	{
+		unsigned short pos[4];		// R16G16B16A16_UNORM, w is padding
+		unsigned short uv[2];		// R16G16_FLOAT
+		short normal[2];			// R16G16_SNORM, octahedral
+	};
+
+	// Constant buffer used to turn packed positions back into model space: pos * scale + offset.
+	struct VertexDequantizationConstantBuffer
+	{
+		DirectX::XMFLOAT4 scale;
+		DirectX::XMFLOAT4 offset;
+	};
 }
\ No newline at end of file
@@ -1,39 +1,98 @@
 ﻿#include "pch.h"
 #include "DX11UWAMain.h"
 #include "Common\DirectXHelper.h"
+#include "AssetPack.h"
+#include "Profiler.h"
 #include <DirectXMath.h>
+#include <algorithm>
+#include <chrono>
 
 using namespace DX11UWA;
 using namespace Windows::Foundation;
 using namespace Windows::System::Threading;
 using namespace Concurrency;
 
+namespace
+{
+	// Set to false to simulate, render and present one after the other on the UI thread, to compare the frame
+	// times and input latency of both
+	const bool decoupledLoops = true;
+
+	// How often the frame stats are written to the debugger's output, and shown on the overlay
+	const double statsSeconds = 5.0;
+	const double overlaySeconds = 0.25;
+
+	// A frame that takes longer than a 60 Hz display's and misses a vsync is a hitch, as is an update or a
+	// submit that takes longer than one frame on its own
+	const float frameMilliseconds = 1000.0f / 60.0f;
+
+	// The install folder is read only, so the stats go in the app's local folder
+	std::string localFilePath(const char *name)
+	{
+		Platform::String^ folder = Windows::Storage::ApplicationData::Current->LocalFolder->Path;
+
+		char path[MAX_PATH];
+		if (WideCharToMultiByte(CP_UTF8, 0, folder->Data(), -1, path, MAX_PATH, nullptr, nullptr) == 0)
+			return name;
+
+		return std::string(path) + "\\" + name;
+	}
+
+	float ticksToMilliseconds(uint64_t ticks, const DX::StepClock &clock)
+	{
+		return static_cast<float>(ticks * 1000.0 / clock.GetFrequency());
+	}
+}
+
 // Loads and initializes application assets when the application is loaded.
 DX11UWAMain::DX11UWAMain(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
-	m_deviceResources(deviceResources), m_deviceResources2(deviceResources)
+	m_deviceResources(deviceResources), m_deviceResources2(deviceResources),
+	m_hasScene(false),
+	m_publishedScenes(0),
+	m_decoupled(decoupledLoops),
+	m_loopsRunning(false),
+	m_lastPresentTicks(0),
+	m_statsStartTicks(0),
+	m_nextOverlayTicks(0),
+	m_drawnInputTicks(0),
+	m_presentedInputTicks(0)
 {
+	PROFILE_THREAD_NAME("UI");
+
+	memset(&m_input, 0, sizeof(m_input));
+
 	// Register to be notified if the Device is lost or recreated
 	m_deviceResources->RegisterDeviceNotify(this);
 
 	m_deviceResources2->RegisterDeviceNotify(this);
 
+	// Models, textures and shaders are read from the asset pack when it was built (see Tools/Packer),
+	// and from their own files otherwise
+	mountAssetPack("Assets/Cooked/Assets.rpak");
+
+	// Both views draw the same scene, so they share every shader, mesh and texture
+	m_assets = std::make_shared<DX::D3DAssetCache>(m_deviceResources);
+
 	// TODO: Replace this with your app's content initialization.
-	m_sceneRenderer = std::unique_ptr<Sample3DSceneRenderer>(new Sample3DSceneRenderer(m_deviceResources));
+	m_sceneRenderer = std::unique_ptr<Sample3DSceneRenderer>(new Sample3DSceneRenderer(m_deviceResources, m_assets));
 
 	m_fpsTextRenderer = std::unique_ptr<SampleFpsTextRenderer>(new SampleFpsTextRenderer(m_deviceResources));
 
-	m_sceneRenderer2 = std::unique_ptr<Sample3DSceneRenderer>(new Sample3DSceneRenderer(m_deviceResources));
+	m_sceneRenderer2 = std::unique_ptr<Sample3DSceneRenderer>(new Sample3DSceneRenderer(m_deviceResources, m_assets));
 	m_fpsTextRenderer2 = std::unique_ptr<SampleFpsTextRenderer>(new SampleFpsTextRenderer(m_deviceResources));
 
-	// TODO: Change the timer settings if you want something other than the default variable timestep mode.
-	// e.g. for 60 FPS fixed timestep update logic, call:
-	
-	m_timer.SetFixedTimeStep(true);
-	m_timer.SetTargetElapsedSeconds(1.0 / 60);
+	// The simulation keeps its own fixed 60 Hz timestep (see SceneSimulation.h), rendering runs at whatever
+	// rate the display does
+	m_frameStats.SetHitchThreshold(FRAME_STAT_UPDATE, frameMilliseconds);
+	m_frameStats.SetHitchThreshold(FRAME_STAT_RENDER, frameMilliseconds);
+	m_frameStats.SetHitchThreshold(FRAME_STAT_PRESENT, 1.5f * frameMilliseconds);
 }
 
 DX11UWAMain::~DX11UWAMain(void)
 {
+	StopLoops();
+	ExportFrameStats();
+
 	// Deregister device notification
 	m_deviceResources->RegisterDeviceNotify(nullptr);
 
@@ -49,33 +108,77 @@ void DX11UWAMain::CreateWindowSizeDependentResources(void)
 	m_sceneRenderer2->CreateWindowSizeDependentResources();
 }
 
-// Updates the application state once per frame.
+// Updates the application state, once per frame or as often as the simulation thread wakes up.
 void DX11UWAMain::Update(void)
 {
-	// Update scene objects.
-	m_timer.Tick([&]()
+	PROFILE_FUNCTION();
+
+	SceneInput input;
 	{
-		// TODO: Replace this with your app's content update functions.
-		m_sceneRenderer->Update(m_timer);
-		m_sceneRenderer->SetInputDeviceData(main_kbuttons, main_currentpos);
-		m_fpsTextRenderer->Update(m_timer);
+		std::lock_guard<std::mutex> lock(m_inputMutex);
+		input = m_input;
+	}
 
-		m_sceneRenderer2->Update(m_timer);
-		m_sceneRenderer2->SetInputDeviceData(main_kbuttons, main_currentpos);
-		m_fpsTextRenderer2->Update(m_timer);
-	});
+	// Snapshots are copied whole into the back buffer, which Render never reads until it's published
+	const DX::StepClock &clock = DX::SystemStepClock::Get();
+	const uint64_t start = clock.GetTicks();
+	if (m_simulation.Update(input))
+	{
+		m_scenes.GetBack() = m_simulation.GetScene();
+		m_scenes.Publish();
+		{
+			std::lock_guard<std::mutex> lock(m_publishMutex);
+			++m_publishedScenes;
+		}
+		m_scenePublished.notify_one();
+
+		m_frameStats.Record(FRAME_STAT_UPDATE, ticksToMilliseconds(clock.GetTicks() - start, clock));
+	}
 }
 
 // Renders the current frame according to the current application state.
 // Returns true if the frame was rendered and is ready to be displayed.
 bool DX11UWAMain::Render(void)
 {
-	// Don't try to render anything before the first Update.
-	if (m_timer.GetFrameCount() == 0)
+	PROFILE_FUNCTION();
+
+	const DX::StepClock &clock = DX::SystemStepClock::Get();
+	const uint64_t start = clock.GetTicks();
+
+	if (m_scenes.Acquire())
+	{
+		m_previousScene = m_hasScene ? m_currentScene : m_scenes.GetFront();
+		m_currentScene = m_scenes.GetFront();
+		m_hasScene = true;
+	}
+
+	// Don't try to render anything before the first step is published.
+	if (!m_hasScene)
 	{
 		return false;
 	}
 
+	// Show the scene as it was one step ago, between the last two steps, so it moves on every frame however
+	// the display's rate lines up with the simulation's
+	const double stepTicks = m_simulation.GetStepSeconds() * clock.GetFrequency();
+	const double sinceStep = static_cast<double>(start - m_currentScene.stepTicks);
+	const float alpha = static_cast<float>(std::min<double>(sinceStep / stepTicks, 1.0));
+
+	SceneSnapshot scene;
+	interpolateScene(m_previousScene, m_currentScene, alpha, scene);
+	m_drawnInputTicks = m_currentScene.inputTicks;
+
+	m_sceneRenderer->Update(scene);
+	m_sceneRenderer2->Update(scene);
+
+	// Often enough to follow, not so often the numbers can't be read
+	if (start >= m_nextOverlayTicks)
+	{
+		m_fpsTextRenderer->Update(m_frameStats);
+		m_fpsTextRenderer2->Update(m_frameStats);
+		m_nextOverlayTicks = start + static_cast<uint64_t>(overlaySeconds * clock.GetFrequency());
+	}
+
 	auto context = m_deviceResources->GetD3DDeviceContext();
 
 	// Reset the viewport to target the whole screen.
@@ -129,9 +232,143 @@ bool DX11UWAMain::Render(void)
 	m_sceneRenderer2->Render(temp_4x4_2);
 	m_fpsTextRenderer2->Render();
 
+	// Textures stream in for the larger of the sizes the two views asked for
+	m_assets->Update();
+
+	m_frameStats.Record(FRAME_STAT_RENDER, ticksToMilliseconds(clock.GetTicks() - start, clock));
 	return true;
 }
 
+void DX11UWAMain::Present(void)
+{
+	PROFILE_FUNCTION();
+
+	m_deviceResources->Present();
+
+	const DX::StepClock &clock = DX::SystemStepClock::Get();
+	const uint64_t now = clock.GetTicks();
+
+	if (m_lastPresentTicks != 0)
+	{
+		const float frameTime = ticksToMilliseconds(now - m_lastPresentTicks, clock);
+		m_frameStats.Record(FRAME_STAT_PRESENT, frameTime);
+		m_frameTimes.Add(frameTime);
+	}
+	else
+		m_statsStartTicks = now;
+	m_lastPresentTicks = now;
+
+	// Only the first frame that shows an input change counts towards the latency
+	if (m_drawnInputTicks > m_presentedInputTicks)
+	{
+		m_inputLatencies.Add(ticksToMilliseconds(now - m_drawnInputTicks, clock));
+		m_presentedInputTicks = m_drawnInputTicks;
+	}
+
+	if (now - m_statsStartTicks >= statsSeconds * clock.GetFrequency())
+		ReportFrameStats(now);
+}
+
+void DX11UWAMain::ReportFrameStats(uint64_t now)
+{
+	const FrameStatSummary frames = m_frameStats.Summarize(FRAME_STAT_PRESENT);
+
+	wchar_t line[320];
+	swprintf_s(line, L"%ls loops: frame %.2f ms +/- %.2f ms (max %.2f ms) over %llu frames, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, %llu hitches, input latency %.2f ms (max %.2f ms) over %llu changes\n",
+		m_decoupled ? L"Decoupled" : L"Serial",
+		m_frameTimes.GetMean(), m_frameTimes.GetDeviation(), m_frameTimes.GetMax(), m_frameTimes.GetCount(),
+		frames.p50, frames.p95, frames.p99, frames.totalHitches,
+		m_inputLatencies.GetMean(), m_inputLatencies.GetMax(), m_inputLatencies.GetCount());
+	OutputDebugStringW(line);
+
+	m_frameTimes.Reset();
+	m_inputLatencies.Reset();
+	m_statsStartTicks = now;
+}
+
+void DX11UWAMain::ExportFrameStats(void)
+{
+	m_frameStats.Export(localFilePath("FrameStats.json").c_str());
+
+#if defined(RAPTURE_PROFILE)
+	Profiler::WriteChromeTrace(localFilePath("Trace.json").c_str());
+#endif
+}
+
+void DX11UWAMain::StartLoops(void)
+{
+	if (!m_decoupled || m_loopsRunning)
+		return;
+
+	// Steps missed while the loops were stopped aren't made up, and the first frame after isn't counted
+	m_simulation.ResetElapsedTime();
+	m_lastPresentTicks = 0;
+
+	m_loopsRunning = true;
+	m_simulationThread = std::thread([this]() { SimulationLoop(); });
+	m_renderThread = std::thread([this]() { RenderLoop(); });
+}
+
+void DX11UWAMain::StopLoops(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_publishMutex);
+		m_loopsRunning = false;
+	}
+	m_scenePublished.notify_one();
+
+	if (m_simulationThread.joinable())
+		m_simulationThread.join();
+	if (m_renderThread.joinable())
+		m_renderThread.join();
+}
+
+void DX11UWAMain::SimulationLoop(void)
+{
+	PROFILE_THREAD_NAME("Simulation");
+
+	while (m_loopsRunning)
+	{
+		Update();
+
+		// The wait may run over by the scheduler's granularity, the steps it misses are caught up on the next Update
+		std::this_thread::sleep_for(std::chrono::duration<double>(m_simulation.GetSecondsToNextStep()));
+	}
+}
+
+void DX11UWAMain::RenderLoop(void)
+{
+	PROFILE_THREAD_NAME("Render");
+
+	while (m_loopsRunning)
+	{
+		uint64_t published;
+		{
+			std::lock_guard<std::mutex> lock(m_publishMutex);
+			published = m_publishedScenes;
+		}
+
+		bool rendered;
+		{
+			critical_section::scoped_lock lock(m_criticalSection);
+
+			// Present waits for the display, which sets the pace of the loop
+			rendered = Render();
+			if (rendered)
+			{
+				Present();
+			}
+		}
+
+		// Until the simulation publishes its first step there's nothing to draw, so sleep until it does
+		if (!rendered)
+		{
+			std::unique_lock<std::mutex> lock(m_publishMutex);
+			m_scenePublished.wait(lock, [this, published]() { return m_publishedScenes != published || !m_loopsRunning; });
+		}
+	}
+}
+
 // Notifies renderers that device resources need to be released.
 void DX11UWAMain::OnDeviceLost(void)
 {
@@ -140,11 +377,16 @@ void DX11UWAMain::OnDeviceLost(void)
 
 	m_sceneRenderer2->ReleaseDeviceDependentResources();
 	m_fpsTextRenderer2->ReleaseDeviceDependentResources();
+
+	// After the renderers, which hold the shared assets
+	m_assets->ReleaseDeviceDependentResources();
 }
 
 // Notifies renderers that device resources may now be recreated.
 void DX11UWAMain::OnDeviceRestored(void)
 {
+	m_assets->CreateDeviceDependentResources();
+
 	m_sceneRenderer->CreateDeviceDependentResources();
 	m_fpsTextRenderer->CreateDeviceDependentResources();
 	CreateWindowSizeDependentResources();
@@ -153,12 +395,21 @@ void DX11UWAMain::OnDeviceRestored(void)
 	m_fpsTextRenderer2->CreateDeviceDependentResources();
 }
 
-void DX11UWAMain::GetKeyboardButtons(const char* buttons)
+void DX11UWAMain::SetInput(const char* buttons, Windows::UI::Input::PointerPoint^ pos)
 {
-	memcpy_s(main_kbuttons, sizeof(main_kbuttons), buttons, sizeof(main_kbuttons));
-}
+	SceneInput input;
+	memcpy_s(input.keys, sizeof(input.keys), buttons, sizeof(input.keys));
+	input.hasPointer = (pos != nullptr);
+	input.rotating = input.hasPointer && pos->Properties->IsRightButtonPressed;
+	input.pointerX = input.hasPointer ? pos->Position.X : 0.0f;
+	input.pointerY = input.hasPointer ? pos->Position.Y : 0.0f;
 
-void DX11UWAMain::GetMousePos(const Windows::UI::Input::PointerPoint^ pos)
-{
-	main_currentpos = const_cast< Windows::UI::Input::PointerPoint^>(pos);
+	std::lock_guard<std::mutex> lock(m_inputMutex);
+
+	// The latency is measured from when the input changes, not from when it's sampled
+	const bool changed = memcmp(input.keys, m_input.keys, sizeof(input.keys)) != 0 || input.hasPointer != m_input.hasPointer ||
+		input.rotating != m_input.rotating || input.pointerX != m_input.pointerX || input.pointerY != m_input.pointerY;
+	input.ticks = changed ? DX::SystemStepClock::Get().GetTicks() : m_input.ticks;
+
+	m_input = input;
 }
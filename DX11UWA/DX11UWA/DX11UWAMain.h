@@ -1,10 +1,18 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "Common\StepTimer.h"
 #include "Common\DeviceResources.h"
 #include "Content\Sample3DSceneRenderer.h"
 #include "Content\SampleFpsTextRenderer.h"
+#include "FrameStats.h"
 #include "ObjLoader.h"
+#include "RunningStats.h"
+#include "SceneSimulation.h"
+#include "TripleBuffer.h"
 
 // Renders Direct2D and 3D content on the screen.
 namespace DX11UWA
@@ -15,34 +23,90 @@ namespace DX11UWA
 		DX11UWAMain(const std::shared_ptr<DX::DeviceResources>& deviceResources);
 		~DX11UWAMain(void);
 		void CreateWindowSizeDependentResources(void);
+
+		// Takes the simulation steps that are due and publishes the scene they made to Render
 		void Update(void);
+
+		// Draws the newest published scene, returns false if there's none yet
 		bool Render(void);
 
+		// Presents what Render drew, and keeps count of frame times and input latency
+		void Present(void);
+
+		// Writes the frame time percentiles and the most recent frame times to FrameStats.json in the app's
+		// local folder, when the app is suspended or closed. Builds with the profiler (see Profiler.h) write
+		// every thread's scopes to Trace.json next to it.
+		void ExportFrameStats(void);
+
+		// Runs Update on a simulation thread and Render and Present on a render thread, until StopLoops. Unless
+		// the loops are decoupled, App::Run calls all three one after the other on the UI thread instead.
+		bool IsDecoupled(void) const { return m_decoupled; }
+		void StartLoops(void);
+		void StopLoops(void);
+
+		// Held by the render thread for every frame, take it before changing the device resources from another thread
+		Concurrency::critical_section &GetCriticalSection(void) { return m_criticalSection; }
+
 		// IDeviceNotify
 		virtual void OnDeviceLost(void);
 		virtual void OnDeviceRestored(void);
 		
-		// Helper functions for the keyboard and mouse input
-		void GetKeyboardButtons(const char* buttons);
-		void GetMousePos(const Windows::UI::Input::PointerPoint^ pos);
+		// The keyboard and mouse as the UI thread last saw them, for the next simulation step
+		void SetInput(const char* buttons, Windows::UI::Input::PointerPoint^ pos);
 
 	private:
+		void SimulationLoop(void);
+		void RenderLoop(void);
+		void ReportFrameStats(uint64_t now);
+
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
 		std::shared_ptr<DX::DeviceResources> m_deviceResources2;
 
+		// Shaders, meshes, materials and textures of both scene renderers
+		std::shared_ptr<DX::D3DAssetCache> m_assets;
+
 		// TODO: Replace with your own content renderers.
 		std::unique_ptr<Sample3DSceneRenderer> m_sceneRenderer;
 		std::unique_ptr<SampleFpsTextRenderer> m_fpsTextRenderer;
 
 		std::unique_ptr<Sample3DSceneRenderer> m_sceneRenderer2;
 		std::unique_ptr<SampleFpsTextRenderer> m_fpsTextRenderer2;
-		// Rendering loop timer.
-		DX::StepTimer m_timer;
 
-		// Data members for the keyboard and mouse input
-		char main_kbuttons[256];
-		Windows::UI::Input::PointerPoint^ main_currentpos;
+		// The simulation steps at 60 Hz and hands each step's scene to Render through m_scenes. Render draws
+		// between the last two it took, a step behind, so the scene moves smoothly at any display rate.
+		SceneSimulation m_simulation;
+		TripleBuffer<SceneSnapshot> m_scenes;
+		SceneSnapshot m_previousScene;
+		SceneSnapshot m_currentScene;
+		bool m_hasScene;
+
+		// Counts the scenes Update publishes, so the render thread can sleep until there is one to draw
+		std::mutex m_publishMutex;
+		std::condition_variable m_scenePublished;
+		uint64_t m_publishedScenes;
+
+		// Sampled on the UI thread, read by the simulation
+		std::mutex m_inputMutex;
+		SceneInput m_input;
+
+		bool m_decoupled;
+		std::atomic<bool> m_loopsRunning;
+		std::thread m_simulationThread;
+		std::thread m_renderThread;
+		Concurrency::critical_section m_criticalSection;
+
+		// Time each update, submit and present takes, shown on the overlay, and from an input change to the
+		// first present showing it. Both are written to the debugger's output every few seconds, the frame
+		// times with their mean and deviation since the last report too.
+		FrameStats m_frameStats;
+		RunningStats m_frameTimes;
+		RunningStats m_inputLatencies;
+		uint64_t m_lastPresentTicks;
+		uint64_t m_statsStartTicks;
+		uint64_t m_nextOverlayTicks;
+		uint64_t m_drawnInputTicks;
+		uint64_t m_presentedInputTicks;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "pch.h"
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace
+{
+	// The smallest sample at least fraction of them are no longer than, of samples sorted shortest first
+	float percentile(const std::vector<float> &sorted, double fraction)
+	{
+		const size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+		return sorted[std::max<size_t>(rank, 1) - 1];
+	}
+
+	bool endsWith(const char *text, const char *suffix)
+	{
+		const size_t length = strlen(text), suffixLength = strlen(suffix);
+		return length >= suffixLength && strcmp(text + length - suffixLength, suffix) == 0;
+	}
+}
+
+FrameStats::FrameStats(uint32_t capacity) :
+	m_capacity(capacity)
+{
+	for (Ring &ring : m_rings)
+	{
+		ring.samples.reset(new std::atomic<float>[capacity]);
+		for (uint32_t i = 0; i < capacity; ++i)
+			ring.samples[i].store(0.0f, std::memory_order_relaxed);
+
+		ring.count.store(0, std::memory_order_relaxed);
+		ring.totalHitches.store(0, std::memory_order_relaxed);
+		ring.hitchThreshold = std::numeric_limits<float>::infinity();
+	}
+}
+
+void FrameStats::SetHitchThreshold(FrameStat stat, float milliseconds)
+{
+	m_rings[stat].hitchThreshold = milliseconds;
+}
+
+void FrameStats::Record(FrameStat stat, float milliseconds)
+{
+	Ring &ring = m_rings[stat];
+
+	// The only writer, so there's no one to race with for the next slot
+	const uint64_t count = ring.count.load(std::memory_order_relaxed);
+	ring.samples[count & (m_capacity - 1)].store(milliseconds, std::memory_order_relaxed);
+	ring.count.store(count + 1, std::memory_order_release);
+
+	if (milliseconds > ring.hitchThreshold)
+		ring.totalHitches.store(ring.totalHitches.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+uint32_t FrameStats::CopyWindow(FrameStat stat, float *samples) const
+{
+	const Ring &ring = m_rings[stat];
+	const uint64_t count = ring.count.load(std::memory_order_acquire);
+	const uint32_t window = static_cast<uint32_t>(std::min<uint64_t>(count, m_capacity));
+
+	for (uint32_t i = 0; i < window; ++i)
+		samples[i] = ring.samples[(count - window + i) & (m_capacity - 1)].load(std::memory_order_relaxed);
+	return window;
+}
+
+FrameStatSummary FrameStats::Summarize(FrameStat stat) const
+{
+	const Ring &ring = m_rings[stat];
+
+	FrameStatSummary summary;
+	memset(&summary, 0, sizeof(summary));
+	summary.count = ring.count.load(std::memory_order_acquire);
+	summary.totalHitches = ring.totalHitches.load(std::memory_order_relaxed);
+
+	std::vector<float> samples(m_capacity);
+	summary.window = CopyWindow(stat, samples.data());
+	if (summary.window == 0)
+		return summary;
+
+	samples.resize(summary.window);
+	std::sort(samples.begin(), samples.end());
+
+	summary.p50 = percentile(samples, 0.50);
+	summary.p95 = percentile(samples, 0.95);
+	summary.p99 = percentile(samples, 0.99);
+	summary.max = samples.back();
+	summary.hitches = static_cast<uint32_t>(samples.end() - std::upper_bound(samples.begin(), samples.end(), ring.hitchThreshold));
+	return summary;
+}
+
+bool FrameStats::Export(const char *path) const
+{
+	FILE *file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	const bool json = endsWith(path, ".json");
+	if (json)
+		fprintf(file, "{\n  \"stats\": [\n");
+	else
+		fprintf(file, "stat,count,window,p50_ms,p95_ms,p99_ms,max_ms,hitches,total_hitches\n");
+
+	std::vector<float> samples(m_capacity);
+	for (int stat = 0; stat < FRAME_STAT_COUNT; ++stat)
+	{
+		const FrameStatSummary summary = Summarize(static_cast<FrameStat>(stat));
+		if (!json)
+		{
+			fprintf(file, "%s,%llu,%u,%.3f,%.3f,%.3f,%.3f,%u,%llu\n", GetName(static_cast<FrameStat>(stat)),
+				static_cast<unsigned long long>(summary.count), summary.window, summary.p50, summary.p95, summary.p99, summary.max,
+				summary.hitches, static_cast<unsigned long long>(summary.totalHitches));
+			continue;
+		}
+
+		fprintf(file, "    { \"name\": \"%s\", \"count\": %llu, \"window\": %u, \"p50Ms\": %.3f, \"p95Ms\": %.3f, \"p99Ms\": %.3f, \"maxMs\": %.3f, "
+			"\"hitches\": %u, \"totalHitches\": %llu, \"hitchThresholdMs\": ", GetName(static_cast<FrameStat>(stat)),
+			static_cast<unsigned long long>(summary.count), summary.window, summary.p50, summary.p95, summary.p99, summary.max,
+			summary.hitches, static_cast<unsigned long long>(summary.totalHitches));
+
+		// JSON has no infinity, a stat without a threshold has null
+		const float threshold = m_rings[stat].hitchThreshold;
+		if (threshold != std::numeric_limits<float>::infinity())
+			fprintf(file, "%.3f", threshold);
+		else
+			fprintf(file, "null");
+
+		fprintf(file, ",\n      \"samplesMs\": [");
+		const uint32_t window = CopyWindow(static_cast<FrameStat>(stat), samples.data());
+		for (uint32_t i = 0; i < window; ++i)
+			fprintf(file, "%s%.3f", (i > 0) ? ", " : "", samples[i]);
+		fprintf(file, "] }%s\n", (stat + 1 < FRAME_STAT_COUNT) ? "," : "");
+	}
+
+	if (json)
+		fprintf(file, "  ]\n}\n");
+
+	const bool written = !ferror(file);
+	return (fclose(file) == 0) && written;
+}
+
+const char *FrameStats::GetName(FrameStat stat)
+{
+	switch (stat)
+	{
+	case FRAME_STAT_UPDATE:
+		return "update";
+	case FRAME_STAT_RENDER:
+		return "render";
+	case FRAME_STAT_PRESENT:
+		return "present";
+	default:
+		return "unknown";
+	}
+}
+
+void formatFrameStats(const FrameStats &stats, char *text, size_t size)
+{
+	// The tail of the frame times matters more than their average
+	const FrameStatSummary present = stats.Summarize(FRAME_STAT_PRESENT);
+	if (present.window == 0)
+	{
+		snprintf(text, size, "frame - ms");
+		return;
+	}
+
+	const FrameStatSummary update = stats.Summarize(FRAME_STAT_UPDATE);
+	const FrameStatSummary render = stats.Summarize(FRAME_STAT_RENDER);
+	snprintf(text, size,
+		"frame p50 %.1f  p95 %.1f  p99 %.1f  max %.1f ms\n"
+		"hitches %u of last %u, %llu total\n"
+		"cpu p99 update %.2f  render %.2f ms",
+		present.p50, present.p95, present.p99, present.max,
+		present.hitches, present.window, static_cast<unsigned long long>(present.totalHitches),
+		update.p99, render.p99);
+}
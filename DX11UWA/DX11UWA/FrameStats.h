@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// What each frame's time goes to
+enum FrameStat
+{
+	FRAME_STAT_UPDATE,		// CPU time of the simulation steps an update takes
+	FRAME_STAT_RENDER,		// CPU time to submit a frame, from the start of Render up to Present
+	FRAME_STAT_PRESENT,		// From one present to the next
+	FRAME_STAT_COUNT
+};
+
+// Percentiles and maximum over the most recent samples of a stat, in milliseconds
+struct FrameStatSummary
+{
+	uint64_t count;			// Samples recorded since the start
+	uint32_t window;		// How many of the most recent ones the rest covers
+	float p50, p95, p99, max;
+	uint32_t hitches;		// Samples in the window longer than the hitch threshold
+	uint64_t totalHitches;	// Since the start
+};
+
+// The time of every frame's update, render and present, kept in a ring of the most recent samples of each.
+// Recording never locks or allocates, each stat may be recorded from one thread while any other summarizes it.
+// A summary taken while a stat is being recorded may include a sample that was just overwritten by a newer one.
+class FrameStats
+{
+public:
+	// Keeps the last capacity samples of each stat, a power of two
+	explicit FrameStats(uint32_t capacity = 1024);
+
+	FrameStats(const FrameStats &) = delete;
+	FrameStats &operator=(const FrameStats &) = delete;
+
+	// Samples longer than this count as hitches, none do until it's set. Set it before recording.
+	void SetHitchThreshold(FrameStat stat, float milliseconds);
+
+	// Only one thread at a time may record each stat
+	void Record(FrameStat stat, float milliseconds);
+
+	FrameStatSummary Summarize(FrameStat stat) const;
+
+	// Every stat's summary, as a CSV row each, or as JSON with the samples in each window too if path ends in
+	// .json. False if the file can't be written.
+	bool Export(const char *path) const;
+
+	// "update", "render" and "present"
+	static const char *GetName(FrameStat stat);
+
+private:
+	struct Ring
+	{
+		std::unique_ptr<std::atomic<float>[]> samples;
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> totalHitches;
+		float hitchThreshold;
+	};
+
+	// The samples in the window of stat, oldest first
+	uint32_t CopyWindow(FrameStat stat, float *samples) const;
+
+	uint32_t m_capacity;
+	Ring m_rings[FRAME_STAT_COUNT];
+};
+
+// The overlay's lines: the percentiles of the frame times, the hitches and the slowest updates and submits
+void formatFrameStats(const FrameStats &stats, char *text, size_t size);
@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "HudText.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const HudGlyph &findGlyph(const HudFont &font, char c)
+	{
+		if (c < HUD_FIRST_GLYPH || c > HUD_LAST_GLYPH)
+			c = '?';
+		return font.glyphs[c - HUD_FIRST_GLYPH];
+	}
+
+	float lineWidth(const HudFont &font, const char *line)
+	{
+		float width = 0.0f;
+		for (const char *c = line; *c && *c != '\n'; ++c)
+			width += findGlyph(font, *c).advance;
+		return width;
+	}
+}
+
+float packHudGlyphs(HudFont &font, float width, float padding)
+{
+	// Cells start on whole DIPs so the atlas samples the same at any scale
+	const float rowHeight = std::ceil(font.lineHeight);
+
+	float x = 0.0f, y = 0.0f;
+	for (HudGlyph &glyph : font.glyphs)
+	{
+		const float cellWidth = std::ceil(glyph.advance + 2.0f * padding);
+		if (x > 0.0f && x + cellWidth > width)
+		{
+			x = 0.0f;
+			y += rowHeight;
+		}
+
+		glyph.source.left = x;
+		glyph.source.top = y;
+		glyph.source.right = x + cellWidth;
+		glyph.source.bottom = y + rowHeight;
+		glyph.originX = padding;
+		x += cellWidth;
+	}
+
+	return y + rowHeight;
+}
+
+void layoutHudText(const HudFont &font, const char *text, HudAlignment alignment, std::vector<HudQuad> &quads, float &width, float &height)
+{
+	quads.clear();
+	width = 0.0f;
+	height = 0.0f;
+	if (!*text)
+		return;
+
+	// Right aligned lines need the widest first
+	uint32_t lines = 1;
+	for (const char *line = text; line; )
+	{
+		width = std::max<float>(width, lineWidth(font, line));
+
+		line = strchr(line, '\n');
+		if (line)
+		{
+			++line;
+			++lines;
+		}
+	}
+	height = lines * font.lineHeight;
+
+	float top = 0.0f;
+	for (const char *line = text; line; top += font.lineHeight)
+	{
+		float x = (alignment == HUD_ALIGN_RIGHT) ? width - lineWidth(font, line) : 0.0f;
+
+		const char *c = line;
+		for (; *c && *c != '\n'; ++c)
+		{
+			const HudGlyph &glyph = findGlyph(font, *c);
+			if (*c != ' ')
+			{
+				HudQuad quad;
+				quad.source = glyph.source;
+				quad.destination.left = x - glyph.originX;
+				quad.destination.top = top;
+				quad.destination.right = quad.destination.left + (glyph.source.right - glyph.source.left);
+				quad.destination.bottom = top + (glyph.source.bottom - glyph.source.top);
+				quads.push_back(quad);
+			}
+			x += glyph.advance;
+		}
+
+		line = *c ? c + 1 : nullptr;
+	}
+}
+
+HudText::HudText(HudTextBackend &backend, const HudFont &font, HudAlignment alignment) :
+	m_backend(backend),
+	m_font(font),
+	m_alignment(alignment),
+	m_width(0.0f),
+	m_height(0.0f),
+	m_layoutCount(0),
+	m_valid(false)
+{
+}
+
+bool HudText::SetText(const char *text)
+{
+	if (m_valid && m_text == text)
+		return false;
+
+	m_text = text;
+	layoutHudText(m_font, text, m_alignment, m_quads, m_width, m_height);
+	m_backend.SetQuads(m_quads.data(), static_cast<uint32_t>(m_quads.size()));
+
+	++m_layoutCount;
+	m_valid = true;
+	return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Overlay text drawn from an atlas the glyphs are rasterized into once, rather than laid out by DirectWrite
+// every time it's drawn. The quads of all the text are drawn with one call, and only built again when the
+// text changes.
+//
+// Where each glyph goes is decided here, without Direct2D. Rasterizing the atlas and drawing the quads is the
+// job of a HudTextBackend, so the same layout and batching can be checked headless by a backend that only
+// records them.
+
+// The atlas has the printable ASCII characters, anything else is drawn as '?'
+const char HUD_FIRST_GLYPH = ' ';
+const char HUD_LAST_GLYPH = '~';
+const uint32_t HUD_GLYPH_COUNT = HUD_LAST_GLYPH - HUD_FIRST_GLYPH + 1;
+
+struct HudRect
+{
+	float left, top, right, bottom;
+};
+
+// Each glyph has a cell of the atlas a line high, with its origin originX from the cell's left edge so glyphs
+// that reach back past their origin aren't clipped
+struct HudGlyph
+{
+	HudRect	source;
+	float	originX;
+	float	advance;	// From this glyph's origin to the next one's
+};
+
+// All sizes are in DIPs
+struct HudFont
+{
+	float		lineHeight;
+	HudGlyph	glyphs[HUD_GLYPH_COUNT];
+};
+
+// Where a glyph's cell is drawn from and to, relative to the top left corner of the text
+struct HudQuad
+{
+	HudRect destination;
+	HudRect source;
+};
+
+// Places the cells of every glyph of font, which has its line height and advances set, in rows across an atlas
+// width wide, padding wider than each advance on both sides. Returns how high the atlas has to be.
+float packHudGlyphs(HudFont &font, float width, float padding);
+
+enum HudAlignment
+{
+	HUD_ALIGN_LEFT,
+	HUD_ALIGN_RIGHT		// Lines end at the right edge of the widest
+};
+
+// Lays text out in lines split at '\n', adding a quad for each glyph other than spaces, and returns the size it
+// takes
+void layoutHudText(const HudFont &font, const char *text, HudAlignment alignment, std::vector<HudQuad> &quads, float &width, float &height);
+
+// Rasterizes the atlas and draws quads from it
+class HudTextBackend
+{
+public:
+	virtual ~HudTextBackend(void) {}
+
+	// Replaces the quads every Draw draws, only called when they change
+	virtual void SetQuads(const HudQuad *quads, uint32_t count) = 0;
+
+	// Draws all the quads with one call, with the top left corner of the text at x, y
+	virtual void Draw(float x, float y) = 0;
+};
+
+// A block of text, laid out again only when it changes
+class HudText
+{
+public:
+	HudText(HudTextBackend &backend, const HudFont &font, HudAlignment alignment = HUD_ALIGN_LEFT);
+
+	HudText(const HudText &) = delete;
+	HudText &operator=(const HudText &) = delete;
+
+	// Lays the text out and hands the quads to the backend, unless it's the text already shown. Returns true if
+	// it was laid out.
+	bool SetText(const char *text);
+
+	void Draw(float x, float y) { m_backend.Draw(x, y); }
+
+	const std::string &GetText(void) const { return m_text; }
+	float GetWidth(void) const { return m_width; }
+	float GetHeight(void) const { return m_height; }
+	uint32_t GetQuadCount(void) const { return static_cast<uint32_t>(m_quads.size()); }
+
+	// How many times the text was laid out
+	uint32_t GetLayoutCount(void) const { return m_layoutCount; }
+
+private:
+	HudTextBackend			&m_backend;
+	HudFont					m_font;
+	HudAlignment			m_alignment;
+	std::string				m_text;
+	std::vector<HudQuad>	m_quads;	// Kept between layouts so they don't allocate
+	float					m_width;
+	float					m_height;
+	uint32_t				m_layoutCount;
+	bool					m_valid;
+};
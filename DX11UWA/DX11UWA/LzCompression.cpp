@@ -0,0 +1,204 @@
+#include "pch.h"
+#include "LzCompression.h"
+
+#include <cstring>
+
+namespace
+{
+	const size_t minMatch = 4;
+
+	// The format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+	const size_t lastLiterals = 5;
+	const size_t matchFindLimit = 12;
+
+	const size_t maxOffset = 65535;
+
+	// Positions of recently seen 4 byte sequences, by hash
+	const unsigned int hashBits = 12;
+
+	uint32_t read32(const uint8_t *p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t hashSequence(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - hashBits);
+	}
+
+	// Lengths of 15 and more continue in bytes of 255 and a last one below it
+	uint8_t *writeLength(uint8_t *out, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+			*out++ = 255;
+		*out++ = static_cast<uint8_t>(length);
+		return out;
+	}
+
+	bool readLength(const uint8_t *&in, const uint8_t *end, size_t &length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (in == end)
+				return false;
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	// Writes one sequence, or the last literals alone when matchLength is 0. Returns null if it doesn't fit.
+	uint8_t *writeSequence(uint8_t *out, const uint8_t *outEnd, const uint8_t *literals, size_t literalCount, size_t offset, size_t matchLength)
+	{
+		// Token, lengths, literals and offset
+		if (static_cast<size_t>(outEnd - out) < 1 + literalCount / 255 + 1 + literalCount + 2 + matchLength / 255 + 1)
+			return nullptr;
+
+		uint8_t *token = out++;
+		*token = static_cast<uint8_t>((literalCount < 15 ? literalCount : 15) << 4);
+		if (literalCount >= 15)
+			out = writeLength(out, literalCount - 15);
+
+		memcpy(out, literals, literalCount);
+		out += literalCount;
+
+		if (matchLength == 0)
+			return out;
+
+		*out++ = static_cast<uint8_t>(offset);
+		*out++ = static_cast<uint8_t>(offset >> 8);
+
+		const size_t extra = matchLength - minMatch;
+		*token |= static_cast<uint8_t>(extra < 15 ? extra : 15);
+		if (extra >= 15)
+			out = writeLength(out, extra - 15);
+
+		return out;
+	}
+}
+
+size_t lzCompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t lzCompress(const uint8_t *src, size_t size, uint8_t *dest, size_t capacity)
+{
+	uint8_t *out = dest;
+	const uint8_t *outEnd = dest + capacity;
+	size_t anchor = 0;
+
+	if (size > matchFindLimit)
+	{
+		// Position + 1 of the last sequence with each hash, 0 for none
+		uint32_t table[1 << hashBits] = {};
+
+		const size_t matchLimit = size - lastLiterals;
+		const size_t searchLimit = size - matchFindLimit;
+		size_t position = 0;
+		size_t misses = 0;
+
+		while (position < searchLimit)
+		{
+			const uint32_t sequence = read32(src + position);
+			const uint32_t hash = hashSequence(sequence);
+			const size_t candidate = table[hash];
+			table[hash] = static_cast<uint32_t>(position + 1);
+
+			if (candidate == 0 || position - (candidate - 1) > maxOffset || read32(src + candidate - 1) != sequence)
+			{
+				// Skip faster through data that doesn't compress
+				position += 1 + (misses++ >> 6);
+				continue;
+			}
+
+			misses = 0;
+			size_t match = candidate - 1;
+			size_t start = position;
+
+			// Grow the match backwards into the pending literals, then forwards
+			while (start > anchor && match > 0 && src[start - 1] == src[match - 1])
+			{
+				--start;
+				--match;
+			}
+
+			size_t length = position - start + minMatch;
+			while (start + length < matchLimit && src[start + length] == src[match + length])
+				++length;
+
+			out = writeSequence(out, outEnd, src + anchor, start - anchor, start - match, length);
+			if (!out)
+				return 0;
+
+			anchor = start + length;
+			position = anchor;
+
+			// The position just before the next search often starts a match too
+			table[hashSequence(read32(src + position - 2))] = static_cast<uint32_t>(position - 2 + 1);
+		}
+	}
+
+	out = writeSequence(out, outEnd, src + anchor, size - anchor, 0, 0);
+	return out ? static_cast<size_t>(out - dest) : 0;
+}
+
+bool lzDecompress(const uint8_t *src, size_t srcSize, uint8_t *dest, size_t destSize)
+{
+	const uint8_t *in = src;
+	const uint8_t *inEnd = src + srcSize;
+	uint8_t *out = dest;
+	uint8_t *outEnd = dest + destSize;
+
+	for (;;)
+	{
+		if (in == inEnd)
+			return false;
+
+		const uint8_t token = *in++;
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !readLength(in, inEnd, literalCount))
+			return false;
+		if (literalCount > static_cast<size_t>(inEnd - in) || literalCount > static_cast<size_t>(outEnd - out))
+			return false;
+
+		memcpy(out, in, literalCount);
+		in += literalCount;
+		out += literalCount;
+
+		// Only the last sequence has no match
+		if (in == inEnd)
+			return out == outEnd;
+
+		if (inEnd - in < 2)
+			return false;
+		const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+		in += 2;
+		if (offset == 0 || offset > static_cast<size_t>(out - dest))
+			return false;
+
+		size_t length = token & 15;
+		if (length == 15 && !readLength(in, inEnd, length))
+			return false;
+		length += minMatch;
+		if (length > static_cast<size_t>(outEnd - out))
+			return false;
+
+		// Matches may overlap what they write, repeating the last offset bytes
+		const uint8_t *match = out - offset;
+		if (offset >= length)
+		{
+			memcpy(out, match, length);
+			out += length;
+		}
+		else
+		{
+			for (size_t i = 0; i < length; ++i)
+				*out++ = match[i];
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Byte oriented LZ77 compression in the LZ4 block format: runs of literals and matches of at least 4 bytes
+// up to 64 KB back, with no entropy coding, so decompressing is little more than memcpy. Asset packs
+// compress their entries with it block by block (see AssetPack.h).
+
+// Most bytes lzCompress can write for size bytes of input
+size_t lzCompressBound(size_t size);
+
+// Compresses size bytes of src into dest. Returns the compressed size, or 0 if it needs more than capacity bytes.
+size_t lzCompress(const uint8_t *src, size_t size, uint8_t *dest, size_t capacity);
+
+// Decompresses a block lzCompress wrote into exactly destSize bytes. Returns false if src is malformed or
+// doesn't decompress to destSize bytes; dest is never written past destSize either way.
+bool lzDecompress(const uint8_t *src, size_t srcSize, uint8_t *dest, size_t destSize);
@@ -0,0 +1,270 @@
+#include "pch.h"
+#include "MappedFile.h"
+#include "AssetPack.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(void) :
+	m_data(nullptr),
+	m_size(0),
+	m_isOpen(false)
+#if defined(_WIN32)
+	, m_fileHandle(nullptr),
+	m_mappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile(void)
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) :
+	MappedFile()
+{
+	*this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other)
+{
+	if (this != &other)
+	{
+		Close();
+
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_isOpen, other.m_isOpen);
+		std::swap(m_pack, other.m_pack);
+		std::swap(m_buffer, other.m_buffer);
+#if defined(_WIN32)
+		std::swap(m_fileHandle, other.m_fileHandle);
+		std::swap(m_mappingHandle, other.m_mappingHandle);
+#endif
+	}
+
+	return *this;
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::OpenFile(const char *path)
+{
+	Close();
+
+	// CreateFile2 only takes wide paths
+	wchar_t widePath[MAX_PATH];
+	if (MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath, MAX_PATH) == 0)
+		return false;
+
+	HANDLE file = CreateFile2(widePath, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	FILE_STANDARD_INFO fileInfo;
+	if (!GetFileInformationByHandleEx(file, FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	// Larger files than the address space can hold, only possible in 32-bit builds
+	if (static_cast<uint64_t>(fileInfo.EndOfFile.QuadPart) > SIZE_MAX)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	m_fileHandle = file;
+	m_size = static_cast<size_t>(fileInfo.EndOfFile.QuadPart);
+	m_isOpen = true;
+
+	// Empty files can't be mapped, but they are still valid (and empty) files
+	if (m_size == 0)
+		return true;
+
+	m_mappingHandle = CreateFileMappingFromApp(file, nullptr, PAGE_READONLY, 0, nullptr);
+	if (!m_mappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	m_data = MapViewOfFileFromApp(m_mappingHandle, FILE_MAP_READ, 0, 0);
+	if (!m_data)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close(void)
+{
+	if (m_data && !m_pack)
+		UnmapViewOfFile(m_data);
+	if (m_mappingHandle)
+		CloseHandle(m_mappingHandle);
+	if (m_fileHandle)
+		CloseHandle(m_fileHandle);
+
+	m_data = nullptr;
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+	m_size = 0;
+	m_isOpen = false;
+	m_pack.reset();
+	m_buffer.reset();
+}
+
+namespace
+{
+	bool getDiskFileStamp(const char *path, FileStamp &out)
+	{
+		wchar_t widePath[MAX_PATH];
+		if (MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath, MAX_PATH) == 0)
+			return false;
+
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExW(widePath, GetFileExInfoStandard, &attributes))
+			return false;
+
+		out.size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+		out.modifiedTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+		return true;
+	}
+}
+
+#else
+
+bool MappedFile::OpenFile(const char *path)
+{
+	Close();
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	if (static_cast<uint64_t>(info.st_size) > SIZE_MAX)
+	{
+		close(fd);
+		return false;
+	}
+
+	m_size = static_cast<size_t>(info.st_size);
+	m_isOpen = true;
+
+	if (m_size > 0)
+	{
+		void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			close(fd);
+			Close();
+			return false;
+		}
+
+		// The whole file is about to be scanned front to back
+		madvise(data, m_size, MADV_SEQUENTIAL);
+		m_data = data;
+	}
+
+	// The mapping keeps its own reference to the file
+	close(fd);
+	return true;
+}
+
+void MappedFile::Close(void)
+{
+	if (m_data && !m_pack)
+		munmap(m_data, m_size);
+
+	m_data = nullptr;
+	m_size = 0;
+	m_isOpen = false;
+	m_pack.reset();
+	m_buffer.reset();
+}
+
+namespace
+{
+	bool getDiskFileStamp(const char *path, FileStamp &out)
+	{
+		struct stat info;
+		if (stat(path, &info) != 0)
+			return false;
+
+		out.size = static_cast<uint64_t>(info.st_size);
+#if defined(__APPLE__)
+		out.modifiedTime = static_cast<uint64_t>(info.st_mtimespec.tv_sec) * 1000000000ull + info.st_mtimespec.tv_nsec;
+#else
+		out.modifiedTime = static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000ull + info.st_mtim.tv_nsec;
+#endif
+		return true;
+	}
+}
+
+#endif
+
+bool MappedFile::Open(const char *path)
+{
+	return OpenPacked(path) || OpenFile(path);
+}
+
+bool MappedFile::OpenPacked(const char *path, unsigned int threadCount)
+{
+	Close();
+
+	std::shared_ptr<const AssetPack> pack;
+	const AssetPackEntry *entry;
+	if (!findMountedAsset(path, pack, entry))
+		return false;
+
+	const uint8_t *data = pack->GetStoredData(*entry);
+	if (!data && entry->size > 0)
+	{
+		std::unique_ptr<uint8_t[]> buffer(new uint8_t[static_cast<size_t>(entry->size)]);
+		if (!pack->Read(*entry, buffer.get(), threadCount))
+			return false;
+
+		data = buffer.get();
+		m_buffer = std::move(buffer);
+	}
+
+	m_pack = pack;
+	m_data = const_cast<uint8_t *>(data);
+	m_size = static_cast<size_t>(entry->size);
+	m_isOpen = true;
+	return true;
+}
+
+bool getFileStamp(const char *path, FileStamp &out)
+{
+	std::shared_ptr<const AssetPack> pack;
+	const AssetPackEntry *entry;
+	if (findMountedAsset(path, pack, entry))
+	{
+		out.size = entry->size;
+		out.modifiedTime = entry->modifiedTime;
+		return true;
+	}
+
+	return getDiskFileStamp(path, out);
+}
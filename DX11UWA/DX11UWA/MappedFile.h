@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class AssetPack;
+
+// Read-only view of a whole file mapped into the address space, or of an entry of a mounted asset pack
+// (see AssetPack.h). The data stays valid until Close() is called or the object is destroyed.
+class MappedFile
+{
+public:
+	MappedFile(void);
+	~MappedFile(void);
+
+	MappedFile(MappedFile &&other);
+	MappedFile &operator=(MappedFile &&other);
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	// Opens the entry named path in the mounted asset packs, or else maps the file at path.
+	// Returns false if it can't be opened or mapped.
+	bool Open(const char *path);
+
+	// Only maps the file on disk
+	bool OpenFile(const char *path);
+
+	// Only opens an entry of a mounted pack. Stored entries are used in place, compressed ones are
+	// decompressed into memory on threadCount threads (0 uses every core).
+	bool OpenPacked(const char *path, unsigned int threadCount = 0);
+	void Close(void);
+
+	bool IsOpen(void) const { return m_isOpen; }
+	const char *GetData(void) const { return static_cast<const char *>(m_data); }
+	size_t GetSize(void) const { return m_size; }
+
+private:
+	void	*m_data;
+	size_t	m_size;
+	bool	m_isOpen;
+
+	// Set when the data is an entry of a pack, which then stays mapped, and when it had to be decompressed
+	std::shared_ptr<const AssetPack>	m_pack;
+	std::unique_ptr<uint8_t[]>			m_buffer;
+
+#if defined(_WIN32)
+	void	*m_fileHandle;
+	void	*m_mappingHandle;
+#endif
+};
+
+// Size and last write time of a file, without opening it. The time is only meaningful for comparing
+// stamps taken on the same machine. Returns false if the file doesn't exist. Entries of mounted asset
+// packs have the stamp of the file they were packed from.
+struct FileStamp
+{
+	uint64_t	size;
+	uint64_t	modifiedTime;
+};
+
+bool getFileStamp(const char *path, FileStamp &out);
@@ -0,0 +1,232 @@
+#include "pch.h"
+#include "MaterialLibrary.h"
+#include "MappedFile.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char *skipSpaces(const char *text)
+	{
+		while (isSpace(*text))
+			++text;
+		return text;
+	}
+
+	// Reads count floats. An RGB statement may give one value for all three channels, so when only the first
+	// is there it's repeated into the rest.
+	bool parseFloats(const char *text, float *out, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			char *end = nullptr;
+			out[i] = strtof(text, &end);
+			if (end == text)
+			{
+				if (i != 1)
+					return false;
+				for (; i < count; ++i)
+					out[i] = out[0];
+				return true;
+			}
+			text = end;
+		}
+		return true;
+	}
+
+	bool parseColor(const char *text, DirectX::XMFLOAT3 &out)
+	{
+		// "spectral" and "xyz" colors aren't used by any of our exporters
+		if (strncmp(text, "spectral", 8) == 0 || strncmp(text, "xyz", 3) == 0)
+			return true;
+		return parseFloats(text, &out.x, 3);
+	}
+
+	const char *trimEnd(const char *text)
+	{
+		const char *end = text + strlen(text);
+		while (end > text && isSpace(end[-1]))
+			--end;
+		return end;
+	}
+
+	// The file name of a map statement is its last word, anything before it is options like -bm or -clamp
+	std::string parseMapName(const char *text)
+	{
+		const char *end = trimEnd(text);
+		const char *start = end;
+		while (start > text && !isSpace(start[-1]))
+			--start;
+		return std::string(start, end);
+	}
+
+	bool isStatement(const char *line, const char *keyword, const char **arguments)
+	{
+		const size_t length = strlen(keyword);
+		if (strncmp(line, keyword, length) != 0 || !isSpace(line[length]))
+			return false;
+		*arguments = skipSpaces(line + length);
+		return true;
+	}
+
+	bool parseLine(const char *line, std::vector<Material> &out)
+	{
+		const char *arguments = nullptr;
+
+		if (isStatement(line, "newmtl", &arguments))
+		{
+			out.push_back(Material());
+			out.back().name.assign(arguments, trimEnd(arguments));
+			return true;
+		}
+
+		// Statements before the first newmtl don't belong to any material
+		if (out.empty())
+			return true;
+		Material &material = out.back();
+
+		if (isStatement(line, "Ka", &arguments))
+			return parseColor(arguments, material.ambient);
+		if (isStatement(line, "Kd", &arguments))
+			return parseColor(arguments, material.diffuse);
+		if (isStatement(line, "Ks", &arguments))
+			return parseColor(arguments, material.specular);
+		if (isStatement(line, "Ke", &arguments))
+			return parseColor(arguments, material.emissive);
+		if (isStatement(line, "Tf", &arguments))
+			return parseColor(arguments, material.transmission);
+		if (isStatement(line, "Ns", &arguments))
+			return parseFloats(arguments, &material.specularPower, 1);
+		if (isStatement(line, "Ni", &arguments))
+			return parseFloats(arguments, &material.refraction, 1);
+		if (isStatement(line, "d", &arguments))
+		{
+			// "d -halo 0.5" fades with the view angle, which is drawn as plain d
+			if (strncmp(arguments, "-halo", 5) == 0)
+				arguments = skipSpaces(arguments + 5);
+			return parseFloats(arguments, &material.opacity, 1);
+		}
+		if (isStatement(line, "Tr", &arguments))
+		{
+			float transparency = 0.0f;
+			if (!parseFloats(arguments, &transparency, 1))
+				return false;
+			material.opacity = 1.0f - transparency;
+			return true;
+		}
+		if (isStatement(line, "illum", &arguments))
+		{
+			char *end = nullptr;
+			material.illumination = static_cast<int>(strtol(arguments, &end, 10));
+			return end != arguments;
+		}
+		if (isStatement(line, "map_Kd", &arguments))
+			material.diffuseMap = parseMapName(arguments);
+		else if (isStatement(line, "map_Ks", &arguments))
+			material.specularMap = parseMapName(arguments);
+		else if (isStatement(line, "map_Bump", &arguments) || isStatement(line, "map_bump", &arguments) || isStatement(line, "bump", &arguments))
+			material.bumpMap = parseMapName(arguments);
+
+		return true;
+	}
+}
+
+Material::Material(void) :
+	ambient(0.0f, 0.0f, 0.0f),
+	diffuse(1.0f, 1.0f, 1.0f),
+	specular(0.0f, 0.0f, 0.0f),
+	emissive(0.0f, 0.0f, 0.0f),
+	transmission(1.0f, 1.0f, 1.0f),
+	specularPower(1.0f),
+	opacity(1.0f),
+	refraction(1.0f),
+	illumination(2)
+{
+}
+
+bool parseMTL(const char *data, size_t size, std::vector<Material> &out)
+{
+	out.clear();
+
+	const char *end = data + size;
+	std::string line;
+
+	while (data < end)
+	{
+		const char *next = static_cast<const char *>(memchr(data, '\n', end - data));
+		if (!next)
+			next = end;
+
+		// Copied so strtof stops at the end of the line
+		line.assign(data, next);
+		const char *text = skipSpaces(line.c_str());
+		if (*text && *text != '#' && !parseLine(text, out))
+			return false;
+
+		data = next + 1;
+	}
+
+	return true;
+}
+
+MaterialTable::MaterialTable(void) :
+	m_materials(1)
+{
+}
+
+uint32_t MaterialTable::Resolve(const std::string &directory, const char *library, const char *name)
+{
+	if (!library || !*library)
+		return 0;
+
+	const std::string path = directory.empty() ? std::string(library) : directory + "/" + library;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_libraries.find(path) == m_libraries.end())
+	{
+		std::vector<Material> materials;
+		MappedFile file;
+		const bool loaded = file.Open(path.c_str()) && parseMTL(file.GetData(), file.GetSize(), materials);
+		m_libraries[path] = loaded;
+
+		if (loaded)
+		{
+			for (Material &material : materials)
+			{
+				// A later definition of the same name replaces the earlier one, as it would in a loader reading the file in order
+				const std::pair<std::string, std::string> key(path, material.name);
+				std::map<std::pair<std::string, std::string>, uint32_t>::iterator found = m_indices.find(key);
+				if (found != m_indices.end())
+				{
+					m_materials[found->second] = std::move(material);
+					continue;
+				}
+
+				m_indices[key] = static_cast<uint32_t>(m_materials.size());
+				m_materials.push_back(std::move(material));
+			}
+		}
+	}
+
+	std::map<std::pair<std::string, std::string>, uint32_t>::const_iterator found = m_indices.find(std::make_pair(path, std::string(name ? name : "")));
+	return (found != m_indices.end()) ? found->second : 0;
+}
+
+Material MaterialTable::Get(uint32_t index) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (index < m_materials.size()) ? m_materials[index] : m_materials[0];
+}
+
+size_t MaterialTable::GetCount(void) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_materials.size();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Surface properties of one material from an MTL file. Maps are file names relative to the MTL file.
+struct Material
+{
+	Material(void);
+
+	std::string			name;
+	DirectX::XMFLOAT3	ambient;		// Ka
+	DirectX::XMFLOAT3	diffuse;		// Kd
+	DirectX::XMFLOAT3	specular;		// Ks
+	DirectX::XMFLOAT3	emissive;		// Ke
+	DirectX::XMFLOAT3	transmission;	// Tf
+	float				specularPower;	// Ns
+	float				opacity;		// d, or 1 - Tr
+	float				refraction;		// Ni
+	int					illumination;	// illum
+	std::string			diffuseMap;		// map_Kd
+	std::string			specularMap;	// map_Ks
+	std::string			bumpMap;		// map_Bump or bump
+};
+
+// Parses the materials of an MTL file. Unknown statements are skipped, so is anything before the first
+// newmtl. Returns false on a malformed number.
+bool parseMTL(const char *data, size_t size, std::vector<Material> &out);
+
+// Every material of the MTL files loaded so far, shared by all meshes so each one is only parsed and
+// stored once. Entry 0 is the default material, used for anything no library defines. Safe to use from
+// several threads at once.
+class MaterialTable
+{
+public:
+	MaterialTable(void);
+
+	MaterialTable(const MaterialTable &) = delete;
+	MaterialTable &operator=(const MaterialTable &) = delete;
+
+	// Index of the named material in directory/library, loading the library the first time it's needed.
+	// Gives 0 when the library can't be read or doesn't have the material.
+	uint32_t Resolve(const std::string &directory, const char *library, const char *name);
+
+	// Copy of the material, as the table may grow while it's used
+	Material Get(uint32_t index) const;
+	size_t GetCount(void) const;
+
+private:
+	mutable std::mutex										m_mutex;
+	std::vector<Material>									m_materials;
+	std::map<std::string, bool>								m_libraries;	// Every path tried, and whether it loaded
+	std::map<std::pair<std::string, std::string>, uint32_t>	m_indices;		// By library path and material name
+};
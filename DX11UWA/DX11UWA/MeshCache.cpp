@@ -0,0 +1,614 @@
+#include "pch.h"
+#include "MeshCache.h"
+#include "MeshClusters.h"
+#include "MeshLod.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace
+{
+	const uint64_t sectionAlignment = 16;
+
+	inline uint64_t alignUp(uint64_t value)
+	{
+		return (value + sectionAlignment - 1) & ~(sectionAlignment - 1);
+	}
+
+	// Replaces target with source, even when target already exists
+	bool replaceFile(const std::string &source, const std::string &target)
+	{
+#if defined(_WIN32)
+		wchar_t wideSource[MAX_PATH], wideTarget[MAX_PATH];
+		if (MultiByteToWideChar(CP_UTF8, 0, source.c_str(), -1, wideSource, MAX_PATH) == 0 ||
+			MultiByteToWideChar(CP_UTF8, 0, target.c_str(), -1, wideTarget, MAX_PATH) == 0)
+			return false;
+
+		return MoveFileExW(wideSource, wideTarget, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return rename(source.c_str(), target.c_str()) == 0;
+#endif
+	}
+
+	// Largest of count indices from start on, in a buffer of 16 or 32 bit indices
+	template<typename Index>
+	uint32_t maxIndex(const char *indices, uint32_t start, uint32_t count)
+	{
+		const Index *first = reinterpret_cast<const Index *>(indices) + start;
+		uint32_t largest = 0;
+		for (uint32_t i = 0; i < count; ++i)
+			largest = std::max<uint32_t>(largest, first[i]);
+		return largest;
+	}
+
+	// Copies as much of the names as fits, always leaving the terminating zero
+	RMeshMaterial makeMeshMaterial(const ObjMaterialName &name)
+	{
+		RMeshMaterial material = {};
+		memcpy(material.name, name.name.c_str(), std::min<size_t>(name.name.size(), RMESH_MAX_NAME - 1));
+		memcpy(material.library, name.library.c_str(), std::min<size_t>(name.library.size(), RMESH_MAX_NAME - 1));
+		return material;
+	}
+}
+
+RMesh::RMesh(void) :
+	m_data(nullptr),
+	m_header(nullptr)
+{
+}
+
+RMesh::RMesh(RMesh &&other) :
+	RMesh()
+{
+	*this = std::move(other);
+}
+
+RMesh &RMesh::operator=(RMesh &&other)
+{
+	if (this != &other)
+	{
+		// Moving a vector keeps its buffer, so the pointers stay valid
+		m_file = std::move(other.m_file);
+		m_image = std::move(other.m_image);
+		m_data = other.m_data;
+		m_header = other.m_header;
+
+		other.Close();
+	}
+
+	return *this;
+}
+
+bool RMesh::Open(const char *path)
+{
+	Close();
+
+	if (!m_file.Open(path))
+		return false;
+
+	if (!Validate(m_file.GetData(), m_file.GetSize()))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool RMesh::Validate(const char *data, size_t size)
+{
+	if (size < sizeof(RMeshHeader))
+		return false;
+
+	const RMeshHeader *header = reinterpret_cast<const RMeshHeader *>(data);
+
+	if (header->magic != RMESH_MAGIC || header->version != RMESH_VERSION || header->headerSize != sizeof(RMeshHeader) ||
+		header->vertexStride != sizeof(DX11UWA::VertexPositionUVNormal) || (header->indexStride != sizeof(uint16_t) && header->indexStride != sizeof(uint32_t)) ||
+		header->fileSize != size)
+		return false;
+
+	// Every section has to be aligned and fit in the file
+	const uint64_t vertexBytes = static_cast<uint64_t>(header->vertexCount) * header->vertexStride;
+	const uint64_t indexBytes = static_cast<uint64_t>(header->indexCount) * header->indexStride;
+	const uint64_t submeshBytes = static_cast<uint64_t>(header->submeshCount) * sizeof(RMeshSubmesh);
+	const uint64_t submeshBoundsBytes = static_cast<uint64_t>(header->submeshCount) * sizeof(RMeshSubmeshBounds);
+	const uint64_t lodBytes = static_cast<uint64_t>(header->lodCount) * sizeof(MeshLod);
+	const uint64_t materialBytes = static_cast<uint64_t>(header->materialCount) * sizeof(RMeshMaterial);
+	const uint64_t clusterBytes = static_cast<uint64_t>(header->clusterCount) * sizeof(MeshCluster);
+	const uint64_t tangentBytes = static_cast<uint64_t>(header->vertexCount) * sizeof(DirectX::XMFLOAT4);
+
+	if (header->vertexOffset % sectionAlignment || header->indexOffset % sectionAlignment || header->submeshOffset % sectionAlignment ||
+		header->submeshBoundsOffset % sectionAlignment || header->submeshBoundsOffset > size || submeshBoundsBytes > size - header->submeshBoundsOffset ||
+		header->lodOffset % sectionAlignment || header->lodOffset > size || lodBytes > size - header->lodOffset ||
+		header->materialOffset % sectionAlignment || header->materialOffset > size || materialBytes > size - header->materialOffset ||
+		header->clusterOffset % sectionAlignment || header->clusterOffset > size || clusterBytes > size - header->clusterOffset ||
+		header->vertexOffset < sizeof(RMeshHeader) || header->vertexOffset > size || vertexBytes > size - header->vertexOffset ||
+		header->indexOffset > size || indexBytes > size - header->indexOffset ||
+		header->submeshOffset > size || submeshBytes > size - header->submeshOffset)
+		return false;
+
+	if (header->tangentOffset != 0 && (header->tangentOffset % sectionAlignment || header->tangentOffset > size || tangentBytes > size - header->tangentOffset))
+		return false;
+
+	// Every index a submesh draws, with its base vertex added, has to be a vertex of the file
+	const RMeshSubmesh *submeshes = reinterpret_cast<const RMeshSubmesh *>(data + header->submeshOffset);
+	for (uint32_t i = 0; i < header->submeshCount; ++i)
+	{
+		const RMeshSubmesh &submesh = submeshes[i];
+		if (submesh.indexStart > header->indexCount || submesh.indexCount > header->indexCount - submesh.indexStart ||
+			submesh.baseVertex > header->vertexCount || submesh.materialIndex >= header->materialCount)
+			return false;
+
+		if (submesh.indexCount == 0)
+			continue;
+
+		const uint32_t largest = (header->indexStride == sizeof(uint16_t)) ?
+			maxIndex<uint16_t>(data + header->indexOffset, submesh.indexStart, submesh.indexCount) :
+			maxIndex<uint32_t>(data + header->indexOffset, submesh.indexStart, submesh.indexCount);
+		if (static_cast<uint64_t>(largest) + submesh.baseVertex >= header->vertexCount)
+			return false;
+	}
+
+	// Names have to end inside their field
+	const RMeshMaterial *materials = reinterpret_cast<const RMeshMaterial *>(data + header->materialOffset);
+	for (uint32_t i = 0; i < header->materialCount; ++i)
+	{
+		if (materials[i].name[RMESH_MAX_NAME - 1] != 0 || materials[i].library[RMESH_MAX_NAME - 1] != 0)
+			return false;
+	}
+
+	// Levels have to be runs of submeshes, starting with level 0
+	const MeshLod *lods = reinterpret_cast<const MeshLod *>(data + header->lodOffset);
+	if (header->lodCount == 0 || lods[0].submeshStart != 0)
+		return false;
+
+	for (uint32_t i = 0; i < header->lodCount; ++i)
+	{
+		if (lods[i].submeshStart > header->submeshCount || lods[i].submeshCount > header->submeshCount - lods[i].submeshStart)
+			return false;
+	}
+
+	// Clusters have to stay inside their submesh
+	const MeshCluster *clusters = reinterpret_cast<const MeshCluster *>(data + header->clusterOffset);
+	for (uint32_t i = 0; i < header->clusterCount; ++i)
+	{
+		if (clusters[i].submesh >= lods[0].submeshCount)
+			return false;
+
+		const RMeshSubmesh &submesh = submeshes[clusters[i].submesh];
+		if (clusters[i].indexStart < submesh.indexStart || clusters[i].indexStart - submesh.indexStart > submesh.indexCount ||
+			clusters[i].indexCount > submesh.indexCount - (clusters[i].indexStart - submesh.indexStart))
+			return false;
+	}
+
+	m_data = data;
+	m_header = header;
+	return true;
+}
+
+void RMesh::Build(const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, const std::vector<DirectX::XMFLOAT4> &tangents, const std::vector<unsigned int> &indices,
+	const std::vector<RMeshSubmesh> &submeshes, const std::vector<MeshLod> &lods, const std::vector<RMeshMaterial> &materials,
+	const std::vector<MeshCluster> &clusters, const FileStamp &source, uint32_t buildKey)
+{
+	Close();
+
+	std::vector<RMeshSubmesh> ranges = submeshes;
+	if (ranges.empty())
+	{
+		RMeshSubmesh whole = { 0, static_cast<uint32_t>(indices.size()), 0, 0 };
+		ranges.push_back(whole);
+	}
+
+	std::vector<MeshLod> levels = lods;
+	if (levels.empty())
+	{
+		MeshLod full = { 0, static_cast<uint32_t>(ranges.size()), 0.0f, 0 };
+		levels.push_back(full);
+	}
+
+	std::vector<RMeshMaterial> surfaces = materials;
+	if (surfaces.empty())
+		surfaces.push_back(RMeshMaterial());
+
+	// Ranges with no indices keep empty bounds at the origin
+	std::vector<RMeshSubmeshBounds> bounds(ranges.size());
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+		RMeshSubmeshBounds &range = bounds[i];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			range.boundsMin[axis] = (ranges[i].indexCount == 0) ? 0.0f : FLT_MAX;
+			range.boundsMax[axis] = (ranges[i].indexCount == 0) ? 0.0f : -FLT_MAX;
+		}
+
+		for (uint32_t j = ranges[i].indexStart; j < ranges[i].indexStart + ranges[i].indexCount; ++j)
+		{
+			const float *position = &vertices[ranges[i].baseVertex + indices[j]].pos.x;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				range.boundsMin[axis] = std::min(range.boundsMin[axis], position[axis]);
+				range.boundsMax[axis] = std::max(range.boundsMax[axis], position[axis]);
+			}
+		}
+	}
+
+	const unsigned int maxIndex = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end());
+	const uint32_t indexStride = (maxIndex < RMESH_MAX_16BIT_VERTICES) ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	RMeshHeader header = {};
+	header.magic = RMESH_MAGIC;
+	header.version = RMESH_VERSION;
+	header.headerSize = sizeof(RMeshHeader);
+	header.vertexStride = sizeof(DX11UWA::VertexPositionUVNormal);
+	header.indexStride = indexStride;
+	header.vertexCount = static_cast<uint32_t>(vertices.size());
+	header.indexCount = static_cast<uint32_t>(indices.size());
+	header.submeshCount = static_cast<uint32_t>(ranges.size());
+	header.lodCount = static_cast<uint32_t>(levels.size());
+	header.materialCount = static_cast<uint32_t>(surfaces.size());
+	header.clusterCount = static_cast<uint32_t>(clusters.size());
+	header.sourceSize = source.size;
+	header.sourceTime = source.modifiedTime;
+	header.buildKey = buildKey;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		header.boundsMin[axis] = vertices.empty() ? 0.0f : FLT_MAX;
+		header.boundsMax[axis] = vertices.empty() ? 0.0f : -FLT_MAX;
+	}
+
+	for (const DX11UWA::VertexPositionUVNormal &vertex : vertices)
+	{
+		const float *position = &vertex.pos.x;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			header.boundsMin[axis] = std::min(header.boundsMin[axis], position[axis]);
+			header.boundsMax[axis] = std::max(header.boundsMax[axis], position[axis]);
+		}
+	}
+
+	header.vertexOffset = alignUp(sizeof(RMeshHeader));
+	const uint64_t verticesEnd = alignUp(header.vertexOffset + vertices.size() * sizeof(DX11UWA::VertexPositionUVNormal));
+	const bool hasTangents = !tangents.empty() && tangents.size() == vertices.size();
+	header.tangentOffset = hasTangents ? verticesEnd : 0;
+	header.indexOffset = hasTangents ? alignUp(verticesEnd + tangents.size() * sizeof(DirectX::XMFLOAT4)) : verticesEnd;
+	header.submeshOffset = alignUp(header.indexOffset + indices.size() * indexStride);
+	header.submeshBoundsOffset = alignUp(header.submeshOffset + ranges.size() * sizeof(RMeshSubmesh));
+	header.lodOffset = alignUp(header.submeshBoundsOffset + bounds.size() * sizeof(RMeshSubmeshBounds));
+	header.materialOffset = alignUp(header.lodOffset + levels.size() * sizeof(MeshLod));
+	header.clusterOffset = alignUp(header.materialOffset + surfaces.size() * sizeof(RMeshMaterial));
+	header.fileSize = header.clusterOffset + clusters.size() * sizeof(MeshCluster);
+
+	// uint64_t storage keeps the image at least 8 byte aligned, like a mapping
+	m_image.assign((header.fileSize + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+	char *image = reinterpret_cast<char *>(m_image.data());
+
+	memcpy(image, &header, sizeof(header));
+	if (!vertices.empty())
+		memcpy(image + header.vertexOffset, vertices.data(), vertices.size() * sizeof(DX11UWA::VertexPositionUVNormal));
+	if (hasTangents)
+		memcpy(image + header.tangentOffset, tangents.data(), tangents.size() * sizeof(DirectX::XMFLOAT4));
+	if (indexStride == sizeof(uint16_t))
+	{
+		uint16_t *narrow = reinterpret_cast<uint16_t *>(image + header.indexOffset);
+		for (size_t i = 0; i < indices.size(); ++i)
+			narrow[i] = static_cast<uint16_t>(indices[i]);
+	}
+	else if (!indices.empty())
+		memcpy(image + header.indexOffset, indices.data(), indices.size() * sizeof(uint32_t));
+	memcpy(image + header.submeshOffset, ranges.data(), ranges.size() * sizeof(RMeshSubmesh));
+	memcpy(image + header.submeshBoundsOffset, bounds.data(), bounds.size() * sizeof(RMeshSubmeshBounds));
+	memcpy(image + header.lodOffset, levels.data(), levels.size() * sizeof(MeshLod));
+	memcpy(image + header.materialOffset, surfaces.data(), surfaces.size() * sizeof(RMeshMaterial));
+	if (!clusters.empty())
+		memcpy(image + header.clusterOffset, clusters.data(), clusters.size() * sizeof(MeshCluster));
+
+	m_data = image;
+	m_header = reinterpret_cast<const RMeshHeader *>(image);
+}
+
+bool RMesh::Save(const char *path) const
+{
+	if (!m_header)
+		return false;
+
+	// Both renderers may rebuild the same cache at once, so each writes its own temporary file
+	std::string temporary = std::string(path) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file)
+		return false;
+
+	const size_t size = static_cast<size_t>(m_header->fileSize);
+	const bool written = fwrite(m_data, 1, size, file) == size;
+
+	if (fclose(file) != 0 || !written || !replaceFile(temporary, path))
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void RMesh::Close(void)
+{
+	m_file.Close();
+	m_image.clear();
+	m_data = nullptr;
+	m_header = nullptr;
+}
+
+const DX11UWA::VertexPositionUVNormal *RMesh::GetVertices(void) const
+{
+	return reinterpret_cast<const DX11UWA::VertexPositionUVNormal *>(m_data + m_header->vertexOffset);
+}
+
+const DirectX::XMFLOAT4 *RMesh::GetTangents(void) const
+{
+	return m_header->tangentOffset ? reinterpret_cast<const DirectX::XMFLOAT4 *>(m_data + m_header->tangentOffset) : nullptr;
+}
+
+const void *RMesh::GetIndices(void) const
+{
+	return m_data + m_header->indexOffset;
+}
+
+const RMeshSubmesh *RMesh::GetSubmeshes(void) const
+{
+	return reinterpret_cast<const RMeshSubmesh *>(m_data + m_header->submeshOffset);
+}
+
+const RMeshSubmeshBounds *RMesh::GetSubmeshBounds(void) const
+{
+	return reinterpret_cast<const RMeshSubmeshBounds *>(m_data + m_header->submeshBoundsOffset);
+}
+
+const MeshLod *RMesh::GetLods(void) const
+{
+	return reinterpret_cast<const MeshLod *>(m_data + m_header->lodOffset);
+}
+
+const RMeshMaterial *RMesh::GetMaterials(void) const
+{
+	return reinterpret_cast<const RMeshMaterial *>(m_data + m_header->materialOffset);
+}
+
+const MeshCluster *RMesh::GetClusters(void) const
+{
+	return reinterpret_cast<const MeshCluster *>(m_data + m_header->clusterOffset);
+}
+
+void splitMeshForIndexSize(std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices,
+	std::vector<RMeshSubmesh> &submeshes, uint32_t maxVertices, std::vector<uint32_t> *firstRanges, std::vector<DirectX::XMFLOAT4> *tangents)
+{
+	if (firstRanges)
+	{
+		firstRanges->resize(submeshes.size() + 1);
+		for (size_t i = 0; i <= submeshes.size(); ++i)
+			(*firstRanges)[i] = static_cast<uint32_t>(i);
+	}
+
+	if (vertices.size() <= maxVertices)
+		return;
+
+	std::vector<DX11UWA::VertexPositionUVNormal> splitVertices;
+	std::vector<DirectX::XMFLOAT4> splitTangents;
+	std::vector<unsigned int> splitIndices;
+	std::vector<RMeshSubmesh> splitSubmeshes;
+	splitVertices.reserve(vertices.size());
+	splitIndices.reserve(indices.size());
+
+	// local[v] is v's index in the current range, valid while stamp[v] is that range's number
+	std::vector<uint32_t> local(vertices.size());
+	std::vector<uint32_t> stamp(vertices.size(), ~0u);
+	uint32_t rangeNumber = 0;
+
+	for (size_t s = 0; s < submeshes.size(); ++s)
+	{
+		const RMeshSubmesh &submesh = submeshes[s];
+		if (firstRanges)
+			(*firstRanges)[s] = static_cast<uint32_t>(splitSubmeshes.size());
+
+		RMeshSubmesh range = { static_cast<uint32_t>(splitIndices.size()), 0, submesh.materialIndex, static_cast<uint32_t>(splitVertices.size()) };
+		const uint32_t end = submesh.indexStart + submesh.indexCount;
+
+		for (uint32_t i = submesh.indexStart; i + 3 <= end; i += 3)
+		{
+			// Start a new range when the triangle's new vertices don't fit. A vertex repeated
+			// in a degenerate triangle is counted twice, which only ends the range a bit early.
+			uint32_t added = 0;
+			for (uint32_t corner = 0; corner < 3; ++corner)
+				added += (stamp[indices[i + corner]] != rangeNumber) ? 1 : 0;
+
+			if (splitVertices.size() - range.baseVertex + added > maxVertices)
+			{
+				range.indexCount = static_cast<uint32_t>(splitIndices.size()) - range.indexStart;
+				splitSubmeshes.push_back(range);
+				++rangeNumber;
+
+				range.indexStart = static_cast<uint32_t>(splitIndices.size());
+				range.baseVertex = static_cast<uint32_t>(splitVertices.size());
+			}
+
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const unsigned int vertex = indices[i + corner];
+				if (stamp[vertex] != rangeNumber)
+				{
+					stamp[vertex] = rangeNumber;
+					local[vertex] = static_cast<uint32_t>(splitVertices.size()) - range.baseVertex;
+					splitVertices.push_back(vertices[vertex]);
+					if (tangents)
+						splitTangents.push_back((*tangents)[vertex]);
+				}
+
+				splitIndices.push_back(local[vertex]);
+			}
+		}
+
+		range.indexCount = static_cast<uint32_t>(splitIndices.size()) - range.indexStart;
+		splitSubmeshes.push_back(range);
+		++rangeNumber;
+	}
+
+	if (firstRanges)
+		firstRanges->back() = static_cast<uint32_t>(splitSubmeshes.size());
+
+	vertices.swap(splitVertices);
+	if (tangents)
+		tangents->swap(splitTangents);
+	indices.swap(splitIndices);
+	submeshes.swap(splitSubmeshes);
+}
+
+uint32_t meshBuildKey(const ObjLoadOptions &options, const MeshRecipe *recipe)
+{
+	uint32_t epsilon;
+	memcpy(&epsilon, &options.weldEpsilon, sizeof(epsilon));
+
+	uint32_t crease;
+	memcpy(&crease, &options.creaseAngle, sizeof(crease));
+
+	uint32_t key = (options.weldCorners ? 1u : 0u) | (options.weldByValue ? 2u : 0u) | (options.optimize ? 4u : 0u) | (options.buildClusters ? 8u : 0u) |
+		(std::min(options.lodCount, 15u) << 4);
+	if (options.weldByValue)
+		key |= (epsilon * 2654435761u) << 8;
+	if (options.generateNormals)
+		key ^= (crease * 2246822519u) | 1u << 31;
+	if (options.buildTangents)
+		key ^= 1u << 30;
+	return key ^ meshRecipeKey(recipe);
+}
+
+namespace
+{
+	// Loads the OBJ from reader if it has read it, from objPath otherwise
+	bool cookMeshFrom(const char *objPath, ObjStreamReader *reader, RMesh &out, const ObjLoadOptions &options, const MeshRecipe *recipe)
+	{
+		FileStamp source = {};
+		if (!getFileStamp(objPath, source))
+		{
+			printf("Impossible to open the file !\n");
+			return false;
+		}
+
+		ObjMeshGroups groups;
+		ObjLoadOptions grouped = options;
+		grouped.groups = &groups;
+		grouped.sourceAttributes = 0;
+
+		std::vector<DX11UWA::VertexPositionUVNormal> vertices;
+		std::vector<unsigned int> indices;
+		{
+			MeshData mesh;
+			if (reader ? !reader->BuildMesh(mesh, grouped) : !loadOBJ(objPath, mesh, grouped))
+				return false;
+
+			// The passes below grow the mesh, so they work on vectors
+			vertices.assign(mesh.GetVertices(), mesh.GetVertices() + mesh.GetVertexCount());
+			indices.assign(mesh.GetIndices(), mesh.GetIndices() + mesh.GetIndexCount());
+		}
+
+		if (recipe)
+			applyMeshRecipe(*recipe, vertices, indices);
+
+		// After the recipe, which can change the normals and uvs. Vertices split for mirrored uvs are appended and
+		// the indices keep their order, so the groups still line up.
+		std::vector<DirectX::XMFLOAT4> tangents;
+		if (options.buildTangents)
+			generateTangents(vertices, indices, tangents, options.parseThreads);
+
+		// Welding for the recipe keeps the order of the indices, so the groups still cover the same ranges
+		std::vector<RMeshSubmesh> submeshes;
+		for (const ObjSubmesh &group : groups.submeshes)
+		{
+			RMeshSubmesh submesh = { group.indexStart, group.indexCount, group.material, 0 };
+			submeshes.push_back(submesh);
+		}
+
+		if (submeshes.empty())
+		{
+			RMeshSubmesh whole = { 0, static_cast<uint32_t>(indices.size()), 0, 0 };
+			submeshes.push_back(whole);
+		}
+
+		std::vector<RMeshMaterial> materials;
+		for (const ObjMaterialName &name : groups.materials)
+			materials.push_back(makeMeshMaterial(name));
+
+		std::vector<MeshLod> lods;
+		if (options.lodCount > 1)
+			buildMeshLods(vertices, indices, submeshes, options.lodCount, lods);
+
+		// Splitting keeps the order of the submeshes, the levels only have to be renumbered
+		std::vector<uint32_t> firstRanges;
+		splitMeshForIndexSize(vertices, indices, submeshes, RMESH_MAX_16BIT_VERTICES, &firstRanges, options.buildTangents ? &tangents : nullptr);
+		for (MeshLod &lod : lods)
+		{
+			const uint32_t end = lod.submeshStart + lod.submeshCount;
+			lod.submeshStart = firstRanges[lod.submeshStart];
+			lod.submeshCount = firstRanges[end] - lod.submeshStart;
+		}
+
+		std::vector<MeshCluster> clusters;
+		if (options.buildClusters)
+		{
+			const std::vector<RMeshSubmesh> fullDetail(submeshes.begin(), submeshes.begin() + (lods.empty() ? submeshes.size() : lods[0].submeshCount));
+			buildMeshClusters(vertices, indices, fullDetail, clusters);
+		}
+
+		out.Build(vertices, tangents, indices, submeshes, lods, materials, clusters, source, meshBuildKey(options, recipe));
+		return true;
+	}
+}
+
+bool cookMesh(const char *objPath, RMesh &out, const ObjLoadOptions &options, const MeshRecipe *recipe)
+{
+	return cookMeshFrom(objPath, nullptr, out, options, recipe);
+}
+
+bool cookMesh(const char *objPath, ObjStreamReader &reader, RMesh &out, const ObjLoadOptions &options, const MeshRecipe *recipe)
+{
+	return cookMeshFrom(objPath, &reader, out, options, recipe);
+}
+
+bool openMeshCache(const char *objPath, const char *cachePath, RMesh &out, const ObjLoadOptions &options, const MeshRecipe *recipe)
+{
+	FileStamp source = {};
+	const bool hasSource = getFileStamp(objPath, source);
+
+	if (out.Open(cachePath))
+	{
+		const RMeshHeader &header = out.GetHeader();
+		if (!hasSource || (header.sourceSize == source.size && header.sourceTime == source.modifiedTime && header.buildKey == meshBuildKey(options, recipe)))
+			return true;
+
+		out.Close();
+	}
+
+	return false;
+}
+
+bool loadMeshCached(const char *objPath, const char *cachePath, RMesh &out, const ObjLoadOptions &options, const MeshRecipe *recipe)
+{
+	if (openMeshCache(objPath, cachePath, out, options, recipe))
+		return true;
+
+	if (!cookMesh(objPath, out, options, recipe))
+		return false;
+
+	if (!out.Save(cachePath))
+		printf("Couldn't write the mesh cache: %s\n", cachePath);
+
+	return true;
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MappedFile.h"
+#include "MeshRecipes.h"
+#include "ObjLoader.h"
+
+// .rmesh files hold a mesh exactly as the renderer uploads it: the interleaved vertex array, the tangents
+// if it has any, the index array, the bounds, the submesh ranges and their bounds, the levels of detail (see MeshLod.h), the
+// materials and the culling clusters (see MeshClusters.h), if it has any. Sections start on 16 byte boundaries, so a mapped file can be
+// handed to CreateBuffer without any parsing or copying.
+//
+// Indices are relative to the baseVertex of their submesh, and 16 bit (indexStride 2) whenever they fit.
+// cookMesh splits meshes that are too large for that into ranges of at most RMESH_MAX_16BIT_VERTICES vertices.
+//
+//   RMeshHeader | vertices (vertexStride * vertexCount) | XMFLOAT4 tangents[vertexCount] (if tangentOffset isn't 0) |
+//   indices (indexStride * indexCount) | RMeshSubmesh[submeshCount] |
+//   RMeshSubmeshBounds[submeshCount] | MeshLod[lodCount] | RMeshMaterial[materialCount] | MeshCluster[clusterCount]
+//
+// Every level of detail is a run of submeshes, level 0 first. Clusters only cover level 0. Submeshes come from
+// the OBJ's object and material groups, sorted by material.
+//
+// Bump RMESH_VERSION whenever the layout or the meaning of a field changes, old caches are then rebuilt.
+const uint32_t RMESH_MAGIC = 0x48534d52;	// "RMSH"
+const uint32_t RMESH_VERSION = 6;
+
+// Longest material and library name an .rmesh keeps, with the terminating zero. Longer names are cut short.
+const uint32_t RMESH_MAX_NAME = 64;
+
+// Most vertices a range can reference with 16 bit indices
+const uint32_t RMESH_MAX_16BIT_VERTICES = 65536;
+
+// A range of the index array drawn with one material: DrawIndexed(indexCount, indexStart, baseVertex)
+struct RMeshSubmesh
+{
+	uint32_t	indexStart;
+	uint32_t	indexCount;
+	uint32_t	materialIndex;
+	uint32_t	baseVertex;		// Added to every index of the range
+};
+
+// Bounds of the vertices the submesh with the same index draws
+struct RMeshSubmeshBounds
+{
+	float		boundsMin[3];
+	float		boundsMax[3];
+};
+
+// A usemtl material of the OBJ, which the renderer looks up in the mtllib file (see MaterialLibrary.h)
+struct RMeshMaterial
+{
+	char		name[RMESH_MAX_NAME];
+	char		library[RMESH_MAX_NAME];	// Relative to the OBJ, empty if the material had none
+};
+
+static_assert(sizeof(RMeshSubmeshBounds) == 24, "RMeshSubmeshBounds is part of the file format");
+static_assert(sizeof(RMeshMaterial) == 128, "RMeshMaterial is part of the file format");
+
+struct RMeshHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	headerSize;
+	uint32_t	vertexStride;
+	uint32_t	indexStride;
+	uint32_t	vertexCount;
+	uint32_t	indexCount;
+	uint32_t	submeshCount;
+
+	// Stamp of the source file and the loader settings the cache was built from
+	uint64_t	sourceSize;
+	uint64_t	sourceTime;
+	uint32_t	buildKey;
+	uint32_t	clusterCount;
+
+	float		boundsMin[3];
+	float		boundsMax[3];
+	uint32_t	lodCount;		// At least 1
+	uint32_t	materialCount;	// At least 1, every submesh's materialIndex is below it
+
+	// Byte offsets from the start of the file
+	uint64_t	vertexOffset;
+	uint64_t	indexOffset;
+	uint64_t	submeshOffset;
+	uint64_t	submeshBoundsOffset;
+	uint64_t	lodOffset;
+	uint64_t	materialOffset;
+	uint64_t	clusterOffset;
+	uint64_t	tangentOffset;	// 0 when the mesh has no tangents
+	uint64_t	fileSize;
+};
+
+static_assert(sizeof(RMeshHeader) == 160, "RMeshHeader is part of the file format");
+
+struct MeshCluster;
+struct MeshLod;
+
+// A mesh in .rmesh layout, either mapped from a cache file or built in memory.
+class RMesh
+{
+public:
+	RMesh(void);
+
+	RMesh(RMesh &&other);
+	RMesh &operator=(RMesh &&other);
+
+	RMesh(const RMesh &) = delete;
+	RMesh &operator=(const RMesh &) = delete;
+
+	// Maps a .rmesh file. Returns false if it can't be read or isn't a valid file of this version.
+	bool Open(const char *path);
+
+	// Lays the mesh out in memory. With no submeshes the whole index array becomes one submesh, and with no
+	// levels of detail all submeshes are level 0. With no materials they all use one without a name. The bounds
+	// of every submesh are computed here. Indices are stored as 16 bit if they all fit, run
+	// splitMeshForIndexSize first to make sure they do. tangents is either empty or has one per vertex.
+	void Build(const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, const std::vector<DirectX::XMFLOAT4> &tangents, const std::vector<unsigned int> &indices,
+		const std::vector<RMeshSubmesh> &submeshes, const std::vector<MeshLod> &lods, const std::vector<RMeshMaterial> &materials,
+		const std::vector<MeshCluster> &clusters, const FileStamp &source, uint32_t buildKey);
+
+	// Writes the mesh to path. Goes through a temporary file, so readers never see a partial cache.
+	bool Save(const char *path) const;
+
+	void Close(void);
+
+	bool IsValid(void) const { return m_header != nullptr; }
+	bool IsMapped(void) const { return m_file.IsOpen(); }
+
+	const RMeshHeader &GetHeader(void) const { return *m_header; }
+	const DX11UWA::VertexPositionUVNormal *GetVertices(void) const;
+	const DirectX::XMFLOAT4 *GetTangents(void) const;	// nullptr without tangents, see generateTangents
+	const void *GetIndices(void) const;
+	const RMeshSubmesh *GetSubmeshes(void) const;
+	const RMeshSubmeshBounds *GetSubmeshBounds(void) const;
+	const MeshLod *GetLods(void) const;
+	const RMeshMaterial *GetMaterials(void) const;
+	const MeshCluster *GetClusters(void) const;
+	uint32_t GetIndexStride(void) const { return m_header->indexStride; }
+	uint32_t GetVertexCount(void) const { return m_header->vertexCount; }
+	uint32_t GetIndexCount(void) const { return m_header->indexCount; }
+	uint32_t GetSubmeshCount(void) const { return m_header->submeshCount; }
+	uint32_t GetLodCount(void) const { return m_header->lodCount; }
+	uint32_t GetMaterialCount(void) const { return m_header->materialCount; }
+	uint32_t GetClusterCount(void) const { return m_header->clusterCount; }
+
+private:
+	bool Validate(const char *data, size_t size);
+
+	MappedFile				m_file;
+	std::vector<uint64_t>	m_image;
+	const char				*m_data;
+	const RMeshHeader		*m_header;
+};
+
+// Splits every submesh into consecutive ranges that reference at most maxVertices vertices each. Every range
+// gets its own copy of the vertices it uses, in the order it first uses them, starting at its baseVertex, and
+// its indices are rewritten relative to that. Vertices used by several ranges are duplicated.
+// The submeshes' indices have to be into the whole vertex array. Meshes that already fit are left alone.
+// firstRanges, if set, receives the first range made from each submesh, followed by the new submesh count.
+// tangents, if set, has one per vertex and is split along with them.
+void splitMeshForIndexSize(std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices,
+	std::vector<RMeshSubmesh> &submeshes, uint32_t maxVertices = RMESH_MAX_16BIT_VERTICES, std::vector<uint32_t> *firstRanges = nullptr,
+	std::vector<DirectX::XMFLOAT4> *tangents = nullptr);
+
+// Identifies the loader settings and recipe that change the output, so caches built differently are rebuilt.
+uint32_t meshBuildKey(const ObjLoadOptions &options, const MeshRecipe *recipe = nullptr);
+
+// Loads the OBJ at objPath with a submesh for every object and material group, applies the recipe (if any),
+// builds options.lodCount levels of detail, splits it for 16 bit indices, builds clusters if options.buildClusters
+// is set and lays the result out in memory as an .rmesh.
+bool cookMesh(const char *objPath, RMesh &out, const ObjLoadOptions &options = ObjLoadOptions(), const MeshRecipe *recipe = nullptr);
+
+// Same, from the OBJ at objPath that reader has read to the end, without parsing it again (see ObjStreamReader::BuildMesh)
+bool cookMesh(const char *objPath, ObjStreamReader &reader, RMesh &out, const ObjLoadOptions &options = ObjLoadOptions(), const MeshRecipe *recipe = nullptr);
+
+// Maps the cache file at cachePath if loadMeshCached would use it as it is, without cooking anything.
+bool openMeshCache(const char *objPath, const char *cachePath, RMesh &out, const ObjLoadOptions &options = ObjLoadOptions(), const MeshRecipe *recipe = nullptr);
+
+// Loads the OBJ at objPath through the cache file at cachePath. The cache is used when it was built from
+// the current source file with the same settings, or when the source is missing (cooked builds). Otherwise
+// the OBJ is cooked and the cache rewritten. If the cache can't be written the in-memory mesh is still returned.
+bool loadMeshCached(const char *objPath, const char *cachePath, RMesh &out, const ObjLoadOptions &options = ObjLoadOptions(), const MeshRecipe *recipe = nullptr);
@@ -0,0 +1,417 @@
+
+
+
+
+
+
+
+
+#include "pch.h"
+#include "MeshClusters.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MESH_CLUSTERS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Once a cluster has this many triangles it stops growing rather than take a neighbour whose normal
+	// is further than about 45 degrees from its average, trading a few more draw ranges for narrower cones
+	const size_t CLUSTER_MIN_TRIANGLES = 64;
+	const float CLUSTER_CONE_LIMIT = 0.7f;
+
+	inline DirectX::XMFLOAT3 subtract(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b)
+	{
+		return DirectX::XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	inline DirectX::XMFLOAT3 cross(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b)
+	{
+		return DirectX::XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	inline float dot(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	// Unit length, or zero for degenerate vectors
+	inline DirectX::XMFLOAT3 normalize(const DirectX::XMFLOAT3 &v)
+	{
+		const float length = sqrtf(dot(v, v));
+		return (length > 0.0f) ? DirectX::XMFLOAT3(v.x / length, v.y / length, v.z / length) : DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+
+	// Sphere around the cluster's vertices and the cone around its face normals
+	void computeClusterBounds(const DX11UWA::VertexPositionUVNormal *vertices, const unsigned int *indices, const std::vector<unsigned int> &triangles,
+		const std::vector<DirectX::XMFLOAT3> &normals, MeshCluster &cluster)
+	{
+		float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		DirectX::XMFLOAT3 normalSum(0.0f, 0.0f, 0.0f);
+
+		for (unsigned int triangle : triangles)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const float *position = &vertices[indices[triangle * 3 + corner]].pos.x;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+					boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+				}
+			}
+
+			normalSum.x += normals[triangle].x;
+			normalSum.y += normals[triangle].y;
+			normalSum.z += normals[triangle].z;
+		}
+
+		const DirectX::XMFLOAT3 center((boundsMin[0] + boundsMax[0]) * 0.5f, (boundsMin[1] + boundsMax[1]) * 0.5f, (boundsMin[2] + boundsMax[2]) * 0.5f);
+		const DirectX::XMFLOAT3 axis = normalize(normalSum);
+
+		float radiusSq = 0.0f;
+		float minDot = 1.0f;
+		for (unsigned int triangle : triangles)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const DirectX::XMFLOAT3 offset = subtract(vertices[indices[triangle * 3 + corner]].pos, center);
+				radiusSq = std::max(radiusSq, dot(offset, offset));
+			}
+
+			// Degenerate triangles are never rasterized, so they don't widen the cone
+			if (dot(normals[triangle], normals[triangle]) > 0.0f)
+				minDot = std::min(minDot, dot(normals[triangle], axis));
+		}
+
+		cluster.center[0] = center.x;
+		cluster.center[1] = center.y;
+		cluster.center[2] = center.z;
+		cluster.radius = sqrtf(radiusSq);
+		cluster.coneAxis[0] = axis.x;
+		cluster.coneAxis[1] = axis.y;
+		cluster.coneAxis[2] = axis.z;
+
+		// A cone of 90 degrees or more always has a triangle facing the camera
+		const bool cullable = dot(axis, axis) > 0.0f && minDot > 0.0f;
+		cluster.coneCutoff = cullable ? sqrtf(1.0f - minDot * minDot) : 1.0f;
+	}
+
+	inline uint8_t cullCluster(const MeshClusterBounds &bounds, const ClusterCullView &view, size_t i)
+	{
+		const float cx = bounds.centerX[i], cy = bounds.centerY[i], cz = bounds.centerZ[i], r = bounds.radius[i];
+		uint8_t culled = 0;
+
+		// Every normal in the cone points away from every point of the sphere seen from the camera
+		const float vx = cx - view.camera.x, vy = cy - view.camera.y, vz = cz - view.camera.z;
+		const float length = sqrtf(vx * vx + vy * vy + vz * vz);
+		if (vx * bounds.axisX[i] + vy * bounds.axisY[i] + vz * bounds.axisZ[i] > bounds.cutoff[i] * length + r)
+			culled |= CLUSTER_CULLED_BACKFACING;
+
+		for (int p = 0; p < 6; ++p)
+		{
+			const DirectX::XMFLOAT4 &plane = view.planes[p];
+			if (plane.x * cx + plane.y * cy + plane.z * cz + plane.w < -r)
+				culled |= CLUSTER_CULLED_OUTSIDE;
+		}
+
+		return culled;
+	}
+
+	inline DirectX::XMFLOAT4 normalizePlane(float x, float y, float z, float w)
+	{
+		const float length = sqrtf(x * x + y * y + z * z);
+		return (length > 0.0f) ? DirectX::XMFLOAT4(x / length, y / length, z / length, w / length) : DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+void buildMeshClusters(const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices,
+	const std::vector<RMeshSubmesh> &submeshes, std::vector<MeshCluster> &clusters, unsigned int maxTriangles)
+{
+	clusters.clear();
+	std::vector<unsigned int> result(indices);
+
+	std::vector<unsigned int> offsets, adjacent, members, candidates;
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<char> assigned;
+
+	for (uint32_t s = 0; s < submeshes.size(); ++s)
+	{
+		const RMeshSubmesh &submesh = submeshes[s];
+		const unsigned int *source = indices.data() + submesh.indexStart;
+		const DX11UWA::VertexPositionUVNormal *base = vertices.data() + submesh.baseVertex;
+		const size_t triangleCount = submesh.indexCount / 3;
+
+		size_t vertexCount = 0;
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			vertexCount = std::max<size_t>(vertexCount, source[i] + 1);
+
+		// Triangles that use each vertex, as offsets into one shared array
+		offsets.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			offsets[source[i] + 1]++;
+		for (size_t v = 0; v < vertexCount; ++v)
+			offsets[v + 1] += offsets[v];
+
+		adjacent.resize(triangleCount * 3);
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+			adjacent[fill[source[i]]++] = static_cast<unsigned int>(i / 3);
+
+		normals.resize(triangleCount);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			const DirectX::XMFLOAT3 &a = base[source[t * 3 + 0]].pos;
+			const DirectX::XMFLOAT3 &b = base[source[t * 3 + 1]].pos;
+			const DirectX::XMFLOAT3 &c = base[source[t * 3 + 2]].pos;
+			normals[t] = normalize(cross(subtract(b, a), subtract(c, a)));
+		}
+
+		assigned.assign(triangleCount, 0);
+		unsigned int *out = result.data() + submesh.indexStart;
+		size_t written = 0;
+		size_t seed = 0;
+
+		while (true)
+		{
+			while (seed < triangleCount && assigned[seed])
+				++seed;
+			if (seed == triangleCount)
+				break;
+
+			members.clear();
+			candidates.clear();
+			DirectX::XMFLOAT3 normalSum(0.0f, 0.0f, 0.0f);
+			size_t next = seed;
+
+			while (true)
+			{
+				assigned[next] = 1;
+				members.push_back(static_cast<unsigned int>(next));
+				normalSum.x += normals[next].x;
+				normalSum.y += normals[next].y;
+				normalSum.z += normals[next].z;
+
+				if (members.size() == maxTriangles)
+					break;
+
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					const unsigned int vertex = source[next * 3 + corner];
+					for (unsigned int j = offsets[vertex]; j < offsets[vertex + 1]; ++j)
+					{
+						if (!assigned[adjacent[j]])
+							candidates.push_back(adjacent[j]);
+					}
+				}
+
+				// Candidates that joined since they were found are dropped on the way
+				float bestScore = -FLT_MAX;
+				size_t best = candidates.size();
+				for (size_t c = 0; c < candidates.size();)
+				{
+					if (assigned[candidates[c]])
+					{
+						candidates[c] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+
+					const float score = dot(normals[candidates[c]], normalSum);
+					if (score > bestScore)
+					{
+						bestScore = score;
+						best = c;
+					}
+					++c;
+				}
+
+				const float sumLength = sqrtf(dot(normalSum, normalSum));
+				const bool withinCone = best < candidates.size() && bestScore >= CLUSTER_CONE_LIMIT * sumLength;
+				if (members.size() >= CLUSTER_MIN_TRIANGLES && !withinCone)
+					break;
+
+				if (best < candidates.size())
+				{
+					next = candidates[best];
+					continue;
+				}
+
+				// Nothing connected is left, carry on with the next triangle in the optimized order
+				while (seed < triangleCount && assigned[seed])
+					++seed;
+				if (seed == triangleCount)
+					break;
+				next = seed;
+			}
+
+			MeshCluster cluster = {};
+			computeClusterBounds(base, source, members, normals, cluster);
+			cluster.indexStart = static_cast<uint32_t>(submesh.indexStart + written * 3);
+			cluster.indexCount = static_cast<uint32_t>(members.size() * 3);
+			cluster.submesh = s;
+			clusters.push_back(cluster);
+
+			for (unsigned int triangle : members)
+			{
+				out[written * 3 + 0] = source[triangle * 3 + 0];
+				out[written * 3 + 1] = source[triangle * 3 + 1];
+				out[written * 3 + 2] = source[triangle * 3 + 2];
+				++written;
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+void prepareClusterBounds(const MeshCluster *clusters, size_t count, MeshClusterBounds &out)
+{
+	const size_t padded = (count + 3) & ~static_cast<size_t>(3);
+	out.count = count;
+
+	// Padding has an infinitely negative radius, so it's outside every plane
+	out.centerX.assign(padded, 0.0f);
+	out.centerY.assign(padded, 0.0f);
+	out.centerZ.assign(padded, 0.0f);
+	out.radius.assign(padded, -FLT_MAX);
+	out.axisX.assign(padded, 0.0f);
+	out.axisY.assign(padded, 0.0f);
+	out.axisZ.assign(padded, 0.0f);
+	out.cutoff.assign(padded, 1.0f);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		out.centerX[i] = clusters[i].center[0];
+		out.centerY[i] = clusters[i].center[1];
+		out.centerZ[i] = clusters[i].center[2];
+		out.radius[i] = clusters[i].radius;
+		out.axisX[i] = clusters[i].coneAxis[0];
+		out.axisY[i] = clusters[i].coneAxis[1];
+		out.axisZ[i] = clusters[i].coneAxis[2];
+		out.cutoff[i] = clusters[i].coneCutoff;
+	}
+}
+
+ClusterCullView makeClusterCullView(const DirectX::XMFLOAT3 &modelSpaceCamera, const DirectX::XMFLOAT4X4 &modelViewProjection)
+{
+	// Gribb and Hartmann: with row vectors each clip plane is a sum of columns, and Direct3D clips z to [0, w]
+	const float (&m)[4][4] = modelViewProjection.m;
+	ClusterCullView view;
+	view.camera = modelSpaceCamera;
+	view.planes[0] = normalizePlane(m[0][3] + m[0][0], m[1][3] + m[1][0], m[2][3] + m[2][0], m[3][3] + m[3][0]);	// Left
+	view.planes[1] = normalizePlane(m[0][3] - m[0][0], m[1][3] - m[1][0], m[2][3] - m[2][0], m[3][3] - m[3][0]);	// Right
+	view.planes[2] = normalizePlane(m[0][3] + m[0][1], m[1][3] + m[1][1], m[2][3] + m[2][1], m[3][3] + m[3][1]);	// Bottom
+	view.planes[3] = normalizePlane(m[0][3] - m[0][1], m[1][3] - m[1][1], m[2][3] - m[2][1], m[3][3] - m[3][1]);	// Top
+	view.planes[4] = normalizePlane(m[0][2], m[1][2], m[2][2], m[3][2]);											// Near
+	view.planes[5] = normalizePlane(m[0][3] - m[0][2], m[1][3] - m[1][2], m[2][3] - m[2][2], m[3][3] - m[3][2]);	// Far
+	return view;
+}
+
+size_t cullMeshClustersScalar(const MeshClusterBounds &bounds, const ClusterCullView &view, uint8_t *culled)
+{
+	size_t visible = 0;
+	for (size_t i = 0; i < bounds.count; ++i)
+	{
+		culled[i] = cullCluster(bounds, view, i);
+		visible += culled[i] ? 0 : 1;
+	}
+
+	return visible;
+}
+
+size_t cullMeshClusters(const MeshClusterBounds &bounds, const ClusterCullView &view, uint8_t *culled)
+{
+#if defined(MESH_CLUSTERS_SSE2)
+	const __m128 cameraX = _mm_set1_ps(view.camera.x);
+	const __m128 cameraY = _mm_set1_ps(view.camera.y);
+	const __m128 cameraZ = _mm_set1_ps(view.camera.z);
+
+	size_t visible = 0;
+	for (size_t i = 0; i < bounds.count; i += 4)
+	{
+		const __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+		const __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+		const __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+		const __m128 r = _mm_loadu_ps(&bounds.radius[i]);
+
+		// Same operations in the same order as cullCluster, so the results match exactly
+		const __m128 vx = _mm_sub_ps(cx, cameraX);
+		const __m128 vy = _mm_sub_ps(cy, cameraY);
+		const __m128 vz = _mm_sub_ps(cz, cameraZ);
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+		const __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&bounds.axisX[i])), _mm_mul_ps(vy, _mm_loadu_ps(&bounds.axisY[i]))),
+			_mm_mul_ps(vz, _mm_loadu_ps(&bounds.axisZ[i])));
+		const __m128 backfacing = _mm_cmpgt_ps(along, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&bounds.cutoff[i]), length), r));
+
+		const __m128 negativeR = _mm_sub_ps(_mm_setzero_ps(), r);
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; ++p)
+		{
+			const DirectX::XMFLOAT4 &plane = view.planes[p];
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+				_mm_mul_ps(_mm_set1_ps(plane.z), cz)), _mm_set1_ps(plane.w));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeR));
+		}
+
+		const int backfacingBits = _mm_movemask_ps(backfacing);
+		const int outsideBits = _mm_movemask_ps(outside);
+		const size_t lanes = std::min<size_t>(4, bounds.count - i);
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			const uint8_t result = static_cast<uint8_t>(((backfacingBits >> lane) & 1) * CLUSTER_CULLED_BACKFACING | ((outsideBits >> lane) & 1) * CLUSTER_CULLED_OUTSIDE);
+			culled[i + lane] = result;
+			visible += result ? 0 : 1;
+		}
+	}
+
+	return visible;
+#else
+	return cullMeshClustersScalar(bounds, view, culled);
+#endif
+}
+
+bool isBoxOutsideView(const float boundsMin[3], const float boundsMax[3], const ClusterCullView &view)
+{
+	for (int p = 0; p < 6; ++p)
+	{
+		// The corner furthest along the plane's normal is the last one to leave it
+		const DirectX::XMFLOAT4 &plane = view.planes[p];
+		const float x = (plane.x >= 0.0f) ? boundsMax[0] : boundsMin[0];
+		const float y = (plane.y >= 0.0f) ? boundsMax[1] : boundsMin[1];
+		const float z = (plane.z >= 0.0f) ? boundsMax[2] : boundsMin[2];
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+			return true;
+	}
+
+	return false;
+}
+
+void buildClusterDrawRanges(const MeshCluster *clusters, size_t count, const uint8_t *culled, const RMeshSubmesh *submeshes, std::vector<RMeshSubmesh> &ranges)
+{
+	ranges.clear();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (culled[i])
+			continue;
+
+		const MeshCluster &cluster = clusters[i];
+		const RMeshSubmesh &submesh = submeshes[cluster.submesh];
+		if (!ranges.empty() && ranges.back().baseVertex == submesh.baseVertex && ranges.back().materialIndex == submesh.materialIndex &&
+			ranges.back().indexStart + ranges.back().indexCount == cluster.indexStart)
+		{
+			ranges.back().indexCount += cluster.indexCount;
+			continue;
+		}
+
+		RMeshSubmesh range = { cluster.indexStart, cluster.indexCount, submesh.materialIndex, submesh.baseVertex };
+		ranges.push_back(range);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshCache.h"
+
+// Clusters are small runs of neighbouring triangles, each with a bounding sphere and a cone around its
+// face normals, so the renderer can skip the ones outside the frustum or facing away from the camera
+// before it issues the DrawIndexed calls. A cluster's triangles are contiguous in the index buffer and
+// never cross a submesh, so visible clusters that follow each other are drawn as one range.
+
+// Largest number of triangles in a cluster
+const unsigned int MESH_CLUSTER_MAX_TRIANGLES = 128;
+
+// Part of the .rmesh format, see MeshCache.h
+struct MeshCluster
+{
+	float		center[3];		// Bounding sphere in model space
+	float		radius;
+	float		coneAxis[3];	// Average direction of the face normals
+	float		coneCutoff;		// Sine of the angle between the axis and the furthest normal, 1 when the cone can't be culled
+	uint32_t	indexStart;
+	uint32_t	indexCount;
+	uint32_t	submesh;		// Submesh the cluster belongs to, for its base vertex
+	uint32_t	reserved;
+};
+
+static_assert(sizeof(MeshCluster) == 48, "MeshCluster is part of the file format");
+
+// Cluster bounds as one array per field, padded to a multiple of 4 with clusters that are always
+// culled, so cullMeshClusters can test four at a time.
+struct MeshClusterBounds
+{
+	size_t				count;
+	std::vector<float>	centerX, centerY, centerZ, radius;
+	std::vector<float>	axisX, axisY, axisZ, cutoff;
+};
+
+// Camera and frustum planes in the model space of the mesh. Planes are normalized and point inwards.
+struct ClusterCullView
+{
+	DirectX::XMFLOAT3	camera;
+	DirectX::XMFLOAT4	planes[6];
+};
+
+// Why a cluster was culled, as bits of the values cullMeshClusters writes. 0 means visible.
+const uint8_t CLUSTER_CULLED_BACKFACING = 1;
+const uint8_t CLUSTER_CULLED_OUTSIDE = 2;
+
+// Reorders the triangles of every submesh into clusters of at most maxTriangles triangles. Clusters grow
+// from the first unassigned triangle over shared vertices, always taking the neighbour whose normal is
+// closest to the cluster's so far, and stop early when that neighbour would widen the cone too much. Indices are relative to the
+// submesh's baseVertex, as in an .rmesh.
+void buildMeshClusters(const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices,
+	const std::vector<RMeshSubmesh> &submeshes, std::vector<MeshCluster> &clusters, unsigned int maxTriangles = MESH_CLUSTER_MAX_TRIANGLES);
+
+void prepareClusterBounds(const MeshCluster *clusters, size_t count, MeshClusterBounds &out);
+
+// Camera position and frustum of modelViewProjection (row vectors, as DirectXMath and the shaders use them)
+// in model space. The model matrix must not scale the axes differently, or the normal cones don't hold.
+ClusterCullView makeClusterCullView(const DirectX::XMFLOAT3 &modelSpaceCamera, const DirectX::XMFLOAT4X4 &modelViewProjection);
+
+// Writes the CLUSTER_CULLED_* bits of every cluster to culled and returns the number of visible clusters.
+// Uses SSE2 where it's available, with exactly the same results as the scalar version.
+size_t cullMeshClusters(const MeshClusterBounds &bounds, const ClusterCullView &view, uint8_t *culled);
+size_t cullMeshClustersScalar(const MeshClusterBounds &bounds, const ClusterCullView &view, uint8_t *culled);
+
+// Whether the axis aligned box is entirely outside one of the view's planes. Used for whole submeshes.
+bool isBoxOutsideView(const float boundsMin[3], const float boundsMax[3], const ClusterCullView &view);
+
+// Merges the visible clusters that follow each other in the index buffer into DrawIndexed ranges.
+void buildClusterDrawRanges(const MeshCluster *clusters, size_t count, const uint8_t *culled, const RMeshSubmesh *submeshes, std::vector<RMeshSubmesh> &ranges);
@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "MeshData.h"
+
+#include <utility>
+
+MeshData::MeshData(void) :
+	m_allocatedSize(0),
+	m_vertices(nullptr),
+	m_vertexCount(0),
+	m_indices(nullptr),
+	m_indexCount(0),
+	m_sourceNormals(nullptr),
+	m_sourceUVs(nullptr)
+{
+}
+
+MeshData::MeshData(MeshData &&other) :
+	MeshData()
+{
+	*this = std::move(other);
+}
+
+MeshData &MeshData::operator=(MeshData &&other)
+{
+	if (this != &other)
+	{
+		Clear();
+
+		std::swap(m_arena, other.m_arena);
+		std::swap(m_allocatedSize, other.m_allocatedSize);
+		std::swap(m_vertices, other.m_vertices);
+		std::swap(m_vertexCount, other.m_vertexCount);
+		std::swap(m_indices, other.m_indices);
+		std::swap(m_indexCount, other.m_indexCount);
+		std::swap(m_sourceNormals, other.m_sourceNormals);
+		std::swap(m_sourceUVs, other.m_sourceUVs);
+	}
+
+	return *this;
+}
+
+void MeshData::Allocate(size_t vertexCount, size_t indexCount, unsigned int attributes)
+{
+	Clear();
+
+	// Every array only needs 4 byte alignment, so they're packed back to back
+	const size_t vertexBytes = vertexCount * sizeof(DX11UWA::VertexPositionUVNormal);
+	const size_t normalBytes = (attributes & SourceNormals) ? vertexCount * sizeof(DirectX::XMFLOAT3) : 0;
+	const size_t uvBytes = (attributes & SourceUVs) ? vertexCount * sizeof(DirectX::XMFLOAT2) : 0;
+	const size_t indexBytes = indexCount * sizeof(unsigned int);
+
+	m_allocatedSize = vertexBytes + normalBytes + uvBytes + indexBytes;
+	if (m_allocatedSize == 0)
+		return;
+
+	m_arena.reset(new uint8_t[m_allocatedSize]);
+
+	uint8_t *next = m_arena.get();
+	m_vertices = reinterpret_cast<DX11UWA::VertexPositionUVNormal *>(next);
+	next += vertexBytes;
+	m_sourceNormals = normalBytes ? reinterpret_cast<DirectX::XMFLOAT3 *>(next) : nullptr;
+	next += normalBytes;
+	m_sourceUVs = uvBytes ? reinterpret_cast<DirectX::XMFLOAT2 *>(next) : nullptr;
+	next += uvBytes;
+	m_indices = reinterpret_cast<unsigned int *>(next);
+
+	m_vertexCount = vertexCount;
+	m_indexCount = indexCount;
+}
+
+void MeshData::Clear(void)
+{
+	m_arena.reset();
+	m_allocatedSize = 0;
+	m_vertices = nullptr;
+	m_vertexCount = 0;
+	m_indices = nullptr;
+	m_indexCount = 0;
+	m_sourceNormals = nullptr;
+	m_sourceUVs = nullptr;
+}
+
+void MeshData::TrimVertices(size_t vertexCount)
+{
+	if (vertexCount < m_vertexCount)
+		m_vertexCount = vertexCount;
+}
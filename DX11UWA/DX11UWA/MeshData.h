@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "Content/ShaderStructures.h"
+
+// An indexed mesh whose arrays all live in one allocation, so a mesh costs one allocation however big it is
+// and moving it costs none. The vertices come first, then the optional source arrays, then the indices.
+class MeshData
+{
+public:
+	// Arrays kept next to the vertices when they're asked for
+	enum SourceAttributes
+	{
+		SourceNormals = 1,	// The normal of every vertex again
+		SourceUVs = 2		// The uv of every vertex as the file has it, V not flipped
+	};
+
+	MeshData(void);
+
+	MeshData(MeshData &&other);
+	MeshData &operator=(MeshData &&other);
+
+	MeshData(const MeshData &) = delete;
+	MeshData &operator=(const MeshData &) = delete;
+
+	// Replaces the arrays with uninitialized ones of these sizes. attributes is a mask of SourceAttributes.
+	void Allocate(size_t vertexCount, size_t indexCount, unsigned int attributes);
+	void Clear(void);
+
+	// Drops the vertices from vertexCount on, and their source attributes. The allocation keeps its size.
+	void TrimVertices(size_t vertexCount);
+
+	bool IsEmpty(void) const { return m_indexCount == 0; }
+
+	DX11UWA::VertexPositionUVNormal *GetVertices(void) { return m_vertices; }
+	const DX11UWA::VertexPositionUVNormal *GetVertices(void) const { return m_vertices; }
+	size_t GetVertexCount(void) const { return m_vertexCount; }
+
+	unsigned int *GetIndices(void) { return m_indices; }
+	const unsigned int *GetIndices(void) const { return m_indices; }
+	size_t GetIndexCount(void) const { return m_indexCount; }
+
+	// Null unless they were allocated
+	DirectX::XMFLOAT3 *GetSourceNormals(void) { return m_sourceNormals; }
+	const DirectX::XMFLOAT3 *GetSourceNormals(void) const { return m_sourceNormals; }
+	DirectX::XMFLOAT2 *GetSourceUVs(void) { return m_sourceUVs; }
+	const DirectX::XMFLOAT2 *GetSourceUVs(void) const { return m_sourceUVs; }
+
+	// Bytes allocated for all the arrays
+	size_t GetAllocatedSize(void) const { return m_allocatedSize; }
+
+private:
+	std::unique_ptr<uint8_t[]>		m_arena;
+	size_t							m_allocatedSize;
+
+	DX11UWA::VertexPositionUVNormal	*m_vertices;
+	size_t							m_vertexCount;
+	unsigned int					*m_indices;
+	size_t							m_indexCount;
+	DirectX::XMFLOAT3				*m_sourceNormals;
+	DirectX::XMFLOAT2				*m_sourceUVs;
+};
@@ -0,0 +1,609 @@
+#include "pch.h"
+#include "MeshLod.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	// Area weighted sum of squared distances to a set of planes: p'Ap + 2b'p + c
+	struct Quadric
+	{
+		double	a00, a11, a22, a01, a02, a12;
+		double	b0, b1, b2;
+		double	c;
+		double	weight;
+	};
+
+	// Plane with unit normal n through point
+	Quadric planeQuadric(const double (&n)[3], const double (&point)[3], double weight)
+	{
+		const double d = -(n[0] * point[0] + n[1] * point[1] + n[2] * point[2]);
+
+		Quadric q;
+		q.a00 = weight * n[0] * n[0];
+		q.a11 = weight * n[1] * n[1];
+		q.a22 = weight * n[2] * n[2];
+		q.a01 = weight * n[0] * n[1];
+		q.a02 = weight * n[0] * n[2];
+		q.a12 = weight * n[1] * n[2];
+		q.b0 = weight * n[0] * d;
+		q.b1 = weight * n[1] * d;
+		q.b2 = weight * n[2] * d;
+		q.c = weight * d * d;
+		q.weight = weight;
+		return q;
+	}
+
+	void addQuadric(Quadric &q, const Quadric &r)
+	{
+		q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+		q.a01 += r.a01; q.a02 += r.a02; q.a12 += r.a12;
+		q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+		q.c += r.c;
+		q.weight += r.weight;
+	}
+
+	// Mean squared distance from p to the planes
+	double quadricError(const Quadric &q, const DirectX::XMFLOAT3 &p)
+	{
+		const double x = p.x, y = p.y, z = p.z;
+		const double r = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+			2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+		return (q.weight > 0.0) ? fabs(r) / q.weight : 0.0;
+	}
+
+	inline void toDouble(const DirectX::XMFLOAT3 &v, double (&out)[3])
+	{
+		out[0] = v.x;
+		out[1] = v.y;
+		out[2] = v.z;
+	}
+
+	inline void crossDouble(const double (&a)[3], const double (&b)[3], double (&out)[3])
+	{
+		out[0] = a[1] * b[2] - a[2] * b[1];
+		out[1] = a[2] * b[0] - a[0] * b[2];
+		out[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	// Normal of the triangle abc, scaled by twice its area
+	void faceNormal(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b, const DirectX::XMFLOAT3 &c, double (&out)[3])
+	{
+		const double ab[3] = { double(b.x) - a.x, double(b.y) - a.y, double(b.z) - a.z };
+		const double ac[3] = { double(c.x) - a.x, double(c.y) - a.y, double(c.z) - a.z };
+		crossDouble(ab, ac, out);
+	}
+
+	inline double lengthDouble(const double (&v)[3])
+	{
+		return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	}
+
+	// Moves every vertex at position from to the matching vertex at position to. Positions are
+	// identified by the first vertex that has them.
+	struct Collapse
+	{
+		unsigned int	from;
+		unsigned int	to;
+		double			error;
+	};
+
+	enum PositionKind : uint8_t
+	{
+		POSITION_MANIFOLD,
+		POSITION_BORDER,	// On an edge with only one triangle
+		POSITION_LOCKED,	// On an edge with more than two triangles
+	};
+
+	// Open borders are kept in place by planes through them, weighted this much more than the faces
+	const double borderWeight = 10.0;
+
+	// Smallest cosine between a triangle's normal before and after a collapse
+	const double flipLimit = 0.25;
+
+	class Simplifier
+	{
+	public:
+		Simplifier(const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices);
+
+		// Runs passes of collapses until the target is reached or nothing more can be collapsed. Returns the largest squared error.
+		double Simplify(size_t targetTriangles, double maxErrorSq);
+
+	private:
+		void RemoveDegenerates(const std::vector<unsigned int> &remap);
+		void Analyze(void);
+		size_t CountEdges(unsigned int a, unsigned int b) const;
+		void CollectNeighbours(unsigned int p, std::vector<unsigned int> &out) const;
+		bool CanCollapse(unsigned int from, unsigned int to, size_t &removed);
+		bool MapWedges(unsigned int from, unsigned int to, std::vector<unsigned int> *remap) const;
+		bool Flips(unsigned int from, unsigned int to) const;
+
+		const DirectX::XMFLOAT3 &Position(unsigned int vertex) const { return m_vertices[vertex].pos; }
+
+		const std::vector<DX11UWA::VertexPositionUVNormal>	&m_vertices;
+		std::vector<unsigned int>							&m_indices;
+
+		// m_position[v] is the first vertex with v's position, m_wedge[v] the next vertex with it, in a ring
+		std::vector<unsigned int>	m_position;
+		std::vector<unsigned int>	m_wedge;
+		std::vector<Quadric>		m_quadrics;
+		std::vector<uint8_t>		m_kind;
+
+		// Triangles that use each vertex, as offsets into one shared array
+		std::vector<unsigned int>	m_offsets;
+		std::vector<unsigned int>	m_adjacent;
+
+		std::vector<unsigned int>	m_neighbours, m_otherNeighbours;
+	};
+
+	Simplifier::Simplifier(const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices) :
+		m_vertices(vertices),
+		m_indices(indices)
+	{
+		const size_t vertexCount = vertices.size();
+		std::vector<unsigned int> order(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i)
+			order[i] = static_cast<unsigned int>(i);
+
+		std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+		{
+			const DirectX::XMFLOAT3 &pa = vertices[a].pos, &pb = vertices[b].pos;
+			if (pa.x != pb.x)
+				return pa.x < pb.x;
+			if (pa.y != pb.y)
+				return pa.y < pb.y;
+			if (pa.z != pb.z)
+				return pa.z < pb.z;
+			return a < b;
+		});
+
+		m_position.resize(vertexCount);
+		m_wedge.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount;)
+		{
+			const DirectX::XMFLOAT3 &first = vertices[order[i]].pos;
+			size_t end = i + 1;
+			while (end < vertexCount && vertices[order[end]].pos.x == first.x && vertices[order[end]].pos.y == first.y && vertices[order[end]].pos.z == first.z)
+				++end;
+
+			for (size_t j = i; j < end; ++j)
+			{
+				m_position[order[j]] = order[i];
+				m_wedge[order[j]] = order[(j + 1 < end) ? j + 1 : i];
+			}
+			i = end;
+		}
+
+		std::vector<unsigned int> identity(order.size());
+		for (size_t i = 0; i < identity.size(); ++i)
+			identity[i] = static_cast<unsigned int>(i);
+		RemoveDegenerates(identity);
+		Analyze();
+
+		// Every position starts with the planes of its triangles and of the open edges it's on
+		const Quadric zero = {};
+		m_quadrics.assign(vertexCount, zero);
+		for (size_t i = 0; i < m_indices.size(); i += 3)
+		{
+			double normal[3];
+			faceNormal(Position(m_indices[i]), Position(m_indices[i + 1]), Position(m_indices[i + 2]), normal);
+			const double length = lengthDouble(normal);
+			if (length == 0.0)
+				continue;
+
+			const double unit[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+			double point[3];
+			toDouble(Position(m_indices[i]), point);
+			const Quadric face = planeQuadric(unit, point, length * 0.5);
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const unsigned int a = m_position[m_indices[i + corner]];
+				const unsigned int b = m_position[m_indices[i + (corner + 1) % 3]];
+				addQuadric(m_quadrics[a], face);
+
+				if (CountEdges(b, a) != 0)
+					continue;
+
+				double start[3], end[3];
+				toDouble(Position(a), start);
+				toDouble(Position(b), end);
+				const double edge[3] = { end[0] - start[0], end[1] - start[1], end[2] - start[2] };
+				double side[3];
+				crossDouble(edge, unit, side);
+				const double sideLength = lengthDouble(side);
+				if (sideLength == 0.0)
+					continue;
+
+				const double sideUnit[3] = { side[0] / sideLength, side[1] / sideLength, side[2] / sideLength };
+				const double edgeLength = lengthDouble(edge);
+				const Quadric border = planeQuadric(sideUnit, start, edgeLength * edgeLength * borderWeight);
+				addQuadric(m_quadrics[a], border);
+				addQuadric(m_quadrics[b], border);
+			}
+		}
+	}
+
+	// Applies remap to the indices and drops the triangles that no longer span three positions
+	void Simplifier::RemoveDegenerates(const std::vector<unsigned int> &remap)
+	{
+		size_t written = 0;
+		for (size_t i = 0; i + 3 <= m_indices.size(); i += 3)
+		{
+			const unsigned int a = remap[m_indices[i]], b = remap[m_indices[i + 1]], c = remap[m_indices[i + 2]];
+			if (m_position[a] == m_position[b] || m_position[b] == m_position[c] || m_position[c] == m_position[a])
+				continue;
+
+			m_indices[written++] = a;
+			m_indices[written++] = b;
+			m_indices[written++] = c;
+		}
+		m_indices.resize(written);
+	}
+
+	void Simplifier::Analyze(void)
+	{
+		const size_t vertexCount = m_vertices.size();
+
+		m_offsets.assign(vertexCount + 1, 0);
+		for (unsigned int index : m_indices)
+			m_offsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; ++v)
+			m_offsets[v + 1] += m_offsets[v];
+
+		std::vector<unsigned int> fill(m_offsets.begin(), m_offsets.end() - 1);
+		m_adjacent.resize(m_indices.size());
+		for (size_t i = 0; i < m_indices.size(); ++i)
+			m_adjacent[fill[m_indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+		m_kind.assign(vertexCount, POSITION_MANIFOLD);
+		for (size_t i = 0; i < m_indices.size(); ++i)
+		{
+			const unsigned int a = m_position[m_indices[i]];
+			const unsigned int b = m_position[m_indices[i - i % 3 + (i % 3 + 1) % 3]];
+
+			if (CountEdges(a, b) > 1)
+				m_kind[a] = m_kind[b] = POSITION_LOCKED;
+			else if (CountEdges(b, a) == 0)
+			{
+				if (m_kind[a] != POSITION_LOCKED)
+					m_kind[a] = POSITION_BORDER;
+				if (m_kind[b] != POSITION_LOCKED)
+					m_kind[b] = POSITION_BORDER;
+			}
+		}
+	}
+
+	// Triangles with the edge from position a to position b
+	size_t Simplifier::CountEdges(unsigned int a, unsigned int b) const
+	{
+		size_t count = 0;
+		unsigned int vertex = a;
+		do
+		{
+			for (unsigned int j = m_offsets[vertex]; j < m_offsets[vertex + 1]; ++j)
+			{
+				const unsigned int *triangle = &m_indices[m_adjacent[j] * 3];
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					if (triangle[corner] == vertex && m_position[triangle[(corner + 1) % 3]] == b)
+						++count;
+				}
+			}
+			vertex = m_wedge[vertex];
+		} while (vertex != a);
+
+		return count;
+	}
+
+	// Positions that share a triangle with position p, sorted
+	void Simplifier::CollectNeighbours(unsigned int p, std::vector<unsigned int> &out) const
+	{
+		out.clear();
+		unsigned int vertex = p;
+		do
+		{
+			for (unsigned int j = m_offsets[vertex]; j < m_offsets[vertex + 1]; ++j)
+			{
+				const unsigned int *triangle = &m_indices[m_adjacent[j] * 3];
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					if (m_position[triangle[corner]] != p)
+						out.push_back(m_position[triangle[corner]]);
+				}
+			}
+			vertex = m_wedge[vertex];
+		} while (vertex != p);
+
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+	}
+
+	// Checks that collapsing from into to keeps the mesh manifold, its borders and its seams, and
+	// returns the number of triangles the collapse removes in removed
+	bool Simplifier::CanCollapse(unsigned int from, unsigned int to, size_t &removed)
+	{
+		if (m_kind[from] == POSITION_LOCKED)
+			return false;
+
+		// Borders only collapse along themselves, so they don't shrink into the mesh
+		if (m_kind[from] == POSITION_BORDER && CountEdges(from, to) + CountEdges(to, from) != 1)
+			return false;
+
+		// The triangles on the edge have to be the only ones the two positions share, or the collapse
+		// would fold two parts of the surface onto each other
+		removed = CountEdges(from, to) + CountEdges(to, from);
+		CollectNeighbours(from, m_neighbours);
+		CollectNeighbours(to, m_otherNeighbours);
+
+		size_t shared = 0;
+		for (size_t i = 0, j = 0; i < m_neighbours.size() && j < m_otherNeighbours.size();)
+		{
+			if (m_neighbours[i] < m_otherNeighbours[j])
+				++i;
+			else if (m_neighbours[i] > m_otherNeighbours[j])
+				++j;
+			else
+			{
+				++shared;
+				++i;
+				++j;
+			}
+		}
+
+		return shared == removed && MapWedges(from, to, nullptr);
+	}
+
+	// Every vertex at from has to share triangles with exactly one vertex at to, which it becomes. A UV
+	// seam at from that doesn't continue to to would be torn open otherwise.
+	bool Simplifier::MapWedges(unsigned int from, unsigned int to, std::vector<unsigned int> *remap) const
+	{
+		unsigned int vertex = from;
+		do
+		{
+			unsigned int target = ~0u;
+			for (unsigned int j = m_offsets[vertex]; j < m_offsets[vertex + 1]; ++j)
+			{
+				const unsigned int *triangle = &m_indices[m_adjacent[j] * 3];
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					if (m_position[triangle[corner]] != to)
+						continue;
+					if (target != ~0u && target != triangle[corner])
+						return false;
+					target = triangle[corner];
+				}
+			}
+
+			// Vertices no triangle uses any more don't matter
+			if (target == ~0u && m_offsets[vertex] != m_offsets[vertex + 1])
+				return false;
+			if (remap && target != ~0u)
+				(*remap)[vertex] = target;
+
+			vertex = m_wedge[vertex];
+		} while (vertex != from);
+
+		return true;
+	}
+
+	// Whether moving from onto to turns any of the triangles that stay around from too far
+	bool Simplifier::Flips(unsigned int from, unsigned int to) const
+	{
+		unsigned int vertex = from;
+		do
+		{
+			for (unsigned int j = m_offsets[vertex]; j < m_offsets[vertex + 1]; ++j)
+			{
+				const unsigned int *triangle = &m_indices[m_adjacent[j] * 3];
+				if (m_position[triangle[0]] == to || m_position[triangle[1]] == to || m_position[triangle[2]] == to)
+					continue;
+
+				DirectX::XMFLOAT3 corners[3] = { Position(triangle[0]), Position(triangle[1]), Position(triangle[2]) };
+				double before[3], after[3];
+				faceNormal(corners[0], corners[1], corners[2], before);
+
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					if (triangle[corner] == vertex)
+						corners[corner] = Position(to);
+				}
+				faceNormal(corners[0], corners[1], corners[2], after);
+
+				// Triangles that were already degenerate can't flip
+				const double lengthBefore = lengthDouble(before);
+				if (lengthBefore > 0.0 && before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= flipLimit * lengthBefore * lengthDouble(after))
+					return true;
+			}
+			vertex = m_wedge[vertex];
+		} while (vertex != from);
+
+		return false;
+	}
+
+	double Simplifier::Simplify(size_t targetTriangles, double maxErrorSq)
+	{
+		const size_t vertexCount = m_vertices.size();
+		std::vector<Collapse> collapses;
+		std::vector<unsigned int> remap(vertexCount);
+		std::vector<char> locked(vertexCount);
+		double resultError = 0.0;
+
+		while (m_indices.size() / 3 > targetTriangles)
+		{
+			// Both directions of every edge, cheapest first
+			collapses.clear();
+			for (size_t i = 0; i < m_indices.size(); ++i)
+			{
+				const unsigned int a = m_position[m_indices[i]];
+				const unsigned int b = m_position[m_indices[i - i % 3 + (i % 3 + 1) % 3]];
+				Collapse forward = { a, b, 0.0 }, backward = { b, a, 0.0 };
+				collapses.push_back(forward);
+				collapses.push_back(backward);
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.from != y.from ? x.from < y.from : x.to < y.to; });
+			collapses.erase(std::unique(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.from == y.from && x.to == y.to; }), collapses.end());
+
+			for (Collapse &collapse : collapses)
+			{
+				Quadric combined = m_quadrics[collapse.from];
+				addQuadric(combined, m_quadrics[collapse.to]);
+				collapse.error = quadricError(combined, Position(collapse.to));
+			}
+			std::stable_sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.error < y.error; });
+
+			// Positions whose triangles changed in this pass wait for the next, so every check
+			// below sees the same topology the adjacency describes
+			for (size_t v = 0; v < vertexCount; ++v)
+				remap[v] = static_cast<unsigned int>(v);
+			std::fill(locked.begin(), locked.end(), 0);
+
+			size_t triangles = m_indices.size() / 3;
+			size_t applied = 0;
+
+			for (const Collapse &collapse : collapses)
+			{
+				if (collapse.error > maxErrorSq || triangles <= targetTriangles)
+					break;
+
+				size_t removed = 0;
+				if (locked[collapse.from] || locked[collapse.to] || !CanCollapse(collapse.from, collapse.to, removed) || Flips(collapse.from, collapse.to))
+					continue;
+
+				MapWedges(collapse.from, collapse.to, &remap);
+				addQuadric(m_quadrics[collapse.to], m_quadrics[collapse.from]);
+
+				locked[collapse.from] = locked[collapse.to] = 1;
+				for (unsigned int neighbour : m_neighbours)
+					locked[neighbour] = 1;
+
+				triangles -= std::min(triangles, removed);
+				resultError = std::max(resultError, collapse.error);
+				++applied;
+			}
+
+			if (applied == 0)
+				break;
+
+			RemoveDegenerates(remap);
+			Analyze();
+		}
+
+		return resultError;
+	}
+}
+
+float simplifyMesh(const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, const unsigned int *indices, size_t indexCount,
+	size_t targetIndexCount, float maxError, std::vector<unsigned int> &out)
+{
+	out.assign(indices, indices + indexCount - indexCount % 3);
+
+	Simplifier simplifier(vertices, out);
+	const double maxErrorSq = (maxError == FLT_MAX) ? DBL_MAX : double(maxError) * maxError;
+	return static_cast<float>(sqrt(simplifier.Simplify(targetIndexCount / 3, maxErrorSq)));
+}
+
+void buildMeshLods(const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices,
+	std::vector<RMeshSubmesh> &submeshes, unsigned int levelCount, std::vector<MeshLod> &lods)
+{
+	lods.clear();
+	MeshLod full = { 0, static_cast<uint32_t>(submeshes.size()), 0.0f, 0 };
+	lods.push_back(full);
+
+	std::vector<unsigned int> simplified;
+	size_t previousCount = indices.size();
+
+	for (unsigned int level = 1; level < levelCount; ++level)
+	{
+		// Every level is simplified from the full detail mesh, so its error is measured against that
+		MeshLod lod = { static_cast<uint32_t>(submeshes.size()), full.submeshCount, lods.back().error, 0 };
+		size_t count = 0;
+
+		for (uint32_t s = 0; s < full.submeshCount; ++s)
+		{
+			const RMeshSubmesh source = submeshes[s];
+			const size_t target = (source.indexCount / 3 >> level) * 3;
+			const float error = simplifyMesh(vertices, indices.data() + source.indexStart, source.indexCount, target, FLT_MAX, simplified);
+			optimizeVertexCache(simplified, vertices.size());
+
+			RMeshSubmesh range = { static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), source.materialIndex, source.baseVertex };
+			indices.insert(indices.end(), simplified.begin(), simplified.end());
+			submeshes.push_back(range);
+
+			lod.error = std::max(lod.error, error);
+			count += simplified.size();
+		}
+
+		// A level that's barely simpler than the one before isn't worth its memory
+		if (count * 10 > previousCount * 9)
+		{
+			indices.resize(submeshes[lod.submeshStart].indexStart);
+			submeshes.resize(lod.submeshStart);
+			break;
+		}
+
+		// A level no coarser in error than the one before draws fewer triangles for the same error, so it takes
+		// that level's place. The full detail level always stays.
+		if (lod.error <= lods.back().error)
+		{
+			if (lods.size() == 1)
+			{
+				indices.resize(submeshes[lod.submeshStart].indexStart);
+				submeshes.resize(lod.submeshStart);
+				previousCount = count;
+				continue;
+			}
+
+			const MeshLod replaced = lods.back();
+			const uint32_t firstIndex = submeshes[replaced.submeshStart].indexStart;
+			const uint32_t removedIndices = submeshes[lod.submeshStart].indexStart - firstIndex;
+			indices.erase(indices.begin() + firstIndex, indices.begin() + firstIndex + removedIndices);
+			submeshes.erase(submeshes.begin() + replaced.submeshStart, submeshes.begin() + lod.submeshStart);
+			for (size_t i = replaced.submeshStart; i < submeshes.size(); ++i)
+				submeshes[i].indexStart -= removedIndices;
+
+			lods.pop_back();
+			lod.submeshStart = replaced.submeshStart;
+		}
+
+		lods.push_back(lod);
+		previousCount = count;
+	}
+}
+
+float lodPixelScale(float viewportHeight, float fovAngleY)
+{
+	return 0.5f * viewportHeight / tanf(0.5f * fovAngleY);
+}
+
+float lodDistance(const DirectX::XMFLOAT3 &camera, const DirectX::XMFLOAT3 &center, float radius)
+{
+	const float dx = center.x - camera.x, dy = center.y - camera.y, dz = center.z - camera.z;
+	return std::max(sqrtf(dx * dx + dy * dy + dz * dz) - radius, 1e-4f);
+}
+
+unsigned int selectMeshLod(const MeshLod *lods, size_t count, float distance, float pixelScale, unsigned int current,
+	float thresholdPixels, float hysteresis)
+{
+	if (count == 0)
+		return 0;
+
+	const float pixelsPerUnit = pixelScale / distance;
+	unsigned int level = std::min(current, static_cast<unsigned int>(count - 1));
+
+	// Too coarse now, step back to the coarsest level under the threshold. Level 0 has no error, so there is one.
+	if (lods[level].error * pixelsPerUnit > thresholdPixels * (1.0f + hysteresis))
+	{
+		while (level > 0 && lods[level].error * pixelsPerUnit > thresholdPixels)
+			--level;
+	}
+
+	while (level + 1 < count && lods[level + 1].error * pixelsPerUnit <= thresholdPixels * (1.0f - hysteresis))
+		++level;
+
+	return level;
+}
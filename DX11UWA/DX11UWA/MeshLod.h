@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshCache.h"
+
+// Levels of detail are coarser versions of a mesh's index buffer, made by collapsing edges in order of
+// quadric error (Garland and Heckbert 1997). They reuse the full detail vertices, so a level is nothing but
+// more submeshes. Each level stores the geometric error it was simplified with, which the renderer projects
+// to the screen to pick the coarsest level that still looks the same.
+
+// Levels the renderer and the cooker build, including the full detail one
+const unsigned int MESH_LOD_DEFAULT_COUNT = 4;
+
+// Part of the .rmesh format, see MeshCache.h. Level 0 is the full detail mesh, coarser levels follow.
+struct MeshLod
+{
+	uint32_t	submeshStart;	// The level's ranges in the submesh array
+	uint32_t	submeshCount;
+	float		error;			// Furthest the level's surface may be from the full detail one, in model units
+	uint32_t	reserved;
+};
+
+static_assert(sizeof(MeshLod) == 16, "MeshLod is part of the file format");
+
+// Collapses edges of the triangles in indices until at most targetIndexCount indices are left, or the next
+// collapse would move the surface further than maxError. Vertices with the same position are treated as one,
+// UV seams and open borders only collapse along themselves and no triangle is allowed to flip. Writes the
+// remaining triangles to out and returns the error of the result.
+float simplifyMesh(const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, const unsigned int *indices, size_t indexCount,
+	size_t targetIndexCount, float maxError, std::vector<unsigned int> &out);
+
+// Appends levels 1 to levelCount - 1 after the submeshes, each simplified from the full detail mesh to half the
+// triangles of the one before, and describes all of them in lods. Each level's error is higher than the one
+// before's, a level that doesn't add any takes the place of the one before. Stops early when a level can't get
+// any simpler. The submeshes' indices have to be into the whole vertex array, so run this before
+// splitMeshForIndexSize.
+void buildMeshLods(const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices,
+	std::vector<RMeshSubmesh> &submeshes, unsigned int levelCount, std::vector<MeshLod> &lods);
+
+// Pixels one model unit covers at distance 1, for a viewport viewportHeight pixels high and the vertical field of view
+float lodPixelScale(float viewportHeight, float fovAngleY);
+
+// How far the camera is from the mesh's bounding sphere, never less than a small positive distance
+float lodDistance(const DirectX::XMFLOAT3 &camera, const DirectX::XMFLOAT3 &center, float radius);
+
+// Picks the coarsest level whose error covers at most thresholdPixels on screen. To keep levels from
+// flickering at the boundary, a coarser level is only taken once it's below (1 - hysteresis) times the
+// threshold, and the current level is only given up once it's above (1 + hysteresis) times it.
+unsigned int selectMeshLod(const MeshLod *lods, size_t count, float distance, float pixelScale, unsigned int current,
+	float thresholdPixels = 1.0f, float hysteresis = 0.25f);
@@ -0,0 +1,488 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	// FIFO post-transform cache. A vertex is cached while fewer than size misses happened since it was loaded.
+	struct FifoCache
+	{
+		FifoCache(size_t vertexCount, unsigned int cacheSize) : stamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+		// Returns true on a miss
+		bool Access(unsigned int vertex)
+		{
+			if (time - stamps[vertex] <= size)
+				return false;
+
+			stamps[vertex] = time++;
+			return true;
+		}
+
+		void Flush(void)
+		{
+			time += size + 1;
+		}
+
+		std::vector<unsigned int>	stamps;
+		unsigned int				time;
+		unsigned int				size;
+	};
+
+	inline DirectX::XMFLOAT3 subtract(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b)
+	{
+		return DirectX::XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	inline DirectX::XMFLOAT3 cross(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b)
+	{
+		return DirectX::XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	inline float dot(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	// Triangles that use each vertex, as offsets into one shared array
+	struct TriangleAdjacency
+	{
+		std::vector<unsigned int>	offsets;
+		std::vector<unsigned int>	triangles;
+	};
+
+	void buildAdjacency(const std::vector<unsigned int> &indices, size_t vertexCount, TriangleAdjacency &adjacency, std::vector<unsigned int> &live)
+	{
+		live.assign(vertexCount, 0);
+		for (unsigned int index : indices)
+			live[index]++;
+
+		adjacency.offsets.resize(vertexCount + 1);
+		adjacency.offsets[0] = 0;
+		for (size_t i = 0; i < vertexCount; ++i)
+			adjacency.offsets[i + 1] = adjacency.offsets[i] + live[i];
+
+		std::vector<unsigned int> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		adjacency.triangles.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+			adjacency.triangles[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+	}
+
+	const float gridSize = 256.0f;
+
+	// Rasterizes one triangle at pixel centres with a less-than depth test. Triangles wound clockwise in
+	// grid space are facing away and culled. Returns the number of pixels that passed the depth test.
+	size_t rasterize(const float (&x)[3], const float (&y)[3], const float (&z)[3], std::vector<float> &depth, int size)
+	{
+		const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (area <= 0.0f)
+			return 0;
+
+		const int minX = std::max(0, static_cast<int>(std::min(x[0], std::min(x[1], x[2]))));
+		const int maxX = std::min(size - 1, static_cast<int>(std::max(x[0], std::max(x[1], x[2]))));
+		const int minY = std::max(0, static_cast<int>(std::min(y[0], std::min(y[1], y[2]))));
+		const int maxY = std::min(size - 1, static_cast<int>(std::max(y[0], std::max(y[1], y[2]))));
+
+		size_t shaded = 0;
+		for (int py = minY; py <= maxY; ++py)
+		{
+			const float sy = py + 0.5f;
+			for (int px = minX; px <= maxX; ++px)
+			{
+				const float sx = px + 0.5f;
+
+				// Edge functions, each the doubled area of the sub-triangle opposite a corner
+				const float w0 = (x[2] - x[1]) * (sy - y[1]) - (y[2] - y[1]) * (sx - x[1]);
+				const float w1 = (x[0] - x[2]) * (sy - y[2]) - (y[0] - y[2]) * (sx - x[2]);
+				const float w2 = (x[1] - x[0]) * (sy - y[0]) - (y[1] - y[0]) * (sx - x[0]);
+				if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+					continue;
+
+				const float d = (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area;
+				float &stored = depth[py * size + px];
+				if (d < stored)
+				{
+					stored = d;
+					shaded++;
+				}
+			}
+		}
+
+		return shaded;
+	}
+}
+
+VertexCacheStats analyzeVertexCache(const unsigned int *indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	stats.triangleCount = indexCount / 3;
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<char> used(vertexCount, 0);
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		const unsigned int index = indices[i];
+		if (cache.Access(index))
+			stats.misses++;
+
+		if (!used[index])
+		{
+			used[index] = 1;
+			stats.vertexCount++;
+		}
+	}
+
+	stats.acmr = stats.triangleCount ? static_cast<float>(stats.misses) / stats.triangleCount : 0.0f;
+	stats.atvr = stats.vertexCount ? static_cast<float>(stats.misses) / stats.vertexCount : 0.0f;
+	return stats;
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize)
+{
+	return analyzeVertexCache(indices.data(), indices.size(), vertexCount, cacheSize);
+}
+
+OverdrawStats analyzeOverdraw(const unsigned int *indices, size_t indexCount, const DX11UWA::VertexPositionUVNormal *vertices)
+{
+	OverdrawStats stats = {};
+
+	float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		const float *position = &vertices[indices[i]].pos.x;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+			boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+		}
+	}
+
+	float extent = 0.0f;
+	for (int axis = 0; axis < 3; ++axis)
+		extent = std::max(extent, boundsMax[axis] - boundsMin[axis]);
+
+	if (indexCount < 3 || extent <= 0.0f)
+		return stats;
+
+	// One scale for every axis keeps the pixels square, so the six views weigh the same
+	const int size = static_cast<int>(gridSize);
+	const float scale = (gridSize - 1.0f) / extent;
+	std::vector<float> depth(size * size);
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const int u = (axis + 1) % 3;
+		const int v = (axis + 2) % 3;
+
+		// Looking along the axis from both ends, so the counter-clockwise (outward) faces toward each camera
+		// are drawn. Mirroring the second view flips the winding with it.
+		for (int side = 0; side < 2; ++side)
+		{
+			std::fill(depth.begin(), depth.end(), FLT_MAX);
+
+			for (size_t i = 0; i + 2 < indexCount; i += 3)
+			{
+				float x[3], y[3], z[3];
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					const float *position = &vertices[indices[i + corner]].pos.x;
+					x[corner] = (position[u] - boundsMin[u]) * scale;
+					y[corner] = (position[v] - boundsMin[v]) * scale;
+					z[corner] = -position[axis];
+
+					if (side)
+					{
+						x[corner] = (gridSize - 1.0f) - x[corner];
+						z[corner] = position[axis];
+					}
+				}
+
+				stats.shadedPixels += rasterize(x, y, z, depth, size);
+			}
+
+			for (float d : depth)
+			{
+				if (d != FLT_MAX)
+					stats.coveredPixels++;
+			}
+		}
+	}
+
+	stats.overdraw = stats.coveredPixels ? static_cast<float>(stats.shadedPixels) / stats.coveredPixels : 0.0f;
+	return stats;
+}
+
+OverdrawStats analyzeOverdraw(const std::vector<unsigned int> &indices, const std::vector<DX11UWA::VertexPositionUVNormal> &vertices)
+{
+	return analyzeOverdraw(indices.data(), indices.size(), vertices.data());
+}
+
+void optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount, std::vector<unsigned int> *clusters, unsigned int cacheSize)
+{
+	if (clusters)
+		clusters->clear();
+
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	TriangleAdjacency adjacency;
+	std::vector<unsigned int> live;
+	buildAdjacency(indices, vertexCount, adjacency, live);
+
+	std::vector<unsigned int> stamps(vertexCount, 0);
+	std::vector<char> emitted(triangleCount, 0);
+	std::vector<unsigned int> deadEnd, candidates, result;
+	deadEnd.reserve(indices.size());
+	result.reserve(indices.size());
+
+	const unsigned int none = ~0u;
+	unsigned int time = cacheSize + 1;
+	size_t cursor = 0;
+	unsigned int current = none;
+	bool jumped = true;
+
+	// The walk starts at the first used vertex
+	while (cursor < vertexCount && live[cursor] == 0)
+		cursor++;
+	if (cursor < vertexCount)
+		current = static_cast<unsigned int>(cursor);
+
+	while (current != none)
+	{
+		if (jumped && clusters)
+			clusters->push_back(static_cast<unsigned int>(result.size()));
+
+		// Emit every remaining triangle around the current vertex
+		candidates.clear();
+		for (unsigned int a = adjacency.offsets[current]; a < adjacency.offsets[current + 1]; ++a)
+		{
+			const unsigned int triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+				continue;
+
+			emitted[triangle] = 1;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const unsigned int vertex = indices[triangle * 3 + corner];
+				result.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+
+				if (time - stamps[vertex] > cacheSize)
+					stamps[vertex] = time++;
+			}
+		}
+
+		// Next is the candidate that's oldest in the cache but will still be there once its remaining
+		// triangles are emitted. Candidates that would fall out of the cache rank behind.
+		unsigned int next = none;
+		int bestPriority = -1;
+		for (unsigned int vertex : candidates)
+		{
+			if (live[vertex] == 0)
+				continue;
+
+			int priority = 0;
+			if (time - stamps[vertex] + 2 * live[vertex] <= cacheSize)
+				priority = static_cast<int>(time - stamps[vertex]);
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+		jumped = false;
+
+		// Dead end: back up to a recently used vertex, or else the next unfinished one in index order
+		while (next == none && !deadEnd.empty())
+		{
+			const unsigned int vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[vertex] > 0)
+				next = vertex;
+		}
+
+		if (next == none)
+		{
+			while (cursor < vertexCount && live[cursor] == 0)
+				cursor++;
+			if (cursor < vertexCount)
+				next = static_cast<unsigned int>(cursor);
+			jumped = true;
+		}
+
+		current = next;
+	}
+
+	indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, const std::vector<unsigned int> &clusters, float threshold, unsigned int cacheSize)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Split the clusters further wherever the cache hasn't been much worse than over the whole cluster
+	std::vector<size_t> starts;
+	FifoCache cache(vertices.size(), cacheSize);
+
+	for (size_t c = 0; c < std::max<size_t>(clusters.size(), 1); ++c)
+	{
+		const size_t begin = clusters.empty() ? 0 : clusters[c] / 3;
+		const size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] / 3 : triangleCount;
+
+		size_t clusterMisses = 0;
+		cache.Flush();
+		for (size_t i = begin * 3; i < end * 3; ++i)
+			clusterMisses += cache.Access(indices[i]) ? 1 : 0;
+
+		const float limit = threshold * clusterMisses / std::max<size_t>(end - begin, 1);
+
+		size_t start = begin;
+		size_t misses = 0;
+		starts.push_back(begin);
+		cache.Flush();
+
+		for (size_t t = begin; t < end; ++t)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+				misses += cache.Access(indices[t * 3 + corner]) ? 1 : 0;
+
+			if (t + 1 < end && static_cast<float>(misses) / (t + 1 - start) <= limit)
+			{
+				start = t + 1;
+				misses = 0;
+				starts.push_back(start);
+				cache.Flush();
+			}
+		}
+	}
+
+	// Area weighted centroid of the whole mesh, and of every cluster with its average normal
+	std::vector<DirectX::XMFLOAT3> centroids(starts.size()), normals(starts.size());
+	DirectX::XMFLOAT3 meshCentroid(0.0f, 0.0f, 0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < starts.size(); ++c)
+	{
+		const size_t end = (c + 1 < starts.size()) ? starts[c + 1] : triangleCount;
+		DirectX::XMFLOAT3 centroid(0.0f, 0.0f, 0.0f), normal(0.0f, 0.0f, 0.0f);
+		float clusterArea = 0.0f;
+
+		for (size_t t = starts[c]; t < end; ++t)
+		{
+			const DirectX::XMFLOAT3 &a = vertices[indices[t * 3 + 0]].pos;
+			const DirectX::XMFLOAT3 &b = vertices[indices[t * 3 + 1]].pos;
+			const DirectX::XMFLOAT3 &d = vertices[indices[t * 3 + 2]].pos;
+
+			const DirectX::XMFLOAT3 n = cross(subtract(b, a), subtract(d, a));
+			const float area = sqrtf(dot(n, n));
+
+			centroid.x += (a.x + b.x + d.x) * area / 3.0f;
+			centroid.y += (a.y + b.y + d.y) * area / 3.0f;
+			centroid.z += (a.z + b.z + d.z) * area / 3.0f;
+			normal.x += n.x;
+			normal.y += n.y;
+			normal.z += n.z;
+			clusterArea += area;
+		}
+
+		meshCentroid.x += centroid.x;
+		meshCentroid.y += centroid.y;
+		meshCentroid.z += centroid.z;
+		meshArea += clusterArea;
+
+		if (clusterArea > 0.0f)
+			centroids[c] = DirectX::XMFLOAT3(centroid.x / clusterArea, centroid.y / clusterArea, centroid.z / clusterArea);
+		normals[c] = normal;
+	}
+
+	if (meshArea > 0.0f)
+		meshCentroid = DirectX::XMFLOAT3(meshCentroid.x / meshArea, meshCentroid.y / meshArea, meshCentroid.z / meshArea);
+
+	// Clusters further out along their normal are more likely to be in front, so they go first
+	std::vector<float> keys(starts.size());
+	std::vector<unsigned int> order(starts.size());
+	for (size_t c = 0; c < starts.size(); ++c)
+	{
+		const float length = sqrtf(dot(normals[c], normals[c]));
+		keys[c] = (length > 0.0f) ? dot(subtract(centroids[c], meshCentroid), normals[c]) / length : 0.0f;
+		order[c] = static_cast<unsigned int>(c);
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&keys](unsigned int a, unsigned int b) { return keys[a] > keys[b]; });
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (unsigned int c : order)
+	{
+		const size_t end = (c + 1 < starts.size()) ? starts[c + 1] : triangleCount;
+		result.insert(result.end(), indices.begin() + starts[c] * 3, indices.begin() + end * 3);
+	}
+
+	indices.swap(result);
+}
+
+size_t optimizeVertexFetchRemap(const unsigned int *indices, size_t indexCount, size_t vertexCount, std::vector<unsigned int> &remap)
+{
+	remap.assign(vertexCount, ~0u);
+
+	unsigned int next = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		if (remap[indices[i]] == ~0u)
+			remap[indices[i]] = next++;
+	}
+
+	return next;
+}
+
+size_t optimizeVertexFetchRemap(const std::vector<unsigned int> &indices, size_t vertexCount, std::vector<unsigned int> &remap)
+{
+	return optimizeVertexFetchRemap(indices.data(), indices.size(), vertexCount, remap);
+}
+
+void optimizeMesh(std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices, MeshOptimizeReport *report)
+{
+	const VertexCacheStats cacheBefore = analyzeVertexCache(indices, vertices.size());
+	if (report)
+	{
+		report->cacheBefore = cacheBefore;
+		report->overdrawBefore = analyzeOverdraw(indices, vertices);
+		report->keptInputRanges = 0;
+	}
+
+	// The overdraw pass gives up some cache efficiency, but not so much that the mesh does worse than it did
+	std::vector<unsigned int> input(indices), clusters;
+	optimizeVertexCache(indices, vertices.size(), &clusters);
+	optimizeOverdraw(indices, vertices, clusters);
+
+	if (analyzeVertexCache(indices, vertices.size()).acmr > cacheBefore.acmr)
+	{
+		indices.swap(input);
+		if (report)
+			report->keptInputRanges = 1;
+	}
+
+	std::vector<unsigned int> remap;
+	const size_t usedCount = optimizeVertexFetchRemap(indices, vertices.size(), remap);
+	for (unsigned int &index : indices)
+		index = remap[index];
+	remapVertices(vertices, remap, usedCount);
+
+	if (report)
+	{
+		report->cacheAfter = analyzeVertexCache(indices, vertices.size());
+		report->overdrawAfter = analyzeOverdraw(indices, vertices);
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "Content/ShaderStructures.h"
+
+// Post-transform vertex cache size the optimizer and the analyzer assume. Real GPUs don't have a
+// simple FIFO, but orders that are good for a 16 entry FIFO are good on all of them.
+const unsigned int MESH_VERTEX_CACHE_SIZE = 16;
+
+// How well an index buffer uses the post-transform vertex cache, simulated as a FIFO.
+struct VertexCacheStats
+{
+	size_t	triangleCount;
+	size_t	vertexCount;	// Vertices referenced by the index buffer
+	size_t	misses;			// Vertex shader invocations
+	float	acmr;			// Average cache miss ratio: misses per triangle, 0.5 at best and 3 at worst
+	float	atvr;			// Average transformed vertex ratio: misses per vertex, 1 at best
+};
+
+// How many times each covered pixel is shaded, estimated by rasterizing the mesh with a depth test
+// from the six axis directions. Faces pointing away from the view are culled, as the renderer does.
+struct OverdrawStats
+{
+	size_t	coveredPixels;
+	size_t	shadedPixels;
+	float	overdraw;		// shadedPixels / coveredPixels, 1 at best
+};
+
+struct MeshOptimizeReport
+{
+	VertexCacheStats	cacheBefore;
+	VertexCacheStats	cacheAfter;
+	OverdrawStats		overdrawBefore;
+	OverdrawStats		overdrawAfter;
+
+	// Ranges of triangles that the passes left with a higher ACMR than they had, which keep their input order
+	// instead. optimizeMesh treats the whole mesh as one range, loadOBJ each object and material group.
+	size_t				keptInputRanges;
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = MESH_VERTEX_CACHE_SIZE);
+VertexCacheStats analyzeVertexCache(const unsigned int *indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = MESH_VERTEX_CACHE_SIZE);
+
+OverdrawStats analyzeOverdraw(const std::vector<unsigned int> &indices, const std::vector<DX11UWA::VertexPositionUVNormal> &vertices);
+OverdrawStats analyzeOverdraw(const unsigned int *indices, size_t indexCount, const DX11UWA::VertexPositionUVNormal *vertices);
+
+// Reorders the triangles for the vertex cache (Tipsify, Sander et al. 2007). clusters receives the index
+// offset of every point where the walk had to jump to an unconnected part of the mesh, starting with 0.
+void optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount, std::vector<unsigned int> *clusters = nullptr, unsigned int cacheSize = MESH_VERTEX_CACHE_SIZE);
+
+// Reorders the clusters from optimizeVertexCache so outward facing ones are drawn first and hide what's
+// behind them. Clusters are first split further wherever that costs at most threshold times their ACMR.
+void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, const std::vector<unsigned int> &clusters, float threshold = 1.05f, unsigned int cacheSize = MESH_VERTEX_CACHE_SIZE);
+
+// Computes the vertex order in which the index buffer first uses each vertex, so fetches walk memory forwards.
+// remap[old] is the new index of a vertex, or ~0u if no triangle uses it. Returns the number of used vertices.
+size_t optimizeVertexFetchRemap(const std::vector<unsigned int> &indices, size_t vertexCount, std::vector<unsigned int> &remap);
+size_t optimizeVertexFetchRemap(const unsigned int *indices, size_t indexCount, size_t vertexCount, std::vector<unsigned int> &remap);
+
+// Moves values[old] to values[remap[old]] and drops the unused ones.
+template <typename T>
+void remapVertices(std::vector<T> &values, const std::vector<unsigned int> &remap, size_t usedCount)
+{
+	std::vector<T> result(usedCount);
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		if (remap[i] != ~0u)
+			result[remap[i]] = values[i];
+	}
+	values.swap(result);
+}
+
+// Same as remapVertices, but moves the values within the array, so only a bit per vertex is allocated.
+// The values remap keeps end up at the start of the array, the rest is left unspecified.
+template <typename T>
+void remapVerticesInPlace(T *values, size_t count, const std::vector<unsigned int> &remap)
+{
+	// Each value is carried to its new slot, and the one it displaces on to its own, until the chain ends
+	// at a slot whose value was already moved or is dropped
+	std::vector<bool> moved(count, false);
+	for (size_t start = 0; start < count; ++start)
+	{
+		if (moved[start] || remap[start] == ~0u)
+			continue;
+
+		T carried = values[start];
+		moved[start] = true;
+
+		for (size_t slot = remap[start];; )
+		{
+			const bool occupied = !moved[slot] && remap[slot] != ~0u;
+			moved[slot] = true;
+
+			if (!occupied)
+			{
+				values[slot] = carried;
+				break;
+			}
+
+			std::swap(carried, values[slot]);
+			slot = remap[slot];
+		}
+	}
+}
+
+// Runs all three passes. If the triangles end up with a higher ACMR than they started with, they keep their
+// input order and only the vertices are reordered. The report, if set, is filled in by the analyzers before and after.
+void optimizeMesh(std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices, MeshOptimizeReport *report = nullptr);
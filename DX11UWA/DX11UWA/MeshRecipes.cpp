@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "MeshRecipes.h"
+#include "ObjLoader.h"
+
+#include <cstring>
+
+namespace
+{
+	const MeshRecipe recipes[] =
+	{
+		// Moved down so it's below the big daddy's feet, and lit as one flat dark surface
+		{ "Floor", DirectX::XMFLOAT3(0.0f, -10.35f, 0.0f), true, DirectX::XMFLOAT2(0.5f, 0.0f), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f) },
+
+		// Moved down so the floor is below his feet
+		{ "Big_Daddy", DirectX::XMFLOAT3(0.0f, -10.0f, 0.0f), false, DirectX::XMFLOAT2(0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f) },
+	};
+
+	// FNV-1a
+	uint32_t hashBytes(uint32_t hash, const void *data, size_t size)
+	{
+		const unsigned char *bytes = static_cast<const unsigned char *>(data);
+		for (size_t i = 0; i < size; ++i)
+			hash = (hash ^ bytes[i]) * 16777619u;
+		return hash;
+	}
+}
+
+const MeshRecipe *findMeshRecipe(const char *name)
+{
+	for (const MeshRecipe &recipe : recipes)
+	{
+		if (strcmp(recipe.name, name) == 0)
+			return &recipe;
+	}
+
+	return nullptr;
+}
+
+void applyMeshRecipe(const MeshRecipe &recipe, std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices)
+{
+	applyMeshRecipe(recipe, vertices.data(), vertices.size());
+
+	if (recipe.flatten)
+		weldVertices(vertices, indices, 0.0f);
+}
+
+void applyMeshRecipe(const MeshRecipe &recipe, DX11UWA::VertexPositionUVNormal *vertices, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		DX11UWA::VertexPositionUVNormal &vertex = vertices[i];
+
+		vertex.pos.x += recipe.offset.x;
+		vertex.pos.y += recipe.offset.y;
+		vertex.pos.z += recipe.offset.z;
+
+		if (recipe.flatten)
+		{
+			vertex.uv = recipe.uv;
+			vertex.normal = recipe.normal;
+		}
+	}
+}
+
+uint32_t meshRecipeKey(const MeshRecipe *recipe)
+{
+	if (!recipe)
+		return 0;
+
+	uint32_t hash = 2166136261u;
+	hash = hashBytes(hash, &recipe->offset, sizeof(recipe->offset));
+	if (recipe->flatten)
+	{
+		hash = hashBytes(hash, &recipe->uv, sizeof(recipe->uv));
+		hash = hashBytes(hash, &recipe->normal, sizeof(recipe->normal));
+	}
+	return hash;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Content/ShaderStructures.h"
+
+// How a model from Assets/Models is prepared for the renderer. The asset cooker bakes the recipe into
+// the cooked .rmesh, and the app applies the same one when it has to load the OBJ itself, so both paths
+// end up with the same vertices.
+struct MeshRecipe
+{
+	const char			*name;			// File name without the .obj extension
+	DirectX::XMFLOAT3	offset;			// Added to every position
+	bool				flatten;		// Replaces every uv and normal with the ones below
+	DirectX::XMFLOAT2	uv;				// Already flipped for Direct3D
+	DirectX::XMFLOAT3	normal;
+};
+
+// Recipe for the named model, or nullptr if the model is used as authored.
+const MeshRecipe *findMeshRecipe(const char *name);
+
+// Applies the recipe to a loaded mesh. Flattened meshes are welded again, since most of their
+// vertices only differed by the attributes that were replaced.
+void applyMeshRecipe(const MeshRecipe &recipe, std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices);
+
+// Applies the recipe to vertices without welding them, for meshes that arrive a batch at a time.
+void applyMeshRecipe(const MeshRecipe &recipe, DX11UWA::VertexPositionUVNormal *vertices, size_t count);
+
+// Hash of everything in the recipe that changes the output, 0 without a recipe.
+uint32_t meshRecipeKey(const MeshRecipe *recipe);
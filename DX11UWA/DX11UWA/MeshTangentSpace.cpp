@@ -0,0 +1,326 @@
+#include "pch.h"
+#include "MeshTangentSpace.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+	// Fewer triangles or vertices than this per thread aren't worth starting the thread for
+	const size_t minItemsPerThread = 8192;
+
+	// Triangle orientations in uv space, for generateTangents
+	const uint8_t orientationNone = 0;		// No uv area, takes the orientation of the other triangles at the vertex
+	const uint8_t orientationPositive = 1;
+	const uint8_t orientationNegative = 2;
+
+	inline DirectX::XMFLOAT3 subtract(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b)
+	{
+		return DirectX::XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	inline DirectX::XMFLOAT3 cross(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b)
+	{
+		return DirectX::XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	inline float dot(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline DirectX::XMFLOAT3 scale(const DirectX::XMFLOAT3 &v, float s)
+	{
+		return DirectX::XMFLOAT3(v.x * s, v.y * s, v.z * s);
+	}
+
+	inline void accumulate(DirectX::XMFLOAT3 &sum, const DirectX::XMFLOAT3 &v, float weight)
+	{
+		sum.x += v.x * weight;
+		sum.y += v.y * weight;
+		sum.z += v.z * weight;
+	}
+
+	// Unit length, or zero for degenerate vectors
+	inline DirectX::XMFLOAT3 normalize(const DirectX::XMFLOAT3 &v)
+	{
+		const float length = sqrtf(dot(v, v));
+		return (length > 0.0f) ? DirectX::XMFLOAT3(v.x / length, v.y / length, v.z / length) : DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+
+	// v without its component along the unit vector n
+	inline DirectX::XMFLOAT3 projectOnPlane(const DirectX::XMFLOAT3 &v, const DirectX::XMFLOAT3 &n)
+	{
+		return subtract(v, scale(n, dot(n, v)));
+	}
+
+	// Cosine of the angle between two edges from their dot product and the product of their lengths.
+	// Edges with no length make no angle.
+	inline float edgeCosine(float edgeDot, float lengths)
+	{
+		return (lengths > 0.0f) ? std::min(std::max(edgeDot / lengths, -1.0f), 1.0f) : 1.0f;
+	}
+
+	unsigned int threadsFor(size_t count, unsigned int threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		const size_t useful = std::max<size_t>(1, count / minItemsPerThread);
+		return static_cast<unsigned int>(std::min<size_t>(threadCount, useful));
+	}
+
+	// Cuts count items into threadCount equal spans and runs work(begin, end) on each, the first one on the calling thread
+	template<typename TWork>
+	void runParallel(size_t count, unsigned int threadCount, const TWork &work)
+	{
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount);
+
+		for (unsigned int i = 1; i < threadCount; ++i)
+			threads.emplace_back(work, count * i / threadCount, count * (i + 1) / threadCount);
+
+		work(0, count / threadCount);
+
+		for (std::thread &thread : threads)
+			thread.join();
+	}
+
+	// Items of every key, in order: the ones of key k are items[start[k]] .. items[start[k + 1] - 1]
+	void buildAdjacency(const unsigned int *keys, size_t count, size_t keyCount, std::vector<unsigned int> &start, std::vector<unsigned int> &items)
+	{
+		start.assign(keyCount + 1, 0);
+		for (size_t i = 0; i < count; ++i)
+			start[keys[i] + 1]++;
+		for (size_t k = 0; k < keyCount; ++k)
+			start[k + 1] += start[k];
+
+		std::vector<unsigned int> next(start.begin(), start.end() - 1);
+		items.resize(count);
+		for (size_t i = 0; i < count; ++i)
+			items[next[keys[i]]++] = static_cast<unsigned int>(i);
+	}
+
+	// Per triangle terms of generateNormals
+	struct TriangleNormals
+	{
+		std::vector<DirectX::XMFLOAT3>	weighted;	// Cross product of two edges, as long as twice the area
+		std::vector<DirectX::XMFLOAT3>	unit;		// Zero for triangles with no area
+		std::vector<float>				angles;		// At each corner
+	};
+
+	void triangleNormals(const DirectX::XMFLOAT3 *positions, const unsigned int *indices, size_t begin, size_t end, TriangleNormals &out)
+	{
+		for (size_t t = begin; t < end; ++t)
+		{
+			const DirectX::XMFLOAT3 &p0 = positions[indices[t * 3]];
+			const DirectX::XMFLOAT3 &p1 = positions[indices[t * 3 + 1]];
+			const DirectX::XMFLOAT3 &p2 = positions[indices[t * 3 + 2]];
+			const DirectX::XMFLOAT3 e01 = subtract(p1, p0), e02 = subtract(p2, p0), e12 = subtract(p2, p1);
+
+			const DirectX::XMFLOAT3 weighted = cross(e01, e02);
+			const float length = sqrtf(dot(weighted, weighted));
+			out.weighted[t] = weighted;
+			out.unit[t] = (length > 0.0f) ? DirectX::XMFLOAT3(weighted.x / length, weighted.y / length, weighted.z / length) : DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+			const float l01 = sqrtf(dot(e01, e01)), l02 = sqrtf(dot(e02, e02)), l12 = sqrtf(dot(e12, e12));
+			out.angles[t * 3] = edgeCosine(dot(e01, e02), l01 * l02);
+			out.angles[t * 3 + 1] = edgeCosine(-dot(e01, e12), l01 * l12);
+			out.angles[t * 3 + 2] = edgeCosine(dot(e02, e12), l02 * l12);
+		}
+	}
+
+	// Per triangle terms of generateTangents: the direction of increasing u and the orientation of the uv mapping
+	void triangleTangents(const DX11UWA::VertexPositionUVNormal *vertices, const unsigned int *indices, size_t begin, size_t end,
+		DirectX::XMFLOAT3 *directions, uint8_t *orientations)
+	{
+		for (size_t t = begin; t < end; ++t)
+		{
+			const DX11UWA::VertexPositionUVNormal &v0 = vertices[indices[t * 3]];
+			const DX11UWA::VertexPositionUVNormal &v1 = vertices[indices[t * 3 + 1]];
+			const DX11UWA::VertexPositionUVNormal &v2 = vertices[indices[t * 3 + 2]];
+			const DirectX::XMFLOAT3 d1 = subtract(v1.pos, v0.pos), d2 = subtract(v2.pos, v0.pos);
+			const float t21x = v1.uv.x - v0.uv.x, t21y = v1.uv.y - v0.uv.y;
+			const float t31x = v2.uv.x - v0.uv.x, t31y = v2.uv.y - v0.uv.y;
+
+			// The derivative of the position along u, times the signed uv area
+			const float area = t21x * t31y - t21y * t31x;
+			const DirectX::XMFLOAT3 direction(t31y * d1.x - t21y * d2.x, t31y * d1.y - t21y * d2.y, t31y * d1.z - t21y * d2.z);
+			const float length = sqrtf(dot(direction, direction));
+
+			if (fabsf(area) > FLT_MIN)
+			{
+				const float sign = (area > 0.0f) ? 1.0f : -1.0f;
+				directions[t] = (length > 0.0f) ? scale(direction, sign / length) : DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+				orientations[t] = (area > 0.0f) ? orientationPositive : orientationNegative;
+			}
+			else
+			{
+				directions[t] = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+				orientations[t] = orientationNone;
+			}
+		}
+	}
+
+	// Some unit vector perpendicular to n, for vertices no triangle gives a tangent
+	DirectX::XMFLOAT3 anyPerpendicular(const DirectX::XMFLOAT3 &n)
+	{
+		const DirectX::XMFLOAT3 axis = (fabsf(n.x) < 0.57f) ? DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f) : DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+		const DirectX::XMFLOAT3 perpendicular = normalize(projectOnPlane(axis, n));
+		return (dot(perpendicular, perpendicular) > 0.0f) ? perpendicular : DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+	}
+
+	// Unit tangent from the sum of a vertex's triangles, with the bitangent sign of their orientation
+	DirectX::XMFLOAT4 finishTangent(const DirectX::XMFLOAT3 &sum, const DirectX::XMFLOAT3 &n, bool negative)
+	{
+		DirectX::XMFLOAT3 tangent = normalize(sum);
+		if (dot(tangent, tangent) == 0.0f)
+			tangent = anyPerpendicular(n);
+		return DirectX::XMFLOAT4(tangent.x, tangent.y, tangent.z, negative ? -1.0f : 1.0f);
+	}
+}
+
+void generateNormals(const DirectX::XMFLOAT3 *positions, size_t positionCount, const unsigned int *positionIndices, size_t cornerCount,
+	float creaseAngle, const uint8_t *needed, DirectX::XMFLOAT3 *normals, unsigned int threadCount)
+{
+	const size_t triangleCount = cornerCount / 3;
+
+	TriangleNormals triangles;
+	triangles.weighted.resize(triangleCount);
+	triangles.unit.resize(triangleCount);
+	triangles.angles.resize(triangleCount * 3);
+
+	runParallel(triangleCount, threadsFor(triangleCount, threadCount), [&](size_t begin, size_t end)
+	{
+		triangleNormals(positions, positionIndices, begin, end, triangles);
+
+		for (size_t i = begin * 3; i < end * 3; ++i)
+			triangles.angles[i] = acosf(triangles.angles[i]);
+	});
+
+	std::vector<unsigned int> start, corners;
+	buildAdjacency(positionIndices, triangleCount * 3, positionCount, start, corners);
+
+	const float creaseCosine = cosf(creaseAngle * 3.14159265f / 180.0f);
+
+	runParallel(triangleCount * 3, threadsFor(triangleCount * 3, threadCount), [&](size_t begin, size_t end)
+	{
+		for (size_t corner = begin; corner < end; ++corner)
+		{
+			if (needed && !needed[corner])
+				continue;
+
+			const size_t triangle = corner / 3;
+			const DirectX::XMFLOAT3 &own = triangles.unit[triangle];
+			const bool degenerate = dot(own, own) == 0.0f;
+
+			// In the order of the corners, so corners with the same neighbours add up the same way
+			DirectX::XMFLOAT3 sum(0.0f, 0.0f, 0.0f);
+			const unsigned int position = positionIndices[corner];
+			for (unsigned int a = start[position]; a < start[position + 1]; ++a)
+			{
+				const unsigned int other = corners[a] / 3;
+				if (other != triangle && !degenerate && dot(own, triangles.unit[other]) < creaseCosine)
+					continue;
+				accumulate(sum, triangles.weighted[other], triangles.angles[corners[a]]);
+			}
+
+			normals[corner] = normalize(sum);
+		}
+	});
+
+	// A trailing partial triangle has no normal to give
+	for (size_t corner = triangleCount * 3; corner < cornerCount; ++corner)
+	{
+		if (!needed || needed[corner])
+			normals[corner] = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+}
+
+size_t generateTangents(std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices,
+	std::vector<DirectX::XMFLOAT4> &tangents, unsigned int threadCount)
+{
+	const size_t vertexCount = vertices.size();
+	const size_t triangleCount = indices.size() / 3;
+
+	std::vector<DirectX::XMFLOAT3> directions(triangleCount);
+	std::vector<uint8_t> orientations(triangleCount);
+
+	runParallel(triangleCount, threadsFor(triangleCount, threadCount), [&](size_t begin, size_t end)
+	{
+		triangleTangents(vertices.data(), indices.data(), begin, end, directions.data(), orientations.data());
+	});
+
+	std::vector<unsigned int> start, corners;
+	buildAdjacency(indices.data(), triangleCount * 3, vertexCount, start, corners);
+
+	// The tangent of each vertex's positive and negative triangles. Triangles with no uv area join the negative
+	// ones if those are the only others, the positive ones otherwise.
+	tangents.assign(vertexCount, DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+	std::vector<DirectX::XMFLOAT4> mirrored(vertexCount);
+	std::vector<uint8_t> split(vertexCount, 0);
+
+	runParallel(vertexCount, threadsFor(vertexCount, threadCount), [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			const DirectX::XMFLOAT3 n = normalize(vertices[v].normal);
+			const DirectX::XMFLOAT3 &p = vertices[v].pos;
+
+			DirectX::XMFLOAT3 sums[3] = { DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f) };
+			bool used[3] = { false, false, false };
+
+			for (unsigned int a = start[v]; a < start[v + 1]; ++a)
+			{
+				const unsigned int corner = corners[a];
+				const unsigned int triangle = corner / 3;
+				const unsigned int first = triangle * 3;
+
+				// Angle at the vertex, measured in the plane of its normal
+				const DirectX::XMFLOAT3 toNext = normalize(projectOnPlane(subtract(vertices[indices[first + (corner - first + 1) % 3]].pos, p), n));
+				const DirectX::XMFLOAT3 toPrevious = normalize(projectOnPlane(subtract(vertices[indices[first + (corner - first + 2) % 3]].pos, p), n));
+				const float angle = acosf(std::min(std::max(dot(toNext, toPrevious), -1.0f), 1.0f));
+
+				const uint8_t orientation = orientations[triangle];
+				accumulate(sums[orientation], normalize(projectOnPlane(directions[triangle], n)), angle);
+				used[orientation] = true;
+			}
+
+			const bool positive = used[orientationPositive], negative = used[orientationNegative];
+			const uint8_t shared = (negative && !positive) ? orientationNegative : orientationPositive;
+			sums[shared].x += sums[orientationNone].x;
+			sums[shared].y += sums[orientationNone].y;
+			sums[shared].z += sums[orientationNone].z;
+
+			tangents[v] = finishTangent(sums[shared], n, shared == orientationNegative);
+			if (positive && negative)
+			{
+				mirrored[v] = finishTangent(sums[orientationNegative], n, true);
+				split[v] = 1;
+			}
+		}
+	});
+
+	// The negative triangles of vertices used both ways get a copy of their own
+	size_t copies = 0;
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		if (!split[v])
+			continue;
+
+		const unsigned int copy = static_cast<unsigned int>(vertices.size());
+		vertices.push_back(vertices[v]);
+		tangents.push_back(mirrored[v]);
+		++copies;
+
+		for (unsigned int a = start[v]; a < start[v + 1]; ++a)
+		{
+			if (orientations[corners[a] / 3] == orientationNegative)
+				indices[corners[a]] = copy;
+		}
+	}
+
+	return copies;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Content/ShaderStructures.h"
+
+// Normals for faces that don't have any, and tangent frames for normal mapping. Both do the per triangle work,
+// then gather it per corner or vertex, on threadCount threads (0 uses every core). The results are exactly the
+// same on any number of threads.
+
+// Faces meeting at a sharper angle than this, in degrees, keep separate normals
+const float MESH_DEFAULT_CREASE_ANGLE = 60.0f;
+
+// Smooth normal of the corners of the triangles in positionIndices (three per triangle) that needed is set for,
+// or of every corner if needed is null. A corner's normal is the sum of the normals of the triangles around its
+// position that are within creaseAngle degrees of its own triangle, each weighted by its area and its angle at
+// that position. Corners of triangles with no area take every triangle around them. Corners with nothing to
+// sum get a zero normal. Corners with the same position and the same triangles around them get exactly the same normal.
+void generateNormals(const DirectX::XMFLOAT3 *positions, size_t positionCount, const unsigned int *positionIndices, size_t cornerCount,
+	float creaseAngle, const uint8_t *needed, DirectX::XMFLOAT3 *normals, unsigned int threadCount = 0);
+
+// Tangent of every vertex as MikkTSpace computes it: the direction of increasing u, projected on the vertex
+// normal's plane and summed over the vertex's triangles weighted by their angle at the vertex. w is the sign
+// of the bitangent, which shaders rebuild as w * cross(normal, tangent). The uvs are taken as they are in the
+// vertices, V already flipped. Vertices shared by triangles whose uv mapping is mirrored relative to each other
+// are split like MikkTSpace splits them: the mirrored triangles get a copy appended to vertices and indices
+// is rewritten. Returns the number of copies.
+//
+// MikkTSpace groups triangles by their connectivity around a vertex, this groups them by their orientation at
+// the vertex only, which only gives different results around non-manifold vertices.
+size_t generateTangents(std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices,
+	std::vector<DirectX::XMFLOAT4> &tangents, unsigned int threadCount = 0);
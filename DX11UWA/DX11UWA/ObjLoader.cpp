@@ -1,5 +1,17 @@
 #include "pch.h"
 #include "ObjLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 float Clamp(float _val, float _max, float _min) {
 	if (_min >= _val)
@@ -94,82 +106,1636 @@ DirectX::XMFLOAT3 Vector_Scalar_Multiply(DirectX::XMFLOAT3 v, float s)
 	return x;
 }
 
-bool loadOBJ(const char * path, std::vector<DX11UWA::VertexPositionUVNormal> &out_vertices, std::vector<unsigned int> &out_indices, std::vector<DirectX::XMFLOAT3> &out_normals, std::vector<DirectX::XMFLOAT2> &out_uvs)
+namespace
 {
-	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-	std::vector<DirectX::XMFLOAT3> temp_vertices;
-	std::vector<DirectX::XMFLOAT2> temp_uvs;
-	std::vector<DirectX::XMFLOAT3> temp_normals;
+	// Exact powers of ten representable in a double
+	const double powersOf10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
 
-	std::vector<DX11UWA::VertexPositionUVNormal> vertices;
-	std::vector<DirectX::XMFLOAT3> normals;
-	std::vector<DirectX::XMFLOAT2> uvs;
-	std::vector<unsigned int> indices;
+	// Exact powers of ten representable in a float
+	const float powersOf10f[] =
+	{
+		1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+	};
 
-	FILE * file = fopen(path, "r");
+	// The parsing helpers below never check for the end of the buffer. parseOBJ only hands
+	// them text that ends in '\n' followed by at least 8 readable bytes, which stops every
+	// digit, blank and token loop and lets the digit parser read a whole 8 byte word.
+	const size_t lineSlack = 16;
 
-	if (file == NULL)
+	inline bool isDigit(char c)
 	{
-		printf("Impossible to open the file !\n");
-		return false;
+		return static_cast<unsigned char>(c - '0') < 10;
 	}
 
-	while (true) {
-		char lineHeader[256];
+	// Whitespace inside a line. '\r' is included so CRLF files parse the same.
+	inline bool isBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
 
-		// read the first word of the line
-		int res = fscanf(file, "%s", lineHeader);
+	inline bool isEndOfToken(char c)
+	{
+		return isBlank(c) || c == '\n';
+	}
 
-		if (res == EOF)
-			break;		// End of file. Quit the loop.
+	inline const char *skipBlanks(const char *p)
+	{
+		while (isBlank(*p))
+			++p;
+		return p;
+	}
 
-						// else : parse lineHeader
-		if (strcmp(lineHeader, "v") == 0)
+	inline unsigned int countTrailingZeros(uint64_t value)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return index;
+#elif defined(_MSC_VER)
+		unsigned long index;
+		if (_BitScanForward(&index, static_cast<unsigned long>(value)))
+			return index;
+		_BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+		return index + 32;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	// Reads the run of up to 8 ASCII digits at p in one go. Returns how many digits there
+	// were; 8 means the run may continue. Assumes a little endian target like all of ours.
+	inline unsigned int parseDigits8(const char *p, uint32_t &value)
+	{
+		uint64_t chunk;
+		memcpy(&chunk, p, sizeof(chunk));
+
+		// Every byte that isn't '0'..'9' ends up with its top bit set
+		const uint64_t digits = chunk - 0x3030303030303030ull;
+		const uint64_t nonDigits = (digits | (digits + 0x7676767676767676ull)) & 0x8080808080808080ull;
+		const unsigned int count = nonDigits ? (countTrailingZeros(nonDigits) >> 3) : 8;
+
+		if (count == 0)
 		{
-			DirectX::XMFLOAT3 vertex;
+			value = 0;
+			return 0;
+		}
 
-			fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
-			temp_vertices.push_back(vertex);
+		// Drop the bytes past the run, leaving leading zeros, then combine pairs, quads and octets
+		uint64_t v = digits << (8 * (8 - count));
+		v = (v * 10 + (v >> 8)) & 0x00FF00FF00FF00FFull;
+		v = (v * 100 + (v >> 16)) & 0x0000FFFF0000FFFFull;
+		v = (v * 10000 + (v >> 32)) & 0x00000000FFFFFFFFull;
+
+		value = static_cast<uint32_t>(v);
+		return count;
+	}
+
+	float scaleMantissa(uint64_t mantissa, int exponent)
+	{
+		// When both the mantissa and the power of ten are exact floats a single float
+		// operation is correctly rounded. That covers the fixed point numbers exporters write.
+		if (mantissa < (1u << 24) && exponent >= -10 && exponent <= 0)
+			return static_cast<float>(mantissa) / powersOf10f[-exponent];
+
+		double value = static_cast<double>(mantissa);
+		if (exponent < 0)
+			value = (exponent >= -22) ? value / powersOf10[-exponent] : value * pow(10.0, exponent);
+		else if (exponent > 0)
+			value = (exponent <= 22) ? value * powersOf10[exponent] : value * pow(10.0, exponent);
+
+		return static_cast<float>(value);
+	}
+
+	// Parses an optional "e-3" style exponent
+	inline const char *parseExponent(const char *p, int &exponent)
+	{
+		if (*p != 'e' && *p != 'E')
+			return p;
+
+		const char *q = p + 1;
+		bool negative = false;
+		if (*q == '-' || *q == '+')
+		{
+			negative = (*q == '-');
+			++q;
 		}
-		else if (strcmp(lineHeader, "vt") == 0)
+
+		if (!isDigit(*q))
+			return p;
+
+		int value = 0;
+		for (; isDigit(*q); ++q)
 		{
-			DirectX::XMFLOAT2 uv;
+			if (value < 10000)
+				value = value * 10 + (*q - '0');
+		}
 
-			fscanf(file, "%f %f\n", &uv.x, &uv.y);
-			temp_uvs.push_back(uv);
+		exponent += negative ? -value : value;
+		return q;
+	}
+
+	// Digit at a time fallback for numbers with runs of 8 digits or more
+	const char *parseLongFloat(const char *p, bool negative, float &out)
+	{
+		// Up to 19 significant digits fit in the mantissa, the rest only move the exponent
+		const uint64_t mantissaLimit = 1000000000000000000ull;
+		uint64_t mantissa = 0;
+		int exponent = 0;
+
+		for (; isDigit(*p); ++p)
+		{
+			if (mantissa < mantissaLimit)
+				mantissa = mantissa * 10 + (*p - '0');
+			else
+				++exponent;
 		}
-		else if (strcmp(lineHeader, "vn") == 0)
+
+		if (*p == '.')
 		{
-			DirectX::XMFLOAT3 normal;
+			for (++p; isDigit(*p); ++p)
+			{
+				if (mantissa < mantissaLimit)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					--exponent;
+				}
+			}
+		}
 
-			fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-			temp_normals.push_back(normal);
+		p = parseExponent(p, exponent);
+
+		const float value = scaleMantissa(mantissa, exponent);
+		out = negative ? -value : value;
+		return p;
+	}
+
+	// Parses a decimal number such as "-0.090400" or "1.5e-3". Returns nullptr if there is none.
+	const char *parseFloat(const char *p, float &out)
+	{
+		static const uint32_t scales[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+
+		p = skipBlanks(p);
+
+		// Signs are close to random in vertex data, so keep them off the branch predictor
+		const bool negative = (*p == '-');
+		p += (negative || *p == '+');
+
+		uint32_t integerPart, fractionPart = 0;
+		unsigned int integerDigits = parseDigits8(p, integerPart);
+		unsigned int fractionDigits = 0;
+
+		if (integerDigits == 8)
+			return parseLongFloat(p, negative, out);
+
+		const char *q = p + integerDigits;
+		if (*q == '.')
+		{
+			fractionDigits = parseDigits8(q + 1, fractionPart);
+			if (fractionDigits == 8)
+				return parseLongFloat(p, negative, out);
+			q += 1 + fractionDigits;
 		}
-		else if (strcmp(lineHeader, "f") == 0)
+
+		if (integerDigits + fractionDigits == 0)
+			return nullptr;
+
+		int exponent = -static_cast<int>(fractionDigits);
+		q = parseExponent(q, exponent);
+
+		const uint64_t mantissa = static_cast<uint64_t>(integerPart) * scales[fractionDigits] + fractionPart;
+		const float value = scaleMantissa(mantissa, exponent);
+		out = negative ? -value : value;
+		return q;
+	}
+
+	const char *parseInt(const char *p, int &out)
+	{
+		bool negative = false;
+		if (*p == '-' || *p == '+')
 		{
-			std::string vertex1, vertex2, vertex3;
-			unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-			int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &vertexIndex[0], &uvIndex[0], &normalIndex[0],
-				&vertexIndex[1], &uvIndex[1], &normalIndex[1],
-				&vertexIndex[2], &uvIndex[2], &normalIndex[2]);
+			negative = (*p == '-');
+			++p;
+		}
 
-			if (matches != 9)
+		uint32_t value;
+		unsigned int count = parseDigits8(p, value);
+		if (count == 0)
+			return nullptr;
+
+		for (p += count; isDigit(*p); ++p)
+			value = value * 10 + (*p - '0');
+
+		out = negative ? -static_cast<int>(value) : static_cast<int>(value);
+		return p;
+	}
+
+	// Marks which attributes of a corner used a negative index, counting back from the end
+	// of the attributes read so far
+	enum RelativeAttribute
+	{
+		RelativePosition = 1,
+		RelativeUV = 2,
+		RelativeNormal = 4
+	};
+
+	// A corner whose relative indices were resolved against its own chunk only. They still
+	// need the number of attributes read in the chunks before it added on.
+	struct RelativeCorner
+	{
+		size_t			corner;
+		unsigned int	attributes;
+	};
+
+	// Parser output for one newline aligned span of the file
+	struct ObjChunk
+	{
+		ObjParseData				*data;
+		std::vector<RelativeCorner>	relative;
+		std::vector<ObjGroupRecord>	records;
+	};
+
+	// OBJ indices are 1-based, or negative to count back from the last element read so far.
+	// Positive indices are only range checked once the whole file is parsed, and relative ones
+	// once the chunk's offsets are known.
+	inline bool resolveIndex(int index, size_t count, int &out, unsigned int attribute, unsigned int &relative)
+	{
+		if (index > 0)
+			out = index - 1;
+		else if (index < 0)
+		{
+			out = static_cast<int>(count) + index;
+			relative |= attribute;
+		}
+		else
+			return false;
+
+		return true;
+	}
+
+	// Parses one "v/vt/vn" face corner. The uv and normal parts are optional ("v", "v/vt", "v//vn"),
+	// and anything after a third slash (e.g. the bone weight index in our exports) is ignored.
+	const char *parseCorner(const char *p, const ObjParseData &data, ObjCorner &corner, unsigned int &relative)
+	{
+		int index;
+
+		corner.uv = -1;
+		corner.normal = -1;
+		relative = 0;
+
+		p = parseInt(p, index);
+		if (!p || !resolveIndex(index, data.positions.size(), corner.position, RelativePosition, relative))
+			return nullptr;
+
+		if (*p == '/')
+		{
+			++p;
+			if (*p != '/' && !isEndOfToken(*p))
 			{
-				printf("File can't be read by our simple parser: (Try exporting with other options)\n");
+				p = parseInt(p, index);
+				if (!p || !resolveIndex(index, data.uvs.size(), corner.uv, RelativeUV, relative))
+					return nullptr;
 			}
 
-			vertexIndices.push_back(vertexIndex[0]);
-			vertexIndices.push_back(vertexIndex[1]);
-			vertexIndices.push_back(vertexIndex[2]);
-			uvIndices.push_back(uvIndex[0]);
-			uvIndices.push_back(uvIndex[1]);
-			uvIndices.push_back(uvIndex[2]);
-			normalIndices.push_back(normalIndex[0]);
-			normalIndices.push_back(normalIndex[1]);
-			normalIndices.push_back(normalIndex[2]);
+			if (*p == '/')
+			{
+				p = parseInt(p + 1, index);
+				if (!p || !resolveIndex(index, data.normals.size(), corner.normal, RelativeNormal, relative))
+					return nullptr;
+			}
+		}
+
+		// Skip any extra components
+		while (!isEndOfToken(*p))
+			++p;
+
+		return p;
+	}
+
+	inline void pushCorner(ObjChunk &chunk, const ObjCorner &corner, unsigned int relative)
+	{
+		if (relative)
+		{
+			RelativeCorner entry = { chunk.data->corners.size(), relative };
+			chunk.relative.push_back(entry);
+		}
+
+		chunk.data->corners.push_back(corner);
+	}
+
+	const char *parseFace(const char *p, ObjChunk &chunk)
+	{
+		ObjCorner first, previous, corner;
+		unsigned int firstRelative = 0, previousRelative = 0, relative;
+		unsigned int count = 0;
+
+		for (;;)
+		{
+			p = skipBlanks(p);
+			if (*p == '\n' || *p == '#')
+				break;
+
+			p = parseCorner(p, *chunk.data, corner, relative);
+			if (!p)
+				return nullptr;
+
+			// Triangulate polygons as a fan around the first corner
+			if (count == 0)
+			{
+				first = corner;
+				firstRelative = relative;
+			}
+			else if (count >= 2)
+			{
+				pushCorner(chunk, first, firstRelative);
+				pushCorner(chunk, previous, previousRelative);
+				pushCorner(chunk, corner, relative);
+			}
+
+			previous = corner;
+			previousRelative = relative;
+			++count;
+		}
+
+		return (count >= 3) ? p : nullptr;
+	}
+
+	// Reads the rest of the line as the name of an o, g, usemtl or mtllib record, without the blanks around it
+	const char *parseGroupRecord(const char *p, ObjGroupRecordKind kind, ObjChunk &chunk)
+	{
+		p = skipBlanks(p);
+
+		const char *end = p;
+		while (*end != '\n')
+			++end;
+
+		const char *last = end;
+		while (last > p && isBlank(last[-1]))
+			--last;
+
+		ObjGroupRecord record = { chunk.data->corners.size(), kind, std::string(p, last) };
+		chunk.records.push_back(std::move(record));
+		return end;
+	}
+
+	// Parses every line in [p, end). The text must end with '\n', and have lineSlack bytes after end.
+	bool parseLines(const char *p, const char *end, ObjChunk &chunk)
+	{
+		ObjParseData &out = *chunk.data;
+
+		while (p < end)
+		{
+			p = skipBlanks(p);
+
+			if (p[0] == 'v' && isBlank(p[1]))
+			{
+				DirectX::XMFLOAT3 position;
+				if (!(p = parseFloat(p + 1, position.x)) || !(p = parseFloat(p, position.y)) || !(p = parseFloat(p, position.z)))
+					return false;
+				out.positions.push_back(position);
+			}
+			else if (p[0] == 'v' && p[1] == 't' && isBlank(p[2]))
+			{
+				DirectX::XMFLOAT2 uv;
+				if (!(p = parseFloat(p + 2, uv.x)) || !(p = parseFloat(p, uv.y)))
+					return false;
+				out.uvs.push_back(uv);
+			}
+			else if (p[0] == 'v' && p[1] == 'n' && isBlank(p[2]))
+			{
+				DirectX::XMFLOAT3 normal;
+				if (!(p = parseFloat(p + 2, normal.x)) || !(p = parseFloat(p, normal.y)) || !(p = parseFloat(p, normal.z)))
+					return false;
+				out.normals.push_back(normal);
+			}
+			else if (p[0] == 'f' && isBlank(p[1]))
+			{
+				if (!(p = parseFace(p + 1, chunk)))
+					return false;
+			}
+			else if ((p[0] == 'o' || p[0] == 'g') && isBlank(p[1]))
+				p = parseGroupRecord(p + 1, ObjRecordObject, chunk);
+			else if (memcmp(p, "usemtl", 6) == 0 && isBlank(p[6]))
+				p = parseGroupRecord(p + 6, ObjRecordMaterial, chunk);
+			else if (memcmp(p, "mtllib", 6) == 0 && isBlank(p[6]))
+				p = parseGroupRecord(p + 6, ObjRecordLibrary, chunk);
+
+			// Parsed records usually stop right at the newline. Everything else (comments,
+			// smoothing groups, bone weights...) is skipped.
+			if (*p != '\n')
+				p = static_cast<const char *>(memchr(p, '\n', end - p));
+			++p;
+		}
+
+		return true;
+	}
+
+	// Parses the lines in [begin, end). The span starts on a line boundary and ends on one,
+	// or at bufferEnd. Lines with enough bytes after them are parsed straight out of the
+	// caller's buffer, the last few are copied and padded like the rest.
+	bool parseSpan(const char *begin, const char *end, const char *bufferEnd, ObjChunk &chunk)
+	{
+		const char *direct = end;
+
+		if (static_cast<size_t>(bufferEnd - end) < lineSlack)
+		{
+			direct = (static_cast<size_t>(bufferEnd - begin) > lineSlack) ? bufferEnd - lineSlack : begin;
+			while (direct > begin && direct[-1] != '\n')
+				--direct;
+		}
+
+		if (!parseLines(begin, direct, chunk))
+			return false;
+
+		if (direct < end)
+		{
+			std::vector<char> lastLines(direct, end);
+			lastLines.push_back('\n');
+
+			const size_t length = lastLines.size();
+			lastLines.resize(length + lineSlack, '\n');
+
+			if (!parseLines(lastLines.data(), lastLines.data() + length, chunk))
+				return false;
+		}
+
+		return true;
+	}
+
+	// Adds the chunk's starting offsets to the relative indices of corners copied to dest
+	bool rebaseRelativeCorners(const ObjChunk &chunk, ObjCorner *dest, int positionBase, int uvBase, int normalBase)
+	{
+		for (const RelativeCorner &entry : chunk.relative)
+		{
+			ObjCorner &corner = dest[entry.corner];
+
+			if (entry.attributes & RelativePosition)
+				corner.position += positionBase;
+			if (entry.attributes & RelativeUV)
+				corner.uv += uvBase;
+			if (entry.attributes & RelativeNormal)
+				corner.normal += normalBase;
+
+			// Counted back past the start of the file
+			if (corner.position < 0 || ((entry.attributes & RelativeUV) && corner.uv < 0) || ((entry.attributes & RelativeNormal) && corner.normal < 0))
+				return false;
+		}
+
+		return true;
+	}
+
+	bool validateIndices(const ObjCorner *corners, size_t count, const ObjParseData &data)
+	{
+		const int positionCount = static_cast<int>(data.positions.size());
+		const int uvCount = static_cast<int>(data.uvs.size());
+		const int normalCount = static_cast<int>(data.normals.size());
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const ObjCorner &corner = corners[i];
+			if (corner.position >= positionCount || corner.uv >= uvCount || corner.normal >= normalCount)
+				return false;
+		}
+
+		return true;
+	}
+
+	// Records in a span of OBJ text, counted by scanOBJ
+	struct ObjCounts
+	{
+		size_t		positionCount;
+		size_t		uvCount;
+		size_t		normalCount;
+		size_t		cornerCount;	// Triangle corners the faces fan out to
+		size_t		recordCount;	// o, g, usemtl and mtllib records
+
+		// Of every position, only found if asked for
+		DirectX::XMFLOAT3	boundsMin;
+		DirectX::XMFLOAT3	boundsMax;
+	};
+
+	// Counts the records in [p, end) without parsing any numbers, so the arrays can be sized before they're
+	// filled, unless boundPositions asks for the positions to be parsed for their bounds. Unlike the parser
+	// this checks for the end of the text itself.
+	void scanOBJ(const char *p, const char *end, ObjCounts &counts, bool boundPositions = false)
+	{
+		counts.positionCount = 0;
+		counts.uvCount = 0;
+		counts.normalCount = 0;
+		counts.cornerCount = 0;
+		counts.recordCount = 0;
+		counts.boundsMin = DirectX::XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		counts.boundsMax = DirectX::XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		while (p < end)
+		{
+			while (p < end && isBlank(*p))
+				++p;
+
+			const char *lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+			lineEnd = lineEnd ? lineEnd + 1 : end;
+
+			if (end - p >= 2 && p[0] == 'v' && isBlank(p[1]))
+			{
+				++counts.positionCount;
+				if (boundPositions)
+				{
+					// Parsed where it is when there's lineSlack after it, from a padded copy at the end of the text.
+					// A malformed position is left to the parser to report.
+					std::string lastLine;
+					const char *line = p;
+					if (static_cast<size_t>(end - lineEnd) < lineSlack)
+					{
+						lastLine.assign(p, lineEnd);
+						lastLine.append(lineSlack + 1, '\n');
+						line = lastLine.c_str();
+					}
+
+					DirectX::XMFLOAT3 position;
+					const char *q = line + 1;
+					if ((q = parseFloat(q, position.x)) && (q = parseFloat(q, position.y)) && (q = parseFloat(q, position.z)))
+					{
+						counts.boundsMin = DirectX::XMFLOAT3(std::min<float>(counts.boundsMin.x, position.x), std::min<float>(counts.boundsMin.y, position.y), std::min<float>(counts.boundsMin.z, position.z));
+						counts.boundsMax = DirectX::XMFLOAT3(std::max<float>(counts.boundsMax.x, position.x), std::max<float>(counts.boundsMax.y, position.y), std::max<float>(counts.boundsMax.z, position.z));
+					}
+				}
+			}
+			else if (end - p >= 3 && p[0] == 'v' && p[1] == 't' && isBlank(p[2]))
+				++counts.uvCount;
+			else if (end - p >= 3 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2]))
+				++counts.normalCount;
+			else if (end - p >= 2 && p[0] == 'f' && isBlank(p[1]))
+			{
+				// One corner per token, up to a comment
+				size_t count = 0;
+				for (const char *q = p + 1; q < lineEnd && *q != '\n' && *q != '#';)
+				{
+					if (isBlank(*q))
+					{
+						++q;
+						continue;
+					}
+
+					++count;
+					while (q < lineEnd && !isEndOfToken(*q))
+						++q;
+				}
+
+				if (count >= 3)
+					counts.cornerCount += 3 * (count - 2);
+			}
+			else if ((end - p >= 2 && (p[0] == 'o' || p[0] == 'g') && isBlank(p[1])) ||
+				(end - p >= 7 && (memcmp(p, "usemtl", 6) == 0 || memcmp(p, "mtllib", 6) == 0) && isBlank(p[6])))
+				++counts.recordCount;
+
+			p = lineEnd;
+		}
+	}
+
+	// Makes room in the chunk for the records in [begin, end), so parsing them never grows the arrays
+	void reserveRecords(const char *begin, const char *end, ObjChunk &chunk)
+	{
+		ObjCounts counts;
+		scanOBJ(begin, end, counts);
+
+		ObjParseData &data = *chunk.data;
+		data.positions.reserve(data.positions.size() + counts.positionCount);
+		data.uvs.reserve(data.uvs.size() + counts.uvCount);
+		data.normals.reserve(data.normals.size() + counts.normalCount);
+		data.corners.reserve(data.corners.size() + counts.cornerCount);
+		chunk.records.reserve(chunk.records.size() + counts.recordCount);
+	}
+
+	// Runs work(0) .. work(count - 1) with one thread each, work(0) on the calling thread
+	template<typename TWork>
+	void runParallel(unsigned int count, const TWork &work)
+	{
+		std::vector<std::thread> threads;
+		threads.reserve(count);
+
+		for (unsigned int i = 1; i < count; ++i)
+			threads.emplace_back(work, i);
+
+		work(0);
+
+		for (std::thread &thread : threads)
+			thread.join();
+	}
+
+	template<typename T>
+	void copyInto(std::vector<T> &dest, size_t offset, const std::vector<T> &source)
+	{
+		if (!source.empty())
+			memcpy(&dest[offset], source.data(), source.size() * sizeof(T));
+	}
+
+	const unsigned int emptySlot = 0xffffffffu;
+
+	// Power of two table size that keeps the load factor at or below one half
+	size_t hashTableSize(size_t count)
+	{
+		size_t size = 16;
+		while (size < count * 2)
+			size *= 2;
+		return size;
+	}
+
+	// 64 bit finalizer from MurmurHash3
+	inline uint64_t mixHash(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	// Linear probing. Returns the slot of the entry that equal() accepts, or the empty slot where it belongs.
+	template<typename TEqual>
+	unsigned int &findSlot(std::vector<unsigned int> &table, uint64_t hash, const TEqual &equal)
+	{
+		const size_t mask = table.size() - 1;
+
+		for (size_t i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask)
+		{
+			unsigned int &slot = table[i];
+			if (slot == emptySlot || equal(slot))
+				return slot;
 		}
 	}
 
+	inline uint64_t hashCorner(const ObjCorner &corner)
+	{
+		uint64_t key = static_cast<uint32_t>(corner.position) | (static_cast<uint64_t>(static_cast<uint32_t>(corner.uv)) << 32);
+		return mixHash(key ^ mixHash(static_cast<uint32_t>(corner.normal)));
+	}
+
+	// FNV-1a over the name's bytes
+	inline uint64_t hashName(const std::string &name)
+	{
+		uint64_t h = 0xcbf29ce484222325ULL;
+		for (char c : name)
+			h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+		return h;
+	}
+
+	// Turns the group records of the whole file, in order and with their corners counted from the start of
+	// the file, into out's groups. Records that change nothing or are followed by no faces leave no group.
+	// The names are moved out of the records, only the library name is copied into each material.
+	void resolveGroups(std::vector<ObjGroupRecord> &records, ObjParseData &out)
+	{
+		out.groups.clear();
+		out.objects.clear();
+		out.materials.clear();
+
+		// Every record adds at most one of each
+		out.groups.reserve(records.size() + 1);
+		out.objects.reserve(records.size());
+		out.materials.reserve(records.size());
+
+		// Files without records don't need the tables
+		const size_t tableSize = records.empty() ? 0 : hashTableSize(records.size());
+		std::vector<unsigned int> objectTable(tableSize, emptySlot), materialTable(tableSize, emptySlot);
+		const std::string *library = nullptr;
+		const std::string noLibrary;
+
+		ObjGroup current = { 0, -1, -1 };
+		out.groups.push_back(current);
+
+		for (ObjGroupRecord &record : records)
+		{
+			if (record.kind == ObjRecordLibrary)
+			{
+				library = &record.name;
+				continue;
+			}
+
+			if (record.kind == ObjRecordObject)
+			{
+				unsigned int &slot = findSlot(objectTable, mixHash(hashName(record.name)), [&](unsigned int object)
+				{
+					return out.objects[object] == record.name;
+				});
+
+				if (slot == emptySlot)
+				{
+					slot = static_cast<unsigned int>(out.objects.size());
+					out.objects.push_back(std::move(record.name));
+				}
+				current.object = static_cast<int>(slot);
+			}
+			else
+			{
+				const std::string &materialLibrary = library ? *library : noLibrary;
+				unsigned int &slot = findSlot(materialTable, mixHash(hashName(record.name) ^ mixHash(hashName(materialLibrary))), [&](unsigned int material)
+				{
+					return out.materials[material].name == record.name && out.materials[material].library == materialLibrary;
+				});
+
+				if (slot == emptySlot)
+				{
+					slot = static_cast<unsigned int>(out.materials.size());
+					out.materials.push_back(ObjMaterialName());
+					out.materials.back().name = std::move(record.name);
+					out.materials.back().library = materialLibrary;
+				}
+				current.material = static_cast<int>(slot);
+			}
+
+			current.cornerStart = record.corner;
+
+			// Records with no faces between them only change the group that's about to start
+			ObjGroup &last = out.groups.back();
+			if (last.cornerStart == current.cornerStart)
+			{
+				last = current;
+				if (out.groups.size() > 1 && out.groups[out.groups.size() - 2].object == current.object && out.groups[out.groups.size() - 2].material == current.material)
+					out.groups.pop_back();
+			}
+			else if (last.object != current.object || last.material != current.material)
+				out.groups.push_back(current);
+		}
+
+		while (!out.groups.empty() && out.groups.back().cornerStart >= out.corners.size())
+			out.groups.pop_back();
+	}
+
+	// Doubles the size of a weld table over unique and inserts every vertex again. unique gets room for as
+	// many vertices as the table can take, so the two grow together.
+	void growCornerTable(std::vector<unsigned int> &table, std::vector<ObjCorner> &unique)
+	{
+		table.assign(table.size() * 2, emptySlot);
+		unique.reserve(table.size() / 2);
+
+		for (size_t vertex = 0; vertex < unique.size(); ++vertex)
+		{
+			findSlot(table, hashCorner(unique[vertex]), [](unsigned int)
+			{
+				return false;
+			}) = static_cast<unsigned int>(vertex);
+		}
+	}
+
+	// Gives each distinct index triple one vertex. indices[i] is the vertex of corner i, and unique holds
+	// the triple of every vertex in order of first use.
+	void weldCornerIndices(const std::vector<ObjCorner> &corners, std::vector<unsigned int> &indices, std::vector<ObjCorner> &unique)
+	{
+		// Meshes have several corners per vertex, so the table starts out smaller than the corner count would
+		// need and grows with the vertices
+		std::vector<unsigned int> table(hashTableSize(corners.size() / 4), emptySlot);
+
+		indices.resize(corners.size());
+		unique.clear();
+		unique.reserve(table.size() / 2);
+
+		for (size_t i = 0; i < corners.size(); ++i)
+		{
+			const ObjCorner &corner = corners[i];
+			unsigned int &slot = findSlot(table, hashCorner(corner), [&](unsigned int vertex)
+			{
+				const ObjCorner &other = unique[vertex];
+				return other.position == corner.position && other.uv == corner.uv && other.normal == corner.normal;
+			});
+
+			unsigned int vertex = slot;
+			if (vertex == emptySlot)
+			{
+				vertex = slot = static_cast<unsigned int>(unique.size());
+				unique.push_back(corner);
+
+				if (unique.size() * 2 > table.size())
+					growCornerTable(table, unique);
+			}
+
+			indices[i] = vertex;
+		}
+	}
+
+	const size_t vertexFloatCount = sizeof(DX11UWA::VertexPositionUVNormal) / sizeof(float);
+
+	inline const float *vertexFloats(const DX11UWA::VertexPositionUVNormal &vertex)
+	{
+		return &vertex.pos.x;
+	}
+
+	// Bit pattern of value, with -0 folded into +0 so the two compare equal
+	inline uint32_t floatBits(float value)
+	{
+		uint32_t bits;
+		value += 0.0f;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	inline uint64_t hashVertexBits(const DX11UWA::VertexPositionUVNormal &vertex)
+	{
+		const float *values = vertexFloats(vertex);
+
+		uint64_t hash = 0;
+		for (size_t i = 0; i < vertexFloatCount; ++i)
+			hash = mixHash(hash ^ floatBits(values[i]));
+		return hash;
+	}
+
+	inline bool withinEpsilon(const DX11UWA::VertexPositionUVNormal &a, const DX11UWA::VertexPositionUVNormal &b, float epsilon)
+	{
+		const float *x = vertexFloats(a);
+		const float *y = vertexFloats(b);
+
+		for (size_t i = 0; i < vertexFloatCount; ++i)
+		{
+			if (!(fabsf(x[i] - y[i]) <= epsilon))
+				return false;
+		}
+
+		return true;
+	}
+
+	struct WeldCell
+	{
+		int64_t x, y, z;
+	};
+
+	inline uint64_t hashCell(const WeldCell &cell)
+	{
+		return mixHash(static_cast<uint64_t>(cell.x) ^ mixHash(static_cast<uint64_t>(cell.y) ^ mixHash(static_cast<uint64_t>(cell.z))));
+	}
+
+	inline int64_t cellCoordinate(float value, float cellSize)
+	{
+		const double cell = floor(static_cast<double>(value) / cellSize);
+		return static_cast<int64_t>(std::max(-4.0e18, std::min(4.0e18, cell)));
+	}
+
+	// Maps every vertex to the first earlier vertex it can be welded to. Returns the vertex count after welding.
+	// remap[i] is the new index of vertex i, and kept[j] the original index of new vertex j (kept is ascending).
+	size_t weldRemap(const DX11UWA::VertexPositionUVNormal *vertices, size_t vertexCount, float epsilon, std::vector<unsigned int> &remap, std::vector<unsigned int> &kept)
+	{
+		remap.resize(vertexCount);
+		kept.clear();
+
+		if (epsilon <= 0.0f)
+		{
+			// Exact values only, so equal vertices hash alike
+			std::vector<unsigned int> table(hashTableSize(vertexCount), emptySlot);
+
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				unsigned int &slot = findSlot(table, hashVertexBits(vertices[i]), [&](unsigned int vertex)
+				{
+					return withinEpsilon(vertices[kept[vertex]], vertices[i], 0.0f);
+				});
+
+				if (slot == emptySlot)
+				{
+					slot = static_cast<unsigned int>(kept.size());
+					kept.push_back(static_cast<unsigned int>(i));
+				}
+
+				remap[i] = slot;
+			}
+
+			return kept.size();
+		}
+
+		// Kept vertices are bucketed by position in a grid of epsilon sized cells, so any vertex within epsilon
+		// of a kept one is in the same or a neighbouring cell. The table holds the first kept vertex of each cell,
+		// the rest of the cell are chained through next, and tail has the last of the cell of each first one.
+		std::vector<unsigned int> table(hashTableSize(vertexCount), emptySlot);
+		std::vector<WeldCell> cells;
+		std::vector<unsigned int> next, tail;
+
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			const DX11UWA::VertexPositionUVNormal &vertex = vertices[i];
+			const WeldCell cell = { cellCoordinate(vertex.pos.x, epsilon), cellCoordinate(vertex.pos.y, epsilon), cellCoordinate(vertex.pos.z, epsilon) };
+
+			unsigned int match = emptySlot;
+
+			for (int dz = -1; dz <= 1 && match == emptySlot; ++dz)
+			{
+				for (int dy = -1; dy <= 1 && match == emptySlot; ++dy)
+				{
+					for (int dx = -1; dx <= 1 && match == emptySlot; ++dx)
+					{
+						const WeldCell neighbour = { cell.x + dx, cell.y + dy, cell.z + dz };
+						unsigned int head = findSlot(table, hashCell(neighbour), [&](unsigned int other)
+						{
+							return cells[other].x == neighbour.x && cells[other].y == neighbour.y && cells[other].z == neighbour.z;
+						});
+
+						for (unsigned int other = head; other != emptySlot; other = next[other])
+						{
+							if (withinEpsilon(vertices[kept[other]], vertex, epsilon))
+							{
+								match = other;
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			if (match == emptySlot)
+			{
+				match = static_cast<unsigned int>(kept.size());
+				kept.push_back(static_cast<unsigned int>(i));
+				cells.push_back(cell);
+
+				unsigned int &head = findSlot(table, hashCell(cell), [&](unsigned int other)
+				{
+					return cells[other].x == cell.x && cells[other].y == cell.y && cells[other].z == cell.z;
+				});
+
+				// Appending to the end of the chain keeps earlier vertices first
+				next.push_back(emptySlot);
+				tail.push_back(match);
+				if (head == emptySlot)
+					head = match;
+				else
+				{
+					next[tail[head]] = match;
+					tail[head] = match;
+				}
+			}
+
+			remap[i] = match;
+		}
+
+		return kept.size();
+	}
+
+	// A generated normal, by the position it's at and its bits, so equal ones sort next to each other
+	struct GeneratedNormal
+	{
+		int			position;
+		uint32_t	bits[3];
+		size_t		corner;
+
+		bool operator<(const GeneratedNormal &other) const
+		{
+			if (position != other.position)
+				return position < other.position;
+			return memcmp(bits, other.bits, sizeof(bits)) < 0;
+		}
+
+		bool SameAs(const GeneratedNormal &other) const
+		{
+			return position == other.position && memcmp(bits, other.bits, sizeof(bits)) == 0;
+		}
+	};
+
+	// Points every corner without a normal at a generated one. Corners that get the same normal at the same
+	// position share one new entry of data.normals, so they still weld into one vertex. Returns how many corners
+	// had none.
+	size_t generateMissingNormals(ObjParseData &data, float creaseAngle, unsigned int threadCount)
+	{
+		const size_t cornerCount = data.corners.size();
+		std::vector<unsigned int> positions(cornerCount);
+		std::vector<uint8_t> needed(cornerCount);
+		size_t missing = 0;
+
+		for (size_t i = 0; i < cornerCount; ++i)
+		{
+			positions[i] = static_cast<unsigned int>(data.corners[i].position);
+			needed[i] = (data.corners[i].normal < 0) ? 1 : 0;
+			missing += needed[i];
+		}
+
+		if (missing == 0)
+			return 0;
+
+		std::vector<DirectX::XMFLOAT3> normals(cornerCount);
+		generateNormals(data.positions.data(), data.positions.size(), positions.data(), cornerCount, creaseAngle, needed.data(), normals.data(), threadCount);
+
+		std::vector<GeneratedNormal> generated;
+		generated.reserve(missing);
+		for (size_t i = 0; i < cornerCount; ++i)
+		{
+			if (!needed[i])
+				continue;
+
+			GeneratedNormal normal = { data.corners[i].position, {}, i };
+			memcpy(normal.bits, &normals[i], sizeof(normal.bits));
+			generated.push_back(normal);
+		}
+
+		// Stable, so the new normals come out in the same order every time
+		std::stable_sort(generated.begin(), generated.end());
+
+		for (size_t i = 0; i < generated.size(); ++i)
+		{
+			if (i == 0 || !generated[i].SameAs(generated[i - 1]))
+				data.normals.push_back(normals[generated[i].corner]);
+			data.corners[generated[i].corner].normal = static_cast<int>(data.normals.size() - 1);
+		}
+
+		return missing;
+	}
+
+	// One submesh per group, in file order. indices must still be in corner order. The names are moved out of data.
+	void makeSubmeshes(ObjParseData &data, size_t cornerCount, ObjMeshGroups &out)
+	{
+		out.submeshes.clear();
+		out.submeshes.reserve(data.groups.size());
+		out.objects = std::move(data.objects);
+		out.materials = std::move(data.materials);
+
+		int defaultMaterial = -1;
+		for (size_t i = 0; i < data.groups.size(); ++i)
+		{
+			const ObjGroup &group = data.groups[i];
+			const size_t end = (i + 1 < data.groups.size()) ? data.groups[i + 1].cornerStart : cornerCount;
+
+			if (group.material < 0 && defaultMaterial < 0)
+			{
+				defaultMaterial = static_cast<int>(out.materials.size());
+				out.materials.push_back(ObjMaterialName());
+			}
+
+			ObjSubmesh submesh = { static_cast<uint32_t>(group.cornerStart), static_cast<uint32_t>(end - group.cornerStart),
+				static_cast<uint32_t>((group.material >= 0) ? group.material : defaultMaterial), group.object };
+			out.submeshes.push_back(submesh);
+		}
+	}
+
+	// Runs the vertex cache and overdraw passes over the triangles of one submesh, on a compact copy of the
+	// vertices they use so the cost doesn't depend on the size of the whole mesh. local has to hold
+	// emptySlot for every vertex, and does again afterwards. Returns false, leaving the triangles in their
+	// input order, if the passes made them miss the vertex cache more often (see optimizeMesh).
+	bool optimizeSubmesh(unsigned int *indices, size_t indexCount, const DX11UWA::VertexPositionUVNormal *vertices, std::vector<unsigned int> &local)
+	{
+		std::vector<DX11UWA::VertexPositionUVNormal> used;
+		std::vector<unsigned int> global, submeshIndices(indexCount), clusters;
+
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			unsigned int &slot = local[indices[i]];
+			if (slot == emptySlot)
+			{
+				slot = static_cast<unsigned int>(used.size());
+				used.push_back(vertices[indices[i]]);
+				global.push_back(indices[i]);
+			}
+			submeshIndices[i] = slot;
+		}
+
+		const float inputAcmr = analyzeVertexCache(submeshIndices, used.size()).acmr;
+		optimizeVertexCache(submeshIndices, used.size(), &clusters);
+		optimizeOverdraw(submeshIndices, used, clusters);
+
+		const bool improved = analyzeVertexCache(submeshIndices, used.size()).acmr <= inputAcmr;
+		if (improved)
+		{
+			for (size_t i = 0; i < indexCount; ++i)
+				indices[i] = global[submeshIndices[i]];
+		}
+		for (unsigned int vertex : global)
+			local[vertex] = emptySlot;
+		return improved;
+	}
+
+	// Moves the entries listed in kept, which must be ascending, to the start of values
+	template<typename T>
+	void keepOnly(T *values, const std::vector<unsigned int> &kept)
+	{
+		for (size_t i = 0; i < kept.size(); ++i)
+			values[i] = values[kept[i]];
+	}
+
+	// The mesh loadOBJ makes from the parsed file, which is used up
+	void buildMesh(ObjParseData &data, MeshData &out, const ObjLoadOptions &options)
+	{
+		const size_t cornerCount = data.corners.size();
+		const size_t generatedNormalCount = options.generateNormals ? generateMissingNormals(data, options.creaseAngle, options.parseThreads) : 0;
+
+		ObjMeshGroups groups;
+		makeSubmeshes(data, cornerCount, groups);
+
+		std::vector<unsigned int> welded;
+		std::vector<ObjCorner> unique;
+
+		if (options.weldCorners)
+		{
+			weldCornerIndices(data.corners, welded, unique);
+			std::vector<ObjCorner>().swap(data.corners);
+		}
+		else
+			unique.swap(data.corners);
+
+		// The vertex count is only known once the corners are welded, so that's when the mesh gets its one allocation
+		const size_t uniqueCount = unique.size();
+		MeshData mesh;
+		mesh.Allocate(uniqueCount, cornerCount, options.sourceAttributes);
+
+		unsigned int *indices = mesh.GetIndices();
+		DX11UWA::VertexPositionUVNormal *vertices = mesh.GetVertices();
+		DirectX::XMFLOAT3 *sourceNormals = mesh.GetSourceNormals();
+		DirectX::XMFLOAT2 *sourceUVs = mesh.GetSourceUVs();
+
+		if (options.weldCorners)
+			std::copy(welded.begin(), welded.end(), indices);
+		else
+		{
+			for (size_t i = 0; i < cornerCount; i++)
+				indices[i] = static_cast<unsigned int>(i);
+		}
+
+		std::vector<unsigned int>().swap(welded);
+
+		// For each distinct corner
+		for (size_t i = 0; i < uniqueCount; i++)
+		{
+			const ObjCorner &corner = unique[i];
+			DX11UWA::VertexPositionUVNormal &temp = vertices[i];
+
+			DirectX::XMFLOAT2 uv = (corner.uv >= 0) ? data.uvs[corner.uv] : DirectX::XMFLOAT2(0.0f, 0.0f);
+			DirectX::XMFLOAT3 normal = (corner.normal >= 0) ? data.normals[corner.normal] : DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+			temp.pos = data.positions[corner.position];
+
+			// Flip V for Direct3D's texture origin
+			temp.uv.x = uv.x;
+			temp.uv.y = 1.0f - uv.y;
+			temp.normal = normal;
+
+			if (sourceUVs)
+				sourceUVs[i] = uv;
+			if (sourceNormals)
+				sourceNormals[i] = normal;
+		}
+
+		// Only the mesh is needed from here on
+		data = ObjParseData();
+		std::vector<ObjCorner>().swap(unique);
+
+		if (options.weldByValue)
+		{
+			std::vector<unsigned int> remap, kept;
+			weldRemap(vertices, mesh.GetVertexCount(), options.weldEpsilon, remap, kept);
+
+			keepOnly(vertices, kept);
+			if (sourceNormals)
+				keepOnly(sourceNormals, kept);
+			if (sourceUVs)
+				keepOnly(sourceUVs, kept);
+			mesh.TrimVertices(kept.size());
+
+			for (size_t i = 0; i < cornerCount; i++)
+				indices[i] = remap[indices[i]];
+		}
+
+		if (options.optimize)
+		{
+			// Same passes as optimizeMesh, with the extra attribute arrays remapped alongside the vertices
+			if (options.stats)
+			{
+				options.stats->optimization.cacheBefore = analyzeVertexCache(indices, cornerCount, mesh.GetVertexCount());
+				options.stats->optimization.overdrawBefore = analyzeOverdraw(indices, cornerCount, vertices);
+			}
+
+			// Groups with the same material end up next to each other, so they can be drawn together. That only takes
+			// a copy of the indices when the file doesn't have them in that order already.
+			auto byMaterial = [](const ObjSubmesh &a, const ObjSubmesh &b)
+			{
+				return a.material < b.material;
+			};
+
+			if (!std::is_sorted(groups.submeshes.begin(), groups.submeshes.end(), byMaterial))
+			{
+				std::stable_sort(groups.submeshes.begin(), groups.submeshes.end(), byMaterial);
+
+				std::vector<unsigned int> sorted;
+				sorted.reserve(cornerCount);
+
+				for (ObjSubmesh &submesh : groups.submeshes)
+				{
+					const size_t start = sorted.size();
+					sorted.insert(sorted.end(), indices + submesh.indexStart, indices + submesh.indexStart + submesh.indexCount);
+					submesh.indexStart = static_cast<uint32_t>(start);
+				}
+
+				std::copy(sorted.begin(), sorted.end(), indices);
+			}
+
+			std::vector<unsigned int> local(mesh.GetVertexCount(), emptySlot), remap;
+			size_t keptInputRanges = 0;
+			for (const ObjSubmesh &submesh : groups.submeshes)
+			{
+				if (!optimizeSubmesh(indices + submesh.indexStart, submesh.indexCount, vertices, local))
+					++keptInputRanges;
+			}
+
+			const size_t usedCount = optimizeVertexFetchRemap(indices, cornerCount, mesh.GetVertexCount(), remap);
+			for (size_t i = 0; i < cornerCount; i++)
+				indices[i] = remap[indices[i]];
+
+			remapVerticesInPlace(vertices, mesh.GetVertexCount(), remap);
+			if (sourceNormals)
+				remapVerticesInPlace(sourceNormals, mesh.GetVertexCount(), remap);
+			if (sourceUVs)
+				remapVerticesInPlace(sourceUVs, mesh.GetVertexCount(), remap);
+			mesh.TrimVertices(usedCount);
+
+			if (options.stats)
+			{
+				options.stats->optimization.cacheAfter = analyzeVertexCache(indices, cornerCount, mesh.GetVertexCount());
+				options.stats->optimization.overdrawAfter = analyzeOverdraw(indices, cornerCount, vertices);
+				options.stats->optimization.keptInputRanges = keptInputRanges;
+			}
+		}
+
+		if (options.groups)
+			*options.groups = std::move(groups);
+
+		if (options.stats)
+		{
+			options.stats->cornerCount = cornerCount;
+			options.stats->uniqueCornerCount = uniqueCount;
+			options.stats->vertexCount = mesh.GetVertexCount();
+			options.stats->indexCount = mesh.GetIndexCount();
+			options.stats->generatedNormalCount = generatedNormalCount;
+		}
+
+		out = std::move(mesh);
+	}
+}
+
+bool parseOBJ(const char * data, size_t size, ObjParseData &out)
+{
+	out.positions.clear();
+	out.uvs.clear();
+	out.normals.clear();
+	out.corners.clear();
+
+	ObjChunk chunk;
+	chunk.data = &out;
+
+	reserveRecords(data, data + size, chunk);
+	if (!parseSpan(data, data + size, data + size, chunk))
+		return false;
+
+	resolveGroups(chunk.records, out);
+
+	return rebaseRelativeCorners(chunk, out.corners.data(), 0, 0, 0) && validateIndices(out.corners.data(), out.corners.size(), out);
+}
+
+bool parseOBJParallel(const char * data, size_t size, ObjParseData &out, unsigned int threadCount)
+{
+	// Below this a chunk isn't worth a thread
+	const size_t minChunkSize = 128 * 1024;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	const size_t maxChunks = std::max<size_t>(1, size / minChunkSize);
+	if (threadCount > maxChunks)
+		threadCount = static_cast<unsigned int>(maxChunks);
+
+	if (threadCount <= 1)
+		return parseOBJ(data, size, out);
+
+	// Cut the file into roughly equal spans that start right after a newline
+	const char *end = data + size;
+	std::vector<const char *> bounds(1, data);
+
+	for (unsigned int i = 1; i < threadCount; ++i)
+	{
+		const char *cut = std::max(bounds.back(), data + size / threadCount * i);
+		const char *newline = static_cast<const char *>(memchr(cut, '\n', end - cut));
+		if (!newline)
+			break;
+		bounds.push_back(newline + 1);
+	}
+
+	bounds.push_back(end);
+
+	const unsigned int chunkCount = static_cast<unsigned int>(bounds.size() - 1);
+	std::vector<ObjParseData> chunkData(chunkCount);
+	std::vector<ObjChunk> chunks(chunkCount);
+	std::unique_ptr<bool[]> succeeded(new bool[chunkCount]);
+
+	runParallel(chunkCount, [&](unsigned int i)
+	{
+		chunks[i].data = &chunkData[i];
+		reserveRecords(bounds[i], bounds[i + 1], chunks[i]);
+		succeeded[i] = parseSpan(bounds[i], bounds[i + 1], end, chunks[i]);
+	});
+
+	for (unsigned int i = 0; i < chunkCount; ++i)
+	{
+		if (!succeeded[i])
+			return false;
+	}
+
+	// Each chunk's attributes and corners go right after the previous chunk's
+	std::vector<size_t> positionBase(chunkCount + 1, 0), uvBase(chunkCount + 1, 0), normalBase(chunkCount + 1, 0), cornerBase(chunkCount + 1, 0);
+
+	for (unsigned int i = 0; i < chunkCount; ++i)
+	{
+		positionBase[i + 1] = positionBase[i] + chunkData[i].positions.size();
+		uvBase[i + 1] = uvBase[i] + chunkData[i].uvs.size();
+		normalBase[i + 1] = normalBase[i] + chunkData[i].normals.size();
+		cornerBase[i + 1] = cornerBase[i] + chunkData[i].corners.size();
+	}
+
+	out.positions.resize(positionBase[chunkCount]);
+	out.uvs.resize(uvBase[chunkCount]);
+	out.normals.resize(normalBase[chunkCount]);
+	out.corners.resize(cornerBase[chunkCount]);
+
+	runParallel(chunkCount, [&](unsigned int i)
+	{
+		copyInto(out.positions, positionBase[i], chunkData[i].positions);
+		copyInto(out.uvs, uvBase[i], chunkData[i].uvs);
+		copyInto(out.normals, normalBase[i], chunkData[i].normals);
+		copyInto(out.corners, cornerBase[i], chunkData[i].corners);
+
+		ObjCorner *corners = out.corners.data() + cornerBase[i];
+		succeeded[i] = rebaseRelativeCorners(chunks[i], corners, static_cast<int>(positionBase[i]), static_cast<int>(uvBase[i]), static_cast<int>(normalBase[i])) &&
+			validateIndices(corners, chunkData[i].corners.size(), out);
+	});
+
+	for (unsigned int i = 0; i < chunkCount; ++i)
+	{
+		if (!succeeded[i])
+			return false;
+	}
+
+	size_t recordCount = 0;
+	for (unsigned int i = 0; i < chunkCount; ++i)
+		recordCount += chunks[i].records.size();
+
+	std::vector<ObjGroupRecord> records;
+	records.reserve(recordCount);
+	for (unsigned int i = 0; i < chunkCount; ++i)
+	{
+		for (ObjGroupRecord &record : chunks[i].records)
+		{
+			records.push_back(std::move(record));
+			records.back().corner += cornerBase[i];
+		}
+	}
+
+	resolveGroups(records, out);
+	return true;
+}
+
+bool loadOBJ(const char * path, MeshData &out, const ObjLoadOptions &options)
+{
+	out.Clear();
+
+	MappedFile file;
+
+	if (!file.Open(path))
+	{
+		printf("Impossible to open the file !\n");
+		return false;
+	}
+
+	ObjParseData data;
+
+	if (!parseOBJParallel(file.GetData(), file.GetSize(), data, options.parseThreads))
+	{
+		printf("File can't be read by our simple parser: %s\n", path);
+		return false;
+	}
+
+	buildMesh(data, out, options);
+	return true;
+}
+
+bool loadOBJ(const char * path, std::vector<DX11UWA::VertexPositionUVNormal> &out_vertices, std::vector<unsigned int> &out_indices, std::vector<DirectX::XMFLOAT3> &out_normals, std::vector<DirectX::XMFLOAT2> &out_uvs, const ObjLoadOptions &options)
+{
+	ObjLoadOptions withSource = options;
+	withSource.sourceAttributes = MeshData::SourceNormals | MeshData::SourceUVs;
+
+	MeshData mesh;
+	if (!loadOBJ(path, mesh, withSource))
+		return false;
+
+	const size_t vertexCount = mesh.GetVertexCount();
+	out_vertices.assign(mesh.GetVertices(), mesh.GetVertices() + vertexCount);
+	out_indices.assign(mesh.GetIndices(), mesh.GetIndices() + mesh.GetIndexCount());
+	out_normals.assign(mesh.GetSourceNormals(), mesh.GetSourceNormals() + (mesh.GetSourceNormals() ? vertexCount : 0));
+	out_uvs.assign(mesh.GetSourceUVs(), mesh.GetSourceUVs() + (mesh.GetSourceUVs() ? vertexCount : 0));
+	return true;
+}
+
+void weldVertices(std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices, float epsilon)
+{
+	std::vector<unsigned int> remap, kept;
+	weldRemap(vertices.data(), vertices.size(), epsilon, remap, kept);
+
+	keepOnly(vertices.data(), kept);
+	vertices.resize(kept.size());
+
+	for (unsigned int &index : indices)
+		index = remap[index];
+}
+
+ObjStreamReader::ObjStreamReader(void) :
+	m_next(nullptr),
+	m_end(nullptr),
+	m_cornerCount(0),
+	m_boundsMin(FLT_MAX, FLT_MAX, FLT_MAX),
+	m_boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX)
+{
+}
+
+bool ObjStreamReader::Open(const char *path)
+{
+	if (!m_file.Open(path))
+		return false;
+
+	m_next = m_file.GetData();
+	m_end = m_next + m_file.GetSize();
+	ObjCounts counts;
+	scanOBJ(m_next, m_end, counts, true);
+	m_cornerCount = counts.cornerCount;
+	m_boundsMin = counts.boundsMin;
+	m_boundsMax = counts.boundsMax;
+
+	// Everything is kept for the whole file, for BuildMesh, so it's sized for all of it up front
+	m_data = ObjParseData();
+	m_data.positions.reserve(counts.positionCount);
+	m_data.uvs.reserve(counts.uvCount);
+	m_data.normals.reserve(counts.normalCount);
+	m_data.corners.reserve(m_cornerCount);
+	m_records.clear();
+	m_records.reserve(counts.recordCount);
+	m_unique.clear();
+	m_table.assign(hashTableSize(m_cornerCount), emptySlot);
+	return true;
+}
+
+bool ObjStreamReader::Read(size_t chunkSize, ObjStreamBatch &batch)
+{
+	batch.vertices.clear();
+	batch.indices.clear();
+
+	if (m_next == m_end)
+		return true;
+
+	// Cut right after the first newline chunkSize bytes on
+	const char *cut = m_next + std::min(chunkSize, static_cast<size_t>(m_end - m_next));
+	const char *newline = static_cast<const char *>(memchr(cut, '\n', m_end - cut));
+	const char *spanEnd = newline ? newline + 1 : m_end;
+
+	// Attributes accumulate over the whole file, so relative indices resolve against everything read so far.
+	// The records go straight into the ones Open made room for.
+	ObjChunk chunk;
+	chunk.data = &m_data;
+	chunk.records.swap(m_records);
+	const size_t first = m_data.corners.size();
+
+	const bool parsed = parseSpan(m_next, spanEnd, m_end, chunk) && rebaseRelativeCorners(chunk, m_data.corners.data(), 0, 0, 0) &&
+		validateIndices(m_data.corners.data() + first, m_data.corners.size() - first, m_data);
+	chunk.records.swap(m_records);
+	if (!parsed)
+		return false;
+
+	m_next = spanEnd;
+
+	// The scan decided how much room the caller made for the mesh
+	if (m_data.corners.size() > m_cornerCount)
+		return false;
+
+	for (size_t i = first; i < m_data.corners.size(); ++i)
+	{
+		const ObjCorner &corner = m_data.corners[i];
+		unsigned int &slot = findSlot(m_table, hashCorner(corner), [&](unsigned int vertex)
+		{
+			const ObjCorner &other = m_unique[vertex];
+			return other.position == corner.position && other.uv == corner.uv && other.normal == corner.normal;
+		});
+
+		if (slot == emptySlot)
+		{
+			slot = static_cast<unsigned int>(m_unique.size());
+			m_unique.push_back(corner);
+
+			// Same vertex as loadOBJ builds, with V flipped for Direct3D's texture origin
+			const DirectX::XMFLOAT2 uv = (corner.uv >= 0) ? m_data.uvs[corner.uv] : DirectX::XMFLOAT2(0.0f, 0.0f);
+
+			DX11UWA::VertexPositionUVNormal vertex;
+			vertex.pos = m_data.positions[corner.position];
+			vertex.uv = DirectX::XMFLOAT2(uv.x, 1.0f - uv.y);
+			vertex.normal = (corner.normal >= 0) ? m_data.normals[corner.normal] : DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+			batch.vertices.push_back(vertex);
+		}
+
+		batch.indices.push_back(slot);
+	}
+
+	return true;
+}
+
+bool ObjStreamReader::BuildMesh(MeshData &out, const ObjLoadOptions &options)
+{
+	out.Clear();
+	if (!m_file.IsOpen() || !IsFinished())
+		return false;
+
+	resolveGroups(m_records, m_data);
+	buildMesh(m_data, out, options);
+
+	// buildMesh used up the parsed file, there's nothing left to read
+	m_file.Close();
+	m_next = m_end = nullptr;
+	m_records.clear();
+	std::vector<ObjCorner>().swap(m_unique);
+	std::vector<unsigned int>().swap(m_table);
+	return true;
+}
+
+bool loadOBJ_fscanf(const char * path, std::vector<DX11UWA::VertexPositionUVNormal> &out_vertices, std::vector<unsigned int> &out_indices, std::vector<DirectX::XMFLOAT3> &out_normals, std::vector<DirectX::XMFLOAT2> &out_uvs, bool warn)
+{
+	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
+	std::vector<DirectX::XMFLOAT3> temp_vertices;
+	std::vector<DirectX::XMFLOAT2> temp_uvs;
+	std::vector<DirectX::XMFLOAT3> temp_normals;
+
+	std::vector<DX11UWA::VertexPositionUVNormal> vertices;
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<DirectX::XMFLOAT2> uvs;
+	std::vector<unsigned int> indices;
+
+	FILE * file = fopen(path, "r");
+
+	if (file == NULL)
+	{
+		printf("Impossible to open the file !\n");
+		return false;
+	}
+
+	bool warned = !warn;
+
+	while (true) {
+		char lineHeader[256];
+
+		// read the first word of the line
+		int res = fscanf(file, "%s", lineHeader);
+
+		if (res == EOF)
+			break;		// End of file. Quit the loop.
+
+						// else : parse lineHeader
+		if (strcmp(lineHeader, "v") == 0)
+		{
+			DirectX::XMFLOAT3 vertex;
+
+			fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
+			temp_vertices.push_back(vertex);
+		}
+		else if (strcmp(lineHeader, "vt") == 0)
+		{
+			DirectX::XMFLOAT2 uv;
+
+			fscanf(file, "%f %f\n", &uv.x, &uv.y);
+			temp_uvs.push_back(uv);
+		}
+		else if (strcmp(lineHeader, "vn") == 0)
+		{
+			DirectX::XMFLOAT3 normal;
+
+			fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
+			temp_normals.push_back(normal);
+		}
+		else if (strcmp(lineHeader, "f") == 0)
+		{
+			std::string vertex1, vertex2, vertex3;
+			unsigned int vertexIndex[3] = {}, uvIndex[3] = {}, normalIndex[3] = {};
+			int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &vertexIndex[0], &uvIndex[0], &normalIndex[0],
+				&vertexIndex[1], &uvIndex[1], &normalIndex[1],
+				&vertexIndex[2], &uvIndex[2], &normalIndex[2]);
+
+			if (matches != 9)
+			{
+				if (!warned)
+					printf("File can't be read by our simple parser: (Try exporting with other options)\n");
+				warned = true;
+				continue;
+			}
+
+			vertexIndices.push_back(vertexIndex[0]);
+			vertexIndices.push_back(vertexIndex[1]);
+			vertexIndices.push_back(vertexIndex[2]);
+			uvIndices.push_back(uvIndex[0]);
+			uvIndices.push_back(uvIndex[1]);
+			uvIndices.push_back(uvIndex[2]);
+			normalIndices.push_back(normalIndex[0]);
+			normalIndices.push_back(normalIndex[1]);
+			normalIndices.push_back(normalIndex[2]);
+		}
+	}
+
+	fclose(file);
+
 	// For each vertex of each triangle
 	for (unsigned int i = 0; i < vertexIndices.size(); i++)
 	{
@@ -1,6 +1,12 @@
 #pragma once
+#include <cstdint>
+#include <string>
 #include <vector>
-#include "Content\ShaderStructures.h"
+#include "Content/ShaderStructures.h"
+#include "MappedFile.h"
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+#include "MeshTangentSpace.h"
 
 #define EPSILON 0.00001f
 
@@ -22,4 +28,212 @@ float Vector_Dot(DirectX::XMFLOAT3 v, DirectX::XMFLOAT3 w);
 
 DirectX::XMFLOAT3 Vector_Scalar_Multiply(DirectX::XMFLOAT3 v, float s);
 
-bool loadOBJ(const char * path, std::vector<DX11UWA::VertexPositionUVNormal> &out_vertices, std::vector<unsigned int> &out_indices, std::vector<DirectX::XMFLOAT3> &out_normals, std::vector<DirectX::XMFLOAT2> &out_uvs);
\ No newline at end of file
+// Attribute indices of one face corner, 0-based. -1 when the face doesn't reference that attribute.
+struct ObjCorner
+{
+	int position;
+	int uv;
+	int normal;
+};
+
+// A usemtl name, and the mtllib file that was the last one named before it ("" if there was none)
+struct ObjMaterialName
+{
+	std::string	name;
+	std::string	library;
+};
+
+// Corners from cornerStart on belong to this object and material, up to the start of the next group
+struct ObjGroup
+{
+	size_t	cornerStart;
+	int		object;		// Into ObjParseData::objects, -1 before the first o or g record
+	int		material;	// Into ObjParseData::materials, -1 before the first usemtl record
+};
+
+enum ObjGroupRecordKind
+{
+	ObjRecordObject,
+	ObjRecordMaterial,
+	ObjRecordLibrary
+};
+
+// An o, g, usemtl or mtllib record and how many corners came before it, before the records are resolved into groups
+struct ObjGroupRecord
+{
+	size_t				corner;
+	ObjGroupRecordKind	kind;
+	std::string			name;
+};
+
+// Attribute streams and triangulated face corners, exactly as they appear in an OBJ file, and the object
+// and material groups that cover the corners.
+struct ObjParseData
+{
+	std::vector<DirectX::XMFLOAT3>	positions;
+	std::vector<DirectX::XMFLOAT2>	uvs;
+	std::vector<DirectX::XMFLOAT3>	normals;
+	std::vector<ObjCorner>			corners;
+
+	std::vector<ObjGroup>			groups;		// Ascending, none empty
+	std::vector<std::string>		objects;	// o and g names, in order of appearance
+	std::vector<ObjMaterialName>	materials;	// In order of appearance
+};
+
+// Parses OBJ text in place, without copying it or tokenizing it into strings.
+// Polygons are fan triangulated. Returns false on malformed records or out of range indices.
+bool parseOBJ(const char * data, size_t size, ObjParseData &out);
+
+// Same as parseOBJ, but cuts the text into newline aligned chunks that are parsed on
+// threadCount threads (0 uses every core) and then merged. The output is identical to parseOBJ's.
+bool parseOBJParallel(const char * data, size_t size, ObjParseData &out, unsigned int threadCount = 0);
+
+// Vertex counts before and after welding, filled in by loadOBJ when ObjLoadOptions::stats is set.
+struct ObjLoadStats
+{
+	size_t	cornerCount;		// Triangle corners in the file, one vertex each without welding
+	size_t	uniqueCornerCount;	// Distinct (position, uv, normal) index triples
+	size_t	vertexCount;		// Vertices after the optional weld by value
+	size_t	indexCount;
+	size_t	generatedNormalCount;	// Corners without a normal in the file, see ObjLoadOptions::generateNormals
+
+	MeshOptimizeReport	optimization;	// Only filled in with ObjLoadOptions::optimize
+};
+
+// A run of the index array from one object and material, filled in by loadOBJ when ObjLoadOptions::groups is set.
+struct ObjSubmesh
+{
+	uint32_t	indexStart;
+	uint32_t	indexCount;
+	uint32_t	material;	// Into ObjMeshGroups::materials
+	int			object;		// Into ObjMeshGroups::objects, -1 for faces before any o or g record
+};
+
+struct ObjMeshGroups
+{
+	std::vector<ObjSubmesh>			submeshes;	// Cover the whole index array
+	std::vector<std::string>		objects;
+
+	// Faces before any usemtl record use a material with no name, added at the end when there are any
+	std::vector<ObjMaterialName>	materials;
+};
+
+struct ObjLoadOptions
+{
+	ObjLoadOptions() : parseThreads(1), weldCorners(true), weldByValue(false), weldEpsilon(0.0f), generateNormals(true), creaseAngle(MESH_DEFAULT_CREASE_ANGLE),
+		optimize(false), buildClusters(false), buildTangents(false), lodCount(1), sourceAttributes(0), stats(nullptr), groups(nullptr) {}
+
+	// Threads used to parse the file and generate normals and tangents. 1 runs on the calling thread, 0 uses every core.
+	// More than one has only been checked to give the same mesh, not measured to be faster, so the default is 1.
+	unsigned int parseThreads;
+
+	// Corners with the same position, uv and normal indices share one vertex.
+	bool weldCorners;
+
+	// Also merges vertices whose attributes differ by at most weldEpsilon (0 merges equal values only),
+	// for files that repeat the same value under different indices.
+	bool weldByValue;
+	float weldEpsilon;
+
+	// Gives face corners without a normal a smooth one, kept apart across edges sharper than creaseAngle degrees
+	// (see generateNormals). Without it they get a zero normal.
+	bool generateNormals;
+	float creaseAngle;
+
+	// Reorders the triangles for the vertex cache and overdraw, then the vertices for fetching (see optimizeMesh).
+	// Triangles stay within their object and material group, and the groups are sorted by material. A group the
+	// passes would leave with a higher ACMR keeps its input order.
+	bool optimize;
+
+	// Groups the triangles into culling clusters (see MeshClusters.h). Only used by cookMesh, as the
+	// clusters are stored in the .rmesh.
+	bool buildClusters;
+
+	// Builds a tangent for every vertex (see generateTangents). Only used by cookMesh, as the tangents are stored in the .rmesh.
+	bool buildTangents;
+
+	// Levels of detail to build, counting the full detail mesh, so 1 builds none (see MeshLod.h). Only used by cookMesh.
+	unsigned int lodCount;
+
+	// MeshData::SourceAttributes to keep next to the vertices. The loadOBJ that fills vectors always keeps both.
+	unsigned int sourceAttributes;
+
+	ObjLoadStats *stats;
+
+	// Receives the submesh of every object and material group
+	ObjMeshGroups *groups;
+};
+
+// Merges vertices whose position, uv and normal all differ by at most epsilon (0 merges equal values only),
+// then drops the unused vertices and rewrites the indices. The first vertex of each group is kept.
+void weldVertices(std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices, float epsilon);
+
+// Memory-maps the OBJ file and builds an indexed mesh from it, with one vertex per distinct face corner
+// (or per corner if options.weldCorners is off). The file is counted before it's parsed, so the parsed arrays
+// never grow, and out is allocated once the vertex count is known. The load isn't free of other allocations:
+// each o, g and usemtl name is a string, and welding, generating normals and the options that rework the
+// mesh afterwards use working arrays of their own.
+bool loadOBJ(const char * path, MeshData &out, const ObjLoadOptions &options = ObjLoadOptions());
+
+// Same, copied into vectors. out_normals and out_uvs hold the unflipped attributes of each vertex.
+bool loadOBJ(const char * path, std::vector<DX11UWA::VertexPositionUVNormal> &out_vertices, std::vector<unsigned int> &out_indices, std::vector<DirectX::XMFLOAT3> &out_normals, std::vector<DirectX::XMFLOAT2> &out_uvs, const ObjLoadOptions &options = ObjLoadOptions());
+
+// Geometry read by one ObjStreamReader::Read call. The vertices follow the ones read before, and the
+// indices are whole triangles that may use any vertex read so far.
+struct ObjStreamBatch
+{
+	std::vector<DX11UWA::VertexPositionUVNormal>	vertices;
+	std::vector<unsigned int>						indices;
+};
+
+// Reads an OBJ file a chunk at a time, so the start of a mesh can be drawn while the rest is still parsed.
+// Vertices are built like loadOBJ builds them with its default options: one per distinct face corner, not
+// welded by value or optimized. Faces can only use attributes that come before them in the file. Corners without
+// a normal get a zero one, as the faces around them may not have been read yet.
+class ObjStreamReader
+{
+public:
+	ObjStreamReader(void);
+
+	ObjStreamReader(const ObjStreamReader &) = delete;
+	ObjStreamReader &operator=(const ObjStreamReader &) = delete;
+
+	// Maps the file, counts its face corners, which bounds the vertices and indices it can produce, and finds
+	// the bounds of its positions. Returns false if it can't be opened.
+	bool Open(const char *path);
+
+	// Parses about chunkSize more bytes, cut at the end of a line, into batch, with the triangles of every face
+	// in them. Returns false on malformed records, or faces using attributes that haven't been read yet.
+	bool Read(size_t chunkSize, ObjStreamBatch &batch);
+
+	bool IsFinished(void) const { return m_next == m_end; }
+
+	// Triangle corners in the file: exactly the index count, and the most vertices there can be
+	size_t GetCornerCount(void) const { return m_cornerCount; }
+
+	// Bounds of every position in the file, known once it's open
+	const DirectX::XMFLOAT3 &GetBoundsMin(void) const { return m_boundsMin; }
+	const DirectX::XMFLOAT3 &GetBoundsMax(void) const { return m_boundsMax; }
+
+	// Once the whole file is read, builds the mesh loadOBJ would build from it with options out of what was
+	// read, without parsing the file again. Uses up what was read, so the file has to be opened again after.
+	bool BuildMesh(MeshData &out, const ObjLoadOptions &options = ObjLoadOptions());
+
+private:
+	MappedFile					m_file;
+	const char					*m_next;
+	const char					*m_end;
+	size_t						m_cornerCount;
+
+	ObjParseData				m_data;				// Every attribute and corner read so far
+	std::vector<ObjGroupRecord>	m_records;			// Resolved into m_data's groups by BuildMesh
+	std::vector<ObjCorner>		m_unique;			// Index triple of every vertex
+	std::vector<unsigned int>	m_table;			// Weld hash table over m_unique
+
+	DirectX::XMFLOAT3			m_boundsMin;
+	DirectX::XMFLOAT3			m_boundsMax;
+};
+
+// The original fscanf loader. Only kept as the baseline for the loader benchmark. Unless warn is off it says
+// once per call if there are faces it can't read.
+bool loadOBJ_fscanf(const char * path, std::vector<DX11UWA::VertexPositionUVNormal> &out_vertices, std::vector<unsigned int> &out_indices, std::vector<DirectX::XMFLOAT3> &out_normals, std::vector<DirectX::XMFLOAT2> &out_uvs, bool warn = true);
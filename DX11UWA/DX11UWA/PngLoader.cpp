@@ -0,0 +1,681 @@
+#include "pch.h"
+#include "PngLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// The largest side Direct3D 11 takes, which also keeps the sizes below from overflowing
+	const uint32_t maxDimension = 16384;
+
+	// Huffman codes up to this long are decoded with one table lookup
+	const int fastBits = 9;
+
+	uint32_t readBigEndian32(const uint8_t *p)
+	{
+		return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+	}
+
+	// Deflate streams are read least significant bit first
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t *data, size_t size) : m_data(data), m_size(size), m_position(0), m_buffer(0), m_bitCount(0), m_overrun(false) {}
+
+		// Up to 16 bits. Past the end of the data it returns zeroes and sets the overrun flag.
+		uint32_t Read(int count)
+		{
+			while (m_bitCount < count)
+			{
+				if (m_position == m_size)
+				{
+					m_overrun = true;
+					return 0;
+				}
+				m_buffer |= static_cast<uint32_t>(m_data[m_position++]) << m_bitCount;
+				m_bitCount += 8;
+			}
+
+			const uint32_t value = m_buffer & ((1u << count) - 1);
+			m_buffer >>= count;
+			m_bitCount -= count;
+			return value;
+		}
+
+		// The next count bits without reading them, zeroes past the end of the data
+		uint32_t Peek(int count)
+		{
+			while (m_bitCount < count && m_position < m_size)
+			{
+				m_buffer |= static_cast<uint32_t>(m_data[m_position++]) << m_bitCount;
+				m_bitCount += 8;
+			}
+			return m_buffer & ((1u << count) - 1);
+		}
+
+		// Skips bits Peek returned
+		void Skip(int count)
+		{
+			if (count > m_bitCount)
+			{
+				m_overrun = true;
+				count = m_bitCount;
+			}
+			m_buffer >>= count;
+			m_bitCount -= count;
+		}
+
+		// Drops the bits left of the current byte, which are never more than 7
+		void AlignToByte(void)
+		{
+			m_buffer = 0;
+			m_bitCount = 0;
+		}
+
+		const uint8_t *GetBytes(size_t count)
+		{
+			if (m_size - m_position < count)
+			{
+				m_overrun = true;
+				return nullptr;
+			}
+			const uint8_t *bytes = m_data + m_position;
+			m_position += count;
+			return bytes;
+		}
+
+		bool HasOverrun(void) const { return m_overrun; }
+
+	private:
+		const uint8_t	*m_data;
+		size_t			m_size;
+		size_t			m_position;
+		uint32_t		m_buffer;
+		int				m_bitCount;
+		bool			m_overrun;
+	};
+
+	// Canonical Huffman code. Short codes are looked up by their next fastBits bits, long ones decoded a bit at
+	// a time from how many codes there are of each length.
+	struct Huffman
+	{
+		uint16_t	counts[16];
+		uint16_t	symbols[288];
+		uint16_t	fast[1 << fastBits];	// Symbol << 4 | code length, 0 for codes longer than fastBits
+	};
+
+	// Incomplete codes are allowed, since deflate uses them when there's one distance code
+	bool buildHuffman(Huffman &huffman, const uint8_t *lengths, int count)
+	{
+		memset(huffman.counts, 0, sizeof(huffman.counts));
+		for (int symbol = 0; symbol < count; ++symbol)
+			huffman.counts[lengths[symbol]]++;
+
+		int left = 1;
+		for (int length = 1; length < 16; ++length)
+		{
+			left = (left << 1) - huffman.counts[length];
+			if (left < 0)
+				return false;
+		}
+
+		uint16_t offsets[16];
+		offsets[1] = 0;
+		for (int length = 1; length < 15; ++length)
+			offsets[length + 1] = offsets[length] + huffman.counts[length];
+
+		for (int symbol = 0; symbol < count; ++symbol)
+		{
+			if (lengths[symbol])
+				huffman.symbols[offsets[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+		}
+
+		// Codes are stored from their first bit, so the table is indexed by them reversed, every entry whose
+		// low bits are the code
+		memset(huffman.fast, 0, sizeof(huffman.fast));
+		int code = 0;
+		int index = 0;
+		for (int length = 1; length <= fastBits; ++length)
+		{
+			for (int i = 0; i < huffman.counts[length]; ++i, ++code, ++index)
+			{
+				int reversed = 0;
+				for (int bit = 0; bit < length; ++bit)
+					reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+
+				for (int entry = reversed; entry < (1 << fastBits); entry += 1 << length)
+					huffman.fast[entry] = static_cast<uint16_t>((huffman.symbols[index] << 4) | length);
+			}
+			code <<= 1;
+		}
+		return true;
+	}
+
+	// Returns -1 for a code that isn't in the table
+	int decodeSymbol(BitReader &reader, const Huffman &huffman)
+	{
+		const uint16_t entry = huffman.fast[reader.Peek(fastBits)];
+		if (entry)
+		{
+			reader.Skip(entry & 15);
+			return entry >> 4;
+		}
+
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		for (int length = 1; length < 16; ++length)
+		{
+			code |= reader.Read(1);
+			const int count = huffman.counts[length];
+			if (code - first < count)
+				return huffman.symbols[index + code - first];
+
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+
+	const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+		4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	bool inflateCodes(BitReader &reader, const Huffman &literals, const Huffman &distances, uint8_t *out, size_t outSize, size_t &written)
+	{
+		for (;;)
+		{
+			const int symbol = decodeSymbol(reader, literals);
+			if (symbol < 0 || reader.HasOverrun())
+				return false;
+
+			if (symbol < 256)
+			{
+				if (written == outSize)
+					return false;
+				out[written++] = static_cast<uint8_t>(symbol);
+			}
+			else if (symbol == 256)
+				return true;
+			else
+			{
+				if (symbol - 257 >= 29)
+					return false;
+				const size_t length = lengthBase[symbol - 257] + reader.Read(lengthExtra[symbol - 257]);
+
+				const int distanceSymbol = decodeSymbol(reader, distances);
+				if (distanceSymbol < 0 || distanceSymbol >= 30)
+					return false;
+				const size_t distance = distanceBase[distanceSymbol] + reader.Read(distanceExtra[distanceSymbol]);
+
+				if (distance > written || length > outSize - written || reader.HasOverrun())
+					return false;
+
+				// Matches may overlap what they copy, so byte by byte
+				const uint8_t *from = out + written - distance;
+				for (size_t i = 0; i < length; ++i)
+					out[written + i] = from[i];
+				written += length;
+			}
+		}
+	}
+
+	bool readDynamicCodes(BitReader &reader, Huffman &literals, Huffman &distances)
+	{
+		static const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		const int literalCount = reader.Read(5) + 257;
+		const int distanceCount = reader.Read(5) + 1;
+		const int codeLengthCount = reader.Read(4) + 4;
+		if (literalCount > 286 || distanceCount > 30)
+			return false;
+
+		uint8_t lengths[320] = {};
+		for (int i = 0; i < codeLengthCount; ++i)
+			lengths[codeLengthOrder[i]] = static_cast<uint8_t>(reader.Read(3));
+
+		Huffman codeLengths;
+		if (!buildHuffman(codeLengths, lengths, 19))
+			return false;
+
+		// The literal and distance code lengths are one run, which repeats may cross
+		int index = 0;
+		while (index < literalCount + distanceCount)
+		{
+			const int symbol = decodeSymbol(reader, codeLengths);
+			if (symbol < 0 || reader.HasOverrun())
+				return false;
+
+			if (symbol < 16)
+			{
+				lengths[index++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+
+			uint8_t repeated = 0;
+			int repeat;
+			if (symbol == 16)
+			{
+				if (index == 0)
+					return false;
+				repeated = lengths[index - 1];
+				repeat = 3 + reader.Read(2);
+			}
+			else if (symbol == 17)
+				repeat = 3 + reader.Read(3);
+			else
+				repeat = 11 + reader.Read(7);
+
+			if (index + repeat > literalCount + distanceCount)
+				return false;
+			while (repeat--)
+				lengths[index++] = repeated;
+		}
+
+		// Without an end of block code the block can't end
+		if (lengths[256] == 0)
+			return false;
+
+		return buildHuffman(literals, lengths, literalCount) && buildHuffman(distances, lengths + literalCount, distanceCount);
+	}
+
+	// Inflates a zlib stream into exactly outSize bytes
+	bool inflateZlib(const uint8_t *data, size_t size, uint8_t *out, size_t outSize)
+	{
+		// Deflate without a preset dictionary
+		if (size < 2 || (data[0] & 0x0f) != 8 || (data[1] & 0x20) || ((data[0] << 8) | data[1]) % 31 != 0)
+			return false;
+
+		BitReader reader(data + 2, size - 2);
+		size_t written = 0;
+		bool lastBlock = false;
+		while (!lastBlock)
+		{
+			lastBlock = reader.Read(1) != 0;
+			const uint32_t type = reader.Read(2);
+
+			if (type == 0)
+			{
+				reader.AlignToByte();
+				const uint8_t *header = reader.GetBytes(4);
+				if (!header)
+					return false;
+
+				const size_t length = header[0] | (header[1] << 8);
+				if ((length ^ 0xffff) != static_cast<size_t>(header[2] | (header[3] << 8)) || length > outSize - written)
+					return false;
+
+				const uint8_t *stored = reader.GetBytes(length);
+				if (!stored)
+					return false;
+				memcpy(out + written, stored, length);
+				written += length;
+			}
+			else if (type == 1)
+			{
+				static Huffman fixedLiterals, fixedDistances;
+				static const bool built = [&]()
+				{
+					uint8_t lengths[288];
+					memset(lengths, 8, 144);
+					memset(lengths + 144, 9, 112);
+					memset(lengths + 256, 7, 24);
+					memset(lengths + 280, 8, 8);
+					buildHuffman(fixedLiterals, lengths, 288);
+
+					memset(lengths, 5, 30);
+					buildHuffman(fixedDistances, lengths, 30);
+					return true;
+				}();
+				(void)built;
+
+				if (!inflateCodes(reader, fixedLiterals, fixedDistances, out, outSize, written))
+					return false;
+			}
+			else if (type == 2)
+			{
+				Huffman literals, distances;
+				if (!readDynamicCodes(reader, literals, distances) || !inflateCodes(reader, literals, distances, out, outSize, written))
+					return false;
+			}
+			else
+				return false;
+
+			if (reader.HasOverrun())
+				return false;
+		}
+
+		return written == outSize;
+	}
+
+	uint8_t paeth(uint8_t left, uint8_t above, uint8_t aboveLeft)
+	{
+		const int estimate = left + above - aboveLeft;
+		const int toLeft = abs(estimate - left);
+		const int toAbove = abs(estimate - above);
+		const int toAboveLeft = abs(estimate - aboveLeft);
+		if (toLeft <= toAbove && toLeft <= toAboveLeft)
+			return left;
+		return (toAbove <= toAboveLeft) ? above : aboveLeft;
+	}
+
+	// Undoes the filter of every row in place. Each row starts with its filter type byte.
+	bool unfilter(uint8_t *rows, uint32_t height, size_t rowBytes, size_t pixelBytes)
+	{
+		const uint8_t *previous = nullptr;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint8_t filter = rows[0];
+			uint8_t *row = rows + 1;
+
+			for (size_t x = 0; x < rowBytes; ++x)
+			{
+				const uint8_t left = (x >= pixelBytes) ? row[x - pixelBytes] : 0;
+				const uint8_t above = previous ? previous[x] : 0;
+				const uint8_t aboveLeft = (previous && x >= pixelBytes) ? previous[x - pixelBytes] : 0;
+
+				switch (filter)
+				{
+				case 0:
+					break;
+				case 1:
+					row[x] += left;
+					break;
+				case 2:
+					row[x] += above;
+					break;
+				case 3:
+					row[x] += static_cast<uint8_t>((left + above) >> 1);
+					break;
+				case 4:
+					row[x] += paeth(left, above, aboveLeft);
+					break;
+				default:
+					return false;
+				}
+			}
+
+			previous = row;
+			rows += rowBytes + 1;
+		}
+		return true;
+	}
+
+	struct PngHeader
+	{
+		uint32_t	width;
+		uint32_t	height;
+		uint8_t		bitDepth;
+		uint8_t		colorType;		// 0 gray, 2 RGB, 3 palette, 4 gray and alpha, 6 RGBA
+		uint8_t		interlace;
+	};
+
+	uint32_t channelCount(uint8_t colorType)
+	{
+		switch (colorType)
+		{
+		case 0:
+		case 3:
+			return 1;
+		case 2:
+			return 3;
+		case 4:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	bool isValidDepth(uint8_t colorType, uint8_t bitDepth)
+	{
+		switch (colorType)
+		{
+		case 0:
+			return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+		case 3:
+			return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+		case 2:
+		case 4:
+		case 6:
+			return bitDepth == 8 || bitDepth == 16;
+		default:
+			return false;
+		}
+	}
+
+	// Sample index of a row, as 16 bits when the depth is 16 and unscaled below 8
+	uint32_t readSample(const uint8_t *row, size_t index, uint8_t bitDepth)
+	{
+		if (bitDepth == 8)
+			return row[index];
+		if (bitDepth == 16)
+			return (row[index * 2] << 8) | row[index * 2 + 1];
+
+		const size_t bit = index * bitDepth;
+		return (row[bit / 8] >> (8 - bitDepth - bit % 8)) & ((1u << bitDepth) - 1);
+	}
+
+	uint8_t toByte(uint32_t sample, uint8_t bitDepth)
+	{
+		if (bitDepth == 16)
+			return static_cast<uint8_t>(sample >> 8);
+		return static_cast<uint8_t>(sample * 255 / ((1u << bitDepth) - 1));
+	}
+}
+
+bool decodePNG(const uint8_t *data, size_t size, std::vector<uint8_t> &rgba, uint32_t &width, uint32_t &height, const char **error)
+{
+	const char *failure = nullptr;
+	const char *&reason = error ? *error : failure;
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	if (size < sizeof(signature) || memcmp(data, signature, sizeof(signature)) != 0)
+	{
+		reason = "isn't a PNG file";
+		return false;
+	}
+
+	PngHeader header = {};
+	bool hasHeader = false;
+	uint8_t palette[256][4];
+	uint32_t paletteSize = 0;
+	memset(palette, 255, sizeof(palette));
+	bool hasColorKey = false;
+	uint32_t colorKey[3] = {};
+	std::vector<uint8_t> compressed;
+
+	size_t position = sizeof(signature);
+	for (;;)
+	{
+		if (size - position < 12)
+		{
+			reason = "ends before its IEND chunk";
+			return false;
+		}
+
+		const uint32_t length = readBigEndian32(data + position);
+		const uint8_t *type = data + position + 4;
+		const uint8_t *chunk = data + position + 8;
+		if (length > size - position - 12)
+		{
+			reason = "has a chunk past the end of the file";
+			return false;
+		}
+		position += 12 + length;
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length != 13)
+			{
+				reason = "has an invalid IHDR chunk";
+				return false;
+			}
+			header.width = readBigEndian32(chunk);
+			header.height = readBigEndian32(chunk + 4);
+			header.bitDepth = chunk[8];
+			header.colorType = chunk[9];
+			header.interlace = chunk[12];
+			if (chunk[10] != 0 || chunk[11] != 0 || !isValidDepth(header.colorType, header.bitDepth))
+			{
+				reason = "has an unknown color type, bit depth or compression";
+				return false;
+			}
+			hasHeader = true;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			paletteSize = std::min<uint32_t>(length / 3, 256);
+			for (uint32_t i = 0; i < paletteSize; ++i)
+			{
+				palette[i][0] = chunk[i * 3];
+				palette[i][1] = chunk[i * 3 + 1];
+				palette[i][2] = chunk[i * 3 + 2];
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0 && hasHeader)
+		{
+			// Alpha of the first palette entries, or the one gray level or color that is transparent
+			if (header.colorType == 3)
+			{
+				for (uint32_t i = 0; i < length && i < 256; ++i)
+					palette[i][3] = chunk[i];
+			}
+			else if (header.colorType == 0 && length >= 2)
+			{
+				hasColorKey = true;
+				colorKey[0] = colorKey[1] = colorKey[2] = (chunk[0] << 8) | chunk[1];
+			}
+			else if (header.colorType == 2 && length >= 6)
+			{
+				hasColorKey = true;
+				for (int c = 0; c < 3; ++c)
+					colorKey[c] = (chunk[c * 2] << 8) | chunk[c * 2 + 1];
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		else if (memcmp(type, "IEND", 4) == 0)
+			break;
+	}
+
+	if (!hasHeader || compressed.empty())
+	{
+		reason = "has no IHDR or IDAT chunk";
+		return false;
+	}
+	if (header.width == 0 || header.height == 0 || header.width > maxDimension || header.height > maxDimension)
+	{
+		reason = "is empty or larger than 16384 pixels on a side";
+		return false;
+	}
+	if (header.interlace != 0)
+	{
+		reason = "is interlaced";
+		return false;
+	}
+	if (header.colorType == 3 && paletteSize == 0)
+	{
+		reason = "has no palette";
+		return false;
+	}
+
+	const uint32_t channels = channelCount(header.colorType);
+	const size_t bitsPerPixel = channels * header.bitDepth;
+	const size_t rowBytes = (header.width * bitsPerPixel + 7) / 8;
+	const size_t pixelBytes = std::max<size_t>(1, bitsPerPixel / 8);
+
+	std::vector<uint8_t> rows((rowBytes + 1) * header.height);
+	if (!inflateZlib(compressed.data(), compressed.size(), rows.data(), rows.size()))
+	{
+		reason = "has corrupt image data";
+		return false;
+	}
+	if (!unfilter(rows.data(), header.height, rowBytes, pixelBytes))
+	{
+		reason = "has an unknown row filter";
+		return false;
+	}
+
+	width = header.width;
+	height = header.height;
+	rgba.resize(static_cast<size_t>(width) * height * 4);
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t *row = rows.data() + y * (rowBytes + 1) + 1;
+		uint8_t *out = rgba.data() + static_cast<size_t>(y) * width * 4;
+
+		// The usual 8 bit RGB and RGBA without a color key take the short way
+		if (header.bitDepth == 8 && header.colorType == 6)
+		{
+			memcpy(out, row, static_cast<size_t>(width) * 4);
+			continue;
+		}
+		if (header.bitDepth == 8 && header.colorType == 2 && !hasColorKey)
+		{
+			for (uint32_t x = 0; x < width; ++x, out += 4, row += 3)
+			{
+				out[0] = row[0];
+				out[1] = row[1];
+				out[2] = row[2];
+				out[3] = 255;
+			}
+			continue;
+		}
+
+		for (uint32_t x = 0; x < width; ++x, out += 4)
+		{
+			if (header.colorType == 3)
+			{
+				const uint32_t entry = readSample(row, x, header.bitDepth);
+				if (entry >= paletteSize)
+				{
+					reason = "uses a color past the end of its palette";
+					return false;
+				}
+				memcpy(out, palette[entry], 4);
+				continue;
+			}
+
+			uint32_t samples[4];
+			for (uint32_t c = 0; c < channels; ++c)
+				samples[c] = readSample(row, x * channels + c, header.bitDepth);
+
+			if (channels <= 2)
+			{
+				out[0] = out[1] = out[2] = toByte(samples[0], header.bitDepth);
+				out[3] = (channels == 2) ? toByte(samples[1], header.bitDepth) : 255;
+				if (hasColorKey && samples[0] == colorKey[0])
+					out[3] = 0;
+			}
+			else
+			{
+				for (uint32_t c = 0; c < 3; ++c)
+					out[c] = toByte(samples[c], header.bitDepth);
+				out[3] = (channels == 4) ? toByte(samples[3], header.bitDepth) : 255;
+				if (hasColorKey && samples[0] == colorKey[0] && samples[1] == colorKey[1] && samples[2] == colorKey[2])
+					out[3] = 0;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool loadPNG(const char *path, std::vector<uint8_t> &rgba, uint32_t &width, uint32_t &height, const char **error)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		if (error)
+			*error = "can't be opened";
+		return false;
+	}
+
+	return decodePNG(reinterpret_cast<const uint8_t *>(file.GetData()), file.GetSize(), rgba, width, height, error);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decodes PNG images into 8 bit RGBA, so textures can be cooked from the images they're authored as. Every
+// color type and bit depth of the format is read, with 16 bit samples cut to their high byte and tRNS
+// transparency applied to the alpha. Interlaced images are rejected.
+
+// Decodes the PNG file in data into width * height RGBA pixels, rows top to bottom. On failure error (when
+// given) points to a short static description of the problem.
+bool decodePNG(const uint8_t *data, size_t size, std::vector<uint8_t> &rgba, uint32_t &width, uint32_t &height, const char **error = nullptr);
+
+// Maps the file at path with MappedFile, so it may also be an entry of a mounted asset pack, and decodes it
+bool loadPNG(const char *path, std::vector<uint8_t> &rgba, uint32_t &width, uint32_t &height, const char **error = nullptr);
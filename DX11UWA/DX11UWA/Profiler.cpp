@@ -0,0 +1,184 @@
+#include "pch.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Events each thread keeps, a power of two. The oldest are overwritten once a thread records more.
+	const uint32_t eventCapacity = 1 << 14;
+
+	struct Event
+	{
+		std::atomic<const char *> name;
+		std::atomic<uint64_t> start;
+		std::atomic<uint64_t> end;
+	};
+
+	// One thread's ring of events. Only that thread records into it, anyone may read it.
+	struct ThreadEvents
+	{
+		std::unique_ptr<Event[]> events;
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> cleared;	// count when the events were last cleared
+		uint32_t id;
+		std::string name;				// Guarded by the registry's mutex
+	};
+
+	// Every thread that has recorded, kept after the thread exits so its events make it into the trace
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadEvents>> threads;
+	};
+
+	Registry &getRegistry(void)
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadEvents *t_events = nullptr;
+
+	ThreadEvents &registerThread(void)
+	{
+		std::unique_ptr<ThreadEvents> events(new ThreadEvents);
+		events->events.reset(new Event[eventCapacity]);
+		events->count.store(0, std::memory_order_relaxed);
+		events->cleared.store(0, std::memory_order_relaxed);
+
+		Registry &registry = getRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		events->id = static_cast<uint32_t>(registry.threads.size()) + 1;
+		registry.threads.push_back(std::move(events));
+		t_events = registry.threads.back().get();
+		return *t_events;
+	}
+
+	// Ticks per microsecond of GetTicks
+	double getTicksPerMicrosecond(void)
+	{
+#if defined(RAPTURE_TOOLS)
+		typedef std::chrono::steady_clock::period Period;
+		return static_cast<double>(Period::den) / (static_cast<double>(Period::num) * 1000000.0);
+#else
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return static_cast<double>(frequency.QuadPart) / 1000000.0;
+#endif
+	}
+
+	void writeJsonString(FILE *file, const char *text)
+	{
+		fputc('"', file);
+		for (const char *c = text; *c; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+				fprintf(file, "\\%c", *c);
+			else if (static_cast<unsigned char>(*c) < 0x20)
+				fprintf(file, "\\u%04x", static_cast<unsigned char>(*c));
+			else
+				fputc(*c, file);
+		}
+		fputc('"', file);
+	}
+}
+
+void Profiler::Record(const char *name, uint64_t start, uint64_t end)
+{
+	ThreadEvents &events = t_events ? *t_events : registerThread();
+
+	// The only writer, so there's no one to race with for the next slot
+	const uint64_t count = events.count.load(std::memory_order_relaxed);
+	Event &event = events.events[count & (eventCapacity - 1)];
+	event.name.store(name, std::memory_order_relaxed);
+	event.start.store(start, std::memory_order_relaxed);
+	event.end.store(end, std::memory_order_relaxed);
+	events.count.store(count + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char *name)
+{
+	ThreadEvents &events = t_events ? *t_events : registerThread();
+
+	Registry &registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	events.name = name;
+}
+
+bool Profiler::WriteChromeTrace(const char *path)
+{
+	FILE *file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	Registry &registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	// Each thread's window of events, oldest first
+	struct Window
+	{
+		const ThreadEvents *thread;
+		uint64_t first, count;
+	};
+	std::vector<Window> windows;
+	uint64_t origin = UINT64_MAX;
+	for (const std::unique_ptr<ThreadEvents> &thread : registry.threads)
+	{
+		Window window;
+		window.thread = thread.get();
+		window.count = thread->count.load(std::memory_order_acquire);
+		window.first = std::max<uint64_t>(thread->cleared.load(std::memory_order_relaxed),
+			(window.count > eventCapacity) ? window.count - eventCapacity : 0);
+		windows.push_back(window);
+
+		for (uint64_t i = window.first; i < window.count; ++i)
+			origin = std::min<uint64_t>(origin, thread->events[i & (eventCapacity - 1)].start.load(std::memory_order_relaxed));
+	}
+
+	// Timestamps in microseconds from the earliest event, which is what the format expects
+	const double ticksPerMicrosecond = getTicksPerMicrosecond();
+	const char *separator = "\n";
+	fprintf(file, "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [");
+	for (const Window &window : windows)
+	{
+		const ThreadEvents &thread = *window.thread;
+
+		fprintf(file, "%s    { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": { \"name\": ", separator, thread.id);
+		if (!thread.name.empty())
+			writeJsonString(file, thread.name.c_str());
+		else
+			fprintf(file, "\"Thread %u\"", thread.id);
+		fprintf(file, " } }");
+		separator = ",\n";
+
+		for (uint64_t i = window.first; i < window.count; ++i)
+		{
+			const Event &event = thread.events[i & (eventCapacity - 1)];
+			const uint64_t start = event.start.load(std::memory_order_relaxed), end = event.end.load(std::memory_order_relaxed);
+
+			fprintf(file, "%s    { \"name\": ", separator);
+			writeJsonString(file, event.name.load(std::memory_order_relaxed));
+			fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f }", thread.id,
+				(start - origin) / ticksPerMicrosecond, (end - start) / ticksPerMicrosecond);
+		}
+	}
+	fprintf(file, "\n  ]\n}\n");
+
+	const bool written = !ferror(file);
+	return (fclose(file) == 0) && written;
+}
+
+void Profiler::Clear(void)
+{
+	Registry &registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (const std::unique_ptr<ThreadEvents> &thread : registry.threads)
+		thread->cleared.store(thread->count.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
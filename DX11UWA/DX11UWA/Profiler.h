@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+
+#if defined(RAPTURE_TOOLS)
+#include <chrono>
+#endif
+
+// Profiling is compiled in for debug builds, and for any other that defines RAPTURE_PROFILE. Otherwise the
+// PROFILE_ macros are compiled out and cost nothing.
+#if defined(_DEBUG) && !defined(RAPTURE_PROFILE)
+#define RAPTURE_PROFILE
+#endif
+
+// Where the time goes on every thread, as a Chrome trace (open it in Perfetto or chrome://tracing). Each thread
+// records the scopes it leaves into a ring of its own, without locking, so the trace holds the most recent
+// events of every thread, the main loop's and the loader tasks' alike. Nested scopes show up nested.
+namespace Profiler
+{
+	// Ticks of the system's monotonic clock, QueryPerformanceCounter in the app
+	inline uint64_t GetTicks(void)
+	{
+#if defined(RAPTURE_TOOLS)
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#else
+		LARGE_INTEGER ticks;
+		QueryPerformanceCounter(&ticks);
+		return ticks.QuadPart;
+#endif
+	}
+
+	// Records that the calling thread spent start to end in name, which has to outlive the profiler (a string
+	// literal or __FUNCTION__)
+	void Record(const char *name, uint64_t start, uint64_t end);
+
+	// Names the calling thread in the trace, threads without a name are numbered. Copies name.
+	void SetThreadName(const char *name);
+
+	// Every thread's events as Chrome trace-event JSON. Events recorded while it writes may or may not be
+	// included. False if the file can't be written.
+	bool WriteChromeTrace(const char *path);
+
+	// Forgets every event recorded so far
+	void Clear(void);
+}
+
+// Times the scope it's declared in, use PROFILE_SCOPE so release builds leave it out
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char *name) : m_name(name), m_start(Profiler::GetTicks()) {}
+	~ProfileScope(void) { Profiler::Record(m_name, m_start, Profiler::GetTicks()); }
+
+	ProfileScope(const ProfileScope &) = delete;
+	ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+	const char *m_name;
+	uint64_t m_start;
+};
+
+#if defined(RAPTURE_PROFILE)
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
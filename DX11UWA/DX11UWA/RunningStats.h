@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// The count, mean, standard deviation and largest of a series of samples, without keeping the samples
+// (Welford's method, which stays accurate over long series)
+class RunningStats
+{
+public:
+	RunningStats(void) { Reset(); }
+
+	void Add(double sample)
+	{
+		++m_count;
+		const double delta = sample - m_mean;
+		m_mean += delta / m_count;
+		m_squares += delta * (sample - m_mean);
+		m_max = (m_count == 1) ? sample : std::max<double>(m_max, sample);
+	}
+
+	void Reset(void)
+	{
+		m_count = 0;
+		m_mean = 0.0;
+		m_squares = 0.0;
+		m_max = 0.0;
+	}
+
+	uint64_t GetCount(void) const { return m_count; }
+	double GetMean(void) const { return m_mean; }
+	double GetMax(void) const { return m_max; }
+
+	// Of the samples themselves, 0 until there are two
+	double GetDeviation(void) const { return (m_count > 1) ? std::sqrt(m_squares / (m_count - 1)) : 0.0; }
+
+private:
+	uint64_t	m_count;
+	double		m_mean;
+	double		m_squares;	// Sum of squared differences from the mean
+	double		m_max;
+};
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "SceneAnimation.h"
+#include "Profiler.h"
+
+using namespace DirectX;
+
+namespace
+{
+	void translateCamera(XMFLOAT4X4 &camera, float x, float y, float z)
+	{
+		XMMATRIX translation = XMMatrixTranslation(x, y, z);
+		XMMATRIX temp_camera = XMLoadFloat4x4(&camera);
+		XMStoreFloat4x4(&camera, XMMatrixMultiply(translation, temp_camera));
+	}
+
+	// Adds increment to value, after reversing it if value has reached a bound
+	void bounce(float &value, float increment, float bounds, bool clamp)
+	{
+		if (value >= bounds)
+		{
+			if (clamp)
+				value = bounds;
+			increment *= -1.0f;
+		}
+		else if (value <= -bounds)
+		{
+			if (clamp)
+				value = -bounds;
+			increment *= -1.0f;
+		}
+
+		value += increment;
+	}
+
+	void lerp(DirectX::XMFLOAT4 &result, const DirectX::XMFLOAT4 &from, const DirectX::XMFLOAT4 &to, float alpha)
+	{
+		XMStoreFloat4(&result, XMVectorLerp(XMLoadFloat4(&from), XMLoadFloat4(&to), alpha));
+	}
+}
+
+void updateCamera(XMFLOAT4X4 &camera, const char *keys, bool rotating, float mouseDx, float mouseDy,
+	float elapsedSeconds, float moveSpeed, float rotateSpeed)
+{
+	PROFILE_FUNCTION();
+
+	const float distance = moveSpeed * elapsedSeconds;
+
+	if (keys['W'])
+		translateCamera(camera, 0.0f, 0.0f, distance);
+	if (keys['S'])
+		translateCamera(camera, 0.0f, 0.0f, -distance);
+	if (keys['A'])
+		translateCamera(camera, -distance, 0.0f, 0.0f);
+	if (keys['D'])
+		translateCamera(camera, distance, 0.0f, 0.0f);
+	if (keys['X'])
+		translateCamera(camera, 0.0f, -distance, 0.0f);
+	if (keys[CAMERA_KEY_UP])
+		translateCamera(camera, 0.0f, distance, 0.0f);
+
+	if (!rotating)
+		return;
+
+	// Turn around the camera's position rather than the origin
+	XMFLOAT4 pos = XMFLOAT4(camera._41, camera._42, camera._43, camera._44);
+
+	camera._41 = 0;
+	camera._42 = 0;
+	camera._43 = 0;
+
+	XMMATRIX rotX = XMMatrixRotationX(mouseDy * rotateSpeed * elapsedSeconds);
+	XMMATRIX rotY = XMMatrixRotationY(mouseDx * rotateSpeed * elapsedSeconds);
+
+	XMMATRIX temp_camera = XMLoadFloat4x4(&camera);
+	temp_camera = XMMatrixMultiply(rotX, temp_camera);
+	temp_camera = XMMatrixMultiply(temp_camera, rotY);
+
+	XMStoreFloat4x4(&camera, temp_camera);
+
+	camera._41 = pos.x;
+	camera._42 = pos.y;
+	camera._43 = pos.z;
+}
+
+void animateLights(DirectionalLight &directional, PointLight &point, SpotLight &spot, float elapsedSeconds)
+{
+	PROFILE_FUNCTION();
+
+	// The directional and point lights are held at their bounds, the spot light only turns around
+	bounce(directional.direction.y, elapsedSeconds, 5.0f, true);
+	bounce(point.position.x, elapsedSeconds, 4.0f, true);
+
+	bounce(spot.position.x, elapsedSeconds, 0.25f, false);
+	bounce(spot.position.z, elapsedSeconds, 0.25f, false);
+	bounce(spot.cone_direction.x, elapsedSeconds, 0.25f, false);
+}
+
+void interpolateScene(const SceneSnapshot &previous, const SceneSnapshot &current, float alpha, SceneSnapshot &result)
+{
+	PROFILE_FUNCTION();
+
+	result = current;
+
+	// The turn wraps at 2 pi, so take the shorter way from one angle to the other
+	float turn = current.modelRadians - previous.modelRadians;
+	if (turn > XM_PI)
+		turn -= XM_2PI;
+	else if (turn < -XM_PI)
+		turn += XM_2PI;
+	result.modelRadians = previous.modelRadians + turn * alpha;
+
+	// The camera only turns and moves, so its rotation and position blend apart
+	XMVECTOR previousScale, previousRotation, previousPosition;
+	XMVECTOR currentScale, currentRotation, currentPosition;
+	if (XMMatrixDecompose(&previousScale, &previousRotation, &previousPosition, XMLoadFloat4x4(&previous.camera)) &&
+		XMMatrixDecompose(&currentScale, &currentRotation, &currentPosition, XMLoadFloat4x4(&current.camera)))
+	{
+		XMMATRIX camera = XMMatrixRotationQuaternion(XMQuaternionSlerp(previousRotation, currentRotation, alpha));
+		camera.r[3] = XMVectorSetW(XMVectorLerp(previousPosition, currentPosition, alpha), 1.0f);
+		XMStoreFloat4x4(&result.camera, camera);
+	}
+
+	lerp(result.directional.direction, previous.directional.direction, current.directional.direction, alpha);
+	lerp(result.directional.color, previous.directional.color, current.directional.color, alpha);
+
+	lerp(result.point.position, previous.point.position, current.point.position, alpha);
+	lerp(result.point.color, previous.point.color, current.point.color, alpha);
+	lerp(result.point.radius, previous.point.radius, current.point.radius, alpha);
+
+	lerp(result.spot.position, previous.spot.position, current.spot.position, alpha);
+	lerp(result.spot.color, previous.spot.color, current.spot.color, alpha);
+	lerp(result.spot.cone_direction, previous.spot.cone_direction, current.spot.cone_direction, alpha);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+
+// What Sample3DSceneRenderer::Update changes every frame besides the constant buffers, kept free of Direct3D
+// and the Windows Runtime so the tools can run it too.
+
+struct DirectionalLight {
+	DirectX::XMFLOAT4 direction;
+	DirectX::XMFLOAT4 color;
+};
+
+struct PointLight {
+	DirectX::XMFLOAT4 position;
+	DirectX::XMFLOAT4 color;
+	DirectX::XMFLOAT4 radius;
+};
+
+struct SpotLight {
+	DirectX::XMFLOAT4 position;
+	DirectX::XMFLOAT4 color;
+	DirectX::XMFLOAT4 cone_direction;
+	DirectX::XMFLOAT4 cone_ratio;
+	DirectX::XMFLOAT4 inner_cone_ratio;
+	DirectX::XMFLOAT4 outer_cone_ratio;
+};
+
+// Index of the key that moves the camera up, VK_SPACE
+const int CAMERA_KEY_UP = 0x20;
+
+// Moves the camera with W, S, A, D, X and space in keys (256 entries, non-zero while pressed) by moveSpeed units
+// a second, then, while rotating, turns it by the mouse movement times rotateSpeed radians a second.
+void updateCamera(DirectX::XMFLOAT4X4 &camera, const char *keys, bool rotating, float mouseDx, float mouseDy,
+	float elapsedSeconds, float moveSpeed, float rotateSpeed);
+
+// Bounces the directional light's height and the point light between their bounds and swings the spot light.
+void animateLights(DirectionalLight &directional, PointLight &point, SpotLight &spot, float elapsedSeconds);
+
+// The scene as one simulation step left it. Snapshots are published whole and never changed afterwards, so the
+// render thread can draw one while the simulation thread makes the next.
+struct SceneSnapshot {
+	uint64_t step;					// Steps taken up to and including this one, 0 before the first
+	uint64_t stepTicks;				// When the step was due, on the simulation's clock
+	uint64_t inputTicks;			// When the newest input it reflects changed, on the same clock
+	float modelRadians;				// The big daddy's turn around Y
+	DirectX::XMFLOAT4X4 camera;
+	DirectionalLight directional;
+	PointLight point;
+	SpotLight spot;
+};
+
+// Blends from previous (alpha 0) to current (alpha 1): positions, directions and colors linearly, the model's
+// turn the short way round and the camera's orientation spherically. The rest is copied from current.
+void interpolateScene(const SceneSnapshot &previous, const SceneSnapshot &current, float alpha, SceneSnapshot &result);
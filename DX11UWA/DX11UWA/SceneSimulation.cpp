@@ -0,0 +1,107 @@
+#include "pch.h"
+#include "SceneSimulation.h"
+#include "Profiler.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// How fast the big daddy turns around
+	const float degreesPerSecond = 45.0f;
+
+	void initialScene(SceneSnapshot &scene)
+	{
+		memset(&scene, 0, sizeof(scene));
+
+		// Eye is at (0,0.7,-1.5), looking at point (0,-0.1,0) with the up-vector along the y-axis.
+		static const XMVECTORF32 eye = { 0.0f, 0.7f, -1.5f, 0.0f };
+		static const XMVECTORF32 at = { 0.0f, -0.1f, 0.0f, 0.0f };
+		static const XMVECTORF32 up = { 0.0f, 1.0f, 0.0f, 0.0f };
+		XMStoreFloat4x4(&scene.camera, XMMatrixInverse(nullptr, XMMatrixLookAtLH(eye, at, up)));
+
+		scene.directional.direction = { 0.0f, -4.0f, 1.0f, 0.0f };
+		scene.directional.color = { 0.250980f , 0.611764f, 1.0f, 0.0f };
+
+		scene.point.position = { 0.0f, 2.0f, 0.0f, 0.0f };
+		scene.point.color = { 0.788f, 0.886f, 1.0f, 0.0f };
+		scene.point.radius.x = 3.0f;
+
+		scene.spot.position = { 0.0f, 2.0f, 0.0f, 0.0f };
+		scene.spot.color = { 1.0f, 0.945f, 0.878f, 0.0f };
+		scene.spot.cone_direction = { 0.0f, -0.35f, -0.1f, 0.0f };
+		scene.spot.cone_ratio.x = 0.5f;
+		scene.spot.inner_cone_ratio.x = 0.96f;
+		scene.spot.outer_cone_ratio.x = 0.95f;
+	}
+}
+
+SceneSimulation::SceneSimulation(const DX::StepClock &clock) :
+	m_clock(&clock),
+	m_timer(clock),
+	m_stepSeconds(1.0 / 60),
+	m_hadPointer(false),
+	m_lastPointerX(0.0f),
+	m_lastPointerY(0.0f)
+{
+	m_timer.SetFixedTimeStep(true);
+	m_timer.SetTargetElapsedSeconds(m_stepSeconds);
+
+	initialScene(m_scene);
+	m_scene.stepTicks = m_clock->GetTicks();
+}
+
+bool SceneSimulation::Update(const SceneInput &input)
+{
+	PROFILE_FUNCTION();
+
+	const uint64_t now = m_clock->GetTicks();
+	const uint32_t steps = m_timer.GetFrameCount();
+
+	m_timer.Tick([&]()
+	{
+		Step(input);
+	});
+
+	if (m_timer.GetFrameCount() == steps)
+		return false;
+
+	// The last step was due as long before now as the time left over for the next one
+	m_scene.stepTicks = now - m_timer.GetLeftOverTicks() * m_clock->GetFrequency() / DX::StepTimer::TicksPerSecond;
+	return true;
+}
+
+double SceneSimulation::GetSecondsToNextStep(void) const
+{
+	return m_stepSeconds - DX::StepTimer::TicksToSeconds(m_timer.GetLeftOverTicks());
+}
+
+void SceneSimulation::Step(const SceneInput &input)
+{
+	PROFILE_FUNCTION();
+
+	const float elapsedSeconds = static_cast<float>(m_timer.GetElapsedSeconds());
+
+	m_scene.step = m_timer.GetFrameCount();
+	m_scene.inputTicks = input.ticks;
+	m_scene.modelRadians = static_cast<float>(fmod(m_timer.GetTotalSeconds() * XMConvertToRadians(degreesPerSecond), XM_2PI));
+
+	// The camera turns by how far the pointer moved since the last step, while the right button is held
+	bool rotating = false;
+	float dx = 0.0f, dy = 0.0f;
+	if (input.hasPointer)
+	{
+		if (input.rotating && m_hadPointer)
+		{
+			rotating = true;
+			dx = input.pointerX - m_lastPointerX;
+			dy = input.pointerY - m_lastPointerY;
+		}
+
+		m_hadPointer = true;
+		m_lastPointerX = input.pointerX;
+		m_lastPointerY = input.pointerY;
+	}
+
+	updateCamera(m_scene.camera, input.keys, rotating, dx, dy, elapsedSeconds, 1.0f, 0.75f);
+	animateLights(m_scene.directional, m_scene.point, m_scene.spot, elapsedSeconds);
+}
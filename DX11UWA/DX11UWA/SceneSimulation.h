@@ -0,0 +1,49 @@
+#pragma once
+#include "Common/StepTimer.h"
+#include "SceneAnimation.h"
+
+// The keyboard and mouse as the simulation reads them, sampled on the UI thread
+struct SceneInput {
+	char keys[256];					// Non-zero while pressed, by virtual key
+	bool hasPointer;				// False until the pointer has been seen over the window
+	bool rotating;					// The right button is held
+	float pointerX, pointerY;
+	uint64_t ticks;					// When any of it last changed, on the simulation's clock
+};
+
+// The big daddy's turn, the camera and the lights, stepped at a fixed 60 Hz however often it's updated. Each
+// update leaves the result of its last step in GetScene, ready to publish to the renderers (see TripleBuffer.h).
+// Free of Direct3D and the Windows Runtime like SceneAnimation.h, so the tools can drive it on a virtual clock.
+class SceneSimulation
+{
+public:
+	// Times the steps with clock, which has to outlive the simulation
+	explicit SceneSimulation(const DX::StepClock &clock = DX::SystemStepClock::Get());
+
+	// Takes every step that's due by now with input, true if there was any
+	bool Update(const SceneInput &input);
+
+	// The scene as the last step left it, the initial one before the first
+	const SceneSnapshot &GetScene(void) const { return m_scene; }
+
+	// Seconds from the last update until the next step is due
+	double GetSecondsToNextStep(void) const;
+
+	// Seconds each step simulates
+	double GetStepSeconds(void) const { return m_stepSeconds; }
+
+	// Starts counting from now, so the steps missed while the loop was stopped aren't made up
+	void ResetElapsedTime(void) { m_timer.ResetElapsedTime(); }
+
+private:
+	void Step(const SceneInput &input);
+
+	const DX::StepClock *m_clock;
+	DX::StepTimer m_timer;
+	double m_stepSeconds;
+	SceneSnapshot m_scene;
+
+	// Where the pointer was at the last step, the camera turns by how far it moved since
+	bool m_hadPointer;
+	float m_lastPointerX, m_lastPointerY;
+};
@@ -1,27 +1,71 @@
 #pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
+#include "SceneAnimation.h"
 
-struct Model
-{
-	// For rendering
-	bool _loadingComplete;
+struct MeshStream;
 
+// What is drawn of a mesh, shared by every model drawn from it (see D3DAssetCache.h)
+struct MeshGeometry
+{
 	// Index Count
 	uint32	_indexCount;
 
-	// Direct 3D resources for the model
-	// ComPtr are safe to share
-	Microsoft::WRL::ComPtr<ID3D11InputLayout>	_inputLayout;
+	// Size of one vertex in _vertexBuffer
+	UINT	_vertexStride;
+
+	// R16_UINT or R32_UINT, see MeshCache.h
+	DXGI_FORMAT	_indexFormat;
+
+	// Ranges of the index buffer, each drawn with its own base vertex
+	std::vector<RMeshSubmesh>					_submeshes;
+	std::vector<RMeshSubmeshBounds>				_submeshBounds;
+
+	// Index in the shared MaterialTable of each material of the mesh, by RMeshSubmesh::materialIndex
+	std::vector<uint32_t>						_materials;
+
+	// Levels of detail as runs of _submeshes and the bounding sphere they're picked with
+	std::vector<MeshLod>						_lods;
+	DirectX::XMFLOAT3							_boundsCenter;
+	float										_boundsRadius;
+
+	// Culling clusters of the mesh, empty if it has none
+	std::vector<MeshCluster>					_clusters;
+	MeshClusterBounds							_clusterBounds;
+
 	Microsoft::WRL::ComPtr<ID3D11Buffer>		_vertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer>		_indexBuffer;
-	Microsoft::WRL::ComPtr<ID3D11VertexShader>	_vertexShader;
-	Microsoft::WRL::ComPtr<ID3D11PixelShader>	_pixelShader;
-	Microsoft::WRL::ComPtr<ID3D11Buffer>		_constantBuffer;
 
-	// Stuff that individuals models will have
-	std::vector<DirectX::XMFLOAT3>				_vertices;
-	std::vector<DirectX::XMFLOAT2>				_uvs;
-	std::vector<DirectX::XMFLOAT3>				_normals;
+	// Only set when the vertices are packed, see VertexPacking.h
+	Microsoft::WRL::ComPtr<ID3D11Buffer>		_dequantizationBuffer;
+
+	// Set while the mesh is still streamed in from its OBJ, see startMeshStream in Sample3DSceneRenderer.cpp
+	std::shared_ptr<MeshStream>					_stream;
+};
+
+struct Model
+{
+	// For rendering. Set by the loading task once everything else the model is drawn with is, and read by the
+	// render thread with acquire, so the render thread sees all of it.
+	std::atomic<bool>							_loadingComplete;
+
+	// Only read and written with std::atomic_load and std::atomic_store, the render thread reads it while a
+	// loading task may set it
+	std::shared_ptr<MeshGeometry>				_mesh;
+
+	// The level of detail drawn last frame. The rest is scratch space for drawing the clusters.
+	unsigned int								_lod;
+	std::vector<uint8_t>						_clusterCulling;
+	std::vector<RMeshSubmesh>					_drawRanges;
+
+	// Direct 3D resources for the model
+	// Shaders and input layouts are shared through D3DAssetCache, the constant buffer is the model's own
+	std::shared_ptr<ID3D11InputLayout>			_inputLayout;
+	std::shared_ptr<ID3D11VertexShader>			_vertexShader;
+	std::shared_ptr<ID3D11PixelShader>			_pixelShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer>		_constantBuffer;
 
 	// Path to the texture if it exists
 	const char 									*_texture_path;
@@ -30,22 +74,19 @@ struct Model
 	DirectX::XMMATRIX							_world_matrix;
 };
 
-struct DirectionalLight {
-	DirectX::XMFLOAT4 direction;
-	DirectX::XMFLOAT4 color;
-};
+// Hands a mesh that is streamed in from the loading thread to the render thread. The loading thread appends
+// geometry, the render thread takes it every frame and copies it into the mesh's buffers after what's already there.
+struct MeshStream
+{
+	std::mutex						mutex;
+	std::vector<uint8_t>			vertices;		// In the vertex buffer's format
+	std::vector<uint8_t>			indices;		// In the index buffer's format, whole triangles
+	std::unique_ptr<MeshGeometry>	replacement;	// The cooked mesh to draw instead once streaming is done, if it could be built
+	bool							finished;
 
-struct PointLight {
-	DirectX::XMFLOAT4 position;
-	DirectX::XMFLOAT4 color;
-	DirectX::XMFLOAT4 radius;
-};
+	// Only used by the render thread
+	UINT							uploadedVertexBytes;
+	UINT							uploadedIndexBytes;
 
-struct SpotLight {
-	DirectX::XMFLOAT4 position;
-	DirectX::XMFLOAT4 color;
-	DirectX::XMFLOAT4 cone_direction;
-	DirectX::XMFLOAT4 cone_ratio;
-	DirectX::XMFLOAT4 inner_cone_ratio;
-	DirectX::XMFLOAT4 outer_cone_ratio;
-};
\ No newline at end of file
+	MeshStream(void) : finished(false), uploadedVertexBytes(0), uploadedIndexBytes(0) {}
+};
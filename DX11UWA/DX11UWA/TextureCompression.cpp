@@ -0,0 +1,1384 @@
+#include "pch.h"
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TEXTURE_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Below this many blocks a texture isn't worth starting another thread for
+	const size_t minBlocksPerThread = 256;
+
+	// Passes of least squares refinement and of endpoint search at each quality
+	const int refinements[3] = { 0, 1, 8 };
+	const int searchPasses = 4;
+
+	enum BlockKind
+	{
+		BLOCK_NONE,
+		BLOCK_BC1,
+		BLOCK_BC3,
+		BLOCK_BC5,
+		BLOCK_BC7
+	};
+
+	BlockKind blockKind(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			return BLOCK_BC1;
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+			return BLOCK_BC3;
+		case DXGI_FORMAT_BC5_UNORM:
+			return BLOCK_BC5;
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return BLOCK_BC7;
+		default:
+			return BLOCK_NONE;
+		}
+	}
+
+	size_t blockBytes(BlockKind kind)
+	{
+		return (kind == BLOCK_BC1) ? 8 : 16;
+	}
+
+	// Channels of the pixels the format keeps, bit 0 for red
+	uint32_t keptChannels(BlockKind kind)
+	{
+		switch (kind)
+		{
+		case BLOCK_BC1:
+			return 0x7;
+		case BLOCK_BC5:
+			return 0x3;
+		default:
+			return 0xf;
+		}
+	}
+
+	typedef uint8_t Color[4];
+
+	// Bytes of channels first to first + count - 1 of a pixel read as a little endian 32 bit value
+	uint32_t channelBytes(int first, int count)
+	{
+		uint32_t mask = 0;
+		for (int c = first; c < first + count; ++c)
+			mask |= 0xffu << (8 * c);
+		return mask;
+	}
+
+	uint8_t clampToByte(float value)
+	{
+		return static_cast<uint8_t>(std::min(std::max(value + 0.5f, 0.0f), 255.0f));
+	}
+
+	void write16(uint8_t *out, uint16_t value)
+	{
+		out[0] = static_cast<uint8_t>(value);
+		out[1] = static_cast<uint8_t>(value >> 8);
+	}
+
+	uint16_t read16(const uint8_t *in)
+	{
+		return static_cast<uint16_t>(in[0] | (in[1] << 8));
+	}
+
+	// Index of the nearest palette entry to each of the 16 pixels of a block, over the channels in channelMask,
+	// and the sum of their squared distances. Ties go to the first entry.
+#if defined(TEXTURE_COMPRESSION_SSE2)
+	// Four pixels at a time: the channels widen to 16 bits, and _mm_madd_epi16 squares and sums them in
+	// pairs, which two shuffles then add up per pixel
+	uint32_t selectIndices(const uint8_t *pixels, const Color *palette, int paletteSize, uint32_t channelMask, uint8_t *indices)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i mask = _mm_set1_epi32(static_cast<int>(channelMask));
+
+		__m128i entries[16];
+		for (int entry = 0; entry < paletteSize; ++entry)
+		{
+			uint32_t color;
+			memcpy(&color, palette[entry], sizeof(color));
+			entries[entry] = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color & channelMask)), zero);
+		}
+
+		__m128i total = zero;
+		for (int group = 0; group < 16; group += 4)
+		{
+			const __m128i quad = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + group * 4)), mask);
+			const __m128i low = _mm_unpacklo_epi8(quad, zero);
+			const __m128i high = _mm_unpackhi_epi8(quad, zero);
+
+			__m128i bestError = _mm_set1_epi32(INT_MAX);
+			__m128i bestIndex = zero;
+			for (int entry = 0; entry < paletteSize; ++entry)
+			{
+				const __m128i lowDifference = _mm_sub_epi16(low, entries[entry]);
+				const __m128i highDifference = _mm_sub_epi16(high, entries[entry]);
+				const __m128 lowSums = _mm_castsi128_ps(_mm_madd_epi16(lowDifference, lowDifference));
+				const __m128 highSums = _mm_castsi128_ps(_mm_madd_epi16(highDifference, highDifference));
+				const __m128i error = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(lowSums, highSums, _MM_SHUFFLE(2, 0, 2, 0))),
+					_mm_castps_si128(_mm_shuffle_ps(lowSums, highSums, _MM_SHUFFLE(3, 1, 3, 1))));
+
+				const __m128i better = _mm_cmplt_epi32(error, bestError);
+				bestError = _mm_or_si128(_mm_and_si128(better, error), _mm_andnot_si128(better, bestError));
+				bestIndex = _mm_or_si128(_mm_and_si128(better, _mm_set1_epi32(entry)), _mm_andnot_si128(better, bestIndex));
+			}
+
+			total = _mm_add_epi32(total, bestError);
+
+			int32_t lanes[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), bestIndex);
+			for (int i = 0; i < 4; ++i)
+				indices[group + i] = static_cast<uint8_t>(lanes[i]);
+		}
+
+		int32_t sums[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(sums), total);
+		return static_cast<uint32_t>(sums[0] + sums[1] + sums[2] + sums[3]);
+	}
+#else
+	uint32_t selectIndices(const uint8_t *pixels, const Color *palette, int paletteSize, uint32_t channelMask, uint8_t *indices)
+	{
+		uint32_t total = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t best = UINT_MAX;
+			for (int entry = 0; entry < paletteSize; ++entry)
+			{
+				uint32_t error = 0;
+				for (int c = 0; c < 4; ++c)
+				{
+					if (channelMask & (0xffu << (8 * c)))
+					{
+						const int difference = pixels[i * 4 + c] - palette[entry][c];
+						error += difference * difference;
+					}
+				}
+
+				if (error < best)
+				{
+					best = error;
+					indices[i] = static_cast<uint8_t>(entry);
+				}
+			}
+			total += best;
+		}
+		return total;
+	}
+#endif
+
+	// Endpoints of the segment along the principal axis of channels first to first + count - 1 of the pixels
+	// that reaches the furthest of them both ways
+	void principalAxisEndpoints(const uint8_t *pixels, int first, int count, float e0[4], float e1[4])
+	{
+		float mean[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < count; ++c)
+				mean[c] += pixels[i * 4 + first + c];
+		}
+		for (int c = 0; c < count; ++c)
+			mean[c] /= 16.0f;
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int a = 0; a < count; ++a)
+			{
+				for (int b = a; b < count; ++b)
+					covariance[a][b] += (pixels[i * 4 + first + a] - mean[a]) * (pixels[i * 4 + first + b] - mean[b]);
+			}
+		}
+		for (int a = 0; a < count; ++a)
+		{
+			for (int b = 0; b < a; ++b)
+				covariance[a][b] = covariance[b][a];
+		}
+
+		// Power iteration, from the row of the channel that varies most
+		int widest = 0;
+		for (int c = 1; c < count; ++c)
+		{
+			if (covariance[c][c] > covariance[widest][widest])
+				widest = c;
+		}
+
+		float axis[4] = {};
+		if (covariance[widest][widest] > 0.0f)
+		{
+			std::copy(covariance[widest], covariance[widest] + count, axis);
+			for (int iteration = 0; iteration < 8; ++iteration)
+			{
+				float next[4] = {};
+				float largest = 0.0f;
+				for (int a = 0; a < count; ++a)
+				{
+					for (int b = 0; b < count; ++b)
+						next[a] += covariance[a][b] * axis[b];
+					largest = std::max(largest, fabsf(next[a]));
+				}
+				if (largest == 0.0f)
+					break;
+				for (int c = 0; c < count; ++c)
+					axis[c] = next[c] / largest;
+			}
+
+			float length = 0.0f;
+			for (int c = 0; c < count; ++c)
+				length += axis[c] * axis[c];
+			length = sqrtf(length);
+			for (int c = 0; c < count; ++c)
+				axis[c] = (length > 0.0f) ? axis[c] / length : 0.0f;
+		}
+
+		float lowest = 0.0f;
+		float highest = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < count; ++c)
+				t += (pixels[i * 4 + first + c] - mean[c]) * axis[c];
+			lowest = std::min(lowest, t);
+			highest = std::max(highest, t);
+		}
+
+		for (int c = 0; c < count; ++c)
+		{
+			e0[c] = std::min(std::max(mean[c] + axis[c] * highest, 0.0f), 255.0f);
+			e1[c] = std::min(std::max(mean[c] + axis[c] * lowest, 0.0f), 255.0f);
+		}
+	}
+
+	// Corners of the bounding box of the pixels, pulled in by a 16th of its size since the colors at the corners
+	// are rarely the ones the block needs. The diagonal is the one the channels vary along together.
+	void boundingBoxEndpoints(const uint8_t *pixels, int first, int count, float e0[4], float e1[4])
+	{
+		float lowest[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+		float highest[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < count; ++c)
+			{
+				lowest[c] = std::min(lowest[c], static_cast<float>(pixels[i * 4 + first + c]));
+				highest[c] = std::max(highest[c], static_cast<float>(pixels[i * 4 + first + c]));
+			}
+		}
+
+		int widest = 0;
+		for (int c = 0; c < count; ++c)
+		{
+			const float inset = (highest[c] - lowest[c]) / 16.0f;
+			e0[c] = highest[c] - inset;
+			e1[c] = lowest[c] + inset;
+			if (highest[c] - lowest[c] > highest[widest] - lowest[widest])
+				widest = c;
+		}
+
+		for (int c = 0; c < count; ++c)
+		{
+			if (c == widest)
+				continue;
+
+			float together = 0.0f;
+			for (int i = 0; i < 16; ++i)
+			{
+				together += (pixels[i * 4 + first + widest] - (lowest[widest] + highest[widest]) * 0.5f) *
+					(pixels[i * 4 + first + c] - (lowest[c] + highest[c]) * 0.5f);
+			}
+			if (together < 0.0f)
+				std::swap(e0[c], e1[c]);
+		}
+	}
+
+	// Endpoints that minimize the squared error of the palette entries the pixels were given, where entry index is
+	// weights[index] of the way from e0 to e1. Returns false when every pixel has the same weight.
+	bool leastSquaresEndpoints(const uint8_t *pixels, int first, int count, const uint8_t *indices, const float *weights, float e0[4], float e1[4])
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			const float b = weights[indices[i]];
+			const float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < count; ++c)
+			{
+				ax[c] += a * pixels[i * 4 + first + c];
+				bx[c] += b * pixels[i * 4 + first + c];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+			return false;
+
+		for (int c = 0; c < count; ++c)
+		{
+			e0[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+			e1[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	// BC1 color blocks: two RGB565 endpoints and a 2 bit index per pixel
+
+	const float bc1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	struct ColorFit
+	{
+		uint16_t	c0;
+		uint16_t	c1;
+		uint8_t		indices[16];
+		uint32_t	error;
+	};
+
+	uint16_t toRgb565(const float color[4])
+	{
+		const int r = std::min(static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f), 31);
+		const int g = std::min(static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f), 63);
+		const int b = std::min(static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f), 31);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void fromRgb565(uint16_t value, uint8_t color[4])
+	{
+		const int r = value >> 11;
+		const int g = (value >> 5) & 63;
+		const int b = value & 31;
+		color[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+		color[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+		color[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+		color[3] = 255;
+	}
+
+	// BC1 blocks with c0 <= c1 have three colors and transparent black, BC3 color blocks always have four
+	void bc1Palette(uint16_t c0, uint16_t c1, bool fourColors, Color palette[4])
+	{
+		fromRgb565(c0, palette[0]);
+		fromRgb565(c1, palette[1]);
+		if (fourColors || c0 > c1)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+				palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+			}
+			palette[2][3] = palette[3][3] = 255;
+		}
+		else
+		{
+			for (int c = 0; c < 3; ++c)
+				palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c] + 1) / 2);
+			palette[2][3] = 255;
+			memset(palette[3], 0, sizeof(palette[3]));
+		}
+	}
+
+	void evaluateColor(const uint8_t *pixels, ColorFit &fit)
+	{
+		Color palette[4];
+		bc1Palette(fit.c0, fit.c1, true, palette);
+		fit.error = selectIndices(pixels, palette, 4, channelBytes(0, 3), fit.indices);
+	}
+
+	void fitColor(const uint8_t *pixels, TextureQuality quality, ColorFit &best)
+	{
+		float e0[4], e1[4];
+		if (quality == TEXTURE_QUALITY_FAST)
+			boundingBoxEndpoints(pixels, 0, 3, e0, e1);
+		else
+			principalAxisEndpoints(pixels, 0, 3, e0, e1);
+
+		best.c0 = toRgb565(e0);
+		best.c1 = toRgb565(e1);
+		evaluateColor(pixels, best);
+
+		for (int pass = 0; pass < refinements[quality] && best.error > 0; ++pass)
+		{
+			ColorFit refined;
+			if (!leastSquaresEndpoints(pixels, 0, 3, best.indices, bc1Weights, e0, e1))
+				break;
+
+			refined.c0 = toRgb565(e0);
+			refined.c1 = toRgb565(e1);
+			if (refined.c0 == best.c0 && refined.c1 == best.c1)
+				break;
+
+			evaluateColor(pixels, refined);
+			if (refined.error >= best.error)
+				break;
+			best = refined;
+		}
+
+		if (quality != TEXTURE_QUALITY_HIGH)
+			return;
+
+		// Each of the six fields of the endpoints a step either way, for as long as that lowers the error
+		static const int shifts[3] = { 11, 5, 0 };
+		static const int limits[3] = { 31, 63, 31 };
+		bool improved = true;
+		for (int pass = 0; pass < searchPasses && improved && best.error > 0; ++pass)
+		{
+			improved = false;
+			for (int endpoint = 0; endpoint < 2; ++endpoint)
+			{
+				for (int field = 0; field < 3; ++field)
+				{
+					for (int step = -1; step <= 1; step += 2)
+					{
+						ColorFit candidate = best;
+						uint16_t &value = endpoint ? candidate.c1 : candidate.c0;
+						const int stepped = ((value >> shifts[field]) & limits[field]) + step;
+						if (stepped < 0 || stepped > limits[field])
+							continue;
+
+						value = static_cast<uint16_t>((value & ~(limits[field] << shifts[field])) | (stepped << shifts[field]));
+						evaluateColor(pixels, candidate);
+						if (candidate.error < best.error)
+						{
+							best = candidate;
+							improved = true;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void writeColor(const ColorFit &fit, uint8_t *out)
+	{
+		// The four color mode needs c0 > c1: swapping the endpoints swaps indices 0 and 1 and 2 and 3. With equal
+		// endpoints every pixel takes the first.
+		uint16_t c0 = fit.c0;
+		uint16_t c1 = fit.c1;
+		uint32_t flip = 0;
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			flip = 1;
+		}
+
+		uint32_t indices = 0;
+		if (c0 != c1)
+		{
+			for (int i = 0; i < 16; ++i)
+				indices |= static_cast<uint32_t>(fit.indices[i] ^ flip) << (2 * i);
+		}
+
+		write16(out, c0);
+		write16(out + 2, c1);
+		write16(out + 4, static_cast<uint16_t>(indices));
+		write16(out + 6, static_cast<uint16_t>(indices >> 16));
+	}
+
+	void decodeColor(const uint8_t *in, bool fourColors, uint8_t *pixels)
+	{
+		Color palette[4];
+		bc1Palette(read16(in), read16(in + 2), fourColors, palette);
+
+		const uint32_t indices = read16(in + 4) | (static_cast<uint32_t>(read16(in + 6)) << 16);
+		for (int i = 0; i < 16; ++i)
+			memcpy(pixels + i * 4, palette[(indices >> (2 * i)) & 3], 4);
+	}
+
+	// BC4 blocks: two 8 bit endpoints and a 3 bit index per pixel, for one channel
+
+	const float bc4Weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+	struct ChannelFit
+	{
+		uint8_t		a0;
+		uint8_t		a1;
+		uint8_t		indices[16];
+		uint32_t	error;
+	};
+
+	// Blocks with a0 > a1 have eight levels between them, the others six and 0 and 255. The palette has the
+	// levels in the byte of channel.
+	void bc4Palette(uint8_t a0, uint8_t a1, int channel, Color palette[8])
+	{
+		uint8_t levels[8];
+		levels[0] = a0;
+		levels[1] = a1;
+		if (a0 > a1)
+		{
+			for (int i = 1; i < 7; ++i)
+				levels[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1 + 3) / 7);
+		}
+		else
+		{
+			for (int i = 1; i < 5; ++i)
+				levels[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1 + 2) / 5);
+			levels[6] = 0;
+			levels[7] = 255;
+		}
+
+		memset(palette, 0, sizeof(Color) * 8);
+		for (int i = 0; i < 8; ++i)
+			palette[i][channel] = levels[i];
+	}
+
+	void evaluateChannel(const uint8_t *pixels, int channel, ChannelFit &fit)
+	{
+		Color palette[8];
+		bc4Palette(fit.a0, fit.a1, channel, palette);
+		fit.error = selectIndices(pixels, palette, 8, channelBytes(channel, 1), fit.indices);
+	}
+
+	void fitChannel(const uint8_t *pixels, int channel, TextureQuality quality, ChannelFit &best)
+	{
+		uint8_t lowest = 255;
+		uint8_t highest = 0;
+		uint8_t innerLowest = 255;
+		uint8_t innerHighest = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			const uint8_t value = pixels[i * 4 + channel];
+			lowest = std::min(lowest, value);
+			highest = std::max(highest, value);
+			if (value != 0 && value != 255)
+			{
+				innerLowest = std::min(innerLowest, value);
+				innerHighest = std::max(innerHighest, value);
+			}
+		}
+
+		// Equal endpoints make a six level block whose first level is exact
+		best.a0 = highest;
+		best.a1 = lowest;
+		evaluateChannel(pixels, channel, best);
+		if (quality == TEXTURE_QUALITY_FAST || best.error == 0)
+			return;
+
+		// Blocks with 0 or 255 in them can spend all their levels on the rest
+		if ((lowest == 0 || highest == 255) && innerLowest <= innerHighest)
+		{
+			ChannelFit candidate;
+			candidate.a0 = innerLowest;
+			candidate.a1 = innerHighest;
+			evaluateChannel(pixels, channel, candidate);
+			if (candidate.error < best.error)
+				best = candidate;
+		}
+
+		for (int pass = 0; pass < refinements[quality] && best.error > 0 && best.a0 > best.a1; ++pass)
+		{
+			float e0[4], e1[4];
+			if (!leastSquaresEndpoints(pixels, channel, 1, best.indices, bc4Weights, e0, e1))
+				break;
+
+			ChannelFit refined;
+			refined.a0 = clampToByte(e0[0]);
+			refined.a1 = clampToByte(e1[0]);
+			if (refined.a0 <= refined.a1 || (refined.a0 == best.a0 && refined.a1 == best.a1))
+				break;
+
+			evaluateChannel(pixels, channel, refined);
+			if (refined.error >= best.error)
+				break;
+			best = refined;
+		}
+
+		if (quality != TEXTURE_QUALITY_HIGH)
+			return;
+
+		bool improved = true;
+		for (int pass = 0; pass < searchPasses && improved && best.error > 0; ++pass)
+		{
+			improved = false;
+			for (int endpoint = 0; endpoint < 2; ++endpoint)
+			{
+				for (int step = -1; step <= 1; step += 2)
+				{
+					ChannelFit candidate = best;
+					uint8_t &value = endpoint ? candidate.a1 : candidate.a0;
+					if ((step < 0 && value == 0) || (step > 0 && value == 255))
+						continue;
+
+					value = static_cast<uint8_t>(value + step);
+					evaluateChannel(pixels, channel, candidate);
+					if (candidate.error < best.error)
+					{
+						best = candidate;
+						improved = true;
+					}
+				}
+			}
+		}
+	}
+
+	void writeChannel(const ChannelFit &fit, uint8_t *out)
+	{
+		out[0] = fit.a0;
+		out[1] = fit.a1;
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 16; ++i)
+			indices |= static_cast<uint64_t>(fit.indices[i]) << (3 * i);
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+	}
+
+	void decodeChannel(const uint8_t *in, int channel, uint8_t *pixels)
+	{
+		Color palette[8];
+		bc4Palette(in[0], in[1], channel, palette);
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; ++i)
+			indices |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+		for (int i = 0; i < 16; ++i)
+			pixels[i * 4 + channel] = palette[(indices >> (3 * i)) & 7][channel];
+	}
+
+	// BC7 blocks are 128 bits read from the least significant bit of the first byte
+
+	class BlockWriter
+	{
+	public:
+		BlockWriter(uint8_t *out) : m_out(out), m_position(0) { memset(out, 0, 16); }
+
+		void Write(uint32_t value, int count)
+		{
+			for (int i = 0; i < count; ++i, ++m_position)
+			{
+				if ((value >> i) & 1)
+					m_out[m_position >> 3] |= static_cast<uint8_t>(1 << (m_position & 7));
+			}
+		}
+
+	private:
+		uint8_t	*m_out;
+		int		m_position;
+	};
+
+	class BlockReader
+	{
+	public:
+		BlockReader(const uint8_t *in) : m_in(in), m_position(0) {}
+
+		uint32_t Read(int count)
+		{
+			uint32_t value = 0;
+			for (int i = 0; i < count; ++i, ++m_position)
+				value |= static_cast<uint32_t>((m_in[m_position >> 3] >> (m_position & 7)) & 1) << i;
+			return value;
+		}
+
+	private:
+		const uint8_t	*m_in;
+		int				m_position;
+	};
+
+	const int bc7Weights2[4] = { 0, 21, 43, 64 };
+	const int bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	const float bc7FloatWeights2[4] = { 0.0f, 21.0f / 64.0f, 43.0f / 64.0f, 1.0f };
+	const float bc7FloatWeights4[16] = { 0.0f, 4.0f / 64.0f, 9.0f / 64.0f, 13.0f / 64.0f, 17.0f / 64.0f, 21.0f / 64.0f, 26.0f / 64.0f,
+		30.0f / 64.0f, 34.0f / 64.0f, 38.0f / 64.0f, 43.0f / 64.0f, 47.0f / 64.0f, 51.0f / 64.0f, 55.0f / 64.0f, 60.0f / 64.0f, 1.0f };
+
+	uint8_t bc7Interpolate(int e0, int e1, int weight)
+	{
+		return static_cast<uint8_t>((e0 * (64 - weight) + e1 * weight + 32) >> 6);
+	}
+
+	// Mode 6: RGBA endpoints of 7 bits and a shared lowest bit each, and a 4 bit index per pixel
+
+	struct Mode6Fit
+	{
+		uint8_t		endpoints[2][4];
+		uint8_t		pBits[2];
+		uint8_t		indices[16];
+		uint32_t	error;
+	};
+
+	void mode6Palette(const Mode6Fit &fit, Color palette[16])
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+				palette[i][c] = bc7Interpolate((fit.endpoints[0][c] << 1) | fit.pBits[0], (fit.endpoints[1][c] << 1) | fit.pBits[1], bc7Weights4[i]);
+		}
+	}
+
+	void evaluateMode6(const uint8_t *pixels, Mode6Fit &fit)
+	{
+		Color palette[16];
+		mode6Palette(fit, palette);
+		fit.error = selectIndices(pixels, palette, 16, 0xffffffff, fit.indices);
+	}
+
+	// Quantizes e0 and e1 with each of the four combinations of p-bits and keeps the best
+	void setMode6Endpoints(const uint8_t *pixels, const float e0[4], const float e1[4], Mode6Fit &best)
+	{
+		best.error = UINT_MAX;
+		for (int bits = 0; bits < 4; ++bits)
+		{
+			Mode6Fit candidate;
+			candidate.pBits[0] = static_cast<uint8_t>(bits & 1);
+			candidate.pBits[1] = static_cast<uint8_t>(bits >> 1);
+			for (int c = 0; c < 4; ++c)
+			{
+				candidate.endpoints[0][c] = static_cast<uint8_t>(std::min(std::max(static_cast<int>((e0[c] - candidate.pBits[0]) * 0.5f + 0.5f), 0), 127));
+				candidate.endpoints[1][c] = static_cast<uint8_t>(std::min(std::max(static_cast<int>((e1[c] - candidate.pBits[1]) * 0.5f + 0.5f), 0), 127));
+			}
+
+			evaluateMode6(pixels, candidate);
+			if (candidate.error < best.error)
+				best = candidate;
+		}
+	}
+
+	void fitMode6(const uint8_t *pixels, TextureQuality quality, Mode6Fit &best)
+	{
+		float e0[4], e1[4];
+		if (quality == TEXTURE_QUALITY_FAST)
+			boundingBoxEndpoints(pixels, 0, 4, e0, e1);
+		else
+			principalAxisEndpoints(pixels, 0, 4, e0, e1);
+		setMode6Endpoints(pixels, e0, e1, best);
+
+		for (int pass = 0; pass < refinements[quality] && best.error > 0; ++pass)
+		{
+			if (!leastSquaresEndpoints(pixels, 0, 4, best.indices, bc7FloatWeights4, e0, e1))
+				break;
+
+			Mode6Fit refined;
+			setMode6Endpoints(pixels, e0, e1, refined);
+			if (refined.error >= best.error)
+				break;
+			best = refined;
+		}
+
+		if (quality != TEXTURE_QUALITY_HIGH)
+			return;
+
+		bool improved = true;
+		for (int pass = 0; pass < searchPasses && improved && best.error > 0; ++pass)
+		{
+			improved = false;
+			for (int endpoint = 0; endpoint < 2; ++endpoint)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					for (int step = -1; step <= 1; step += 2)
+					{
+						Mode6Fit candidate = best;
+						uint8_t &value = candidate.endpoints[endpoint][c];
+						if ((step < 0 && value == 0) || (step > 0 && value == 127))
+							continue;
+
+						value = static_cast<uint8_t>(value + step);
+						evaluateMode6(pixels, candidate);
+						if (candidate.error < best.error)
+						{
+							best = candidate;
+							improved = true;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void writeMode6(const Mode6Fit &fit, uint8_t *out)
+	{
+		// The first pixel's index is stored without its top bit, so it has to be below 8. Swapping the endpoints
+		// makes it so, with every index reversed.
+		const bool swap = fit.indices[0] >= 8;
+		const int first = swap ? 1 : 0;
+
+		BlockWriter writer(out);
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Write(fit.endpoints[first][c], 7);
+			writer.Write(fit.endpoints[1 - first][c], 7);
+		}
+		writer.Write(fit.pBits[first], 1);
+		writer.Write(fit.pBits[1 - first], 1);
+
+		for (int i = 0; i < 16; ++i)
+			writer.Write(swap ? 15 - fit.indices[i] : fit.indices[i], i ? 4 : 3);
+	}
+
+	// Mode 5: RGB endpoints of 7 bits and alpha endpoints of 8 with a 2 bit index per pixel for each, after
+	// swapping one of the color channels with the alpha if the rotation says so
+
+	struct Mode5Fit
+	{
+		int			rotation;		// 0 for none, else 1 + the channel swapped with the alpha
+		uint8_t		color[2][3];
+		uint8_t		alpha[2];
+		uint8_t		colorIndices[16];
+		uint8_t		alphaIndices[16];
+		uint32_t	error;
+	};
+
+	uint8_t unquantize7(uint8_t value)
+	{
+		return static_cast<uint8_t>((value << 1) | (value >> 6));
+	}
+
+	uint32_t evaluateMode5Color(const uint8_t *pixels, const uint8_t color[2][3], uint8_t *indices)
+	{
+		Color palette[4] = {};
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int c = 0; c < 3; ++c)
+				palette[i][c] = bc7Interpolate(unquantize7(color[0][c]), unquantize7(color[1][c]), bc7Weights2[i]);
+		}
+		return selectIndices(pixels, palette, 4, channelBytes(0, 3), indices);
+	}
+
+	uint32_t evaluateMode5Alpha(const uint8_t *pixels, const uint8_t alpha[2], uint8_t *indices)
+	{
+		Color palette[4] = {};
+		for (int i = 0; i < 4; ++i)
+			palette[i][3] = bc7Interpolate(alpha[0], alpha[1], bc7Weights2[i]);
+		return selectIndices(pixels, palette, 4, channelBytes(3, 1), indices);
+	}
+
+	void quantizeMode5Color(const float e0[4], const float e1[4], uint8_t color[2][3])
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			color[0][c] = static_cast<uint8_t>(std::min(static_cast<int>(e0[c] * 127.0f / 255.0f + 0.5f), 127));
+			color[1][c] = static_cast<uint8_t>(std::min(static_cast<int>(e1[c] * 127.0f / 255.0f + 0.5f), 127));
+		}
+	}
+
+	// The color and the alpha are fitted apart, since each has its own indices
+	void fitMode5(const uint8_t *source, int rotation, Mode5Fit &fit)
+	{
+		uint8_t pixels[64];
+		memcpy(pixels, source, sizeof(pixels));
+		if (rotation)
+		{
+			for (int i = 0; i < 16; ++i)
+				std::swap(pixels[i * 4 + rotation - 1], pixels[i * 4 + 3]);
+		}
+		fit.rotation = rotation;
+
+		float e0[4], e1[4];
+		principalAxisEndpoints(pixels, 0, 3, e0, e1);
+		quantizeMode5Color(e0, e1, fit.color);
+		uint32_t colorError = evaluateMode5Color(pixels, fit.color, fit.colorIndices);
+
+		for (int pass = 0; pass < refinements[TEXTURE_QUALITY_HIGH] && colorError > 0; ++pass)
+		{
+			uint8_t color[2][3];
+			uint8_t indices[16];
+			if (!leastSquaresEndpoints(pixels, 0, 3, fit.colorIndices, bc7FloatWeights2, e0, e1))
+				break;
+
+			quantizeMode5Color(e0, e1, color);
+			const uint32_t error = evaluateMode5Color(pixels, color, indices);
+			if (error >= colorError)
+				break;
+
+			memcpy(fit.color, color, sizeof(color));
+			memcpy(fit.colorIndices, indices, sizeof(indices));
+			colorError = error;
+		}
+
+		uint8_t lowest = 255;
+		uint8_t highest = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			lowest = std::min(lowest, pixels[i * 4 + 3]);
+			highest = std::max(highest, pixels[i * 4 + 3]);
+		}
+		fit.alpha[0] = highest;
+		fit.alpha[1] = lowest;
+		uint32_t alphaError = evaluateMode5Alpha(pixels, fit.alpha, fit.alphaIndices);
+
+		for (int pass = 0; pass < refinements[TEXTURE_QUALITY_HIGH] && alphaError > 0; ++pass)
+		{
+			uint8_t alpha[2];
+			uint8_t indices[16];
+			if (!leastSquaresEndpoints(pixels, 3, 1, fit.alphaIndices, bc7FloatWeights2, e0, e1))
+				break;
+
+			alpha[0] = clampToByte(e0[0]);
+			alpha[1] = clampToByte(e1[0]);
+			const uint32_t error = evaluateMode5Alpha(pixels, alpha, indices);
+			if (error >= alphaError)
+				break;
+
+			memcpy(fit.alpha, alpha, sizeof(alpha));
+			memcpy(fit.alphaIndices, indices, sizeof(indices));
+			alphaError = error;
+		}
+
+		fit.error = colorError + alphaError;
+	}
+
+	void writeMode5(const Mode5Fit &fit, uint8_t *out)
+	{
+		// As in mode 6, but the color and alpha indices each have their first pixel's top bit left out
+		const bool swapColor = fit.colorIndices[0] >= 2;
+		const bool swapAlpha = fit.alphaIndices[0] >= 2;
+		const int firstColor = swapColor ? 1 : 0;
+		const int firstAlpha = swapAlpha ? 1 : 0;
+
+		BlockWriter writer(out);
+		writer.Write(1 << 5, 6);
+		writer.Write(fit.rotation, 2);
+		for (int c = 0; c < 3; ++c)
+		{
+			writer.Write(fit.color[firstColor][c], 7);
+			writer.Write(fit.color[1 - firstColor][c], 7);
+		}
+		writer.Write(fit.alpha[firstAlpha], 8);
+		writer.Write(fit.alpha[1 - firstAlpha], 8);
+
+		for (int i = 0; i < 16; ++i)
+			writer.Write(swapColor ? 3 - fit.colorIndices[i] : fit.colorIndices[i], i ? 2 : 1);
+		for (int i = 0; i < 16; ++i)
+			writer.Write(swapAlpha ? 3 - fit.alphaIndices[i] : fit.alphaIndices[i], i ? 2 : 1);
+	}
+
+	void compressBC7(const uint8_t *pixels, TextureQuality quality, uint8_t *out)
+	{
+		Mode6Fit mode6;
+		fitMode6(pixels, quality, mode6);
+
+		if (quality == TEXTURE_QUALITY_HIGH && mode6.error > 0)
+		{
+			Mode5Fit best = {};
+			best.error = UINT_MAX;
+			for (int rotation = 0; rotation < 4; ++rotation)
+			{
+				Mode5Fit candidate;
+				fitMode5(pixels, rotation, candidate);
+				if (candidate.error < best.error)
+					best = candidate;
+			}
+
+			if (best.error < mode6.error)
+			{
+				writeMode5(best, out);
+				return;
+			}
+		}
+
+		writeMode6(mode6, out);
+	}
+
+	void decodeBC7(const uint8_t *in, uint8_t *pixels)
+	{
+		BlockReader reader(in);
+		int mode = 0;
+		while (mode < 8 && reader.Read(1) == 0)
+			++mode;
+
+		if (mode == 6)
+		{
+			uint8_t endpoints[2][4];
+			for (int c = 0; c < 4; ++c)
+			{
+				endpoints[0][c] = static_cast<uint8_t>(reader.Read(7) << 1);
+				endpoints[1][c] = static_cast<uint8_t>(reader.Read(7) << 1);
+			}
+			const uint32_t p0 = reader.Read(1);
+			const uint32_t p1 = reader.Read(1);
+
+			for (int i = 0; i < 16; ++i)
+			{
+				const int weight = bc7Weights4[reader.Read(i ? 4 : 3)];
+				for (int c = 0; c < 4; ++c)
+					pixels[i * 4 + c] = bc7Interpolate(endpoints[0][c] | p0, endpoints[1][c] | p1, weight);
+			}
+		}
+		else if (mode == 5)
+		{
+			const uint32_t rotation = reader.Read(2);
+			uint8_t color[2][3];
+			for (int c = 0; c < 3; ++c)
+			{
+				color[0][c] = unquantize7(static_cast<uint8_t>(reader.Read(7)));
+				color[1][c] = unquantize7(static_cast<uint8_t>(reader.Read(7)));
+			}
+			const uint8_t alpha0 = static_cast<uint8_t>(reader.Read(8));
+			const uint8_t alpha1 = static_cast<uint8_t>(reader.Read(8));
+
+			for (int i = 0; i < 16; ++i)
+			{
+				const int weight = bc7Weights2[reader.Read(i ? 2 : 1)];
+				for (int c = 0; c < 3; ++c)
+					pixels[i * 4 + c] = bc7Interpolate(color[0][c], color[1][c], weight);
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				pixels[i * 4 + 3] = bc7Interpolate(alpha0, alpha1, bc7Weights2[reader.Read(i ? 2 : 1)]);
+				if (rotation)
+					std::swap(pixels[i * 4 + rotation - 1], pixels[i * 4 + 3]);
+			}
+		}
+		else
+			memset(pixels, 0, 64);
+	}
+
+	void compressBlock(BlockKind kind, const uint8_t *pixels, TextureQuality quality, uint8_t *out)
+	{
+		ColorFit color;
+		ChannelFit channel;
+		switch (kind)
+		{
+		case BLOCK_BC1:
+			fitColor(pixels, quality, color);
+			writeColor(color, out);
+			break;
+		case BLOCK_BC3:
+			fitChannel(pixels, 3, quality, channel);
+			writeChannel(channel, out);
+			fitColor(pixels, quality, color);
+			writeColor(color, out + 8);
+			break;
+		case BLOCK_BC5:
+			fitChannel(pixels, 0, quality, channel);
+			writeChannel(channel, out);
+			fitChannel(pixels, 1, quality, channel);
+			writeChannel(channel, out + 8);
+			break;
+		default:
+			compressBC7(pixels, quality, out);
+			break;
+		}
+	}
+
+	void decompressBlock(BlockKind kind, const uint8_t *in, uint8_t *pixels)
+	{
+		switch (kind)
+		{
+		case BLOCK_BC1:
+			decodeColor(in, false, pixels);
+			break;
+		case BLOCK_BC3:
+			decodeColor(in + 8, true, pixels);
+			decodeChannel(in, 3, pixels);
+			break;
+		case BLOCK_BC5:
+			for (int i = 0; i < 16; ++i)
+			{
+				pixels[i * 4 + 2] = 0;
+				pixels[i * 4 + 3] = 255;
+			}
+			decodeChannel(in, 0, pixels);
+			decodeChannel(in + 8, 1, pixels);
+			break;
+		default:
+			decodeBC7(in, pixels);
+			break;
+		}
+	}
+
+	unsigned int threadsFor(size_t blockCount, size_t rowCount, unsigned int threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		const size_t useful = std::min(rowCount, std::max<size_t>(1, blockCount / minBlocksPerThread));
+		return static_cast<unsigned int>(std::min<size_t>(threadCount, useful));
+	}
+
+	// Cuts count items into threadCount equal spans and runs work(begin, end) on each, the first one on the calling thread
+	template<typename TWork>
+	void runParallel(size_t count, unsigned int threadCount, const TWork &work)
+	{
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount);
+
+		for (unsigned int i = 1; i < threadCount; ++i)
+			threads.emplace_back(work, count * i / threadCount, count * (i + 1) / threadCount);
+
+		work(0, count / threadCount);
+
+		for (std::thread &thread : threads)
+			thread.join();
+	}
+
+	// Each pixel is the average of the 2x2 it covers in the mip above, whose last row or column repeats when
+	// its size is odd
+	void downsample(const uint8_t *rgba, uint32_t width, uint32_t height, uint8_t *out)
+	{
+		const uint32_t outWidth = std::max(width / 2, 1u);
+		const uint32_t outHeight = std::max(height / 2, 1u);
+		for (uint32_t y = 0; y < outHeight; ++y)
+		{
+			const uint8_t *row0 = rgba + static_cast<size_t>(std::min(y * 2, height - 1)) * width * 4;
+			const uint8_t *row1 = rgba + static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width * 4;
+			for (uint32_t x = 0; x < outWidth; ++x, out += 4)
+			{
+				const uint32_t x0 = std::min(x * 2, width - 1) * 4;
+				const uint32_t x1 = std::min(x * 2 + 1, width - 1) * 4;
+				for (int c = 0; c < 4; ++c)
+					out[c] = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+			}
+		}
+	}
+
+	void addSquaredError(const uint8_t *a, const uint8_t *b, size_t pixelCount, uint32_t channelMask, uint64_t &error, uint64_t &samples)
+	{
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				if (channelMask & (1u << c))
+				{
+					const int difference = a[i * 4 + c] - b[i * 4 + c];
+					error += difference * difference;
+					++samples;
+				}
+			}
+		}
+	}
+
+	double psnrFromError(uint64_t error, uint64_t samples)
+	{
+		if (error == 0 || samples == 0)
+			return 99.0;
+		return std::min(99.0, 10.0 * log10(255.0 * 255.0 * samples / error));
+	}
+
+	// Laid out like D3D11_SUBRESOURCE_DATA for FillDDSInitData
+	struct SubresourceData
+	{
+		const void	*pSysMem;
+		uint32_t	SysMemPitch;
+		uint32_t	SysMemSlicePitch;
+	};
+}
+
+bool isTextureCompressionFormat(DXGI_FORMAT format)
+{
+	return blockKind(format) != BLOCK_NONE;
+}
+
+void compressTextureBlocks(const uint8_t *rgba, uint32_t width, uint32_t height, DXGI_FORMAT format, TextureQuality quality,
+	uint8_t *blocks, unsigned int threadCount)
+{
+	const BlockKind kind = blockKind(format);
+	if (kind == BLOCK_NONE || width == 0 || height == 0)
+		return;
+
+	const uint32_t blocksWide = (width + 3) / 4;
+	const uint32_t blocksHigh = (height + 3) / 4;
+	const size_t bytes = blockBytes(kind);
+
+	runParallel(blocksHigh, threadsFor(static_cast<size_t>(blocksWide) * blocksHigh, blocksHigh, threadCount), [&](size_t begin, size_t end)
+	{
+		uint8_t pixels[64];
+		for (size_t row = begin; row < end; ++row)
+		{
+			for (uint32_t column = 0; column < blocksWide; ++column)
+			{
+				// Past the edges the last column and row repeat
+				for (uint32_t y = 0; y < 4; ++y)
+				{
+					const size_t sourceRow = std::min(static_cast<uint32_t>(row * 4 + y), height - 1);
+					for (uint32_t x = 0; x < 4; ++x)
+						memcpy(pixels + (y * 4 + x) * 4, rgba + (sourceRow * width + std::min(column * 4 + x, width - 1)) * 4, 4);
+				}
+
+				compressBlock(kind, pixels, quality, blocks + (row * blocksWide + column) * bytes);
+			}
+		}
+	});
+}
+
+void decompressTextureBlocks(const uint8_t *blocks, uint32_t width, uint32_t height, DXGI_FORMAT format, uint8_t *rgba)
+{
+	const BlockKind kind = blockKind(format);
+	if (kind == BLOCK_NONE)
+		return;
+
+	const uint32_t blocksWide = (width + 3) / 4;
+	const uint32_t blocksHigh = (height + 3) / 4;
+	uint8_t pixels[64];
+	for (uint32_t row = 0; row < blocksHigh; ++row)
+	{
+		for (uint32_t column = 0; column < blocksWide; ++column)
+		{
+			decompressBlock(kind, blocks + (static_cast<size_t>(row) * blocksWide + column) * blockBytes(kind), pixels);
+
+			for (uint32_t y = 0; y < 4 && row * 4 + y < height; ++y)
+			{
+				for (uint32_t x = 0; x < 4 && column * 4 + x < width; ++x)
+					memcpy(rgba + ((static_cast<size_t>(row) * 4 + y) * width + column * 4 + x) * 4, pixels + (y * 4 + x) * 4, 4);
+			}
+		}
+	}
+}
+
+bool compressTexture(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t arraySize, bool isCubeMap,
+	const TextureCompressionOptions &options, std::vector<uint8_t> &ddsFile, TextureCompressionStats *stats)
+{
+	const BlockKind kind = blockKind(options.format);
+	if (kind == BLOCK_NONE || width == 0 || height == 0 || arraySize == 0 || (isCubeMap && (width != height || arraySize % 6 != 0)))
+		return false;
+
+	uint32_t mipCount = 1;
+	if (options.generateMips)
+	{
+		while ((std::max(width, height) >> mipCount) > 0)
+			++mipCount;
+	}
+
+	// Sizes as DDSTextureLoader reads them back
+	std::vector<size_t> mipBytes(mipCount);
+	size_t sliceBytes = 0;
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		GetSurfaceInfo(std::max(width >> mip, 1u), std::max(height >> mip, 1u), options.format, &mipBytes[mip], nullptr, nullptr);
+		sliceBytes += mipBytes[mip];
+	}
+
+	DDS_HEADER header = {};
+	header.size = sizeof(DDS_HEADER);
+	header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_LINEARSIZE | ((mipCount > 1) ? DDS_HEADER_FLAGS_MIPMAP : 0);
+	header.width = width;
+	header.height = height;
+	header.pitchOrLinearSize = static_cast<uint32_t>(mipBytes[0]);
+	header.mipMapCount = mipCount;
+	header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+	header.ddspf.flags = DDS_FOURCC;
+	header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+	header.caps = DDS_SURFACE_FLAGS_TEXTURE | ((mipCount > 1) ? DDS_SURFACE_FLAGS_MIPMAP : 0) | (isCubeMap ? DDS_SURFACE_FLAGS_CUBEMAP : 0);
+	header.caps2 = isCubeMap ? DDS_CUBEMAP_ALLFACES : 0;
+
+	DDS_HEADER_DXT10 extension = {};
+	extension.dxgiFormat = options.format;
+	extension.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+	extension.miscFlag = isCubeMap ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+	extension.arraySize = isCubeMap ? arraySize / 6 : arraySize;
+
+	const uint32_t magic = DDS_MAGIC;
+	const size_t headerBytes = sizeof(magic) + sizeof(header) + sizeof(extension);
+	ddsFile.resize(headerBytes + sliceBytes * arraySize);
+	memcpy(ddsFile.data(), &magic, sizeof(magic));
+	memcpy(ddsFile.data() + sizeof(magic), &header, sizeof(header));
+	memcpy(ddsFile.data() + sizeof(magic) + sizeof(header), &extension, sizeof(extension));
+
+	uint8_t *out = ddsFile.data() + headerBytes;
+	std::vector<uint8_t> level, nextLevel, decoded;
+	uint64_t error = 0;
+	uint64_t samples = 0;
+	uint64_t blockCount = 0;
+
+	for (uint32_t slice = 0; slice < arraySize; ++slice)
+	{
+		const uint8_t *source = rgba + static_cast<size_t>(width) * height * 4 * slice;
+		uint32_t levelWidth = width;
+		uint32_t levelHeight = height;
+
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			compressTextureBlocks(source, levelWidth, levelHeight, options.format, options.quality, out, options.threadCount);
+			blockCount += static_cast<uint64_t>((levelWidth + 3) / 4) * ((levelHeight + 3) / 4);
+
+			if (mip == 0 && stats)
+			{
+				decoded.resize(static_cast<size_t>(levelWidth) * levelHeight * 4);
+				decompressTextureBlocks(out, levelWidth, levelHeight, options.format, decoded.data());
+				addSquaredError(source, decoded.data(), static_cast<size_t>(levelWidth) * levelHeight, keptChannels(kind), error, samples);
+			}
+			out += mipBytes[mip];
+
+			if (mip + 1 < mipCount)
+			{
+				nextLevel.resize(static_cast<size_t>(std::max(levelWidth / 2, 1u)) * std::max(levelHeight / 2, 1u) * 4);
+				downsample(source, levelWidth, levelHeight, nextLevel.data());
+				level.swap(nextLevel);
+				source = level.data();
+				levelWidth = std::max(levelWidth / 2, 1u);
+				levelHeight = std::max(levelHeight / 2, 1u);
+			}
+		}
+	}
+
+	if (stats)
+	{
+		stats->psnr = psnrFromError(error, samples);
+		stats->mipCount = mipCount;
+		stats->blockCount = blockCount;
+	}
+	return true;
+}
+
+double texturePSNR(const uint8_t *a, const uint8_t *b, size_t pixelCount, uint32_t channelMask)
+{
+	uint64_t error = 0;
+	uint64_t samples = 0;
+	addSquaredError(a, b, pixelCount, channelMask, error, samples);
+	return psnrFromError(error, samples);
+}
+
+bool readDDSPixels(const MappedDDS &source, std::vector<uint8_t> &rgba)
+{
+	const DDSDescription &desc = source.GetDescription();
+	if (desc.resourceDimension != DDS_DIMENSION_TEXTURE2D)
+		return false;
+
+	bool swapRedBlue = true;
+	bool opaque = false;
+	switch (desc.format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		swapRedBlue = false;
+		break;
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		break;
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		opaque = true;
+		break;
+	default:
+		return false;
+	}
+
+	std::vector<SubresourceData> subresources(desc.mipCount * desc.arraySize);
+	size_t width, height, depth, skipMip;
+	if (FillDDSInitData(desc.width, desc.height, desc.depth, desc.mipCount, desc.arraySize, desc.format, 0, source.GetBitSize(), source.GetBitData(),
+		width, height, depth, skipMip, subresources.data()) != DDS_FILL_OK)
+		return false;
+
+	rgba.resize(desc.width * desc.height * 4 * desc.arraySize);
+	uint8_t *out = rgba.data();
+	for (size_t slice = 0; slice < desc.arraySize; ++slice)
+	{
+		const SubresourceData &surface = subresources[slice * desc.mipCount];
+		for (size_t y = 0; y < desc.height; ++y)
+		{
+			const uint8_t *row = static_cast<const uint8_t *>(surface.pSysMem) + y * surface.SysMemPitch;
+			for (size_t x = 0; x < desc.width; ++x, out += 4)
+			{
+				out[0] = row[x * 4 + (swapRedBlue ? 2 : 0)];
+				out[1] = row[x * 4 + 1];
+				out[2] = row[x * 4 + (swapRedBlue ? 0 : 2)];
+				out[3] = opaque ? 255 : row[x * 4 + 3];
+			}
+		}
+	}
+	return true;
+}
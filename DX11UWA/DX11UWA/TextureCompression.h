@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Common/DDS.h"
+
+// Block compression of 8 bit RGBA images into BC1, BC3, BC5 and BC7, and DDS files of them with a DX10 header,
+// so textures can be cooked from the images they're authored as. Each 4x4 block is fitted on its own: endpoints
+// along the block's colors, then the nearest palette entry for every pixel, which is picked four pixels at a time
+// with SSE2 where it's available. Rows of blocks are compressed on threadCount threads (0 uses every core).
+//
+// BC1 is always written in its four color mode, so it has no transparency. BC3 is BC1 with a BC4 block for the
+// alpha and BC5 two BC4 blocks for red and green, as normal maps use. BC7 only uses mode 6, one set of RGBA
+// endpoints with 16 levels, and at high quality also mode 5 with each channel rotated into the alpha; the
+// partitioned modes aren't tried.
+
+enum TextureQuality
+{
+	TEXTURE_QUALITY_FAST,		// Endpoints from the bounding box of each block
+	TEXTURE_QUALITY_NORMAL,		// From the block's principal axis, refined once by least squares
+	TEXTURE_QUALITY_HIGH		// Refined until it stops improving, then searched around for a lower error
+};
+
+struct TextureCompressionOptions
+{
+	TextureCompressionOptions() : format(DXGI_FORMAT_BC1_UNORM), quality(TEXTURE_QUALITY_NORMAL), generateMips(true), threadCount(0) {}
+
+	// BC1, BC3 or BC7 as UNORM or UNORM_SRGB, or BC5_UNORM
+	DXGI_FORMAT		format;
+	TextureQuality	quality;
+
+	// Every mip down to 1x1, each a box filter of the one before as the pixels are stored, else only the image
+	bool			generateMips;
+
+	unsigned int	threadCount;
+};
+
+struct TextureCompressionStats
+{
+	// Of the first mip of every slice decoded again against the image, over the channels the format keeps:
+	// RGB for BC1, RG for BC5 and RGBA for BC3 and BC7. 99 dB when nothing was lost.
+	double		psnr;
+	uint32_t	mipCount;
+	uint64_t	blockCount;
+};
+
+bool isTextureCompressionFormat(DXGI_FORMAT format);
+
+// Compresses width x height pixels into rows of blocks of format, top to bottom. Partial blocks at the right
+// and bottom edges repeat the last column and row.
+void compressTextureBlocks(const uint8_t *rgba, uint32_t width, uint32_t height, DXGI_FORMAT format, TextureQuality quality,
+	uint8_t *blocks, unsigned int threadCount = 0);
+
+// Decodes what compressTextureBlocks wrote. Of BC7 only modes 5 and 6 are decoded, blocks in other modes come
+// out transparent black like blocks in a reserved mode.
+void decompressTextureBlocks(const uint8_t *blocks, uint32_t width, uint32_t height, DXGI_FORMAT format, uint8_t *rgba);
+
+// Compresses arraySize slices of width x height pixels, one after the other, into a DDS file. The slices of a
+// cube map are its faces in Direct3D order, six per cube. Returns false for a format compressTextureBlocks
+// doesn't write, an empty image or a cube map with faces that aren't square or a slice count that isn't a
+// multiple of six.
+bool compressTexture(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t arraySize, bool isCubeMap,
+	const TextureCompressionOptions &options, std::vector<uint8_t> &ddsFile, TextureCompressionStats *stats = nullptr);
+
+// Peak signal to noise ratio of b against a in dB, over the channels whose bit is set in channelMask (1 for red
+// up to 8 for alpha)
+double texturePSNR(const uint8_t *a, const uint8_t *b, size_t pixelCount, uint32_t channelMask);
+
+// The first mip of every slice of a 2D texture or cube map in R8G8B8A8, B8G8R8A8 or B8G8R8X8, as RGBA one slice
+// after the other. Returns false for any other format or dimension.
+bool readDDSPixels(const MappedDDS &source, std::vector<uint8_t> &rgba);
@@ -0,0 +1,289 @@
+#include "pch.h"
+#include "TextureStreaming.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	uint32_t mipSize(size_t size, uint32_t mip)
+	{
+		return std::max<uint32_t>(static_cast<uint32_t>(size >> mip), 1);
+	}
+
+	// The first mip no larger than minSize on either side. Only 2D textures and cube maps are streamed.
+	uint32_t minResidentMip(const DDSDescription &desc, uint32_t minSize)
+	{
+		if (desc.resourceDimension != DDS_DIMENSION_TEXTURE2D)
+			return 0;
+
+		uint32_t mip = 0;
+		while (mip + 1 < desc.mipCount && (mipSize(desc.width, mip) > minSize || mipSize(desc.height, mip) > minSize))
+			++mip;
+		return mip;
+	}
+}
+
+uint64_t textureMipBytes(const DDSDescription &desc, uint32_t mip)
+{
+	size_t bytes = 0;
+	GetSurfaceInfo(mipSize(desc.width, mip), mipSize(desc.height, mip), desc.format, &bytes, nullptr, nullptr);
+	return static_cast<uint64_t>(bytes) * mipSize(desc.depth, mip) * desc.arraySize;
+}
+
+uint64_t textureResidentBytes(const DDSDescription &desc, uint32_t firstMip)
+{
+	uint64_t bytes = 0;
+	for (uint32_t mip = firstMip; mip < desc.mipCount; ++mip)
+		bytes += textureMipBytes(desc, mip);
+	return bytes;
+}
+
+uint32_t selectTextureMip(const DDSDescription &desc, float screenPixels, float bias)
+{
+	const uint32_t lastMip = static_cast<uint32_t>(desc.mipCount) - 1;
+	if (screenPixels <= 0.0f)
+		return lastMip;
+
+	const float size = static_cast<float>(std::max(desc.width, desc.height));
+	const float mip = floorf(log2f(size / screenPixels) + bias);
+	if (mip <= 0.0f)
+		return 0;
+	return std::min(static_cast<uint32_t>(mip), lastMip);
+}
+
+TextureStreamer::TextureStreamer(TextureStreamingBackend &backend, const TextureStreamingOptions &options) :
+	m_backend(backend),
+	m_options(options),
+	m_residentBytes(0),
+	m_frame(0)
+{
+}
+
+TextureStreamer::~TextureStreamer(void)
+{
+	for (StreamedTextureId id = 0; id < m_textures.size(); ++id)
+	{
+		if (m_textures[id])
+			RemoveTexture(id);
+	}
+}
+
+StreamedTextureId TextureStreamer::AddTexture(const char *path)
+{
+	std::unique_ptr<Texture> texture(new Texture());
+	if (texture->source.Open(path) != DDS_OPEN_OK)
+		return INVALID_STREAMED_TEXTURE;
+
+	const DDSDescription &desc = texture->source.GetDescription();
+	texture->minResidentMip = minResidentMip(desc, m_options.minResidentSize);
+	texture->firstResidentMip = texture->minResidentMip;
+	texture->wantedMip = texture->minResidentMip;
+	texture->screenPixels = 0.0f;
+	texture->lastUsedFrame = m_frame;
+	texture->blocked = false;
+
+	StreamedTextureId id = static_cast<StreamedTextureId>(m_textures.size());
+	if (!m_freeIds.empty())
+		id = m_freeIds.back();
+
+	if (!m_backend.UploadMips(id, texture->source, texture->firstResidentMip, static_cast<uint32_t>(desc.mipCount)))
+		return INVALID_STREAMED_TEXTURE;
+
+	m_residentBytes += textureResidentBytes(desc, texture->firstResidentMip);
+
+	if (id == m_textures.size())
+		m_textures.push_back(std::move(texture));
+	else
+	{
+		m_freeIds.pop_back();
+		m_textures[id] = std::move(texture);
+	}
+
+	return id;
+}
+
+void TextureStreamer::RemoveTexture(StreamedTextureId texture)
+{
+	const Texture &removed = *m_textures[texture];
+	m_residentBytes -= textureResidentBytes(removed.source.GetDescription(), removed.firstResidentMip);
+	m_backend.RemoveTexture(texture);
+
+	m_textures[texture].reset();
+	m_freeIds.push_back(texture);
+}
+
+void TextureStreamer::RequestTexture(StreamedTextureId texture, float screenPixels)
+{
+	Texture &requested = *m_textures[texture];
+	requested.screenPixels = std::max(requested.screenPixels, screenPixels);
+	requested.lastUsedFrame = m_frame;
+}
+
+void TextureStreamer::EvictMip(StreamedTextureId texture)
+{
+	Texture &evicted = *m_textures[texture];
+	m_backend.EvictMips(texture, evicted.source, evicted.firstResidentMip + 1, evicted.firstResidentMip);
+	m_residentBytes -= textureMipBytes(evicted.source.GetDescription(), evicted.firstResidentMip);
+	++evicted.firstResidentMip;
+}
+
+StreamedTextureId TextureStreamer::FindEvictable(StreamedTextureId except) const
+{
+	StreamedTextureId found = INVALID_STREAMED_TEXTURE;
+	uint64_t foundBytes = 0;
+
+	for (StreamedTextureId id = 0; id < m_textures.size(); ++id)
+	{
+		const Texture *texture = m_textures[id].get();
+		if (!texture || id == except || texture->firstResidentMip >= texture->minResidentMip)
+			continue;
+
+		// Textures drawn this frame only give up the mips finer than they need
+		if (texture->lastUsedFrame == m_frame && texture->firstResidentMip >= texture->wantedMip)
+			continue;
+
+		// Least recently used first, and of those the one that frees the most
+		const uint64_t bytes = textureMipBytes(texture->source.GetDescription(), texture->firstResidentMip);
+		if (found == INVALID_STREAMED_TEXTURE || texture->lastUsedFrame < m_textures[found]->lastUsedFrame ||
+			(texture->lastUsedFrame == m_textures[found]->lastUsedFrame && bytes > foundBytes))
+		{
+			found = id;
+			foundBytes = bytes;
+		}
+	}
+
+	return found;
+}
+
+uint64_t TextureStreamer::GetEvictableBytes(StreamedTextureId except) const
+{
+	uint64_t bytes = 0;
+	for (StreamedTextureId id = 0; id < m_textures.size(); ++id)
+	{
+		const Texture *texture = m_textures[id].get();
+		if (!texture || id == except)
+			continue;
+
+		const uint32_t keptMip = (texture->lastUsedFrame == m_frame) ? texture->wantedMip : texture->minResidentMip;
+		for (uint32_t mip = texture->firstResidentMip; mip < keptMip; ++mip)
+			bytes += textureMipBytes(texture->source.GetDescription(), mip);
+	}
+	return bytes;
+}
+
+bool TextureStreamer::MakeRoom(uint64_t bytes, StreamedTextureId except)
+{
+	// Nothing is evicted for mips that won't fit anyway
+	if (m_residentBytes + bytes > m_options.budgetBytes && m_residentBytes + bytes - GetEvictableBytes(except) > m_options.budgetBytes)
+		return false;
+
+	while (m_residentBytes + bytes > m_options.budgetBytes)
+	{
+		const StreamedTextureId victim = FindEvictable(except);
+		if (victim == INVALID_STREAMED_TEXTURE)
+			return false;
+		EvictMip(victim);
+	}
+	return true;
+}
+
+void TextureStreamer::Update(void)
+{
+	for (std::unique_ptr<Texture> &texture : m_textures)
+	{
+		if (!texture)
+			continue;
+
+		// Textures that weren't drawn only need the mips they always keep
+		texture->wantedMip = texture->minResidentMip;
+		if (texture->lastUsedFrame == m_frame)
+			texture->wantedMip = std::min(texture->wantedMip, selectTextureMip(texture->source.GetDescription(), texture->screenPixels, m_options.mipBias));
+	}
+
+	// After the budget was lowered, mips are taken from the textures drawn this frame as well if needed,
+	// the largest first
+	while (m_residentBytes > m_options.budgetBytes)
+	{
+		StreamedTextureId victim = FindEvictable(INVALID_STREAMED_TEXTURE);
+		if (victim == INVALID_STREAMED_TEXTURE)
+		{
+			uint64_t victimBytes = 0;
+			for (StreamedTextureId id = 0; id < m_textures.size(); ++id)
+			{
+				const Texture *texture = m_textures[id].get();
+				if (!texture || texture->firstResidentMip >= texture->minResidentMip)
+					continue;
+
+				const uint64_t bytes = textureMipBytes(texture->source.GetDescription(), texture->firstResidentMip);
+				if (bytes > victimBytes)
+				{
+					victim = id;
+					victimBytes = bytes;
+				}
+			}
+		}
+
+		if (victim == INVALID_STREAMED_TEXTURE)
+			break;
+		EvictMip(victim);
+	}
+
+	// One mip at a time, to the texture furthest from the mip it needs, and of those the largest on screen
+	uint64_t uploaded = 0;
+	for (std::unique_ptr<Texture> &texture : m_textures)
+	{
+		if (texture)
+			texture->blocked = false;
+	}
+
+	for (;;)
+	{
+		StreamedTextureId next = INVALID_STREAMED_TEXTURE;
+		for (StreamedTextureId id = 0; id < m_textures.size(); ++id)
+		{
+			const Texture *texture = m_textures[id].get();
+			if (!texture || texture->blocked || texture->firstResidentMip <= texture->wantedMip)
+				continue;
+
+			if (next == INVALID_STREAMED_TEXTURE)
+			{
+				next = id;
+				continue;
+			}
+
+			const Texture &best = *m_textures[next];
+			const uint32_t missing = texture->firstResidentMip - texture->wantedMip;
+			const uint32_t bestMissing = best.firstResidentMip - best.wantedMip;
+			if (missing > bestMissing || (missing == bestMissing && texture->screenPixels > best.screenPixels))
+				next = id;
+		}
+
+		if (next == INVALID_STREAMED_TEXTURE)
+			break;
+
+		Texture &texture = *m_textures[next];
+		const uint32_t mip = texture.firstResidentMip - 1;
+		const uint64_t bytes = textureMipBytes(texture.source.GetDescription(), mip);
+		if (uploaded > 0 && uploaded + bytes > m_options.uploadBytesPerUpdate)
+			break;
+
+		// A texture that doesn't fit now waits for textures to stop being drawn, or for a larger budget
+		if (!MakeRoom(bytes, next) || !m_backend.UploadMips(next, texture.source, mip, texture.firstResidentMip))
+		{
+			texture.blocked = true;
+			continue;
+		}
+
+		texture.firstResidentMip = mip;
+		m_residentBytes += bytes;
+		uploaded += bytes;
+	}
+
+	for (std::unique_ptr<Texture> &texture : m_textures)
+	{
+		if (texture)
+			texture->screenPixels = 0.0f;
+	}
+	++m_frame;
+}
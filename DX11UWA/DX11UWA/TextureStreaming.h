@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Common/DDS.h"
+
+// Textures are streamed a mip at a time. When a texture is added only its smallest mips are uploaded, so it
+// can be drawn straight away, and each frame the renderer reports how large every texture it drew covers on
+// screen. Update then uploads the next finer mip of the textures that need one most, and keeps the mips
+// resident within a memory budget by evicting the finest mips of the least recently drawn textures first.
+//
+// Which mips are resident is decided here, without Direct3D. Making them resident is the job of a
+// TextureStreamingBackend, so the same decisions can be driven headless by a backend that only records them.
+
+typedef uint32_t StreamedTextureId;
+
+const StreamedTextureId INVALID_STREAMED_TEXTURE = 0xffffffff;
+
+// Bytes mip takes over every array slice (and every face of a cube map)
+uint64_t textureMipBytes(const DDSDescription &desc, uint32_t mip);
+
+// Bytes mips firstMip to the last one take
+uint64_t textureResidentBytes(const DDSDescription &desc, uint32_t firstMip);
+
+// The finest mip worth having for a texture covering screenPixels pixels across: the coarsest one still at least
+// that large on its larger side, made coarser by bias mips. Textures that aren't on screen only need their last mip.
+uint32_t selectTextureMip(const DDSDescription &desc, float screenPixels, float bias = 0.0f);
+
+// Creates, fills and drops the mips the streamer decides on. Mips are always resident from some first mip to
+// the last one, so a texture is described by its first resident mip, or the mip count when it has none yet.
+class TextureStreamingBackend
+{
+public:
+	virtual ~TextureStreamingBackend(void) {}
+
+	// Makes mips firstMip to the last one resident, where previousFirstMip on already were, with the data in
+	// source. Returns false if it couldn't, and then the texture keeps the mips it had.
+	virtual bool UploadMips(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip, uint32_t previousFirstMip) = 0;
+
+	// Drops mips previousFirstMip to firstMip - 1, keeping firstMip to the last one
+	virtual void EvictMips(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip, uint32_t previousFirstMip) = 0;
+
+	// Drops every mip of a texture that was removed
+	virtual void RemoveTexture(StreamedTextureId texture) = 0;
+};
+
+struct TextureStreamingOptions
+{
+	TextureStreamingOptions() : budgetBytes(64 * 1024 * 1024), uploadBytesPerUpdate(4 * 1024 * 1024), minResidentSize(64), mipBias(0.0f) {}
+
+	// Most bytes of mips resident at once. The mips every texture always keeps count as well, but are kept
+	// even when they alone are over budget.
+	uint64_t budgetBytes;
+
+	// Most bytes uploaded by one Update, so streaming never stalls a frame for long. One mip is always
+	// uploaded when one is needed, however large it is.
+	uint64_t uploadBytesPerUpdate;
+
+	// Mips no larger than this on either side are uploaded with the texture and never evicted. Textures
+	// other than 2D ones and cube maps aren't streamed and have all their mips uploaded.
+	uint32_t minResidentSize;
+
+	// Added to the mip the screen size calls for, positive for blurrier textures that need less memory
+	float mipBias;
+};
+
+class TextureStreamer
+{
+public:
+	TextureStreamer(TextureStreamingBackend &backend, const TextureStreamingOptions &options = TextureStreamingOptions());
+	~TextureStreamer(void);
+
+	TextureStreamer(const TextureStreamer &) = delete;
+	TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+	// Maps the DDS file at path and uploads the mips it always keeps. Returns INVALID_STREAMED_TEXTURE if it
+	// can't be opened, isn't a valid DDS file or the backend can't upload it.
+	StreamedTextureId AddTexture(const char *path);
+	void RemoveTexture(StreamedTextureId texture);
+
+	// Records that texture is drawn this frame covering screenPixels pixels across. The largest of the
+	// requests of a frame counts.
+	void RequestTexture(StreamedTextureId texture, float screenPixels);
+
+	// Uploads and evicts mips toward what this frame's requests call for, then starts the next frame
+	void Update(void);
+
+	// Takes effect at the next Update, which evicts down to it if needed
+	void SetBudget(uint64_t budgetBytes) { m_options.budgetBytes = budgetBytes; }
+	uint64_t GetBudget(void) const { return m_options.budgetBytes; }
+
+	uint64_t GetResidentBytes(void) const { return m_residentBytes; }
+	uint32_t GetFrame(void) const { return m_frame; }
+
+	const DDSDescription &GetDescription(StreamedTextureId texture) const { return m_textures[texture]->source.GetDescription(); }
+	uint32_t GetFirstResidentMip(StreamedTextureId texture) const { return m_textures[texture]->firstResidentMip; }
+	uint32_t GetWantedMip(StreamedTextureId texture) const { return m_textures[texture]->wantedMip; }
+
+private:
+	struct Texture
+	{
+		MappedDDS	source;
+		uint32_t	firstResidentMip;
+		uint32_t	minResidentMip;		// The first of the mips it always keeps
+		uint32_t	wantedMip;
+		float		screenPixels;		// Largest request this frame, 0 when it wasn't drawn
+		uint32_t	lastUsedFrame;
+		bool		blocked;			// Its next mip didn't fit in this Update
+	};
+
+	// Drops the finest resident mip of texture
+	void EvictMip(StreamedTextureId texture);
+
+	// The least recently used texture with mips it doesn't need this frame, other than except, or
+	// INVALID_STREAMED_TEXTURE if there is none
+	StreamedTextureId FindEvictable(StreamedTextureId except) const;
+
+	// Bytes FindEvictable could free, leaving out except
+	uint64_t GetEvictableBytes(StreamedTextureId except) const;
+
+	// Evicts from the least recently used textures until bytes more fit in the budget. Returns false if
+	// they can't be made to fit without taking mips from textures drawn this frame.
+	bool MakeRoom(uint64_t bytes, StreamedTextureId except);
+
+	TextureStreamingBackend					&m_backend;
+	TextureStreamingOptions					m_options;
+	std::vector<std::unique_ptr<Texture>>	m_textures;		// Null where a texture was removed
+	std::vector<StreamedTextureId>			m_freeIds;
+	uint64_t								m_residentBytes;
+	uint32_t								m_frame;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+
+// Hands the newest of a stream of values from one writer thread to one reader thread without either waiting for
+// the other. The writer fills the back slot and publishes it, the reader acquires the latest published slot and
+// reads it for as long as it likes; the third slot sits between them. Values published faster than the reader
+// acquires them are dropped, so the reader always gets the newest.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer(void) : m_back(0), m_front(1), m_middle(2) {}
+
+	TripleBuffer(const TripleBuffer &) = delete;
+	TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+	// Writer only. The slot to fill, which the reader never sees until it's published.
+	T &GetBack(void) { return m_slots[m_back]; }
+
+	// Writer only. Makes the back slot the newest value and takes over the slot it replaces.
+	void Publish(void)
+	{
+		m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// Reader only. Takes the newest value published since the last call, false if there's none and the front
+	// slot still holds the one taken before.
+	bool Acquire(void)
+	{
+		if (!(m_middle.load(std::memory_order_relaxed) & FRESH))
+			return false;
+
+		m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+
+	// Reader only. The value taken by the last successful Acquire, which stays as it is until the next one.
+	const T &GetFront(void) const { return m_slots[m_front]; }
+
+private:
+	// The middle slot's index, and whether it was published since the reader last took it
+	static const unsigned INDEX = 3;
+	static const unsigned FRESH = 4;
+
+	T						m_slots[3];
+	unsigned				m_back;
+	unsigned				m_front;
+	std::atomic<unsigned>	m_middle;
+};
@@ -0,0 +1,438 @@
+#include "pch.h"
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define VERTEX_PACKING_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const float unormScale = 65535.0f;
+	const float snormScale = 32767.0f;
+
+	inline uint32_t asBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	inline float asFloat(uint32_t bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// Rounds to nearest even. Values too large for a half become infinity, NaNs stay NaNs.
+	inline uint16_t floatToHalf(float value)
+	{
+		const uint32_t bits = asBits(value);
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		const uint32_t magnitude = bits & 0x7fffffff;
+
+		uint32_t result;
+		if (magnitude > 0x477fefff)
+			result = 0x7c00 | ((magnitude > 0x7f800000) ? 0x200 : 0);
+		else if (magnitude < 0x38800000)
+			result = asBits(asFloat(magnitude) + 0.5f) - 0x3f000000;		// Denormal, the add lines the mantissa up
+		else
+			result = (magnitude + 0xc8000fff + ((magnitude >> 13) & 1)) >> 13;	// Rebias the exponent and round
+
+		return static_cast<uint16_t>(sign | result);
+	}
+
+	inline float halfToFloat(uint16_t half)
+	{
+		uint32_t bits = static_cast<uint32_t>(half & 0x7fff) << 13;
+		const uint32_t exponent = bits & 0x0f800000;
+		bits += 112u << 23;
+
+		if (exponent == 0x0f800000)
+			bits += 112u << 23;		// Infinity or NaN
+		else if (exponent == 0)
+			bits = asBits(asFloat(bits + (1u << 23)) - asFloat(113u << 23));	// Denormal
+
+		return asFloat(bits | (static_cast<uint32_t>(half & 0x8000) << 16));
+	}
+
+	// value must already be clamped to [0, 65535]
+	inline uint16_t roundUnorm(float value)
+	{
+		return static_cast<uint16_t>(static_cast<int>(value + 0.5f));
+	}
+
+	// Offset to positive first, so truncating rounds the same way on both sides of 0
+	inline int16_t roundSnorm(float value)
+	{
+		const float scaled = std::min(std::max(value, -1.0f), 1.0f) * snormScale;
+		return static_cast<int16_t>(static_cast<int>(scaled + (snormScale + 0.5f)) - static_cast<int>(snormScale));
+	}
+
+	inline float signNotZero(float value)
+	{
+		return (value >= 0.0f) ? 1.0f : -1.0f;
+	}
+
+	// Quantization step per axis, and its inverse (0 on flat axes)
+	void quantizationSteps(const VertexQuantization &quantization, float (&step)[3], float (&inverse)[3])
+	{
+		const float *scale = &quantization.scale.x;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			step[axis] = scale[axis] / unormScale;
+			inverse[axis] = (scale[axis] > 0.0f) ? unormScale / scale[axis] : 0.0f;
+		}
+	}
+
+	void packVertex(const DX11UWA::VertexPositionUVNormal &vertex, const float *offset, const float (&inverse)[3], DX11UWA::VertexPositionUVNormalPacked &out)
+	{
+		const float *position = &vertex.pos.x;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float q = (position[axis] - offset[axis]) * inverse[axis];
+			out.pos[axis] = roundUnorm(std::min(std::max(q, 0.0f), unormScale));
+		}
+		out.pos[3] = 0;
+
+		out.uv[0] = floatToHalf(vertex.uv.x);
+		out.uv[1] = floatToHalf(vertex.uv.y);
+
+		// Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper one
+		const DirectX::XMFLOAT3 &n = vertex.normal;
+		const float length = std::max((fabsf(n.x) + fabsf(n.y)) + fabsf(n.z), FLT_MIN);
+		float x = n.x / length;
+		float y = n.y / length;
+
+		if (n.z < 0.0f)
+		{
+			const float foldedX = (1.0f - fabsf(y)) * signNotZero(x);
+			const float foldedY = (1.0f - fabsf(x)) * signNotZero(y);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		out.normal[0] = roundSnorm(x);
+		out.normal[1] = roundSnorm(y);
+	}
+
+	void unpackVertex(const DX11UWA::VertexPositionUVNormalPacked &packed, const float *offset, const float (&step)[3], DX11UWA::VertexPositionUVNormal &out)
+	{
+		float *position = &out.pos.x;
+		for (int axis = 0; axis < 3; ++axis)
+			position[axis] = offset[axis] + static_cast<float>(packed.pos[axis]) * step[axis];
+
+		out.uv.x = halfToFloat(packed.uv[0]);
+		out.uv.y = halfToFloat(packed.uv[1]);
+
+		// -32768 is -1 as well, like the R16G16_SNORM format
+		float x = std::max(static_cast<float>(packed.normal[0]) / snormScale, -1.0f);
+		float y = std::max(static_cast<float>(packed.normal[1]) / snormScale, -1.0f);
+		const float z = (1.0f - fabsf(x)) - fabsf(y);
+
+		const float t = std::max(-z, 0.0f);
+		x += (x >= 0.0f) ? -t : t;
+		y += (y >= 0.0f) ? -t : t;
+
+		const float length = sqrtf(x * x + y * y + z * z);
+		out.normal = DirectX::XMFLOAT3(x / length, y / length, z / length);
+	}
+
+#if defined(VERTEX_PACKING_SSE2)
+	inline __m128i select(__m128i mask, __m128i a, __m128i b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	inline __m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	// floatToHalf on four lanes, the result is in the low 16 bits of each
+	inline __m128i floatToHalf4(__m128 value)
+	{
+		const __m128i bits = _mm_castps_si128(value);
+		const __m128i sign = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000));
+		const __m128i magnitude = _mm_and_si128(bits, _mm_set1_epi32(0x7fffffff));
+
+		const __m128i nanBit = _mm_and_si128(_mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7f800000)), _mm_set1_epi32(0x200));
+		const __m128i overflow = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x477fefff));
+		const __m128i denormal = _mm_cmplt_epi32(magnitude, _mm_set1_epi32(0x38800000));
+
+		const __m128i denormalResult = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(magnitude), _mm_set1_ps(0.5f))), _mm_set1_epi32(0x3f000000));
+		const __m128i odd = _mm_and_si128(_mm_srli_epi32(magnitude, 13), _mm_set1_epi32(1));
+		const __m128i normalResult = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(magnitude, _mm_set1_epi32(static_cast<int>(0xc8000fff))), odd), 13);
+
+		__m128i result = select(denormal, denormalResult, normalResult);
+		result = select(overflow, _mm_or_si128(_mm_set1_epi32(0x7c00), nanBit), result);
+		return _mm_or_si128(result, sign);
+	}
+
+	// halfToFloat on the low 16 bits of four lanes
+	inline __m128 halfToFloat4(__m128i half)
+	{
+		__m128i bits = _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x7fff)), 13);
+		const __m128i exponent = _mm_and_si128(bits, _mm_set1_epi32(0x0f800000));
+		bits = _mm_add_epi32(bits, _mm_set1_epi32(112 << 23));
+
+		const __m128i infinite = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(0x0f800000));
+		bits = _mm_add_epi32(bits, _mm_and_si128(infinite, _mm_set1_epi32(112 << 23)));
+
+		const __m128i denormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+		const __m128 denormalValue = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1 << 23))), _mm_castsi128_ps(_mm_set1_epi32(113 << 23)));
+		bits = select(denormal, _mm_castps_si128(denormalValue), bits);
+
+		return _mm_castsi128_ps(_mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x8000)), 16)));
+	}
+
+	inline __m128 abs4(__m128 value)
+	{
+		return _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+	}
+
+	inline __m128 signNotZero4(__m128 value)
+	{
+		return select(_mm_cmpge_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f), _mm_set1_ps(-1.0f));
+	}
+
+	inline __m128i roundSnorm4(__m128 value)
+	{
+		const __m128 scaled = _mm_mul_ps(_mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f)), _mm_set1_ps(snormScale));
+		return _mm_sub_epi32(_mm_cvttps_epi32(_mm_add_ps(scaled, _mm_set1_ps(snormScale + 0.5f))), _mm_set1_epi32(static_cast<int>(snormScale)));
+	}
+
+	inline void transpose(__m128i &a, __m128i &b, __m128i &c, __m128i &d)
+	{
+		const __m128i ab0 = _mm_unpacklo_epi32(a, b);
+		const __m128i cd0 = _mm_unpacklo_epi32(c, d);
+		const __m128i ab1 = _mm_unpackhi_epi32(a, b);
+		const __m128i cd1 = _mm_unpackhi_epi32(c, d);
+
+		a = _mm_unpacklo_epi64(ab0, cd0);
+		b = _mm_unpackhi_epi64(ab0, cd0);
+		c = _mm_unpacklo_epi64(ab1, cd1);
+		d = _mm_unpackhi_epi64(ab1, cd1);
+	}
+
+	// Packs four vertices. Each vertex is two 16 byte rows, (pos.xyz, uv.x) and (uv.y, normal), which
+	// are transposed so every lane holds one vertex.
+	void packVertices4(const DX11UWA::VertexPositionUVNormal *vertices, const float *offset, const float (&inverse)[3], DX11UWA::VertexPositionUVNormalPacked *out)
+	{
+		__m128 px = _mm_loadu_ps(&vertices[0].pos.x);
+		__m128 py = _mm_loadu_ps(&vertices[1].pos.x);
+		__m128 pz = _mm_loadu_ps(&vertices[2].pos.x);
+		__m128 u = _mm_loadu_ps(&vertices[3].pos.x);
+		_MM_TRANSPOSE4_PS(px, py, pz, u);
+
+		__m128 v = _mm_loadu_ps(&vertices[0].uv.y);
+		__m128 nx = _mm_loadu_ps(&vertices[1].uv.y);
+		__m128 ny = _mm_loadu_ps(&vertices[2].uv.y);
+		__m128 nz = _mm_loadu_ps(&vertices[3].uv.y);
+		_MM_TRANSPOSE4_PS(v, nx, ny, nz);
+
+		// Positions
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 maximum = _mm_set1_ps(unormScale);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		const __m128i qx = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(px, _mm_set1_ps(offset[0])), _mm_set1_ps(inverse[0])), zero), maximum), half));
+		const __m128i qy = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(py, _mm_set1_ps(offset[1])), _mm_set1_ps(inverse[1])), zero), maximum), half));
+		const __m128i qz = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(pz, _mm_set1_ps(offset[2])), _mm_set1_ps(inverse[2])), zero), maximum), half));
+
+		// Normals
+		const __m128 length = _mm_max_ps(_mm_add_ps(_mm_add_ps(abs4(nx), abs4(ny)), abs4(nz)), _mm_set1_ps(FLT_MIN));
+		const __m128 x = _mm_div_ps(nx, length);
+		const __m128 y = _mm_div_ps(ny, length);
+
+		const __m128 lower = _mm_cmplt_ps(nz, zero);
+		const __m128 foldedX = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), abs4(y)), signNotZero4(x));
+		const __m128 foldedY = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), abs4(x)), signNotZero4(y));
+
+		const __m128i ox = roundSnorm4(select(lower, foldedX, x));
+		const __m128i oy = roundSnorm4(select(lower, foldedY, y));
+
+		// One 32 bit word per pair of 16 bit fields, then back to one vertex per row
+		const __m128i low = _mm_set1_epi32(0xffff);
+		__m128i word0 = _mm_or_si128(qx, _mm_slli_epi32(qy, 16));
+		__m128i word1 = qz;
+		__m128i word2 = _mm_or_si128(floatToHalf4(u), _mm_slli_epi32(floatToHalf4(v), 16));
+		__m128i word3 = _mm_or_si128(_mm_and_si128(ox, low), _mm_slli_epi32(oy, 16));
+		transpose(word0, word1, word2, word3);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 0), word0);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 1), word1);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2), word2);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 3), word3);
+	}
+
+	void unpackVertices4(const DX11UWA::VertexPositionUVNormalPacked *packed, const float *offset, const float (&step)[3], DX11UWA::VertexPositionUVNormal *out)
+	{
+		__m128i word0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + 0));
+		__m128i word1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + 1));
+		__m128i word2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + 2));
+		__m128i word3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + 3));
+		transpose(word0, word1, word2, word3);
+
+		const __m128i low = _mm_set1_epi32(0xffff);
+
+		// Positions
+		__m128 px = _mm_add_ps(_mm_set1_ps(offset[0]), _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(word0, low)), _mm_set1_ps(step[0])));
+		__m128 py = _mm_add_ps(_mm_set1_ps(offset[1]), _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(word0, 16)), _mm_set1_ps(step[1])));
+		__m128 pz = _mm_add_ps(_mm_set1_ps(offset[2]), _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(word1, low)), _mm_set1_ps(step[2])));
+
+		// Uvs
+		__m128 u = halfToFloat4(word2);
+		__m128 v = halfToFloat4(_mm_srli_epi32(word2, 16));
+
+		// Normals, sign extended from 16 bits
+		const __m128 minusOne = _mm_set1_ps(-1.0f);
+		const __m128 zero = _mm_setzero_ps();
+		__m128 x = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(word3, 16), 16)), _mm_set1_ps(snormScale)), minusOne);
+		__m128 y = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(word3, 16)), _mm_set1_ps(snormScale)), minusOne);
+		__m128 z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), abs4(x)), abs4(y));
+
+		const __m128 t = _mm_max_ps(_mm_sub_ps(zero, z), zero);
+		const __m128 negativeT = _mm_sub_ps(zero, t);
+		x = _mm_add_ps(x, select(_mm_cmpge_ps(x, zero), negativeT, t));
+		y = _mm_add_ps(y, select(_mm_cmpge_ps(y, zero), negativeT, t));
+
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		__m128 nx = _mm_div_ps(x, length);
+		__m128 ny = _mm_div_ps(y, length);
+		__m128 nz = _mm_div_ps(z, length);
+
+		_MM_TRANSPOSE4_PS(px, py, pz, u);
+		_MM_TRANSPOSE4_PS(v, nx, ny, nz);
+
+		_mm_storeu_ps(&out[0].pos.x, px);
+		_mm_storeu_ps(&out[1].pos.x, py);
+		_mm_storeu_ps(&out[2].pos.x, pz);
+		_mm_storeu_ps(&out[3].pos.x, u);
+		_mm_storeu_ps(&out[0].uv.y, v);
+		_mm_storeu_ps(&out[1].uv.y, nx);
+		_mm_storeu_ps(&out[2].uv.y, ny);
+		_mm_storeu_ps(&out[3].uv.y, nz);
+	}
+#endif
+}
+
+VertexQuantization computeVertexQuantization(const DX11UWA::VertexPositionUVNormal *vertices, size_t count)
+{
+	float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float *position = &vertices[i].pos.x;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+			boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+		}
+	}
+
+	VertexQuantization quantization = {};
+	if (count == 0)
+		return quantization;
+
+	quantization.offset = DirectX::XMFLOAT3(boundsMin[0], boundsMin[1], boundsMin[2]);
+	quantization.scale = DirectX::XMFLOAT3(boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2]);
+	return quantization;
+}
+
+DX11UWA::VertexDequantizationConstantBuffer makeDequantizationConstants(const VertexQuantization &quantization)
+{
+	DX11UWA::VertexDequantizationConstantBuffer constants;
+	constants.scale = DirectX::XMFLOAT4(quantization.scale.x, quantization.scale.y, quantization.scale.z, 0.0f);
+	constants.offset = DirectX::XMFLOAT4(quantization.offset.x, quantization.offset.y, quantization.offset.z, 0.0f);
+	return constants;
+}
+
+void packVerticesScalar(const DX11UWA::VertexPositionUVNormal *vertices, size_t count, const VertexQuantization &quantization, DX11UWA::VertexPositionUVNormalPacked *out)
+{
+	float step[3], inverse[3];
+	quantizationSteps(quantization, step, inverse);
+
+	for (size_t i = 0; i < count; ++i)
+		packVertex(vertices[i], &quantization.offset.x, inverse, out[i]);
+}
+
+void unpackVerticesScalar(const DX11UWA::VertexPositionUVNormalPacked *packed, size_t count, const VertexQuantization &quantization, DX11UWA::VertexPositionUVNormal *out)
+{
+	float step[3], inverse[3];
+	quantizationSteps(quantization, step, inverse);
+
+	for (size_t i = 0; i < count; ++i)
+		unpackVertex(packed[i], &quantization.offset.x, step, out[i]);
+}
+
+void packVertices(const DX11UWA::VertexPositionUVNormal *vertices, size_t count, const VertexQuantization &quantization, DX11UWA::VertexPositionUVNormalPacked *out)
+{
+	size_t i = 0;
+
+#if defined(VERTEX_PACKING_SSE2)
+	float step[3], inverse[3];
+	quantizationSteps(quantization, step, inverse);
+
+	for (; i + 4 <= count; i += 4)
+		packVertices4(vertices + i, &quantization.offset.x, inverse, out + i);
+#endif
+
+	packVerticesScalar(vertices + i, count - i, quantization, out + i);
+}
+
+void unpackVertices(const DX11UWA::VertexPositionUVNormalPacked *packed, size_t count, const VertexQuantization &quantization, DX11UWA::VertexPositionUVNormal *out)
+{
+	size_t i = 0;
+
+#if defined(VERTEX_PACKING_SSE2)
+	float step[3], inverse[3];
+	quantizationSteps(quantization, step, inverse);
+
+	for (; i + 4 <= count; i += 4)
+		unpackVertices4(packed + i, &quantization.offset.x, step, out + i);
+#endif
+
+	unpackVerticesScalar(packed + i, count - i, quantization, out + i);
+}
+
+VertexPackingError measurePackingError(const DX11UWA::VertexPositionUVNormal *vertices, const DX11UWA::VertexPositionUVNormalPacked *packed, size_t count, const VertexQuantization &quantization)
+{
+	VertexPackingError error = {};
+	float maxCosine = 1.0f;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		DX11UWA::VertexPositionUVNormal decoded;
+		unpackVerticesScalar(packed + i, 1, quantization, &decoded);
+
+		const DX11UWA::VertexPositionUVNormal &vertex = vertices[i];
+		const float dx = decoded.pos.x - vertex.pos.x;
+		const float dy = decoded.pos.y - vertex.pos.y;
+		const float dz = decoded.pos.z - vertex.pos.z;
+		error.maxPosition = std::max(error.maxPosition, sqrtf(dx * dx + dy * dy + dz * dz));
+
+		error.maxUV = std::max(error.maxUV, std::max(fabsf(decoded.uv.x - vertex.uv.x), fabsf(decoded.uv.y - vertex.uv.y)));
+
+		const DirectX::XMFLOAT3 &n = vertex.normal;
+		const float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+		if (length > 0.0f)
+		{
+			const float cosine = (n.x * decoded.normal.x + n.y * decoded.normal.y + n.z * decoded.normal.z) / length;
+			maxCosine = std::min(maxCosine, cosine);
+		}
+	}
+
+	const float extent = std::max(quantization.scale.x, std::max(quantization.scale.y, quantization.scale.z));
+	error.maxPositionRelative = (extent > 0.0f) ? error.maxPosition / extent : 0.0f;
+	error.maxNormalDegrees = acosf(std::min(std::max(maxCosine, -1.0f), 1.0f)) * (180.0f / 3.14159265f);
+	return error;
+}
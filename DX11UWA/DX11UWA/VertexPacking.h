@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include "Content/ShaderStructures.h"
+
+// Packs VertexPositionUVNormal (32 bytes) into VertexPositionUVNormalPacked (16 bytes):
+//  - positions become 16 bit fractions of the mesh bounds,
+//  - uvs become half floats,
+//  - normals are octahedral encoded into two 16 bit signed fractions.
+// Content/PackedVertex.hlsli decodes the same format in the vertex shader.
+//
+// packVertices and unpackVertices work on four vertices at a time with SSE2 where it's available and
+// give exactly the same results as the scalar versions, which are kept for other targets and as a reference.
+
+// Maps packed positions back to model space: position = offset + unorm * scale
+struct VertexQuantization
+{
+	DirectX::XMFLOAT3	offset;
+	DirectX::XMFLOAT3	scale;
+};
+
+// Largest differences between the original vertices and their packed versions
+struct VertexPackingError
+{
+	float	maxPosition;			// In model units
+	float	maxPositionRelative;	// maxPosition over the largest side of the bounds
+	float	maxNormalDegrees;
+	float	maxUV;
+};
+
+// Quantization covering the bounds of the vertices.
+VertexQuantization computeVertexQuantization(const DX11UWA::VertexPositionUVNormal *vertices, size_t count);
+
+// Constants for the vertex shader's VertexDequantization buffer.
+DX11UWA::VertexDequantizationConstantBuffer makeDequantizationConstants(const VertexQuantization &quantization);
+
+void packVertices(const DX11UWA::VertexPositionUVNormal *vertices, size_t count, const VertexQuantization &quantization, DX11UWA::VertexPositionUVNormalPacked *out);
+void unpackVertices(const DX11UWA::VertexPositionUVNormalPacked *packed, size_t count, const VertexQuantization &quantization, DX11UWA::VertexPositionUVNormal *out);
+
+void packVerticesScalar(const DX11UWA::VertexPositionUVNormal *vertices, size_t count, const VertexQuantization &quantization, DX11UWA::VertexPositionUVNormalPacked *out);
+void unpackVerticesScalar(const DX11UWA::VertexPositionUVNormalPacked *packed, size_t count, const VertexQuantization &quantization, DX11UWA::VertexPositionUVNormal *out);
+
+// Compares the original vertices against their packed versions. Normals of zero length are skipped.
+VertexPackingError measurePackingError(const DX11UWA::VertexPositionUVNormal *vertices, const DX11UWA::VertexPositionUVNormalPacked *packed, size_t count, const VertexQuantization &quantization);
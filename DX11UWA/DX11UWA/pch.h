@@ -1,5 +1,19 @@
 ﻿#pragma once
 
+#if defined(RAPTURE_TOOLS)
+
+// The command-line tools build the loader code without the UWP/Direct3D runtime.
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#else
+
 #include <wrl.h>
 #include <wrl/client.h>
 #include <dxgi1_4.h>
@@ -12,4 +26,6 @@
 #include <DirectXMath.h>
 #include <memory>
 #include <agile.h>
-#include <concrt.h>
\ No newline at end of file
+#include <concrt.h>
+
+#endif
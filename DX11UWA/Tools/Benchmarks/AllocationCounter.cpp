@@ -0,0 +1,82 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace
+{
+	// Every allocation is prefixed with its size, so frees can be subtracted
+	const size_t headerSize = 16;
+
+	std::atomic<size_t> allocationCount(0);
+	std::atomic<size_t> heapBytes(0);
+	std::atomic<size_t> peakHeapBytes(0);
+
+	void *allocate(size_t size)
+	{
+		uint8_t *block = static_cast<uint8_t *>(malloc(size + headerSize));
+		if (!block)
+			throw std::bad_alloc();
+
+		memcpy(block, &size, sizeof(size));
+		++allocationCount;
+
+		const size_t now = heapBytes += size;
+		size_t peak = peakHeapBytes.load();
+		while (now > peak && !peakHeapBytes.compare_exchange_weak(peak, now))
+		{
+		}
+
+		return block + headerSize;
+	}
+
+	void release(void *pointer)
+	{
+		if (!pointer)
+			return;
+
+		uint8_t *block = static_cast<uint8_t *>(pointer) - headerSize;
+		size_t size;
+		memcpy(&size, block, sizeof(size));
+		heapBytes -= size;
+		free(block);
+	}
+}
+
+void *operator new(size_t size)
+{
+	return allocate(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+	release(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+	release(pointer);
+}
+
+size_t getAllocationCount(void)
+{
+	return allocationCount.load();
+}
+
+size_t getHeapBytes(void)
+{
+	return heapBytes.load();
+}
+
+size_t getPeakHeapBytes(void)
+{
+	return peakHeapBytes.load();
+}
+
+void resetPeakHeapBytes(void)
+{
+	peakHeapBytes = heapBytes.load();
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+
+// Linking AllocationCounter.cpp into a benchmark replaces the global operator new and delete with ones that
+// count every allocation of the process and how many bytes are allocated at once.
+
+// Allocations made since the process started
+size_t getAllocationCount(void);
+
+// Bytes allocated now, and the most that were since the last resetPeakHeapBytes
+size_t getHeapBytes(void);
+size_t getPeakHeapBytes(void);
+
+// Starts the peak again from what is allocated now
+void resetPeakHeapBytes(void);
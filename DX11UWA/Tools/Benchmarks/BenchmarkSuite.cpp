@@ -0,0 +1,757 @@
+// Times the model and texture loaders, the math helpers in ObjLoader.h and the per-frame update of the scene,
+// and writes the results as JSON so they can be compared between releases.
+//
+// Usage: RaptureBenchmarks [--out <file.json>] [--filter <text>] [--models <dir>] [--textures <dir>] [--min-time <seconds>]
+// With no arguments every .obj in Assets/Models and every .dds and .png in Assets/Textures is loaded, every .png is
+// block compressed in each format at each quality, and the JSON goes to stdout. --filter only runs the cases whose name contains the text. Progress goes to stderr.
+//
+// Every case is run once to warm up, then timed one iteration at a time until it has run for --min-time
+// (0.25 seconds by default) and at least 10 times. Cases too quick to time alone, such as parsing a DDS header,
+// run a batch of itemsPerIteration in each iteration. The exit code is non-zero if any case failed.
+
+#include "pch.h"
+#include "AllocationCounter.h"
+#include "Common/DDS.h"
+#include "Common/StepTimer.h"
+#include "FrameStats.h"
+#include "HudText.h"
+#include "MappedFile.h"
+#include "ObjLoader.h"
+#include "PngLoader.h"
+#include "Profiler.h"
+#include "SceneAnimation.h"
+#include "SceneSimulation.h"
+#include "TextureCompression.h"
+#include "TripleBuffer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const size_t minIterations = 10;
+	const size_t maxIterations = 100000;
+
+	// Frames of update/* cases, at 60 frames a second
+	const int frameCount = 1000;
+	const float frameSeconds = 1.0f / 60.0f;
+
+	// How long each presented frame of update/frame takes on the virtual clock: mostly a 60 Hz display, with a
+	// missed vsync every 7th frame and a long stall every 100th, which StepTimer clamps to a tenth of a second
+	double presentedFrameSeconds(int frame)
+	{
+		if (frame % 100 == 99)
+			return 0.25;
+		if (frame % 7 == 6)
+			return 2.0 / 60.0;
+		return 1.0 / 60.0;
+	}
+
+	// Keeps the optimizer from dropping work whose result isn't used
+	volatile float floatSink;
+	volatile size_t sizeSink;
+
+	struct Case
+	{
+		std::string				name;
+		size_t					itemsPerIteration;
+		std::function<bool()>	run;		// One iteration, false if it failed
+	};
+
+	struct CaseResult
+	{
+		std::string	name;
+		bool		succeeded;
+		size_t		iterations;
+		size_t		itemsPerIteration;
+		double		minNs;
+		double		medianNs;
+		double		p99Ns;
+		double		allocationsPerIteration;
+	};
+
+	bool endsWith(const std::string &text, const char *suffix)
+	{
+		const size_t length = strlen(suffix);
+		if (text.size() < length)
+			return false;
+
+		// Extensions are matched case insensitively
+		for (size_t i = 0; i < length; ++i)
+		{
+			if (tolower(static_cast<unsigned char>(text[text.size() - length + i])) != tolower(static_cast<unsigned char>(suffix[i])))
+				return false;
+		}
+
+		return true;
+	}
+
+	std::string stem(const std::string &name)
+	{
+		const size_t dot = name.find_last_of('.');
+		return (dot == std::string::npos) ? name : name.substr(0, dot);
+	}
+
+	// Names of the files in directory ending in extension, sorted so the cases always run in the same order
+	std::vector<std::string> listFiles(const std::string &directory, const char *extension)
+	{
+		std::vector<std::string> names;
+
+#if defined(_WIN32)
+		WIN32_FIND_DATAA found;
+		HANDLE search = FindFirstFileA((directory + "\\*").c_str(), &found);
+		if (search != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && endsWith(found.cFileName, extension))
+					names.push_back(found.cFileName);
+			} while (FindNextFileA(search, &found));
+
+			FindClose(search);
+		}
+#else
+		DIR *dir = opendir(directory.c_str());
+		if (dir)
+		{
+			while (dirent *entry = readdir(dir))
+			{
+				std::string name = entry->d_name;
+				struct stat info;
+				if (endsWith(name, extension) && stat((directory + "/" + name).c_str(), &info) == 0 && S_ISREG(info.st_mode))
+					names.push_back(name);
+			}
+
+			closedir(dir);
+		}
+#endif
+
+		std::sort(names.begin(), names.end());
+		return names;
+	}
+
+	// Value at fraction of the sorted samples, by nearest rank
+	double percentile(const std::vector<double> &sorted, double fraction)
+	{
+		size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.999999);
+		rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+		return sorted[rank - 1];
+	}
+
+	CaseResult runCase(const Case &benchmark, double minSeconds)
+	{
+		CaseResult result = {};
+		result.name = benchmark.name;
+		result.itemsPerIteration = benchmark.itemsPerIteration;
+
+		// The warm up also fills the caches a loader keeps, so the allocations are the steady state ones
+		result.succeeded = benchmark.run();
+		if (!result.succeeded)
+			return result;
+
+		std::vector<double> samples;
+		samples.reserve(maxIterations);
+
+		const size_t allocationsBefore = getAllocationCount();
+		const Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(minSeconds));
+		while ((samples.size() < minIterations || Clock::now() < end) && samples.size() < maxIterations)
+		{
+			const Clock::time_point start = Clock::now();
+			const bool succeeded = benchmark.run();
+			samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+
+			if (!succeeded)
+			{
+				result.succeeded = false;
+				return result;
+			}
+		}
+
+		result.allocationsPerIteration = static_cast<double>(getAllocationCount() - allocationsBefore) / samples.size();
+
+		std::sort(samples.begin(), samples.end());
+		result.iterations = samples.size();
+		result.minNs = samples.front();
+		result.medianNs = percentile(samples, 0.5);
+		result.p99Ns = percentile(samples, 0.99);
+		return result;
+	}
+
+	void writeJsonString(FILE *file, const std::string &text)
+	{
+		fputc('"', file);
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				fprintf(file, "\\%c", c);
+			else if (static_cast<unsigned char>(c) < 0x20)
+				fprintf(file, "\\u%04x", c);
+			else
+				fputc(c, file);
+		}
+		fputc('"', file);
+	}
+
+	void writeResults(FILE *file, const std::vector<CaseResult> &results)
+	{
+		fprintf(file, "{\n  \"suite\": \"RaptureBenchmarks\",\n  \"cases\": [");
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const CaseResult &result = results[i];
+			fprintf(file, "%s\n    { \"name\": ", i ? "," : "");
+			writeJsonString(file, result.name);
+			if (!result.succeeded)
+			{
+				fprintf(file, ", \"failed\": true }");
+				continue;
+			}
+
+			fprintf(file, ", \"iterations\": %zu, \"itemsPerIteration\": %zu, \"minNs\": %.0f, \"medianNs\": %.0f, \"p99Ns\": %.0f, \"allocationsPerIteration\": %.2f }",
+				result.iterations, result.itemsPerIteration, result.minNs, result.medianNs, result.p99Ns, result.allocationsPerIteration);
+		}
+		fprintf(file, "\n  ]\n}\n");
+	}
+
+	void addModelCases(std::vector<Case> &cases, const std::string &modelDir)
+	{
+		for (const std::string &name : listFiles(modelDir, ".obj"))
+		{
+			const std::string path = modelDir + "/" + name;
+			cases.push_back({ "obj/" + stem(name), 1, [path]()
+			{
+				MeshData mesh;
+				if (!loadOBJ(path.c_str(), mesh))
+					return false;
+				sizeSink = mesh.GetIndexCount();
+				return true;
+			} });
+		}
+	}
+
+	// What FillDDSInitData fills in, laid out like D3D11_SUBRESOURCE_DATA
+	struct SubresourceData
+	{
+		const void	*pSysMem;
+		uint32_t	SysMemPitch;
+		uint32_t	SysMemSlicePitch;
+	};
+
+	void addTextureCases(std::vector<Case> &cases, const std::string &textureDir)
+	{
+		const size_t headersPerIteration = 1000;
+
+		for (const std::string &name : listFiles(textureDir, ".dds"))
+		{
+			// The file stays mapped for as long as the cases are kept
+			std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+			const std::string path = textureDir + "/" + name;
+			const std::string texture = stem(name);
+
+			if (!file->Open(path.c_str()))
+			{
+				cases.push_back({ "dds/describe/" + texture, headersPerIteration, []() { return false; } });
+				continue;
+			}
+
+			cases.push_back({ "dds/describe/" + texture, headersPerIteration, [file]()
+			{
+				DDSDescription desc;
+				for (size_t i = 0; i < headersPerIteration; ++i)
+				{
+					if (!GetDDSDescription(reinterpret_cast<const uint8_t *>(file->GetData()), file->GetSize(), desc))
+						return false;
+				}
+				sizeSink = desc.width;
+				return true;
+			} });
+
+			// Every mip of every slice, as the loader fills them in before creating the texture. Where they're
+			// filled in is allocated up front, so the iterations don't allocate.
+			DDSDescription desc;
+			if (!GetDDSDescription(reinterpret_cast<const uint8_t *>(file->GetData()), file->GetSize(), desc))
+			{
+				cases.push_back({ "dds/fill/" + texture, headersPerIteration, []() { return false; } });
+				continue;
+			}
+
+			std::shared_ptr<std::vector<SubresourceData>> initData = std::make_shared<std::vector<SubresourceData>>(desc.mipCount * desc.arraySize);
+			cases.push_back({ "dds/fill/" + texture, headersPerIteration, [file, desc, initData]()
+			{
+				const uint8_t *bitData = reinterpret_cast<const uint8_t *>(file->GetData()) + desc.bitOffset;
+				size_t twidth, theight, tdepth, skipMip;
+				for (size_t i = 0; i < headersPerIteration; ++i)
+				{
+					if (FillDDSInitData(desc.width, desc.height, desc.depth, desc.mipCount, desc.arraySize, desc.format, 0, desc.bitSize, bitData,
+						twidth, theight, tdepth, skipMip, initData->data()) != DDS_FILL_OK)
+						return false;
+				}
+				sizeSink = (*initData)[0].SysMemPitch;
+				return true;
+			} });
+		}
+
+		// The first mip of every image in each format the cooker compresses to, on every core as the cooker does
+		const DXGI_FORMAT compressedFormats[] = { DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_BC5_UNORM, DXGI_FORMAT_BC7_UNORM };
+		const char *const formatNames[] = { "bc1", "bc3", "bc5", "bc7" };
+		const char *const qualityNames[] = { "fast", "normal", "high" };
+		for (const std::string &name : listFiles(textureDir, ".png"))
+		{
+			const std::string path = textureDir + "/" + name;
+			const std::string texture = stem(name);
+			cases.push_back({ "png/decode/" + texture, 1, [path]()
+			{
+				std::vector<uint8_t> rgba;
+				uint32_t width, height;
+				if (!loadPNG(path.c_str(), rgba, width, height))
+					return false;
+				sizeSink = rgba.size();
+				return true;
+			} });
+
+			std::shared_ptr<std::vector<uint8_t>> rgba = std::make_shared<std::vector<uint8_t>>();
+			uint32_t width = 0, height = 0;
+			const bool loaded = loadPNG(path.c_str(), *rgba, width, height);
+			for (size_t format = 0; format < sizeof(compressedFormats) / sizeof(compressedFormats[0]); ++format)
+			{
+				for (int quality = TEXTURE_QUALITY_FAST; quality <= TEXTURE_QUALITY_HIGH; ++quality)
+				{
+					const std::string caseName = std::string(formatNames[format]) + "/" + qualityNames[quality] + "/" + texture;
+					if (!loaded)
+					{
+						cases.push_back({ caseName, 1, []() { return false; } });
+						continue;
+					}
+
+					const size_t blockCount = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+					std::shared_ptr<std::vector<uint8_t>> blocks = std::make_shared<std::vector<uint8_t>>(blockCount * 16);
+					const DXGI_FORMAT compressedFormat = compressedFormats[format];
+					cases.push_back({ caseName, blockCount, [rgba, width, height, compressedFormat, quality, blocks]()
+					{
+						compressTextureBlocks(rgba->data(), width, height, compressedFormat, static_cast<TextureQuality>(quality), blocks->data());
+						sizeSink = (*blocks)[0];
+						return true;
+					} });
+				}
+			}
+		}
+
+		// Every mip of a 1024x1024 texture in each of the formats the textures come in
+		const DXGI_FORMAT formats[] = { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_BC7_UNORM };
+		const size_t mipCount = 11;
+		cases.push_back({ "dds/surface_info", (sizeof(formats) / sizeof(formats[0])) * mipCount, [=]()
+		{
+			size_t total = 0;
+			for (DXGI_FORMAT format : formats)
+			{
+				for (size_t mip = 0; mip < mipCount; ++mip)
+				{
+					size_t numBytes, rowBytes, numRows;
+					GetSurfaceInfo(size_t(1024) >> mip, size_t(1024) >> mip, format, &numBytes, &rowBytes, &numRows);
+					total += numBytes;
+				}
+			}
+			sizeSink = total;
+			return true;
+		} });
+	}
+
+	void addMathCases(std::vector<Case> &cases)
+	{
+		const size_t vectorCount = 4096;
+
+		// The same pseudo random vectors every run
+		std::shared_ptr<std::vector<DirectX::XMFLOAT3>> vectors = std::make_shared<std::vector<DirectX::XMFLOAT3>>(vectorCount);
+		unsigned int seed = 12345;
+		for (DirectX::XMFLOAT3 &v : *vectors)
+		{
+			float *components[] = { &v.x, &v.y, &v.z };
+			for (float *component : components)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				*component = (seed >> 8) / 16777216.0f * 20.0f - 10.0f;
+			}
+		}
+
+		cases.push_back({ "math/Clamp", vectorCount, [vectors]()
+		{
+			float sum = 0.0f;
+			for (const DirectX::XMFLOAT3 &v : *vectors)
+				sum += Clamp(v.x, 5.0f, -5.0f);
+			floatSink = sum;
+			return true;
+		} });
+
+		cases.push_back({ "math/Lerp", vectorCount, [vectors]()
+		{
+			float sum = 0.0f;
+			for (size_t i = 1; i < vectors->size(); ++i)
+				sum += Lerp((*vectors)[i - 1], (*vectors)[i], 0.25f).x;
+			floatSink = sum;
+			return true;
+		} });
+
+		cases.push_back({ "math/Vector_Subtraction", vectorCount, [vectors]()
+		{
+			float sum = 0.0f;
+			for (size_t i = 1; i < vectors->size(); ++i)
+				sum += Vector_Subtraction((*vectors)[i - 1], (*vectors)[i]).y;
+			floatSink = sum;
+			return true;
+		} });
+
+		cases.push_back({ "math/Vector_Length", vectorCount, [vectors]()
+		{
+			float sum = 0.0f;
+			for (const DirectX::XMFLOAT3 &v : *vectors)
+				sum += Vector_Length(v);
+			floatSink = sum;
+			return true;
+		} });
+
+		cases.push_back({ "math/Vector_Normalize", vectorCount, [vectors]()
+		{
+			float sum = 0.0f;
+			for (const DirectX::XMFLOAT3 &v : *vectors)
+				sum += Vector_Normalize(v).z;
+			floatSink = sum;
+			return true;
+		} });
+
+		cases.push_back({ "math/Vector_Dot", vectorCount, [vectors]()
+		{
+			float sum = 0.0f;
+			for (size_t i = 1; i < vectors->size(); ++i)
+				sum += Vector_Dot((*vectors)[i - 1], (*vectors)[i]);
+			floatSink = sum;
+			return true;
+		} });
+
+		cases.push_back({ "math/Vector_Scalar_Multiply", vectorCount, [vectors]()
+		{
+			float sum = 0.0f;
+			for (const DirectX::XMFLOAT3 &v : *vectors)
+				sum += Vector_Scalar_Multiply(v, 0.5f).x;
+			floatSink = sum;
+			return true;
+		} });
+	}
+
+	// The scene as Sample3DSceneRenderer sets it up
+	struct Scene
+	{
+		DirectX::XMFLOAT4X4	camera;
+		DirectionalLight	directional;
+		PointLight			point;
+		SpotLight			spot;
+	};
+
+	Scene initialScene(void)
+	{
+		Scene scene = {};
+
+		static const DirectX::XMVECTORF32 eye = { 0.0f, 0.7f, -1.5f, 0.0f };
+		static const DirectX::XMVECTORF32 at = { 0.0f, -0.1f, 0.0f, 0.0f };
+		static const DirectX::XMVECTORF32 up = { 0.0f, 1.0f, 0.0f, 0.0f };
+		DirectX::XMStoreFloat4x4(&scene.camera, DirectX::XMMatrixInverse(nullptr, DirectX::XMMatrixLookAtLH(eye, at, up)));
+
+		scene.directional.direction = { 0.0f, -4.0f, 1.0f, 0.0f };
+		scene.directional.color = { 0.250980f , 0.611764f, 1.0f, 0.0f };
+
+		scene.point.position = { 0.0f, 2.0f, 0.0f, 0.0f };
+		scene.point.color = { 0.788f, 0.886f, 1.0f, 0.0f };
+		scene.point.radius.x = 3.0f;
+
+		scene.spot.position = { 0.0f, 2.0f, 0.0f, 0.0f };
+		scene.spot.color = { 1.0f, 0.945f, 0.878f, 0.0f };
+		scene.spot.cone_direction = { 0.0f, -0.35f, -0.1f, 0.0f };
+		scene.spot.cone_ratio.x = 0.5f;
+		scene.spot.inner_cone_ratio.x = 0.96f;
+		scene.spot.outer_cone_ratio.x = 0.95f;
+		return scene;
+	}
+
+	void addUpdateCases(std::vector<Case> &cases)
+	{
+		// Walking forward and strafing while turning with the mouse, the most the camera does in a frame
+		std::shared_ptr<std::vector<char>> keys = std::make_shared<std::vector<char>>(256, 0);
+		(*keys)['W'] = 1;
+		(*keys)['D'] = 1;
+
+		cases.push_back({ "update/camera", frameCount, [keys]()
+		{
+			Scene scene = initialScene();
+			for (int frame = 0; frame < frameCount; ++frame)
+				updateCamera(scene.camera, keys->data(), true, 3.0f, -1.0f, frameSeconds, 1.0f, 0.75f);
+			floatSink = scene.camera._41;
+			return true;
+		} });
+
+		cases.push_back({ "update/lights", frameCount, []()
+		{
+			Scene scene = initialScene();
+			for (int frame = 0; frame < frameCount; ++frame)
+				animateLights(scene.directional, scene.point, scene.spot, frameSeconds);
+			floatSink = scene.point.position.x;
+			return true;
+		} });
+
+		// Everything Update and Render compute on the CPU each frame, short of filling the constant buffers, driven
+		// by a fixed 60 Hz StepTimer as DX11UWAMain does. The timer runs on a virtual clock, so every run makes the
+		// same updates with the same elapsed times, including the catch-up ones, and fails if it doesn't.
+		struct FrameResult
+		{
+			uint32_t			updateCount;
+			DirectX::XMFLOAT4X4	model, view;
+			PointLight			point;
+		};
+
+		std::shared_ptr<FrameResult> reference = std::make_shared<FrameResult>();
+		std::shared_ptr<bool> hasReference = std::make_shared<bool>(false);
+
+		cases.push_back({ "update/frame", frameCount, [keys, reference, hasReference]()
+		{
+			using namespace DirectX;
+
+			DX::VirtualStepClock clock;
+			DX::StepTimer timer(clock);
+			timer.SetFixedTimeStep(true);
+			timer.SetTargetElapsedSeconds(1.0 / 60);
+
+			Scene scene = initialScene();
+			FrameResult result = {};
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				clock.AdvanceSeconds(presentedFrameSeconds(frame));
+				timer.Tick([&]()
+				{
+					const float elapsedSeconds = static_cast<float>(timer.GetElapsedSeconds());
+					const float radians = static_cast<float>(fmod(timer.GetTotalSeconds() * XMConvertToRadians(45.0f), XM_2PI));
+					XMStoreFloat4x4(&result.model, XMMatrixMultiply(XMMatrixRotationY(radians), XMMatrixTranslation(0.0f, 10.0f, 0.0f)));
+
+					updateCamera(scene.camera, keys->data(), true, 3.0f, -1.0f, elapsedSeconds, 1.0f, 0.75f);
+					animateLights(scene.directional, scene.point, scene.spot, elapsedSeconds);
+
+					XMStoreFloat4x4(&result.view, XMMatrixInverse(nullptr, XMLoadFloat4x4(&scene.camera)));
+				});
+			}
+			result.updateCount = timer.GetFrameCount();
+			result.point = scene.point;
+			floatSink = result.model._11 + result.view._41 + scene.directional.direction.y;
+
+			if (!*hasReference)
+			{
+				*reference = result;
+				*hasReference = true;
+				return true;
+			}
+			return memcmp(&result, reference.get(), sizeof(result)) == 0;
+		} });
+
+		// What DX11UWAMain does for each frame on a 144 Hz display with the simulation at 60 Hz: publish the
+		// steps due, take the newest and draw the scene between it and the one before. Fails if a frame ever
+		// goes back in time.
+		cases.push_back({ "update/interpolate", frameCount, [keys]()
+		{
+			DX::VirtualStepClock clock;
+			SceneSimulation simulation(clock);
+			TripleBuffer<SceneSnapshot> scenes;
+
+			SceneInput input = {};
+			memcpy(input.keys, keys->data(), sizeof(input.keys));
+
+			SceneSnapshot previous = simulation.GetScene(), current = previous, scene;
+			const double stepTicks = simulation.GetStepSeconds() * clock.GetFrequency();
+			float lastRadians = 0.0f;
+			bool forward = true;
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				clock.AdvanceSeconds(1.0 / 144);
+				if (simulation.Update(input))
+				{
+					scenes.GetBack() = simulation.GetScene();
+					scenes.Publish();
+				}
+
+				if (scenes.Acquire())
+				{
+					previous = current;
+					current = scenes.GetFront();
+				}
+
+				const float alpha = static_cast<float>(std::min((clock.GetTicks() - current.stepTicks) / stepTicks, 1.0));
+				interpolateScene(previous, current, alpha, scene);
+
+				// The turn only wraps around once in a while, and never by less than most of a circle
+				if (scene.modelRadians < lastRadians && lastRadians - scene.modelRadians < DirectX::XM_PI)
+					forward = false;
+				lastRadians = scene.modelRadians;
+			}
+			floatSink = scene.camera._41 + scene.point.position.x;
+			return forward;
+		} });
+
+		// The frame stats DX11UWAMain keeps: recording a frame's update, submit and present times, which it
+		// does every frame, and summarizing a full window, which the overlay does a few times a second. Every
+		// 50th frame is a hitch, and the summary has to count them.
+		std::shared_ptr<FrameStats> stats = std::make_shared<FrameStats>();
+		stats->SetHitchThreshold(FRAME_STAT_PRESENT, 25.0f);
+
+		cases.push_back({ "update/stats-record", frameCount, [stats]()
+		{
+			for (int frame = 0; frame < frameCount; ++frame)
+			{
+				stats->Record(FRAME_STAT_UPDATE, 0.25f);
+				stats->Record(FRAME_STAT_RENDER, 1.5f + (frame % 7) * 0.1f);
+				stats->Record(FRAME_STAT_PRESENT, (frame % 50 == 49) ? 33.3f : 16.7f);
+			}
+			return true;
+		} });
+
+		cases.push_back({ "update/stats-summarize", 1, [stats]()
+		{
+			const FrameStatSummary summary = stats->Summarize(FRAME_STAT_PRESENT);
+			floatSink = summary.p99;
+			return summary.window == 1024 && summary.p50 == 16.7f && summary.max == 33.3f && summary.hitches >= 20 && summary.hitches <= 21;
+		} });
+
+		// The overlay's text: laying it out when the numbers change, and what a refresh costs when they don't,
+		// which is most of them once the frame times settle. Neither may upload quads for unchanged text.
+		class CountingHudBackend : public HudTextBackend
+		{
+		public:
+			CountingHudBackend(void) : uploads(0) {}
+			virtual void SetQuads(const HudQuad * /*quads*/, uint32_t /*count*/) override { ++uploads; }
+			virtual void Draw(float /*x*/, float /*y*/) override {}
+			size_t uploads;
+		};
+
+		std::shared_ptr<HudFont> font = std::make_shared<HudFont>();
+		memset(font.get(), 0, sizeof(HudFont));
+		font->lineHeight = 21.3f;
+		for (HudGlyph &glyph : font->glyphs)
+			glyph.advance = 8.0f;
+		packHudGlyphs(*font, 512.0f, 2.0f);
+
+		std::shared_ptr<std::string> overlay = std::make_shared<std::string>(1024, '\0');
+		formatFrameStats(*stats, &(*overlay)[0], overlay->size());
+		overlay->resize(strlen(overlay->c_str()));
+
+		cases.push_back({ "update/hud-layout", 1, [font, overlay]()
+		{
+			CountingHudBackend backend;
+			HudText text(backend, *font, HUD_ALIGN_RIGHT);
+			text.SetText(overlay->c_str());
+			return backend.uploads == 1 && text.GetQuadCount() > 0;
+		} });
+
+		cases.push_back({ "update/hud-unchanged", 1, [font, overlay]()
+		{
+			static CountingHudBackend backend;
+			static HudText text(backend, *font, HUD_ALIGN_RIGHT);
+			text.SetText(overlay->c_str());
+			return backend.uploads == 1;
+		} });
+
+		// A profiler marker around each step of a frame, nested two deep like Render inside the frame, so the
+		// median over markerCount is what one marker costs (the budget is 50 ns). The tools build leaves the
+		// PROFILE_ macros out, so this uses ProfileScope itself.
+		const int markerCount = 1000;
+		cases.push_back({ "update/profile-scope", markerCount, []()
+		{
+			for (int frame = 0; frame < markerCount / 2; ++frame)
+			{
+				ProfileScope frameScope("frame");
+				{
+					ProfileScope stepScope("step");
+					floatSink += 1.0f;
+				}
+			}
+			return true;
+		} });
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::string modelDir = std::string(RAPTURE_ASSET_DIR) + "/Models";
+	std::string textureDir = std::string(RAPTURE_ASSET_DIR) + "/Textures";
+	std::string outPath;
+	std::string filter;
+	double minSeconds = 0.25;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--out" && i + 1 < argc)
+			outPath = argv[++i];
+		else if (arg == "--filter" && i + 1 < argc)
+			filter = argv[++i];
+		else if (arg == "--models" && i + 1 < argc)
+			modelDir = argv[++i];
+		else if (arg == "--textures" && i + 1 < argc)
+			textureDir = argv[++i];
+		else if (arg == "--min-time" && i + 1 < argc)
+			minSeconds = atof(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Usage: %s [--out <file.json>] [--filter <text>] [--models <dir>] [--textures <dir>] [--min-time <seconds>]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	std::vector<Case> cases;
+	addModelCases(cases, modelDir);
+	addTextureCases(cases, textureDir);
+	addMathCases(cases);
+	addUpdateCases(cases);
+
+	std::vector<CaseResult> results;
+	bool failed = false;
+	for (const Case &benchmark : cases)
+	{
+		if (!filter.empty() && benchmark.name.find(filter) == std::string::npos)
+			continue;
+
+		const CaseResult result = runCase(benchmark, minSeconds);
+		if (result.succeeded)
+		{
+			fprintf(stderr, "%-32s %8zu iterations %14.0f ns median %14.0f ns p99 %10.2f allocations\n", result.name.c_str(), result.iterations,
+				result.medianNs, result.p99Ns, result.allocationsPerIteration);
+		}
+		else
+			fprintf(stderr, "%-32s failed\n", result.name.c_str());
+
+		failed = failed || !result.succeeded;
+		results.push_back(result);
+	}
+
+	FILE *file = outPath.empty() ? stdout : fopen(outPath.c_str(), "w");
+	if (!file)
+	{
+		fprintf(stderr, "can't write %s\n", outPath.c_str());
+		return 1;
+	}
+
+	writeResults(file, results);
+	if (file != stdout && fclose(file) != 0)
+	{
+		fprintf(stderr, "can't write %s\n", outPath.c_str());
+		return 1;
+	}
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,255 @@
+// Builds culling clusters for each model and flies cameras around it, reporting how many triangles
+// the cluster culling rejects, how many DrawIndexed ranges are left and how fast the SIMD culling is.
+//
+// Usage: ClusterCullBenchmark [file.obj ...]
+// With no arguments Big_Daddy.obj (if it's in Assets/Models) and every model shipped there are measured.
+
+#include "pch.h"
+#include "MeshCache.h"
+#include "MeshClusters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Vector3
+	{
+		float x, y, z;
+	};
+
+	Vector3 subtract(const Vector3 &a, const Vector3 &b)
+	{
+		Vector3 result = { a.x - b.x, a.y - b.y, a.z - b.z };
+		return result;
+	}
+
+	Vector3 cross(const Vector3 &a, const Vector3 &b)
+	{
+		Vector3 result = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		return result;
+	}
+
+	float dot(const Vector3 &a, const Vector3 &b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	Vector3 normalize(const Vector3 &v)
+	{
+		const float length = sqrtf(dot(v, v));
+		Vector3 result = { v.x / length, v.y / length, v.z / length };
+		return result;
+	}
+
+	// View * projection for a left handed camera, as XMMatrixLookAtLH * XMMatrixPerspectiveFovLH would give.
+	// The model matrix is the identity, so this is also the model-view-projection.
+	DirectX::XMFLOAT4X4 viewProjection(const Vector3 &eye, const Vector3 &at, float aspect, float farPlane)
+	{
+		const Vector3 up = { 0.0f, 1.0f, 0.0f };
+		const Vector3 zAxis = normalize(subtract(at, eye));
+		const Vector3 xAxis = normalize(cross(up, zAxis));
+		const Vector3 yAxis = cross(zAxis, xAxis);
+
+		const float view[4][4] =
+		{
+			{ xAxis.x, yAxis.x, zAxis.x, 0.0f },
+			{ xAxis.y, yAxis.y, zAxis.y, 0.0f },
+			{ xAxis.z, yAxis.z, zAxis.z, 0.0f },
+			{ -dot(xAxis, eye), -dot(yAxis, eye), -dot(zAxis, eye), 1.0f },
+		};
+
+		// Same field of view and near plane as the renderer
+		const float nearPlane = 0.01f;
+		const float height = 1.0f / tanf(70.0f * 3.14159265f / 360.0f);
+		const float projection[4][4] =
+		{
+			{ height / aspect, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, height, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, farPlane / (farPlane - nearPlane), 1.0f },
+			{ 0.0f, 0.0f, -nearPlane * farPlane / (farPlane - nearPlane), 0.0f },
+		};
+
+		DirectX::XMFLOAT4X4 result;
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < 4; ++k)
+					sum += view[row][k] * projection[k][column];
+				result.m[row][column] = sum;
+			}
+		}
+
+		return result;
+	}
+
+	struct CameraPath
+	{
+		const char			*name;
+		std::vector<Vector3> eyes;
+		std::vector<Vector3> targets;
+	};
+
+	// Orbits at two distances around the bounding sphere and a walk past the model looking ahead
+	std::vector<CameraPath> makePaths(const Vector3 &center, float radius)
+	{
+		std::vector<CameraPath> paths(3);
+		paths[0].name = "orbit 3r";
+		paths[1].name = "orbit 1.5r";
+		paths[2].name = "walk past";
+
+		const int steps = 72;
+		for (int i = 0; i < steps; ++i)
+		{
+			const float angle = 6.28318531f * i / steps;
+			for (int p = 0; p < 2; ++p)
+			{
+				const float distance = radius * (p ? 1.5f : 3.0f);
+				const Vector3 eye = { center.x + cosf(angle) * distance, center.y + 0.3f * radius, center.z + sinf(angle) * distance };
+				paths[p].eyes.push_back(eye);
+				paths[p].targets.push_back(center);
+			}
+
+			const float t = static_cast<float>(i) / (steps - 1);
+			const Vector3 eye = { center.x + (t * 6.0f - 3.0f) * radius, center.y, center.z - 1.2f * radius };
+			const Vector3 target = { eye.x + radius, eye.y, eye.z + 0.5f * radius };
+			paths[2].eyes.push_back(eye);
+			paths[2].targets.push_back(target);
+		}
+
+		return paths;
+	}
+
+	const char *fileName(const std::string &path)
+	{
+		const char *name = strrchr(path.c_str(), '/');
+		return name ? name + 1 : path.c_str();
+	}
+
+	std::string stem(const std::string &name)
+	{
+		const size_t dot = name.rfind('.');
+		return (dot == std::string::npos) ? name : name.substr(0, dot);
+	}
+
+	void measureModel(const std::string &path)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		ObjLoadOptions options;
+		options.parseThreads = 0;
+		options.optimize = true;
+		options.buildClusters = true;
+
+		RMesh mesh;
+		if (!cookMesh(path.c_str(), mesh, options, findMeshRecipe(stem(fileName(path)).c_str())))
+		{
+			printf("%s: can't load\n", path.c_str());
+			return;
+		}
+
+		const RMeshHeader &header = mesh.GetHeader();
+		const MeshCluster *clusters = mesh.GetClusters();
+		const size_t clusterCount = mesh.GetClusterCount();
+		const size_t triangleCount = mesh.GetIndexCount() / 3;
+
+		MeshClusterBounds bounds;
+		prepareClusterBounds(clusters, clusterCount, bounds);
+
+		const Vector3 center = { (header.boundsMin[0] + header.boundsMax[0]) * 0.5f, (header.boundsMin[1] + header.boundsMax[1]) * 0.5f,
+			(header.boundsMin[2] + header.boundsMax[2]) * 0.5f };
+		const Vector3 extent = { header.boundsMax[0] - center.x, header.boundsMax[1] - center.y, header.boundsMax[2] - center.z };
+		const float radius = std::max(sqrtf(dot(extent, extent)), 1e-3f);
+
+		printf("\n%s: %zu triangles, %zu clusters, %.1f triangles per cluster\n", fileName(path), triangleCount, clusterCount,
+			clusterCount ? static_cast<double>(triangleCount) / clusterCount : 0.0);
+		printf("%-12s %12s %12s %12s %10s %12s %12s %10s\n", "path", "backfacing", "outside", "rejected", "ranges", "scalar ns", "simd ns", "identical");
+
+		std::vector<uint8_t> culled(clusterCount), culledScalar(clusterCount);
+		std::vector<RMeshSubmesh> ranges;
+
+		for (const CameraPath &cameraPath : makePaths(center, radius))
+		{
+			size_t backfacing = 0, outside = 0, rejected = 0, rangeCount = 0, total = 0;
+			std::vector<double> scalarSamples, simdSamples;
+			bool identical = true;
+
+			for (size_t frame = 0; frame < cameraPath.eyes.size(); ++frame)
+			{
+				const Vector3 &eye = cameraPath.eyes[frame];
+				const ClusterCullView view = makeClusterCullView(DirectX::XMFLOAT3(eye.x, eye.y, eye.z),
+					viewProjection(eye, cameraPath.targets[frame], 16.0f / 9.0f, radius * 100.0f));
+
+				// Best of a few runs, one frame is only a few microseconds
+				double scalarBest = 1e30, simdBest = 1e30;
+				for (int run = 0; run < 16; ++run)
+				{
+					Clock::time_point start = Clock::now();
+					cullMeshClustersScalar(bounds, view, culledScalar.data());
+					Clock::time_point middle = Clock::now();
+					cullMeshClusters(bounds, view, culled.data());
+
+					scalarBest = std::min(scalarBest, std::chrono::duration<double, std::nano>(middle - start).count());
+					simdBest = std::min(simdBest, std::chrono::duration<double, std::nano>(Clock::now() - middle).count());
+				}
+				scalarSamples.push_back(scalarBest / std::max<size_t>(clusterCount, 1));
+				simdSamples.push_back(simdBest / std::max<size_t>(clusterCount, 1));
+				identical = identical && culled == culledScalar;
+
+				for (size_t i = 0; i < clusterCount; ++i)
+				{
+					const size_t triangles = clusters[i].indexCount / 3;
+					backfacing += (culled[i] & CLUSTER_CULLED_BACKFACING) ? triangles : 0;
+					outside += (culled[i] & CLUSTER_CULLED_OUTSIDE) ? triangles : 0;
+					rejected += culled[i] ? triangles : 0;
+				}
+				total += triangleCount;
+
+				buildClusterDrawRanges(clusters, clusterCount, culled.data(), mesh.GetSubmeshes(), ranges);
+				rangeCount += ranges.size();
+			}
+
+			std::sort(scalarSamples.begin(), scalarSamples.end());
+			std::sort(simdSamples.begin(), simdSamples.end());
+
+			const double frames = static_cast<double>(cameraPath.eyes.size());
+			printf("%-12s %11.1f%% %11.1f%% %11.1f%% %10.1f %12.2f %12.2f %10s\n", cameraPath.name, 100.0 * backfacing / std::max<size_t>(total, 1),
+				100.0 * outside / std::max<size_t>(total, 1), 100.0 * rejected / std::max<size_t>(total, 1), rangeCount / frames,
+				scalarSamples[scalarSamples.size() / 2], simdSamples[simdSamples.size() / 2], identical ? "yes" : "NO");
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+		paths.push_back(argv[i]);
+
+	if (paths.empty())
+	{
+		// Big_Daddy.obj isn't checked in, so it's only measured when it has been copied there
+		const std::string bigDaddy = std::string(RAPTURE_ASSET_DIR) + "/Models/Big_Daddy.obj";
+		FileStamp stamp;
+		if (getFileStamp(bigDaddy.c_str(), stamp))
+			paths.push_back(bigDaddy);
+
+		const char *models[] = { "Bioshock_Label.obj", "Dr_Suchong.obj", "Subject_Delta.obj", "test pyramid.obj" };
+		for (const char *model : models)
+			paths.push_back(std::string(RAPTURE_ASSET_DIR) + "/Models/" + model);
+	}
+
+	// Percentages are of all the triangles drawn over the path, a cluster can be both backfacing and outside
+	printf("cluster culling, at most %u triangles per cluster\n", MESH_CLUSTER_MAX_TRIANGLES);
+
+	for (const std::string &path : paths)
+		measureModel(path);
+
+	return 0;
+}
@@ -0,0 +1,225 @@
+// Loads each model into vectors and into a MeshData, counting every heap allocation the load makes and the
+// most heap and resident memory it needed at once, next to the size of what it returned.
+//
+// Usage: LoaderMemoryBenchmark [file.obj ...]
+// With no arguments Big_Daddy.obj (if it's in Assets/Models) and every model shipped there are measured.
+//
+// Resident memory is only measured on Linux, where the peak can be reset between loads.
+
+#include "pch.h"
+#include "AllocationCounter.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <cstdio>
+#include <malloc.h>
+#endif
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+#if defined(__linux__)
+	// Writing 5 to clear_refs resets the peak resident set size of the process to its current size. The memory
+	// malloc kept from the last load is handed back first, so it doesn't hide this one.
+	bool resetPeakResident(void)
+	{
+		malloc_trim(0);
+
+		FILE *file = fopen("/proc/self/clear_refs", "w");
+		if (!file)
+			return false;
+		const bool written = fputs("5", file) >= 0;
+		return (fclose(file) == 0) && written;
+	}
+
+	// A field of /proc/self/status, such as "VmHWM:", in bytes. 0 if it can't be read.
+	size_t statusBytes(const char *field)
+	{
+		FILE *file = fopen("/proc/self/status", "r");
+		if (!file)
+			return 0;
+
+		char line[256];
+		size_t kilobytes = 0;
+		while (fgets(line, sizeof(line), file))
+		{
+			if (strncmp(line, field, strlen(field)) == 0)
+			{
+				kilobytes = strtoull(line + strlen(field), nullptr, 10);
+				break;
+			}
+		}
+
+		fclose(file);
+		return kilobytes * 1024;
+	}
+
+	size_t currentResident(void)
+	{
+		return statusBytes("VmRSS:");
+	}
+
+	size_t peakResident(void)
+	{
+		return statusBytes("VmHWM:");
+	}
+#else
+	bool resetPeakResident(void)
+	{
+		return false;
+	}
+
+	size_t currentResident(void)
+	{
+		return 0;
+	}
+
+	size_t peakResident(void)
+	{
+		return 0;
+	}
+#endif
+
+	const double megabyte = 1024.0 * 1024.0;
+
+	const char *fileName(const std::string &path)
+	{
+		const char *name = strrchr(path.c_str(), '/');
+		return name ? name + 1 : path.c_str();
+	}
+
+	struct LoadMemory
+	{
+		bool	loaded;
+		double	milliseconds;
+		size_t	allocations;
+		size_t	peakHeap;		// Above what was allocated before the load
+		bool	residentMeasured;
+		size_t	peakResident;	// Above the resident size before the load
+		size_t	resultBytes;	// Held by what the load returned
+	};
+
+	template<typename TLoad>
+	LoadMemory measure(const TLoad &load)
+	{
+		LoadMemory result = {};
+
+		const size_t baseline = getHeapBytes();
+		result.residentMeasured = resetPeakResident();
+		const size_t residentBefore = currentResident();
+		const size_t allocationsBefore = getAllocationCount();
+		resetPeakHeapBytes();
+
+		const Clock::time_point start = Clock::now();
+		result.loaded = load(result.resultBytes);
+		result.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		result.allocations = getAllocationCount() - allocationsBefore;
+		result.peakHeap = getPeakHeapBytes() - baseline;
+		if (result.residentMeasured)
+			result.peakResident = peakResident() - std::min(peakResident(), residentBefore);
+		return result;
+	}
+
+	void printRow(const char *model, const char *mode, const LoadMemory &memory)
+	{
+		if (!memory.loaded)
+		{
+			printf("%-24s %-20s can't load\n", model, mode);
+			return;
+		}
+
+		char resident[32] = "-";
+		if (memory.residentMeasured)
+			snprintf(resident, sizeof(resident), "%.2f", memory.peakResident / megabyte);
+
+		printf("%-24s %-20s %10.3f %12zu %12.2f %12s %12.2f %10.1fx\n", model, mode, memory.milliseconds, memory.allocations, memory.peakHeap / megabyte,
+			resident, memory.resultBytes / megabyte, static_cast<double>(memory.peakHeap) / std::max<size_t>(memory.resultBytes, 1));
+	}
+
+	void measureModel(const std::string &path)
+	{
+		const char *model = fileName(path);
+
+		// The vectors are declared inside, so freeing them isn't timed but they're still held at the peak
+		printRow(model, "vectors", measure([&](size_t &resultBytes)
+		{
+			std::vector<DX11UWA::VertexPositionUVNormal> vertices;
+			std::vector<unsigned int> indices;
+			std::vector<DirectX::XMFLOAT3> normals;
+			std::vector<DirectX::XMFLOAT2> uvs;
+
+			const bool loaded = loadOBJ(path.c_str(), vertices, indices, normals, uvs);
+			resultBytes = vertices.capacity() * sizeof(vertices[0]) + indices.capacity() * sizeof(indices[0]) +
+				normals.capacity() * sizeof(normals[0]) + uvs.capacity() * sizeof(uvs[0]);
+			return loaded;
+		}));
+
+		printRow(model, "MeshData", measure([&](size_t &resultBytes)
+		{
+			MeshData mesh;
+			const bool loaded = loadOBJ(path.c_str(), mesh);
+			resultBytes = mesh.GetAllocatedSize();
+			return loaded;
+		}));
+
+		printRow(model, "MeshData, source", measure([&](size_t &resultBytes)
+		{
+			ObjLoadOptions options;
+			options.sourceAttributes = MeshData::SourceNormals | MeshData::SourceUVs;
+
+			MeshData mesh;
+			const bool loaded = loadOBJ(path.c_str(), mesh, options);
+			resultBytes = mesh.GetAllocatedSize();
+			return loaded;
+		}));
+
+		printRow(model, "MeshData, optimized", measure([&](size_t &resultBytes)
+		{
+			ObjLoadOptions options;
+			options.optimize = true;
+
+			MeshData mesh;
+			const bool loaded = loadOBJ(path.c_str(), mesh, options);
+			resultBytes = mesh.GetAllocatedSize();
+			return loaded;
+		}));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+		paths.push_back(argv[i]);
+
+	if (paths.empty())
+	{
+		// Big_Daddy.obj isn't checked in, so it's only measured when it has been copied there
+		const std::string bigDaddy = std::string(RAPTURE_ASSET_DIR) + "/Models/Big_Daddy.obj";
+		FileStamp stamp;
+		if (getFileStamp(bigDaddy.c_str(), stamp))
+			paths.push_back(bigDaddy);
+
+		const char *models[] = { "Bioshock_Label.obj", "Dr_Suchong.obj", "Subject_Delta.obj", "test pyramid.obj" };
+		for (const char *model : models)
+			paths.push_back(std::string(RAPTURE_ASSET_DIR) + "/Models/" + model);
+	}
+
+	printf("loading, single threaded (peaks in MB, resident includes the mapped file)\n");
+	printf("%-24s %-20s %10s %12s %12s %12s %12s %11s\n", "model", "result", "ms", "allocations", "peak heap", "peak rss", "result MB", "peak/result");
+
+	for (const std::string &path : paths)
+		measureModel(path);
+
+	return 0;
+}
@@ -0,0 +1,206 @@
+// Builds the levels of detail of each model, then flies a camera away from it and back, picking a level
+// every frame the way the renderer does. Reports the error and size of every level, how many triangles the
+// selection saves over always drawing full detail and how often the level changes with and without hysteresis.
+// Fails if a level's error isn't higher than the one before's, as the selection would never pick the finer one.
+//
+// Usage: LodBenchmark [file.obj ...]
+// With no arguments Big_Daddy.obj (if it's in Assets/Models) and every model shipped there are measured.
+
+#include "pch.h"
+#include "MeshCache.h"
+#include "MeshLod.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// The renderer's projection on a 1080p screen
+	const float viewportHeight = 1080.0f;
+	const float fovAngleY = 70.0f * 3.14159265f / 180.0f;
+
+	const char *fileName(const std::string &path)
+	{
+		const char *name = strrchr(path.c_str(), '/');
+		return name ? name + 1 : path.c_str();
+	}
+
+	std::string stem(const std::string &name)
+	{
+		const size_t dot = name.rfind('.');
+		return (dot == std::string::npos) ? name : name.substr(0, dot);
+	}
+
+	// Camera distances from the centre, in bounding radii: out from 1.5 to 80 and back in over 1200 frames,
+	// with a small wobble every frame, as a camera held by a player would have
+	std::vector<float> makePath(void)
+	{
+		const int frames = 1200;
+		std::vector<float> distances;
+		for (int i = 0; i < frames; ++i)
+		{
+			const float t = static_cast<float>(i) / (frames - 1);
+			const float out = 1.0f - fabsf(2.0f * t - 1.0f);
+			const float wobble = 1.0f + 0.03f * sinf(i * 1.7f);
+			distances.push_back(1.5f * powf(80.0f / 1.5f, out) * wobble);
+		}
+		return distances;
+	}
+
+	struct PathResult
+	{
+		size_t				triangles;
+		size_t				switches;
+		std::vector<size_t>	framesAtLevel;
+	};
+
+	PathResult runPath(const std::vector<float> &distances, const std::vector<MeshLod> &lods, const std::vector<size_t> &levelTriangles,
+		float radius, float hysteresis)
+	{
+		const float pixelScale = lodPixelScale(viewportHeight, fovAngleY);
+		const DirectX::XMFLOAT3 center(0.0f, 0.0f, 0.0f);
+
+		PathResult result = { 0, 0, std::vector<size_t>(lods.size(), 0) };
+		unsigned int level = 0;
+
+		for (float distance : distances)
+		{
+			const DirectX::XMFLOAT3 camera(0.0f, 0.0f, -distance * radius);
+			const unsigned int next = selectMeshLod(lods.data(), lods.size(), lodDistance(camera, center, radius), pixelScale, level, 1.0f, hysteresis);
+			result.switches += (next != level) ? 1 : 0;
+			level = next;
+
+			result.triangles += levelTriangles[level];
+			result.framesAtLevel[level]++;
+		}
+
+		return result;
+	}
+
+	// False if the levels' errors don't go up
+	bool measureModel(const std::string &path)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		ObjLoadOptions options;
+		options.parseThreads = 0;
+		options.optimize = true;
+
+		std::vector<DX11UWA::VertexPositionUVNormal> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<DirectX::XMFLOAT3> normals;
+		std::vector<DirectX::XMFLOAT2> uvs;
+		if (!loadOBJ(path.c_str(), vertices, indices, normals, uvs, options))
+		{
+			printf("%s: can't load\n", path.c_str());
+			return true;
+		}
+
+		const MeshRecipe *recipe = findMeshRecipe(stem(fileName(path)).c_str());
+		if (recipe)
+			applyMeshRecipe(*recipe, vertices, indices);
+
+		float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (const DX11UWA::VertexPositionUVNormal &vertex : vertices)
+		{
+			const float *position = &vertex.pos.x;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+				boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+			}
+		}
+		const float extent[3] = { (boundsMax[0] - boundsMin[0]) * 0.5f, (boundsMax[1] - boundsMin[1]) * 0.5f, (boundsMax[2] - boundsMin[2]) * 0.5f };
+		const float radius = std::max(sqrtf(extent[0] * extent[0] + extent[1] * extent[1] + extent[2] * extent[2]), 1e-3f);
+
+		RMeshSubmesh whole = { 0, static_cast<uint32_t>(indices.size()), 0, 0 };
+		std::vector<RMeshSubmesh> submeshes(1, whole);
+		std::vector<MeshLod> lods;
+
+		Clock::time_point start = Clock::now();
+		buildMeshLods(vertices, indices, submeshes, MESH_LOD_DEFAULT_COUNT, lods);
+		const double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		std::vector<size_t> levelTriangles;
+		for (const MeshLod &lod : lods)
+		{
+			size_t count = 0;
+			for (uint32_t i = lod.submeshStart; i < lod.submeshStart + lod.submeshCount; ++i)
+				count += submeshes[i].indexCount / 3;
+			levelTriangles.push_back(count);
+		}
+
+		printf("\n%s: %zu triangles, %zu levels built in %.1f ms\n", fileName(path), levelTriangles[0], lods.size(), milliseconds);
+		printf("%-8s %12s %10s %12s %14s %14s\n", "level", "triangles", "of full", "error", "of radius", "1px beyond");
+		for (size_t level = 0; level < lods.size(); ++level)
+		{
+			// Distance in radii at which the level's error covers one pixel
+			const float switchDistance = lods[level].error * lodPixelScale(viewportHeight, fovAngleY) / radius;
+			printf("%-8zu %12zu %9.1f%% %12.4g %13.3f%% %13.1fr\n", level, levelTriangles[level], 100.0 * levelTriangles[level] / std::max<size_t>(levelTriangles[0], 1),
+				lods[level].error, 100.0f * lods[level].error / radius, switchDistance);
+		}
+
+		bool increasing = true;
+		for (size_t level = 1; level < lods.size(); ++level)
+		{
+			if (!(lods[level].error > lods[level - 1].error))
+			{
+				printf("error: level %zu isn't coarser than level %zu\n", level, level - 1);
+				increasing = false;
+			}
+		}
+
+		const std::vector<float> distances = makePath();
+		const size_t fullDetail = levelTriangles[0] * distances.size();
+
+		printf("%-12s %14s %10s %10s   %s\n", "hysteresis", "triangles", "saved", "switches", "frames per level");
+		const float settings[] = { 0.25f, 0.0f };
+		for (float hysteresis : settings)
+		{
+			const PathResult result = runPath(distances, lods, levelTriangles, radius, hysteresis);
+
+			std::string frames;
+			for (size_t count : result.framesAtLevel)
+				frames += std::to_string(count) + " ";
+
+			printf("%-12.2f %14zu %9.1f%% %10zu   %s\n", hysteresis, result.triangles, 100.0 - 100.0 * result.triangles / std::max<size_t>(fullDetail, 1),
+				result.switches, frames.c_str());
+		}
+
+		return increasing;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+		paths.push_back(argv[i]);
+
+	if (paths.empty())
+	{
+		// Big_Daddy.obj isn't checked in, so it's only measured when it has been copied there
+		const std::string bigDaddy = std::string(RAPTURE_ASSET_DIR) + "/Models/Big_Daddy.obj";
+		FileStamp stamp;
+		if (getFileStamp(bigDaddy.c_str(), stamp))
+			paths.push_back(bigDaddy);
+
+		const char *models[] = { "Bioshock_Label.obj", "Dr_Suchong.obj", "Subject_Delta.obj", "test pyramid.obj" };
+		for (const char *model : models)
+			paths.push_back(std::string(RAPTURE_ASSET_DIR) + "/Models/" + model);
+	}
+
+	// Levels are picked so their error covers at most a pixel, on a 1080 pixel high viewport
+	printf("levels of detail, %u levels at most, camera path of %zu frames from 1.5 to 80 radii and back\n", MESH_LOD_DEFAULT_COUNT, makePath().size());
+
+	bool increasing = true;
+	for (const std::string &path : paths)
+		increasing = measureModel(path) && increasing;
+
+	return increasing ? 0 : 1;
+}
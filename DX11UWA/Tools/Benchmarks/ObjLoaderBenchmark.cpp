@@ -0,0 +1,530 @@
+// Compares the memory-mapped OBJ parser against the original fscanf loader, then measures
+// how parseOBJParallel scales with the thread count, how much welding saves, what the
+// .rmesh cache costs, how fast vertices pack and how soon a streamed mesh has something
+// to draw. Cache files are written to the working directory.
+//
+// Usage: ObjLoaderBenchmark [file.obj ...]
+// With no arguments every model shipped in Assets/Models is measured.
+
+#include "pch.h"
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshLod.h"
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef bool(*LoadFunction)(const char *, std::vector<DX11UWA::VertexPositionUVNormal> &, std::vector<unsigned int> &, std::vector<DirectX::XMFLOAT3> &, std::vector<DirectX::XMFLOAT2> &);
+
+	// loadOBJ doing only what the fscanf loader does: single threaded, one vertex per corner and no normals made
+	// up for corners without one
+	bool loadMapped(const char *path, std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices, std::vector<DirectX::XMFLOAT3> &normals, std::vector<DirectX::XMFLOAT2> &uvs)
+	{
+		ObjLoadOptions options;
+		options.weldCorners = false;
+		options.generateNormals = false;
+		return loadOBJ(path, vertices, indices, normals, uvs, options);
+	}
+
+	// The fscanf loader without its warning, which is printed once per file before it's timed
+	bool loadFscanf(const char *path, std::vector<DX11UWA::VertexPositionUVNormal> &vertices, std::vector<unsigned int> &indices, std::vector<DirectX::XMFLOAT3> &normals, std::vector<DirectX::XMFLOAT2> &uvs)
+	{
+		return loadOBJ_fscanf(path, vertices, indices, normals, uvs, false);
+	}
+
+	struct Timing
+	{
+		double	bestSeconds;
+		double	medianSeconds;
+		size_t	vertexCount;
+		size_t	indexCount;
+		bool	loaded;
+	};
+
+	// Runs the loader until at least minSeconds have passed (and at least minRuns times).
+	Timing measure(LoadFunction load, const char *path, double minSeconds, int minRuns)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		std::vector<double> samples;
+		std::vector<DX11UWA::VertexPositionUVNormal> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<DirectX::XMFLOAT3> normals;
+		std::vector<DirectX::XMFLOAT2> uvs;
+
+		Timing timing = {};
+		double total = 0.0;
+
+		while (total < minSeconds || static_cast<int>(samples.size()) < minRuns)
+		{
+			Clock::time_point start = Clock::now();
+			timing.loaded = load(path, vertices, indices, normals, uvs);
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+			samples.push_back(seconds);
+			total += seconds;
+		}
+
+		std::sort(samples.begin(), samples.end());
+		timing.bestSeconds = samples.front();
+		timing.medianSeconds = samples[samples.size() / 2];
+		timing.vertexCount = vertices.size();
+		timing.indexCount = indices.size();
+		return timing;
+	}
+
+	template<typename T>
+	bool sameBytes(const std::vector<T> &a, const std::vector<T> &b)
+	{
+		return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+	}
+
+	bool sameParse(const ObjParseData &a, const ObjParseData &b)
+	{
+		return sameBytes(a.positions, b.positions) && sameBytes(a.uvs, b.uvs) && sameBytes(a.normals, b.normals) && sameBytes(a.corners, b.corners);
+	}
+
+	// Median time of parseOBJParallel over the mapped file
+	double measureParse(const MappedFile &file, unsigned int threads, ObjParseData &out, int runs)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		std::vector<double> samples;
+		for (int i = 0; i < runs; ++i)
+		{
+			Clock::time_point start = Clock::now();
+			parseOBJParallel(file.GetData(), file.GetSize(), out, threads);
+			samples.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+		}
+
+		std::sort(samples.begin(), samples.end());
+		return samples[samples.size() / 2];
+	}
+
+	void printScaling(const std::vector<std::string> &paths)
+	{
+		const unsigned int threadCounts[] = { 1, 2, 4, 8, 16 };
+
+		printf("\nparseOBJParallel scaling (%u hardware threads)\n", std::thread::hardware_concurrency());
+		printf("%-20s", "model");
+		for (unsigned int threads : threadCounts)
+			printf(" %8u thr", threads);
+		printf(" %10s\n", "identical");
+
+		for (const std::string &path : paths)
+		{
+			MappedFile file;
+			if (!file.Open(path.c_str()))
+				continue;
+
+			ObjParseData serial, parallel;
+			parseOBJ(file.GetData(), file.GetSize(), serial);
+
+			const char *name = strrchr(path.c_str(), '/');
+			printf("%-20s", name ? name + 1 : path.c_str());
+
+			bool identical = true;
+			double baseline = 0.0;
+			for (unsigned int threads : threadCounts)
+			{
+				double seconds = measureParse(file, threads, parallel, 21);
+				if (threads == 1)
+					baseline = seconds;
+
+				printf(" %11.2fx", baseline / seconds);
+				identical = identical && sameParse(serial, parallel);
+			}
+
+			printf(" %10s\n", identical ? "yes" : "NO");
+		}
+	}
+
+	void printWelding(const std::vector<std::string> &paths)
+	{
+		printf("\nvertex welding\n");
+		printf("%-20s %10s %12s %12s %12s %10s\n", "model", "corners", "index weld", "equal weld", "1e-5 weld", "reduction");
+
+		for (const std::string &path : paths)
+		{
+			std::vector<DX11UWA::VertexPositionUVNormal> vertices;
+			std::vector<unsigned int> indices;
+			std::vector<DirectX::XMFLOAT3> normals;
+			std::vector<DirectX::XMFLOAT2> uvs;
+
+			ObjLoadStats stats = {}, equalStats = {}, epsilonStats = {};
+			ObjLoadOptions options;
+			options.stats = &stats;
+			if (!loadOBJ(path.c_str(), vertices, indices, normals, uvs, options))
+				continue;
+
+			options.weldByValue = true;
+			options.stats = &equalStats;
+			loadOBJ(path.c_str(), vertices, indices, normals, uvs, options);
+
+			options.weldEpsilon = 1e-5f;
+			options.stats = &epsilonStats;
+			loadOBJ(path.c_str(), vertices, indices, normals, uvs, options);
+
+			const char *name = strrchr(path.c_str(), '/');
+			printf("%-20s %10zu %12zu %12zu %12zu %9.2fx\n", name ? name + 1 : path.c_str(), stats.cornerCount,
+				stats.uniqueCornerCount, equalStats.vertexCount, epsilonStats.vertexCount,
+				static_cast<double>(stats.cornerCount) / std::max<size_t>(stats.uniqueCornerCount, 1));
+		}
+	}
+
+	void printCache(const std::vector<std::string> &paths)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		printf("\n.rmesh cache\n");
+		printf("%-20s %12s %12s %12s %10s %8s\n", "model", "rmesh bytes", "rebuild ms", "cached ms", "speedup", "indices");
+
+		for (const std::string &path : paths)
+		{
+			const char *name = strrchr(path.c_str(), '/');
+			name = name ? name + 1 : path.c_str();
+			const std::string cachePath = std::string(name) + ".rmesh";
+
+			// The first load parses the OBJ and writes the cache, the others only map it
+			remove(cachePath.c_str());
+
+			RMesh mesh;
+			Clock::time_point start = Clock::now();
+			if (!loadMeshCached(path.c_str(), cachePath.c_str(), mesh))
+				continue;
+			const double rebuild = std::chrono::duration<double>(Clock::now() - start).count();
+			const uint64_t bytes = mesh.GetHeader().fileSize;
+
+			std::vector<double> samples;
+			for (int i = 0; i < 51; ++i)
+			{
+				start = Clock::now();
+				loadMeshCached(path.c_str(), cachePath.c_str(), mesh);
+
+				// Touch every page, as buffer creation would
+				volatile uint32_t sum = 0;
+				const char *indices = reinterpret_cast<const char *>(mesh.GetIndices());
+				for (size_t j = 0; j < mesh.GetIndexCount() * mesh.GetIndexStride(); j += 4096)
+					sum += indices[j];
+				const char *vertices = reinterpret_cast<const char *>(mesh.GetVertices());
+				for (size_t j = 0; j < mesh.GetVertexCount() * sizeof(DX11UWA::VertexPositionUVNormal); j += 4096)
+					sum += vertices[j];
+
+				samples.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+			}
+
+			std::sort(samples.begin(), samples.end());
+			const double cached = samples[samples.size() / 2];
+
+			printf("%-20s %12llu %12.3f %12.3f %9.1fx %5u bit%s\n", name, static_cast<unsigned long long>(bytes), rebuild * 1000.0, cached * 1000.0,
+				rebuild / cached, mesh.GetIndexStride() * 8, mesh.IsMapped() ? "" : " (not mapped)");
+		}
+	}
+
+	typedef void(*PackFunction)(const DX11UWA::VertexPositionUVNormal *, size_t, const VertexQuantization &, DX11UWA::VertexPositionUVNormalPacked *);
+	typedef void(*UnpackFunction)(const DX11UWA::VertexPositionUVNormalPacked *, size_t, const VertexQuantization &, DX11UWA::VertexPositionUVNormal *);
+
+	// Median nanoseconds per vertex of packing, then unpacking, the whole mesh
+	void measurePacking(PackFunction pack, UnpackFunction unpack, const std::vector<DX11UWA::VertexPositionUVNormal> &vertices, const VertexQuantization &quantization,
+		std::vector<DX11UWA::VertexPositionUVNormalPacked> &packed, std::vector<DX11UWA::VertexPositionUVNormal> &unpacked, double &packNs, double &unpackNs)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		std::vector<double> packSamples, unpackSamples;
+		for (int i = 0; i < 101; ++i)
+		{
+			Clock::time_point start = Clock::now();
+			pack(vertices.data(), vertices.size(), quantization, packed.data());
+			Clock::time_point middle = Clock::now();
+			unpack(packed.data(), packed.size(), quantization, unpacked.data());
+
+			packSamples.push_back(std::chrono::duration<double, std::nano>(middle - start).count());
+			unpackSamples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - middle).count());
+		}
+
+		std::sort(packSamples.begin(), packSamples.end());
+		std::sort(unpackSamples.begin(), unpackSamples.end());
+		packNs = packSamples[packSamples.size() / 2] / std::max<size_t>(vertices.size(), 1);
+		unpackNs = unpackSamples[unpackSamples.size() / 2] / std::max<size_t>(vertices.size(), 1);
+	}
+
+	void printPacking(const std::vector<std::string> &paths)
+	{
+		printf("\nvertex packing (%zu -> %zu bytes per vertex), ns per vertex\n", sizeof(DX11UWA::VertexPositionUVNormal), sizeof(DX11UWA::VertexPositionUVNormalPacked));
+		printf("%-20s %10s %10s %10s %10s %10s %10s %12s %10s\n", "model", "pack", "pack simd", "unpack", "unpk simd", "identical", "pos err", "normal deg", "uv err");
+
+		for (const std::string &path : paths)
+		{
+			std::vector<DX11UWA::VertexPositionUVNormal> vertices;
+			std::vector<unsigned int> indices;
+			std::vector<DirectX::XMFLOAT3> normals;
+			std::vector<DirectX::XMFLOAT2> uvs;
+			if (!loadOBJ(path.c_str(), vertices, indices, normals, uvs))
+				continue;
+
+			const VertexQuantization quantization = computeVertexQuantization(vertices.data(), vertices.size());
+			std::vector<DX11UWA::VertexPositionUVNormalPacked> packed(vertices.size()), packedSimd(vertices.size());
+			std::vector<DX11UWA::VertexPositionUVNormal> unpacked(vertices.size()), unpackedSimd(vertices.size());
+
+			double packNs, unpackNs, packSimdNs, unpackSimdNs;
+			measurePacking(packVerticesScalar, unpackVerticesScalar, vertices, quantization, packed, unpacked, packNs, unpackNs);
+			measurePacking(packVertices, unpackVertices, vertices, quantization, packedSimd, unpackedSimd, packSimdNs, unpackSimdNs);
+
+			const bool identical = sameBytes(packed, packedSimd) && sameBytes(unpacked, unpackedSimd);
+			const VertexPackingError error = measurePackingError(vertices.data(), packed.data(), vertices.size(), quantization);
+
+			const char *name = strrchr(path.c_str(), '/');
+			printf("%-20s %10.2f %10.2f %10.2f %10.2f %10s %10.2g %12.3f %10.2g\n", name ? name + 1 : path.c_str(), packNs, packSimdNs,
+				unpackNs, unpackSimdNs, identical ? "yes" : "NO", error.maxPosition, error.maxNormalDegrees, error.maxUV);
+		}
+	}
+
+	// Time until an ObjStreamReader has the first triangles to draw, against cooking the whole mesh as the
+	// renderer does on a cache miss, and the time to cook what the reader parsed once it's done. The streamed
+	// mesh has to come out the same as loadOBJ's, and the mesh cooked from it the same as cookMesh's.
+	void printStreaming(const std::vector<std::string> &paths)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		const size_t chunkSize = 256 * 1024;
+
+		printf("\nstreaming in %zu KB chunks, ms\n", chunkSize / 1024);
+		printf("%-20s %10s %12s %12s %10s %10s %10s %10s\n", "model", "cook", "first batch", "all batches", "earlier", "batches", "then cook", "identical");
+
+		for (const std::string &path : paths)
+		{
+			ObjLoadOptions cookOptions;
+			cookOptions.parseThreads = 0;
+			cookOptions.optimize = true;
+			cookOptions.buildClusters = true;
+			cookOptions.lodCount = MESH_LOD_DEFAULT_COUNT;
+
+			RMesh mesh;
+			Clock::time_point start = Clock::now();
+			if (!cookMesh(path.c_str(), mesh, cookOptions))
+				continue;
+			const double cook = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			std::vector<double> firstSamples, allSamples;
+			std::vector<DX11UWA::VertexPositionUVNormal> vertices;
+			std::vector<unsigned int> indices;
+			size_t batches = 0;
+			bool streamed = true;
+			ObjStreamReader reader;
+			ObjStreamBatch batch;
+
+			for (int run = 0; run < 11 && streamed; ++run)
+			{
+				vertices.clear();
+				indices.clear();
+				batches = 0;
+
+				start = Clock::now();
+				streamed = reader.Open(path.c_str());
+
+				while (streamed && !reader.IsFinished())
+				{
+					streamed = reader.Read(chunkSize, batch);
+					if (batch.indices.empty())
+						continue;
+
+					if (batches++ == 0)
+						firstSamples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+					vertices.insert(vertices.end(), batch.vertices.begin(), batch.vertices.end());
+					indices.insert(indices.end(), batch.indices.begin(), batch.indices.end());
+				}
+
+				allSamples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+			}
+
+			const char *name = strrchr(path.c_str(), '/');
+			name = name ? name + 1 : path.c_str();
+			if (!streamed || firstSamples.empty())
+			{
+				printf("%-20s %10.2f %12s\n", name, cook, "can't stream");
+				continue;
+			}
+
+			std::vector<DX11UWA::VertexPositionUVNormal> loadedVertices;
+			std::vector<unsigned int> loadedIndices;
+			std::vector<DirectX::XMFLOAT3> normals;
+			std::vector<DirectX::XMFLOAT2> uvs;
+			bool identical = loadOBJ(path.c_str(), loadedVertices, loadedIndices, normals, uvs) && sameBytes(vertices, loadedVertices) && sameBytes(indices, loadedIndices);
+
+			// The reader still has the last run's parse
+			RMesh streamedMesh;
+			start = Clock::now();
+			identical = cookMesh(path.c_str(), reader, streamedMesh, cookOptions) && identical;
+			const double streamedCook = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			identical = identical && streamedMesh.GetHeader().fileSize == mesh.GetHeader().fileSize &&
+				memcmp(&streamedMesh.GetHeader(), &mesh.GetHeader(), mesh.GetHeader().fileSize) == 0;
+
+			std::sort(firstSamples.begin(), firstSamples.end());
+			std::sort(allSamples.begin(), allSamples.end());
+			const double first = firstSamples[firstSamples.size() / 2];
+
+			printf("%-20s %10.2f %12.3f %12.2f %9.1fx %10zu %10.2f %10s\n", name, cook, first, allSamples[allSamples.size() / 2], cook / first,
+				batches, streamedCook, identical ? "yes" : "NO");
+		}
+	}
+
+	size_t fileSize(const char *path)
+	{
+		FILE *file = fopen(path, "rb");
+		if (!file)
+			return 0;
+
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fclose(file);
+		return (size > 0) ? static_cast<size_t>(size) : 0;
+	}
+
+	// Largest difference between the values the two loaders read. Where the fscanf loader reads every face both
+	// have a vertex per corner, in the same order, and they're compared vertex by vertex. Otherwise the position,
+	// uv and normal records are read the way the fscanf loader reads them and compared with parseOBJ's.
+	float maxDifference(const char *path, bool &byVertex)
+	{
+		std::vector<DX11UWA::VertexPositionUVNormal> a, b;
+		std::vector<unsigned int> indicesA, indicesB;
+		std::vector<DirectX::XMFLOAT3> normals;
+		std::vector<DirectX::XMFLOAT2> uvs;
+
+		float difference = 0.0f;
+		byVertex = loadMapped(path, a, indicesA, normals, uvs) && loadFscanf(path, b, indicesB, normals, uvs) && a.size() == b.size();
+		if (byVertex)
+		{
+			for (size_t i = 0; i < b.size(); ++i)
+			{
+				const float *x = &a[i].pos.x;
+				const float *y = &b[i].pos.x;
+				for (size_t c = 0; c < sizeof(DX11UWA::VertexPositionUVNormal) / sizeof(float); ++c)
+					difference = std::max<float>(difference, fabsf(x[c] - y[c]));
+			}
+
+			return difference;
+		}
+
+		MappedFile mapped;
+		ObjParseData data;
+		FILE *file = fopen(path, "r");
+		if (!file || !mapped.Open(path) || !parseOBJ(mapped.GetData(), mapped.GetSize(), data))
+		{
+			if (file)
+				fclose(file);
+			return -1.0f;
+		}
+
+		size_t positions = 0, uvCount = 0, normalCount = 0;
+		char header[256];
+		while (fscanf(file, "%255s", header) == 1)
+		{
+			float value[3];
+			const float *parsed = nullptr;
+			int components = 0;
+			if (strcmp(header, "v") == 0 && positions < data.positions.size())
+			{
+				parsed = &data.positions[positions++].x;
+				components = fscanf(file, "%f %f %f", &value[0], &value[1], &value[2]);
+			}
+			else if (strcmp(header, "vt") == 0 && uvCount < data.uvs.size())
+			{
+				parsed = &data.uvs[uvCount++].x;
+				components = fscanf(file, "%f %f", &value[0], &value[1]);
+			}
+			else if (strcmp(header, "vn") == 0 && normalCount < data.normals.size())
+			{
+				parsed = &data.normals[normalCount++].x;
+				components = fscanf(file, "%f %f %f", &value[0], &value[1], &value[2]);
+			}
+
+			for (int c = 0; c < components; ++c)
+				difference = std::max<float>(difference, fabsf(parsed[c] - value[c]));
+		}
+
+		fclose(file);
+		const bool allRead = positions == data.positions.size() && uvCount == data.uvs.size() && normalCount == data.normals.size();
+		return allRead ? difference : -1.0f;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+		paths.push_back(argv[i]);
+
+	if (paths.empty())
+	{
+		const char *models[] = { "Bioshock_Label.obj", "Dr_Suchong.obj", "Subject_Delta.obj", "test pyramid.obj" };
+		for (const char *model : models)
+			paths.push_back(std::string(RAPTURE_ASSET_DIR) + "/Models/" + model);
+	}
+
+	// Throughput uses the median run, the speedup is also given for the best runs since
+	// short loads are easily disturbed by the rest of the machine.
+	printf("%-20s %10s %12s %12s %10s %10s %10s %12s\n", "model", "bytes", "fscanf MB/s", "mmap MB/s", "speedup", "best", "vertices", "max diff");
+
+	const double target = 10.0;
+	size_t measured = 0, reached = 0;
+	for (const std::string &path : paths)
+	{
+		const size_t bytes = fileSize(path.c_str());
+		if (bytes == 0)
+		{
+			printf("%s: can't open\n", path.c_str());
+			continue;
+		}
+
+		// Says once whether the fscanf loader can read the faces, the timed runs don't
+		{
+			std::vector<DX11UWA::VertexPositionUVNormal> vertices;
+			std::vector<unsigned int> indices;
+			std::vector<DirectX::XMFLOAT3> normals;
+			std::vector<DirectX::XMFLOAT2> uvs;
+			loadOBJ_fscanf(path.c_str(), vertices, indices, normals, uvs);
+		}
+
+		Timing baseline = measure(loadFscanf, path.c_str(), 0.5, 3);
+		Timing current = measure(loadMapped, path.c_str(), 0.5, 10);
+
+		const double megabytes = bytes / (1024.0 * 1024.0);
+		const double speedup = baseline.medianSeconds / current.medianSeconds;
+		const char *name = strrchr(path.c_str(), '/');
+
+		// The fscanf loader can't read "v//vn" or "v/vt/vn/w" corners, so for most files only the records are compared
+		bool byVertex;
+		float difference = maxDifference(path.c_str(), byVertex);
+
+		printf("%-20s %10zu %12.1f %12.1f %9.1fx %9.1fx %10zu ", name ? name + 1 : path.c_str(), bytes,
+			megabytes / baseline.medianSeconds, megabytes / current.medianSeconds,
+			speedup, baseline.bestSeconds / current.bestSeconds, current.vertexCount);
+
+		if (difference >= 0.0f)
+			printf("%12g %s\n", difference, byVertex ? "vertices" : "records");
+		else
+			printf("%12s\n", "n/a");
+
+		++measured;
+		reached += (speedup >= target) ? 1 : 0;
+	}
+
+	// The fscanf loader skips faces it can't read, so where it does it has less to do than loadOBJ
+	printf("%.0fx the fscanf loader's median throughput reached on %zu of %zu models\n", target, reached, measured);
+
+	printScaling(paths);
+	printWelding(paths);
+	printCache(paths);
+	printPacking(paths);
+	printStreaming(paths);
+
+	return 0;
+}
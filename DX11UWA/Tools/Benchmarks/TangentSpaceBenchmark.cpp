@@ -0,0 +1,204 @@
+// Throws away the normals of each model and generates them again, then builds its tangents, timing both on one
+// thread and on every core. Reports how far the generated normals are from the ones the artist exported and
+// whether both give exactly the same result.
+//
+// Usage: TangentSpaceBenchmark [file.obj ...]
+// With no arguments Big_Daddy.obj (if it's in Assets/Models), Subject_Delta.obj and Dr_Suchong.obj are measured.
+
+#include "pch.h"
+#include "MeshTangentSpace.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Each timing is the best of this many runs
+	const int runs = 7;
+
+	const char *fileName(const std::string &path)
+	{
+		const char *name = strrchr(path.c_str(), '/');
+		return name ? name + 1 : path.c_str();
+	}
+
+	template<typename TWork>
+	double bestMilliseconds(const TWork &work)
+	{
+		double best = 1e30;
+		for (int run = 0; run < runs; ++run)
+		{
+			const Clock::time_point start = Clock::now();
+			work();
+			best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		}
+		return best;
+	}
+
+	template<typename T>
+	bool sameBytes(const std::vector<T> &a, const std::vector<T> &b)
+	{
+		return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+	}
+
+	float angleDegrees(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b)
+	{
+		const float lengths = sqrtf((a.x * a.x + a.y * a.y + a.z * a.z) * (b.x * b.x + b.y * b.y + b.z * b.z));
+		if (lengths == 0.0f)
+			return 180.0f;
+		const float cosine = (a.x * b.x + a.y * b.y + a.z * b.z) / lengths;
+		return acosf(std::min(std::max(cosine, -1.0f), 1.0f)) * 180.0f / 3.14159265f;
+	}
+
+	void measureNormals(const std::string &path)
+	{
+		MappedFile file;
+		ObjParseData data;
+		if (!file.Open(path.c_str()) || !parseOBJParallel(file.GetData(), file.GetSize(), data, 0))
+		{
+			printf("%-24s can't load\n", fileName(path));
+			return;
+		}
+
+		// Every corner is generated, as if the file had no vn records
+		const size_t cornerCount = data.corners.size();
+		std::vector<unsigned int> positions(cornerCount);
+		for (size_t i = 0; i < cornerCount; ++i)
+			positions[i] = static_cast<unsigned int>(data.corners[i].position);
+
+		std::vector<DirectX::XMFLOAT3> single(cornerCount), threaded(cornerCount);
+		const double singleMs = bestMilliseconds([&]()
+		{
+			generateNormals(data.positions.data(), data.positions.size(), positions.data(), cornerCount, MESH_DEFAULT_CREASE_ANGLE, nullptr, single.data(), 1);
+		});
+		const double threadedMs = bestMilliseconds([&]()
+		{
+			generateNormals(data.positions.data(), data.positions.size(), positions.data(), cornerCount, MESH_DEFAULT_CREASE_ANGLE, nullptr, threaded.data(), 0);
+		});
+
+		// Against the exported normals, where the file has them
+		double errorSum = 0.0;
+		size_t compared = 0, within = 0;
+		for (size_t i = 0; i < cornerCount; ++i)
+		{
+			if (data.corners[i].normal < 0)
+				continue;
+
+			const float error = angleDegrees(single[i], data.normals[data.corners[i].normal]);
+			errorSum += error;
+			within += (error <= 10.0f) ? 1 : 0;
+			++compared;
+		}
+
+		printf("%-24s %10zu %10.3f %10.3f %9.1fx %10s %10.2f %9.1f%%\n", fileName(path), cornerCount, singleMs, threadedMs,
+			singleMs / std::max(threadedMs, 1e-6), sameBytes(single, threaded) ? "yes" : "NO",
+			compared ? errorSum / compared : 0.0, compared ? 100.0 * within / compared : 0.0);
+	}
+
+	void measureTangents(const std::string &path)
+	{
+		std::vector<DX11UWA::VertexPositionUVNormal> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<DirectX::XMFLOAT3> normals;
+		std::vector<DirectX::XMFLOAT2> uvs;
+
+		ObjLoadOptions options;
+		options.parseThreads = 0;
+		if (!loadOBJ(path.c_str(), vertices, indices, normals, uvs, options))
+		{
+			printf("%-24s can't load\n", fileName(path));
+			return;
+		}
+
+		struct Result
+		{
+			std::vector<DX11UWA::VertexPositionUVNormal>	vertices;
+			std::vector<unsigned int>						indices;
+			std::vector<DirectX::XMFLOAT4>					tangents;
+			size_t											copies;
+		};
+
+		// Every run starts from a fresh copy, which isn't timed
+		auto measure = [&](Result &result, unsigned int threads)
+		{
+			double best = 1e30;
+			for (int run = 0; run < runs; ++run)
+			{
+				result.vertices = vertices;
+				result.indices = indices;
+
+				const Clock::time_point start = Clock::now();
+				result.copies = generateTangents(result.vertices, result.indices, result.tangents, threads);
+				best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+			}
+			return best;
+		};
+
+		Result single, threaded;
+		const double singleMs = measure(single, 1);
+		const double threadedMs = measure(threaded, 0);
+
+		const bool identical = sameBytes(single.vertices, threaded.vertices) && sameBytes(single.indices, threaded.indices) &&
+			sameBytes(single.tangents, threaded.tangents);
+
+		// Tangents have to be unit length and perpendicular to the normal
+		float worstDot = 0.0f, worstLength = 0.0f;
+		size_t mirrored = 0;
+		for (size_t i = 0; i < single.tangents.size(); ++i)
+		{
+			const DirectX::XMFLOAT4 &t = single.tangents[i];
+			const DirectX::XMFLOAT3 &n = single.vertices[i].normal;
+			const float normalLength = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+			if (normalLength > 0.0f)
+				worstDot = std::max(worstDot, fabsf(t.x * n.x + t.y * n.y + t.z * n.z) / normalLength);
+			worstLength = std::max(worstLength, fabsf(sqrtf(t.x * t.x + t.y * t.y + t.z * t.z) - 1.0f));
+			mirrored += (t.w < 0.0f) ? 1 : 0;
+		}
+
+		printf("%-24s %10zu %10.3f %10.3f %9.1fx %10s %8zu %8zu %10.1e %10.1e\n", fileName(path), vertices.size(), singleMs, threadedMs,
+			singleMs / std::max(threadedMs, 1e-6), identical ? "yes" : "NO", single.copies, mirrored, worstDot, worstLength);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+		paths.push_back(argv[i]);
+
+	if (paths.empty())
+	{
+		// Big_Daddy.obj isn't checked in, so it's only measured when it has been copied there
+		const std::string bigDaddy = std::string(RAPTURE_ASSET_DIR) + "/Models/Big_Daddy.obj";
+		FileStamp stamp;
+		if (getFileStamp(bigDaddy.c_str(), stamp))
+			paths.push_back(bigDaddy);
+
+		paths.push_back(std::string(RAPTURE_ASSET_DIR) + "/Models/Subject_Delta.obj");
+		paths.push_back(std::string(RAPTURE_ASSET_DIR) + "/Models/Dr_Suchong.obj");
+	}
+
+	const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+
+	printf("smooth normals, every corner regenerated, crease angle %.0f degrees, ms (best of %d, %u threads)\n", MESH_DEFAULT_CREASE_ANGLE, runs, cores);
+	printf("%-24s %10s %10s %10s %10s %10s %10s %10s\n", "model", "corners", "1 thread", "threads", "speedup", "identical", "err deg", "<= 10 deg");
+	for (const std::string &path : paths)
+		measureNormals(path);
+
+	printf("\ntangents, ms (best of %d, %u threads)\n", runs, cores);
+	printf("%-24s %10s %10s %10s %10s %10s %8s %8s %10s %10s\n", "model", "vertices", "1 thread", "threads", "speedup", "identical", "split", "w < 0",
+		"max n.t", "max |t|-1");
+	for (const std::string &path : paths)
+		measureTangents(path);
+
+	return 0;
+}
@@ -0,0 +1,601 @@
+// Cooks the app's assets ahead of time, so the shipped app doesn't parse anything.
+//
+// Usage: AssetCooker [--models <dir>] [--textures <dir>]... [--out <dir>] [--format auto|bc1|bc3|bc5|bc7] [--quality fast|normal|high]
+//
+// Every .obj in the models folder is loaded, optimized for the vertex cache and overdraw, run through
+// its MeshRecipe, simplified into levels of detail, grouped into culling clusters and written to
+// <out>/Models/<name>.rmesh. Every .png in the texture folders, and every .dds in 8 bit RGBA or BGRA, is
+// block compressed with a full mip chain into <out>/Textures/<name>.dds; a .png takes the place of a .dds
+// of the same name. The format is BC1 for opaque images and BC3 for the others unless --format says
+// otherwise, at normal quality unless --quality does. Other .dds files are validated and copied as they are.
+// <out>/manifest.json lists what was cooked, how much precision packing the vertices to
+// VertexPositionUVNormalPacked loses, the PSNR of every compressed texture, and why anything was rejected.
+// With no arguments it cooks the repository's Assets folder into Assets/Cooked, which the
+// app project deploys. The exit code is non-zero if any asset failed.
+
+#include "pch.h"
+#include "Common/DDS.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshLod.h"
+#include "PngLoader.h"
+#include "TextureCompression.h"
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	struct CookedMesh
+	{
+		std::string	source;
+		std::string	output;
+		bool		hasRecipe;
+		uint32_t	vertexCount;
+		uint32_t	indexCount;
+		uint32_t	indexStride;
+		uint32_t	submeshCount;
+		uint32_t	clusterCount;
+		uint64_t	bytes;
+		bool		hasTangents;
+		uint64_t	generatedNormals;	// Corners the OBJ had no normal for
+		float		boundsMin[3];
+		float		boundsMax[3];
+
+		// Triangles and error of every level of detail, level 0 first
+		std::vector<uint32_t>	lodTriangles;
+		std::vector<float>		lodErrors;
+
+		// Names of the materials the submeshes use and the MTL file they're from, empty for faces without one
+		std::vector<std::string>	materials;
+		std::string					materialLibrary;
+
+		MeshOptimizeReport	optimization;
+		VertexPackingError	packingError;
+	};
+
+	struct CookedTexture
+	{
+		std::string		source;
+		std::string		output;
+		DDSDescription	desc;
+		uint64_t		bytes;
+		bool			compressed;
+		double			psnr;			// Of the compressed first mip against the source image
+		double			seconds;		// Spent compressing
+	};
+
+	const char *const qualityNames[] = { "fast", "normal", "high" };
+
+	struct TextureCookOptions
+	{
+		TextureCookOptions() : autoFormat(true) {}
+
+		TextureCompressionOptions	compression;
+		bool						autoFormat;		// BC1 or BC3 by whether the image has alpha, else compression.format
+	};
+
+	struct Failure
+	{
+		std::string	source;
+		std::string	reason;
+	};
+
+	bool endsWith(const std::string &text, const char *suffix)
+	{
+		const size_t length = strlen(suffix);
+		if (text.size() < length)
+			return false;
+
+		// Extensions are matched case insensitively
+		for (size_t i = 0; i < length; ++i)
+		{
+			if (tolower(static_cast<unsigned char>(text[text.size() - length + i])) != tolower(static_cast<unsigned char>(suffix[i])))
+				return false;
+		}
+
+		return true;
+	}
+
+	// Names of the files in directory ending in extension, sorted so the output doesn't depend on the file system
+	std::vector<std::string> listFiles(const std::string &directory, const char *extension)
+	{
+		std::vector<std::string> names;
+
+#if defined(_WIN32)
+		WIN32_FIND_DATAA found;
+		HANDLE search = FindFirstFileA((directory + "\\*").c_str(), &found);
+		if (search != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && endsWith(found.cFileName, extension))
+					names.push_back(found.cFileName);
+			} while (FindNextFileA(search, &found));
+
+			FindClose(search);
+		}
+#else
+		DIR *dir = opendir(directory.c_str());
+		if (dir)
+		{
+			while (dirent *entry = readdir(dir))
+			{
+				std::string name = entry->d_name;
+				struct stat info;
+				if (endsWith(name, extension) && stat((directory + "/" + name).c_str(), &info) == 0 && S_ISREG(info.st_mode))
+					names.push_back(name);
+			}
+
+			closedir(dir);
+		}
+#endif
+
+		std::sort(names.begin(), names.end());
+		return names;
+	}
+
+	bool makeDirectory(const std::string &path)
+	{
+#if defined(_WIN32)
+		return CreateDirectoryA(path.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+		return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+	}
+
+	bool writeFile(const std::string &path, const void *data, size_t size)
+	{
+		FILE *file = fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+
+		const bool written = fwrite(data, 1, size, file) == size;
+		return (fclose(file) == 0) && written;
+	}
+
+	// Last component of a path, so the manifest doesn't record where the cooker ran
+	std::string baseName(const std::string &path)
+	{
+		std::string trimmed = path;
+		while (trimmed.size() > 1 && (trimmed.back() == '/' || trimmed.back() == '\\'))
+			trimmed.pop_back();
+
+		const size_t slash = trimmed.find_last_of("/\\");
+		return (slash == std::string::npos) ? trimmed : trimmed.substr(slash + 1);
+	}
+
+	std::string stem(const std::string &name)
+	{
+		const size_t dot = name.rfind('.');
+		return (dot == std::string::npos) ? name : name.substr(0, dot);
+	}
+
+	void writeJsonString(FILE *file, const std::string &text)
+	{
+		fputc('"', file);
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				fprintf(file, "\\%c", c);
+			else if (static_cast<unsigned char>(c) < 0x20)
+				fprintf(file, "\\u%04x", c);
+			else
+				fputc(c, file);
+		}
+		fputc('"', file);
+	}
+
+	bool writeManifest(const std::string &path, const std::vector<CookedMesh> &meshes, const std::vector<CookedTexture> &textures, const std::vector<Failure> &failures)
+	{
+		FILE *file = fopen(path.c_str(), "w");
+		if (!file)
+			return false;
+
+		fprintf(file, "{\n  \"rmeshVersion\": %u,\n  \"meshes\": [", RMESH_VERSION);
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			const CookedMesh &mesh = meshes[i];
+			fprintf(file, "%s\n    { \"source\": ", i ? "," : "");
+			writeJsonString(file, mesh.source);
+			fprintf(file, ", \"output\": ");
+			writeJsonString(file, mesh.output);
+			fprintf(file, ", \"recipe\": %s, \"vertices\": %u, \"indices\": %u, \"indexStride\": %u, \"submeshes\": %u, \"clusters\": %u, \"bytes\": %llu, \"boundsMin\": [%g, %g, %g], \"boundsMax\": [%g, %g, %g]",
+				mesh.hasRecipe ? "true" : "false", mesh.vertexCount, mesh.indexCount, mesh.indexStride, mesh.submeshCount, mesh.clusterCount, static_cast<unsigned long long>(mesh.bytes),
+				mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2], mesh.boundsMax[0], mesh.boundsMax[1], mesh.boundsMax[2]);
+
+			fprintf(file, ", \"lods\": [");
+			for (size_t level = 0; level < mesh.lodTriangles.size(); ++level)
+				fprintf(file, "%s{ \"triangles\": %u, \"error\": %g }", level ? ", " : "", mesh.lodTriangles[level], mesh.lodErrors[level]);
+			fprintf(file, "]");
+
+			fprintf(file, ", \"tangents\": %s, \"generatedNormals\": %llu", mesh.hasTangents ? "true" : "false", static_cast<unsigned long long>(mesh.generatedNormals));
+
+			fprintf(file, ", \"materialLibrary\": ");
+			writeJsonString(file, mesh.materialLibrary);
+			fprintf(file, ", \"materials\": [");
+			for (size_t material = 0; material < mesh.materials.size(); ++material)
+			{
+				fprintf(file, "%s", material ? ", " : "");
+				writeJsonString(file, mesh.materials[material]);
+			}
+			fprintf(file, "]");
+
+			// Analyzer figures before and after the optimizer, as [before, after]
+			const MeshOptimizeReport &report = mesh.optimization;
+			fprintf(file, ", \"acmr\": [%.4f, %.4f], \"atvr\": [%.4f, %.4f], \"overdraw\": [%.4f, %.4f], \"keptInputRanges\": %zu",
+				report.cacheBefore.acmr, report.cacheAfter.acmr, report.cacheBefore.atvr, report.cacheAfter.atvr,
+				report.overdrawBefore.overdraw, report.overdrawAfter.overdraw, report.keptInputRanges);
+
+			const VertexPackingError &error = mesh.packingError;
+			fprintf(file, ", \"packedStride\": %u, \"packedMaxError\": { \"position\": %g, \"positionRelative\": %g, \"normalDegrees\": %g, \"uv\": %g } }",
+				static_cast<unsigned int>(sizeof(DX11UWA::VertexPositionUVNormalPacked)), error.maxPosition, error.maxPositionRelative, error.maxNormalDegrees, error.maxUV);
+		}
+
+		fprintf(file, "\n  ],\n  \"textures\": [");
+		for (size_t i = 0; i < textures.size(); ++i)
+		{
+			const CookedTexture &texture = textures[i];
+			fprintf(file, "%s\n    { \"source\": ", i ? "," : "");
+			writeJsonString(file, texture.source);
+			fprintf(file, ", \"output\": ");
+			writeJsonString(file, texture.output);
+			fprintf(file, ", \"dxgiFormat\": %d, \"dimension\": %u, \"width\": %zu, \"height\": %zu, \"depth\": %zu, \"mips\": %zu, \"arraySize\": %zu, \"cubeMap\": %s, \"bytes\": %llu",
+				static_cast<int>(texture.desc.format), texture.desc.resourceDimension, texture.desc.width, texture.desc.height, texture.desc.depth,
+				texture.desc.mipCount, texture.desc.arraySize, texture.desc.isCubeMap ? "true" : "false", static_cast<unsigned long long>(texture.bytes));
+			fprintf(file, ", \"compressed\": %s", texture.compressed ? "true" : "false");
+			if (texture.compressed)
+				fprintf(file, ", \"psnr\": %.3f, \"encodeMs\": %.1f", texture.psnr, texture.seconds * 1000.0);
+			fprintf(file, " }");
+		}
+
+		fprintf(file, "\n  ],\n  \"failures\": [");
+		for (size_t i = 0; i < failures.size(); ++i)
+		{
+			fprintf(file, "%s\n    { \"source\": ", i ? "," : "");
+			writeJsonString(file, failures[i].source);
+			fprintf(file, ", \"reason\": ");
+			writeJsonString(file, failures[i].reason);
+			fprintf(file, " }");
+		}
+
+		fprintf(file, "\n  ]\n}\n");
+		return fclose(file) == 0;
+	}
+
+	void cookMeshes(const std::string &modelDir, const std::string &outDir, std::vector<CookedMesh> &cooked, std::vector<Failure> &failures)
+	{
+		for (const std::string &name : listFiles(modelDir, ".obj"))
+		{
+			const std::string path = modelDir + "/" + name;
+			const std::string source = baseName(modelDir) + "/" + name;
+			const std::string output = "Models/" + stem(name) + ".rmesh";
+			const MeshRecipe *recipe = findMeshRecipe(stem(name).c_str());
+
+			ObjLoadStats stats = {};
+			ObjLoadOptions options;
+			options.parseThreads = 0;
+			options.optimize = true;
+			options.buildClusters = true;
+			options.buildTangents = true;
+			options.lodCount = MESH_LOD_DEFAULT_COUNT;
+			options.stats = &stats;
+
+			RMesh mesh;
+			const char *error = nullptr;
+			if (!cookMesh(path.c_str(), mesh, options, recipe))
+				error = "can't be loaded as an OBJ";
+			else if (!mesh.Save((outDir + "/" + output).c_str()))
+				error = "can't be written to the output folder";
+
+			if (error)
+			{
+				Failure failure = { source, error };
+				failures.push_back(failure);
+				printf("  %-32s rejected: %s\n", source.c_str(), error);
+				continue;
+			}
+
+			const RMeshHeader &header = mesh.GetHeader();
+			CookedMesh result = {};
+			result.source = source;
+			result.output = output;
+			result.hasRecipe = recipe != nullptr;
+			result.vertexCount = header.vertexCount;
+			result.indexCount = header.indexCount;
+			result.indexStride = header.indexStride;
+			result.submeshCount = header.submeshCount;
+			result.clusterCount = header.clusterCount;
+			result.bytes = header.fileSize;
+			result.hasTangents = mesh.GetTangents() != nullptr;
+			result.generatedNormals = stats.generatedNormalCount;
+			std::copy(header.boundsMin, header.boundsMin + 3, result.boundsMin);
+			std::copy(header.boundsMax, header.boundsMax + 3, result.boundsMax);
+
+			for (uint32_t level = 0; level < mesh.GetLodCount(); ++level)
+			{
+				const MeshLod &lod = mesh.GetLods()[level];
+				uint32_t indices = 0;
+				for (uint32_t i = lod.submeshStart; i < lod.submeshStart + lod.submeshCount; ++i)
+					indices += mesh.GetSubmeshes()[i].indexCount;
+
+				result.lodTriangles.push_back(indices / 3);
+				result.lodErrors.push_back(lod.error);
+			}
+			for (uint32_t i = 0; i < mesh.GetMaterialCount(); ++i)
+			{
+				result.materials.push_back(mesh.GetMaterials()[i].name);
+				if (result.materialLibrary.empty())
+					result.materialLibrary = mesh.GetMaterials()[i].library;
+			}
+			result.optimization = stats.optimization;
+
+			// The renderer packs the vertices when it uploads them, this is what that costs in precision
+			const VertexQuantization quantization = computeVertexQuantization(mesh.GetVertices(), mesh.GetVertexCount());
+			std::vector<DX11UWA::VertexPositionUVNormalPacked> packed(mesh.GetVertexCount());
+			packVertices(mesh.GetVertices(), mesh.GetVertexCount(), quantization, packed.data());
+			result.packingError = measurePackingError(mesh.GetVertices(), packed.data(), mesh.GetVertexCount(), quantization);
+			cooked.push_back(result);
+
+			const MeshOptimizeReport &report = stats.optimization;
+			printf("  %-32s %8u vertices %8u indices (%u bit, %u ranges, %u materials, %u clusters)%s\n", output.c_str(), header.vertexCount, header.indexCount,
+				header.indexStride * 8, header.submeshCount, header.materialCount, header.clusterCount, recipe ? "  (recipe)" : "");
+			printf("  %-32s ACMR %.3f -> %.3f  ATVR %.3f -> %.3f  overdraw %.3f -> %.3f", "", report.cacheBefore.acmr, report.cacheAfter.acmr,
+				report.cacheBefore.atvr, report.cacheAfter.atvr, report.overdrawBefore.overdraw, report.overdrawAfter.overdraw);
+			if (report.keptInputRanges)
+				printf("  (input order kept in %zu ranges)", report.keptInputRanges);
+			printf("\n");
+			printf("  %-32s packed max error: position %.3g (%.4f%% of bounds)  normal %.3f deg  uv %.3g\n", "", result.packingError.maxPosition,
+				result.packingError.maxPositionRelative * 100.0f, result.packingError.maxNormalDegrees, result.packingError.maxUV);
+			for (size_t level = 1; level < result.lodTriangles.size(); ++level)
+				printf("  %-32s LOD %zu: %u triangles, error %.3g\n", "", level, result.lodTriangles[level], result.lodErrors[level]);
+		}
+	}
+
+	bool isOpaque(const std::vector<uint8_t> &rgba)
+	{
+		for (size_t i = 3; i < rgba.size(); i += 4)
+		{
+			if (rgba[i] != 255)
+				return false;
+		}
+		return true;
+	}
+
+	bool isSrgbFormat(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+	}
+
+	// The sRGB twin of a block format, for sources stored as sRGB. BC5 has none.
+	DXGI_FORMAT srgbFormat(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+			return DXGI_FORMAT_BC1_UNORM_SRGB;
+		case DXGI_FORMAT_BC3_UNORM:
+			return DXGI_FORMAT_BC3_UNORM_SRGB;
+		case DXGI_FORMAT_BC7_UNORM:
+			return DXGI_FORMAT_BC7_UNORM_SRGB;
+		default:
+			return format;
+		}
+	}
+
+	// Compresses the slices in rgba to outPath, after reading the file back with the checks DDSTextureLoader
+	// applies. Returns why it failed, or null.
+	const char *compressImage(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height, uint32_t arraySize, bool isCubeMap, bool srgb,
+		const TextureCookOptions &options, const std::string &outPath, CookedTexture &result)
+	{
+		TextureCompressionOptions compression = options.compression;
+		if (options.autoFormat)
+			compression.format = isOpaque(rgba) ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC3_UNORM;
+		if (srgb)
+			compression.format = srgbFormat(compression.format);
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::vector<uint8_t> dds;
+		TextureCompressionStats stats;
+		if (!compressTexture(rgba.data(), width, height, arraySize, isCubeMap, compression, dds, &stats))
+			return "can't be block compressed";
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		const char *error = nullptr;
+		if (!GetDDSDescription(dds.data(), dds.size(), result.desc, &error))
+			return error;
+		if (!writeFile(outPath, dds.data(), dds.size()))
+			return "can't be written to the output folder";
+
+		result.bytes = dds.size();
+		result.compressed = true;
+		result.psnr = stats.psnr;
+		return nullptr;
+	}
+
+	void cookTextures(const std::string &textureDir, const std::string &outDir, const TextureCookOptions &options, std::vector<CookedTexture> &cooked,
+		std::vector<Failure> &failures)
+	{
+		// The images, and the .dds files that aren't made from one of them
+		const std::vector<std::string> images = listFiles(textureDir, ".png");
+		std::vector<std::string> names = images;
+		for (const std::string &name : listFiles(textureDir, ".dds"))
+		{
+			bool replaced = false;
+			for (const std::string &image : images)
+				replaced |= stem(image) == stem(name);
+			if (!replaced)
+				names.push_back(name);
+		}
+		std::sort(names.begin(), names.end());
+
+		for (const std::string &name : names)
+		{
+			const std::string path = textureDir + "/" + name;
+			const std::string source = baseName(textureDir) + "/" + name;
+			const std::string output = "Textures/" + stem(name) + ".dds";
+
+			CookedTexture result = { source, output, DDSDescription(), 0, false, 0.0, 0.0 };
+			const char *error = nullptr;
+
+			if (endsWith(name, ".png"))
+			{
+				std::vector<uint8_t> rgba;
+				uint32_t width, height;
+				if (loadPNG(path.c_str(), rgba, width, height, &error))
+					error = compressImage(rgba, width, height, 1, false, false, options, outDir + "/" + output, result);
+			}
+			else
+			{
+				MappedDDS file;
+				std::vector<uint8_t> rgba;
+
+				// Open sets error itself when the headers are rejected
+				const DDS_OPEN_RESULT opened = file.Open(path.c_str(), &error);
+				if (opened == DDS_OPEN_NO_FILE)
+					error = "can't be opened";
+				else if (opened == DDS_OPEN_OK && readDDSPixels(file, rgba))
+				{
+					const DDSDescription &desc = file.GetDescription();
+					error = compressImage(rgba, static_cast<uint32_t>(desc.width), static_cast<uint32_t>(desc.height), static_cast<uint32_t>(desc.arraySize),
+						desc.isCubeMap, isSrgbFormat(desc.format), options, outDir + "/" + output, result);
+				}
+				else if (opened == DDS_OPEN_OK)
+				{
+					result.desc = file.GetDescription();
+					result.bytes = file.GetSize();
+					if (!writeFile(outDir + "/" + output, file.GetData(), file.GetSize()))
+						error = "can't be written to the output folder";
+				}
+			}
+
+			if (error)
+			{
+				Failure failure = { source, error };
+				failures.push_back(failure);
+				printf("  %-32s rejected: %s\n", source.c_str(), error);
+				continue;
+			}
+			cooked.push_back(result);
+
+			const DDSDescription &desc = result.desc;
+			printf("  %-32s %5zux%-5zu %2zu mips, DXGI format %d%s", output.c_str(), desc.width, desc.height, desc.mipCount,
+				static_cast<int>(desc.format), desc.isCubeMap ? ", cube map" : "");
+			if (result.compressed)
+				printf(", from %s at %s quality: PSNR %.2f dB in %.1f ms", name.c_str(), qualityNames[options.compression.quality], result.psnr, result.seconds * 1000.0);
+			printf("\n");
+		}
+	}
+
+	bool parseFormat(const std::string &name, TextureCookOptions &options)
+	{
+		static const struct { const char *name; DXGI_FORMAT format; } formats[] =
+		{
+			{ "bc1", DXGI_FORMAT_BC1_UNORM }, { "bc3", DXGI_FORMAT_BC3_UNORM }, { "bc5", DXGI_FORMAT_BC5_UNORM }, { "bc7", DXGI_FORMAT_BC7_UNORM }
+		};
+
+		if (name == "auto")
+		{
+			options.autoFormat = true;
+			return true;
+		}
+
+		for (const auto &format : formats)
+		{
+			if (name == format.name)
+			{
+				options.autoFormat = false;
+				options.compression.format = format.format;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool parseQuality(const std::string &name, TextureCookOptions &options)
+	{
+		for (int quality = TEXTURE_QUALITY_FAST; quality <= TEXTURE_QUALITY_HIGH; ++quality)
+		{
+			if (name == qualityNames[quality])
+			{
+				options.compression.quality = static_cast<TextureQuality>(quality);
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::string modelDir = std::string(RAPTURE_ASSET_DIR) + "/Models";
+	std::vector<std::string> textureDirs;
+	std::string outDir = std::string(RAPTURE_ASSET_DIR) + "/Cooked";
+	TextureCookOptions textureOptions;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+		if (i + 1 < argc && argument == "--models")
+			modelDir = argv[++i];
+		else if (i + 1 < argc && argument == "--textures")
+			textureDirs.push_back(argv[++i]);
+		else if (i + 1 < argc && argument == "--out")
+			outDir = argv[++i];
+		else if (i + 1 < argc && argument == "--format" && parseFormat(argv[i + 1], textureOptions))
+			++i;
+		else if (i + 1 < argc && argument == "--quality" && parseQuality(argv[i + 1], textureOptions))
+			++i;
+		else
+		{
+			printf("Usage: %s [--models <dir>] [--textures <dir>]... [--out <dir>] [--format auto|bc1|bc3|bc5|bc7] [--quality fast|normal|high]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (textureDirs.empty())
+	{
+		textureDirs.push_back(std::string(RAPTURE_ASSET_DIR) + "/Textures");
+		textureDirs.push_back(std::string(RAPTURE_ASSET_DIR) + "/Cubemaps");
+	}
+
+	if (!makeDirectory(outDir) || !makeDirectory(outDir + "/Models") || !makeDirectory(outDir + "/Textures"))
+	{
+		printf("Can't create the output folder %s\n", outDir.c_str());
+		return 1;
+	}
+
+	std::vector<CookedMesh> meshes;
+	std::vector<CookedTexture> textures;
+	std::vector<Failure> failures;
+
+	printf("Cooking %s\n", modelDir.c_str());
+	cookMeshes(modelDir, outDir, meshes, failures);
+
+	for (const std::string &textureDir : textureDirs)
+	{
+		printf("Cooking %s\n", textureDir.c_str());
+		cookTextures(textureDir, outDir, textureOptions, textures, failures);
+	}
+
+	if (!writeManifest(outDir + "/manifest.json", meshes, textures, failures))
+	{
+		printf("Can't write %s/manifest.json\n", outDir.c_str());
+		return 1;
+	}
+
+	printf("%zu meshes, %zu textures, %zu failures\n", meshes.size(), textures.size(), failures.size());
+	return failures.empty() ? 0 : 1;
+}
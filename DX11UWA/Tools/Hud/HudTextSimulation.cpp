@@ -0,0 +1,210 @@
+// Drives the frame stats overlay without Direct2D: two HudTexts, like the two DX11UWAMain draws, show the
+// overlay SampleFpsTextRenderer would for scripted frame times, through a backend that only records the quads
+// it's given and the draws it's asked for. Prints each layout and checks that every frame is one draw, that
+// text is only laid out again when it changes and that the quads are where the glyphs go.
+//
+// Usage: HudTextSimulation [--frames <n>] [--quiet]
+// The font is a stand-in with made up advances, since the real one is only measured by DirectWrite.
+
+#include "pch.h"
+#include "FrameStats.h"
+#include "HudText.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const float atlasWidth = 512.0f;
+	const float glyphPadding = 2.0f;
+
+	// The overlay refreshes every 0.25 seconds at 60 frames a second
+	const uint32_t overlayFrames = 15;
+
+	// Keeps the quads it was given like a real backend would, and counts what it was asked to do
+	class RecordingHudBackend : public HudTextBackend
+	{
+	public:
+		RecordingHudBackend(float atlasHeight) : m_atlasHeight(atlasHeight), m_errors(0), m_uploads(0), m_draws(0) {}
+
+		virtual void SetQuads(const HudQuad *quads, uint32_t count) override
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const HudRect &source = quads[i].source, &destination = quads[i].destination;
+				Check(source.left >= 0.0f && source.top >= 0.0f && source.right <= atlasWidth && source.bottom <= m_atlasHeight,
+					"quad is outside the atlas");
+				Check(std::fabs((destination.right - destination.left) - (source.right - source.left)) < 0.001f &&
+					std::fabs((destination.bottom - destination.top) - (source.bottom - source.top)) < 0.001f, "quad is scaled");
+			}
+
+			m_quads.assign(quads, quads + count);
+			++m_uploads;
+		}
+
+		virtual void Draw(float /*x*/, float /*y*/) override
+		{
+			++m_draws;
+		}
+
+		void Check(bool condition, const char *what)
+		{
+			if (!condition)
+			{
+				printf("  error: %s\n", what);
+				++m_errors;
+			}
+		}
+
+		std::vector<HudQuad>	m_quads;
+		float					m_atlasHeight;
+		int						m_errors;
+		size_t					m_uploads;
+		size_t					m_draws;
+	};
+
+	// Roughly the proportions of a 16 pt proportional font
+	void standInFont(HudFont &font)
+	{
+		memset(&font, 0, sizeof(font));
+		font.lineHeight = 21.3f;
+		for (uint32_t i = 0; i < HUD_GLYPH_COUNT; ++i)
+		{
+			const char c = static_cast<char>(HUD_FIRST_GLYPH + i);
+			if (c >= '0' && c <= '9')
+				font.glyphs[i].advance = 8.1f;
+			else if (c >= 'a' && c <= 'z')
+				font.glyphs[i].advance = (c == 'i' || c == 'l') ? 3.4f : ((c == 'm' || c == 'w') ? 11.2f : 7.3f);
+			else if (c >= 'A' && c <= 'Z')
+				font.glyphs[i].advance = 9.6f;
+			else
+				font.glyphs[i].advance = 4.2f;
+		}
+	}
+
+	// Mostly 60 Hz, a little slower every 7th frame, with a hitch every 50th for the first half of the run
+	// and none after, so the numbers shown settle down
+	float scriptedFrameMilliseconds(uint32_t frame, uint32_t frameCount)
+	{
+		if (frame < frameCount / 2 && frame % 50 == 49)
+			return 33.3f;
+		return (frame % 7 == 6) ? 17.1f : 16.7f;
+	}
+
+	// Where each line's glyphs have to end up, worked out from the advances alone
+	void checkLayout(RecordingHudBackend &backend, const HudFont &font, const HudText &text)
+	{
+		const char *c = text.GetText().c_str();
+		size_t quad = 0;
+		uint32_t line = 0;
+		while (*c)
+		{
+			const char *end = strchr(c, '\n');
+			if (!end)
+				end = c + strlen(c);
+
+			float lineWidth = 0.0f;
+			for (const char *glyph = c; glyph < end; ++glyph)
+				lineWidth += font.glyphs[*glyph - HUD_FIRST_GLYPH].advance;
+
+			// Right aligned, so each line starts as far from the right edge as it's wide
+			float x = text.GetWidth() - lineWidth;
+			for (const char *glyph = c; glyph < end; x += font.glyphs[*glyph - HUD_FIRST_GLYPH].advance, ++glyph)
+			{
+				if (*glyph == ' ')
+					continue;
+
+				const HudGlyph &expected = font.glyphs[*glyph - HUD_FIRST_GLYPH];
+				const bool placed = quad < backend.m_quads.size() &&
+					std::fabs(backend.m_quads[quad].destination.left + expected.originX - x) < 0.001f &&
+					backend.m_quads[quad].destination.top == line * font.lineHeight &&
+					backend.m_quads[quad].source.left == expected.source.left && backend.m_quads[quad].source.top == expected.source.top;
+				backend.Check(placed, "glyph isn't where it goes");
+				++quad;
+			}
+
+			c = *end ? end + 1 : end;
+			++line;
+		}
+
+		backend.Check(quad == backend.m_quads.size(), "quads for glyphs that aren't drawn");
+		backend.Check(text.GetHeight() == line * font.lineHeight, "height isn't the lines'");
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t frameCount = 2400;
+	bool quiet = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frameCount = static_cast<uint32_t>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--quiet") == 0)
+			quiet = true;
+		else
+		{
+			fprintf(stderr, "Usage: %s [--frames <n>] [--quiet]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	HudFont font;
+	standInFont(font);
+	const float atlasHeight = packHudGlyphs(font, atlasWidth, glyphPadding);
+	printf("atlas %.0fx%.0f DIPs for %u glyphs\n\n", atlasWidth, atlasHeight, HUD_GLYPH_COUNT);
+
+	RecordingHudBackend backends[2] = { RecordingHudBackend(atlasHeight), RecordingHudBackend(atlasHeight) };
+	HudText text(backends[0], font, HUD_ALIGN_RIGHT);
+	HudText text2(backends[1], font, HUD_ALIGN_RIGHT);
+
+	FrameStats stats;
+	stats.SetHitchThreshold(FRAME_STAT_PRESENT, 25.0f);
+
+	size_t refreshes = 0, changes = 0;
+	char overlay[256] = "";
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		stats.Record(FRAME_STAT_UPDATE, 0.25f);
+		stats.Record(FRAME_STAT_RENDER, 1.5f);
+		stats.Record(FRAME_STAT_PRESENT, scriptedFrameMilliseconds(frame, frameCount));
+
+		if (frame % overlayFrames == 0)
+		{
+			char next[256];
+			formatFrameStats(stats, next, sizeof(next));
+			changes += (strcmp(next, overlay) != 0) ? 1 : 0;
+			strcpy(overlay, next);
+			++refreshes;
+
+			if (text.SetText(overlay))
+			{
+				checkLayout(backends[0], font, text);
+				if (!quiet)
+					printf("frame %4u  %u quads, %.1fx%.1f\n%s\n\n", frame, text.GetQuadCount(), text.GetWidth(), text.GetHeight(), overlay);
+			}
+			text2.SetText(overlay);
+		}
+
+		text.Draw(0.0f, 0.0f);
+		text2.Draw(0.0f, 0.0f);
+	}
+
+	int errors = 0;
+	for (RecordingHudBackend &backend : backends)
+	{
+		backend.Check(backend.m_draws == frameCount, "not one draw a frame");
+		backend.Check(backend.m_uploads == changes, "quads uploaded when the text didn't change, or not when it did");
+		errors += backend.m_errors;
+	}
+
+	printf("%u frames, %zu overlay refreshes, %u layouts and %zu uploads of each text, %zu draws of each\n", frameCount, refreshes,
+		text.GetLayoutCount(), backends[0].m_uploads, backends[0].m_draws);
+
+	if (errors)
+		printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,283 @@
+// Builds, lists and unpacks .rpak asset packs (see AssetPack.h).
+//
+// Usage:
+//   AssetPacker pack <out.rpak> [--threads <n>] [--ext <.ext>]... [--store <.ext>]... [--root <dir>] <path>...
+//   AssetPacker list <pack.rpak>
+//   AssetPacker extract <pack.rpak> <name> <out file>
+//
+// pack adds every path, a file or a folder searched recursively, under its path relative to the last --root
+// before it (the current folder by default), which is what the app looks it up by. Files in folders are only
+// added when their extension is one of the --ext ones, if any are given. Entries are compressed unless their
+// extension is one of the --store ones or compressing them saves too little. "pack" alone packs the
+// repository's models, textures and cooked meshes into Assets/Cooked/Assets.rpak, which the app mounts.
+
+#include "pch.h"
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	const double megabyte = 1024.0 * 1024.0;
+
+	bool endsWith(const std::string &text, const std::string &suffix)
+	{
+		if (text.size() < suffix.size())
+			return false;
+
+		// Extensions are matched case insensitively
+		for (size_t i = 0; i < suffix.size(); ++i)
+		{
+			if (tolower(static_cast<unsigned char>(text[text.size() - suffix.size() + i])) != tolower(static_cast<unsigned char>(suffix[i])))
+				return false;
+		}
+
+		return true;
+	}
+
+	bool hasExtension(const std::string &name, const std::vector<std::string> &extensions)
+	{
+		for (const std::string &extension : extensions)
+		{
+			if (endsWith(name, extension))
+				return true;
+		}
+		return false;
+	}
+
+	bool isDirectory(const std::string &path)
+	{
+#if defined(_WIN32)
+		const DWORD attributes = GetFileAttributesA(path.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+	}
+
+	// Paths relative to root of the files in the folder relative, and in its subfolders
+	void listFilesRecursive(const std::string &root, const std::string &relative, std::vector<std::string> &out)
+	{
+		std::vector<std::string> names;
+
+#if defined(_WIN32)
+		WIN32_FIND_DATAA found;
+		HANDLE search = FindFirstFileA((root + "\\" + relative + "\\*").c_str(), &found);
+		if (search != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if (strcmp(found.cFileName, ".") != 0 && strcmp(found.cFileName, "..") != 0)
+					names.push_back(found.cFileName);
+			} while (FindNextFileA(search, &found));
+
+			FindClose(search);
+		}
+#else
+		DIR *dir = opendir((root + "/" + relative).c_str());
+		if (dir)
+		{
+			while (dirent *entry = readdir(dir))
+			{
+				if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+					names.push_back(entry->d_name);
+			}
+
+			closedir(dir);
+		}
+#endif
+
+		// Sorted so the pack doesn't depend on the file system
+		std::sort(names.begin(), names.end());
+
+		for (const std::string &name : names)
+		{
+			const std::string path = relative + "/" + name;
+			if (isDirectory(root + "/" + path))
+				listFilesRecursive(root, path, out);
+			else
+				out.push_back(path);
+		}
+	}
+
+	int pack(const std::string &outPath, const std::vector<std::string> &arguments)
+	{
+		std::string root = ".";
+		std::vector<std::string> extensions;
+		std::vector<std::string> storedExtensions;
+		unsigned int threadCount = 0;
+		AssetPackBuilder builder;
+		int failures = 0;
+
+		auto add = [&](const std::string &name)
+		{
+			const std::string path = root + "/" + name;
+			if (!builder.AddFile(name.c_str(), path.c_str(), !hasExtension(name, storedExtensions)))
+			{
+				printf("Can't add %s, it doesn't exist or is already in the pack\n", path.c_str());
+				++failures;
+			}
+		};
+
+		for (size_t i = 0; i < arguments.size(); ++i)
+		{
+			const std::string &argument = arguments[i];
+			if (i + 1 < arguments.size() && argument == "--root")
+				root = arguments[++i];
+			else if (i + 1 < arguments.size() && argument == "--ext")
+				extensions.push_back(arguments[++i]);
+			else if (i + 1 < arguments.size() && argument == "--store")
+				storedExtensions.push_back(arguments[++i]);
+			else if (i + 1 < arguments.size() && argument == "--threads")
+				threadCount = static_cast<unsigned int>(atoi(arguments[++i].c_str()));
+			else if (isDirectory(root + "/" + argument))
+			{
+				std::vector<std::string> files;
+				listFilesRecursive(root, argument, files);
+				for (const std::string &file : files)
+				{
+					if (extensions.empty() || hasExtension(file, extensions))
+						add(file);
+				}
+			}
+			else
+				add(argument);
+		}
+
+		const Clock::time_point start = Clock::now();
+		std::string error;
+		if (!builder.Write(outPath.c_str(), threadCount, &error))
+		{
+			printf("Can't write %s: %s\n", outPath.c_str(), error.c_str());
+			return 1;
+		}
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		AssetPack written;
+		if (!written.Open(outPath.c_str()))
+		{
+			printf("%s was written but can't be read back\n", outPath.c_str());
+			return 1;
+		}
+
+		uint64_t size = 0, storedSize = 0;
+		uint32_t compressed = 0;
+		for (uint32_t i = 0; i < written.GetEntryCount(); ++i)
+		{
+			size += written.GetEntry(i).size;
+			storedSize += written.GetEntry(i).storedSize;
+			compressed += (written.GetEntry(i).compression == ASSET_PACK_LZ) ? 1 : 0;
+		}
+
+		FileStamp stamp = {};
+		getFileStamp(outPath.c_str(), stamp);
+
+		printf("Packed %u files (%u compressed) into %s in %.2f s: %.2f MB of assets, %.2f MB stored, %.2f MB pack\n", written.GetEntryCount(), compressed,
+			outPath.c_str(), seconds, size / megabyte, storedSize / megabyte, stamp.size / megabyte);
+		return failures ? 1 : 0;
+	}
+
+	int list(const std::string &packPath)
+	{
+		AssetPack assets;
+		if (!assets.Open(packPath.c_str()))
+		{
+			printf("Can't open %s\n", packPath.c_str());
+			return 1;
+		}
+
+		printf("%-48s %12s %12s %8s %12s\n", "name", "size", "stored", "ratio", "offset");
+		for (uint32_t i = 0; i < assets.GetEntryCount(); ++i)
+		{
+			const AssetPackEntry &entry = assets.GetEntry(i);
+			printf("%-48s %12llu %12llu %7.1f%% %12llu%s\n", assets.GetName(entry), static_cast<unsigned long long>(entry.size),
+				static_cast<unsigned long long>(entry.storedSize), entry.size ? 100.0 * entry.storedSize / entry.size : 100.0,
+				static_cast<unsigned long long>(entry.offset), (entry.compression == ASSET_PACK_LZ) ? "  lz" : "");
+		}
+
+		return 0;
+	}
+
+	int extract(const std::string &packPath, const std::string &name, const std::string &outPath)
+	{
+		AssetPack assets;
+		if (!assets.Open(packPath.c_str()))
+		{
+			printf("Can't open %s\n", packPath.c_str());
+			return 1;
+		}
+
+		const AssetPackEntry *entry = assets.Find(name.c_str());
+		if (!entry)
+		{
+			printf("%s has no %s\n", packPath.c_str(), name.c_str());
+			return 1;
+		}
+
+		FILE *file = fopen(outPath.c_str(), "wb");
+		if (!file)
+		{
+			printf("Can't write %s\n", outPath.c_str());
+			return 1;
+		}
+
+		// Written a batch at a time, so entries of any size only need a few blocks of memory
+		AssetPackStream stream(assets, *entry);
+		const uint8_t *data;
+		size_t size;
+		bool written = true;
+		while (written && stream.Next(data, size))
+			written = fwrite(data, 1, size, file) == size;
+
+		if (fclose(file) != 0 || !written || stream.Failed())
+		{
+			printf("Can't extract %s from %s\n", name.c_str(), packPath.c_str());
+			remove(outPath.c_str());
+			return 1;
+		}
+
+		return 0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const std::string command = (argc > 1) ? argv[1] : "";
+	std::vector<std::string> arguments(argv + std::min(argc, 3), argv + argc);
+
+	if (command == "pack" && argc == 2)
+	{
+		const std::string assets = RAPTURE_ASSET_DIR;
+
+		// Named as the app opens them, relative to its installed folder
+		const char *defaults[] = { "--root", RAPTURE_ASSET_DIR "/..", "--ext", ".obj", "--ext", ".mtl", "--ext", ".dds", "--ext", ".rmesh",
+			"Assets/Models", "Assets/Textures", "Assets/Cubemaps", "Assets/Cooked/Models" };
+		return pack(assets + "/Cooked/Assets.rpak", std::vector<std::string>(defaults, defaults + sizeof(defaults) / sizeof(defaults[0])));
+	}
+	if (command == "pack")
+		return pack(argv[2], arguments);
+	if (command == "list" && argc == 3)
+		return list(argv[2]);
+	if (command == "extract" && argc == 5)
+		return extract(argv[2], argv[3], argv[4]);
+
+	printf("Usage:\n");
+	printf("  %s pack <out.rpak> [--threads <n>] [--ext <.ext>]... [--store <.ext>]... [--root <dir>] <path>...\n", argv[0]);
+	printf("  %s list <pack.rpak>\n", argv[0]);
+	printf("  %s extract <pack.rpak> <name> <out file>\n", argv[0]);
+	return 2;
+}
@@ -0,0 +1,273 @@
+// Drives TextureStreamer without Direct3D, through a backend that only records the uploads and evictions it's
+// asked for, while scripted objects move toward and away from the camera. Prints what was streamed each frame
+// and checks that the backend and the streamer agree on what's resident and that the budget was kept.
+//
+// Usage: TextureStreamingSimulation [--budget <MB>] [--frames <n>] [--quiet] [file.dds ...]
+// With no files it writes stand-in textures to the current folder first: a 2048x2048 BC1 texture with every
+// mip, a 1024x1024 RGBA one and a 512x512 cube map, since the large textures the app uses aren't checked in.
+
+#include "pch.h"
+#include "TextureStreaming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const double megabyte = 1024.0 * 1024.0;
+
+	// Keeps the first resident mip of every texture like a real backend would, and the log of what it did
+	class RecordingTextureBackend : public TextureStreamingBackend
+	{
+	public:
+		struct Event
+		{
+			char				kind;		// 'u'pload, 'e'viction or 'r'emoval
+			StreamedTextureId	texture;
+			uint32_t			firstMip;
+			uint32_t			previousFirstMip;
+		};
+
+		RecordingTextureBackend(void) : m_errors(0), m_uploads(0), m_evictions(0), m_uploadedBytes(0) {}
+
+		virtual bool UploadMips(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip, uint32_t previousFirstMip) override
+		{
+			// A texture that was just added has no mips yet
+			if (texture >= m_firstMips.size())
+				m_firstMips.resize(texture + 1, 0);
+			if (previousFirstMip == source.GetDescription().mipCount)
+				m_firstMips[texture] = previousFirstMip;
+
+			Check(m_firstMips[texture] == previousFirstMip && firstMip < previousFirstMip, "upload doesn't extend the resident mips");
+			for (uint32_t mip = firstMip; mip < previousFirstMip; ++mip)
+				m_uploadedBytes += textureMipBytes(source.GetDescription(), mip);
+
+			m_firstMips[texture] = firstMip;
+			Event event = { 'u', texture, firstMip, previousFirstMip };
+			m_events.push_back(event);
+			++m_uploads;
+			return true;
+		}
+
+		virtual void EvictMips(StreamedTextureId texture, const MappedDDS &source, uint32_t firstMip, uint32_t previousFirstMip) override
+		{
+			Check(texture < m_firstMips.size() && m_firstMips[texture] == previousFirstMip && firstMip > previousFirstMip &&
+				firstMip < source.GetDescription().mipCount, "eviction doesn't shrink the resident mips");
+
+			m_firstMips[texture] = firstMip;
+			Event event = { 'e', texture, firstMip, previousFirstMip };
+			m_events.push_back(event);
+			++m_evictions;
+		}
+
+		virtual void RemoveTexture(StreamedTextureId texture) override
+		{
+			Event event = { 'r', texture, 0, 0 };
+			m_events.push_back(event);
+		}
+
+		void Check(bool condition, const char *what)
+		{
+			if (!condition)
+			{
+				printf("  error: %s\n", what);
+				++m_errors;
+			}
+		}
+
+		uint32_t GetFirstMip(StreamedTextureId texture) const { return m_firstMips[texture]; }
+
+		std::vector<Event>		m_events;		// Since the last frame was printed
+		int						m_errors;
+		size_t					m_uploads;
+		size_t					m_evictions;
+		uint64_t				m_uploadedBytes;
+
+	private:
+		std::vector<uint32_t>	m_firstMips;
+	};
+
+	// Writes a DDS file of zeroes with a DX10 header and every mip
+	bool writeStandInDDS(const std::string &path, DXGI_FORMAT format, uint32_t size, bool cubeMap)
+	{
+		uint32_t mipCount = 1;
+		while ((size >> mipCount) > 0)
+			++mipCount;
+
+		DDS_HEADER header = {};
+		header.size = sizeof(DDS_HEADER);
+		header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
+		header.width = size;
+		header.height = size;
+		header.mipMapCount = mipCount;
+		header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+		header.ddspf.flags = DDS_FOURCC;
+		header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+		header.caps = DDS_SURFACE_FLAGS_TEXTURE | DDS_SURFACE_FLAGS_MIPMAP;
+
+		DDS_HEADER_DXT10 extension = {};
+		extension.dxgiFormat = format;
+		extension.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+		extension.miscFlag = cubeMap ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+		extension.arraySize = 1;
+
+		DDSDescription desc = {};
+		desc.width = size;
+		desc.height = size;
+		desc.depth = 1;
+		desc.mipCount = mipCount;
+		desc.arraySize = cubeMap ? 6 : 1;
+		desc.format = format;
+
+		FILE *file = fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+
+		const uint32_t magic = DDS_MAGIC;
+		bool written = fwrite(&magic, sizeof(magic), 1, file) == 1 && fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(&extension, sizeof(extension), 1, file) == 1;
+
+		const std::vector<uint8_t> zeroes(static_cast<size_t>(textureMipBytes(desc, 0)));
+		for (uint32_t mip = 0; written && mip < mipCount; ++mip)
+			written = fwrite(zeroes.data(), 1, static_cast<size_t>(textureMipBytes(desc, mip)), file) == textureMipBytes(desc, mip);
+
+		return (fclose(file) == 0) && written;
+	}
+
+	const char *fileName(const std::string &path)
+	{
+		const char *name = strrchr(path.c_str(), '/');
+		return name ? name + 1 : path.c_str();
+	}
+
+	// How large an object covers on screen over the run. The first one comes close and goes away again, the
+	// second stays at a distance and the third fills the screen like a sky box, but is hidden for a while.
+	float scriptedScreenPixels(size_t object, uint32_t frame, uint32_t frameCount)
+	{
+		const float t = static_cast<float>(frame) / frameCount;
+		switch (object % 3)
+		{
+		case 0:
+			return 2400.0f * sinf(3.14159265f * t) + 16.0f;
+		case 1:
+			return 300.0f;
+		default:
+			return (t > 0.4f && t < 0.7f) ? 0.0f : 1080.0f;
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> paths;
+	TextureStreamingOptions options;
+	options.budgetBytes = 8 * 1024 * 1024;
+	options.uploadBytesPerUpdate = 1024 * 1024;
+	uint32_t frameCount = 240;
+	bool quiet = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+			options.budgetBytes = static_cast<uint64_t>(atof(argv[++i]) * megabyte);
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frameCount = static_cast<uint32_t>(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--quiet") == 0)
+			quiet = true;
+		else
+			paths.push_back(argv[i]);
+	}
+
+	if (paths.empty())
+	{
+		paths.push_back("StandIn_2048_BC1.dds");
+		paths.push_back("StandIn_1024_RGBA.dds");
+		paths.push_back("StandIn_512_Cube.dds");
+		if (!writeStandInDDS(paths[0], DXGI_FORMAT_BC1_UNORM, 2048, false) || !writeStandInDDS(paths[1], DXGI_FORMAT_R8G8B8A8_UNORM, 1024, false) ||
+			!writeStandInDDS(paths[2], DXGI_FORMAT_R8G8B8A8_UNORM, 512, true))
+		{
+			printf("Can't write the stand-in textures to the current folder\n");
+			return 1;
+		}
+	}
+
+	RecordingTextureBackend backend;
+	int errors = 0;
+	{
+		TextureStreamer streamer(backend, options);
+
+		std::vector<StreamedTextureId> textures;
+		for (const std::string &path : paths)
+		{
+			const StreamedTextureId texture = streamer.AddTexture(path.c_str());
+			if (texture == INVALID_STREAMED_TEXTURE)
+			{
+				printf("Can't stream %s\n", path.c_str());
+				return 1;
+			}
+
+			const DDSDescription &desc = streamer.GetDescription(texture);
+			printf("texture %u: %s, %zux%zu, %zu mips, %.2f MB, starts with mip %u resident\n", texture, fileName(path), desc.width, desc.height,
+				desc.mipCount, textureResidentBytes(desc, 0) / megabyte, streamer.GetFirstResidentMip(texture));
+			textures.push_back(texture);
+		}
+
+		// The mips every texture always keeps, which may go over the budget
+		uint64_t minimumBytes = 0;
+		for (StreamedTextureId texture : textures)
+			minimumBytes += textureResidentBytes(streamer.GetDescription(texture), streamer.GetFirstResidentMip(texture));
+
+		printf("budget %.2f MB, %.2f MB uploaded per frame at most, %u frames, the budget halves at frame %u\n\n", options.budgetBytes / megabyte,
+			options.uploadBytesPerUpdate / megabyte, frameCount, frameCount * 3 / 4);
+		backend.m_events.clear();
+
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			if (frame == frameCount * 3 / 4)
+				streamer.SetBudget(streamer.GetBudget() / 2);
+
+			for (size_t object = 0; object < textures.size(); ++object)
+			{
+				const float pixels = scriptedScreenPixels(object, frame, frameCount);
+				if (pixels > 0.0f)
+					streamer.RequestTexture(textures[object], pixels);
+			}
+
+			streamer.Update();
+
+			// What the backend was told has to add up to what the streamer thinks is resident
+			uint64_t residentBytes = 0;
+			for (StreamedTextureId texture : textures)
+			{
+				backend.Check(backend.GetFirstMip(texture) == streamer.GetFirstResidentMip(texture), "backend and streamer disagree on the resident mips");
+				residentBytes += textureResidentBytes(streamer.GetDescription(texture), streamer.GetFirstResidentMip(texture));
+			}
+			backend.Check(residentBytes == streamer.GetResidentBytes(), "resident bytes are miscounted");
+			backend.Check(residentBytes <= std::max(streamer.GetBudget(), minimumBytes), "over budget");
+
+			if (!backend.m_events.empty() && !quiet)
+			{
+				printf("frame %4u  %7.2f MB resident ", frame, streamer.GetResidentBytes() / megabyte);
+				for (const RecordingTextureBackend::Event &event : backend.m_events)
+					printf(" %s%u:%u", (event.kind == 'u') ? "+" : "-", event.texture, event.firstMip);
+				printf("  wanted");
+				for (StreamedTextureId texture : textures)
+					printf(" %u", streamer.GetWantedMip(texture));
+				printf("\n");
+			}
+			backend.m_events.clear();
+		}
+
+		printf("\n%zu uploads (%.2f MB), %zu evictions, %.2f MB resident at the end\n", backend.m_uploads, backend.m_uploadedBytes / megabyte,
+			backend.m_evictions, streamer.GetResidentBytes() / megabyte);
+		errors = backend.m_errors;
+	}
+
+	if (errors)
+		printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}